@@ -0,0 +1,36 @@
+#.rst:
+# FindZstd
+# --------
+#
+# Find the Zstandard compression library.
+#
+# ::
+#
+#   ZSTD_INCLUDE_DIRS   - where to find zstd.h.
+#   ZSTD_LIBRARIES      - List of libraries when using zstd.
+#   ZSTD_FOUND          - True if zstd found.
+#   ZSTD_VERSION_STRING - the version of zstd found.
+
+find_path(ZSTD_INCLUDE_DIR NAMES zstd.h)
+mark_as_advanced(ZSTD_INCLUDE_DIR)
+
+find_library(ZSTD_LIBRARY NAMES zstd zstd_static libzstd)
+mark_as_advanced(ZSTD_LIBRARY)
+
+if(ZSTD_INCLUDE_DIR AND EXISTS "${ZSTD_INCLUDE_DIR}/zstd.h")
+  file(STRINGS "${ZSTD_INCLUDE_DIR}/zstd.h" zstd_version_str
+       REGEX "^#define[\t ]+ZSTD_VERSION_(MAJOR|MINOR|RELEASE)[\t ]+[0-9]+")
+  string(REGEX REPLACE ".*MAJOR[\t ]+([0-9]+).*MINOR[\t ]+([0-9]+).*RELEASE[\t ]+([0-9]+).*"
+         "\\1.\\2.\\3" ZSTD_VERSION_STRING "${zstd_version_str}")
+  unset(zstd_version_str)
+endif()
+
+include(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(Zstd
+                                  REQUIRED_VARS ZSTD_LIBRARY ZSTD_INCLUDE_DIR
+                                  VERSION_VAR ZSTD_VERSION_STRING)
+
+if(ZSTD_FOUND)
+  set(ZSTD_LIBRARIES ${ZSTD_LIBRARY})
+  set(ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR})
+endif()
@@ -11,17 +11,28 @@
 #include <entwine/reader/cache.hpp>
 
 #include <cassert>
+#include <cstdint>
+#include <functional>
+#include <set>
 
 #include <entwine/reader/chunk-reader.hpp>
 #include <entwine/reader/reader.hpp>
 #include <entwine/types/metadata.hpp>
 #include <entwine/types/schema.hpp>
-#include <entwine/util/pool.hpp>
+#include <entwine/types/storage.hpp>
+#include <entwine/util/async-io.hpp>
 #include <entwine/util/unique.hpp>
 
 namespace entwine
 {
 
+namespace
+{
+    LockSite hierarchySite("cache-hierarchy");
+
+    const std::size_t shardCount(16);
+}
+
 FetchInfo::FetchInfo(
         const Reader& reader,
         const Id& id,
@@ -45,9 +56,11 @@ bool FetchInfo::operator<(const FetchInfo& other) const
 Block::Block(
         Cache& cache,
         const std::string& readerPath,
-        const FetchInfoSet& fetches)
+        const FetchInfoSet& fetches,
+        const Projection* projection)
     : m_cache(cache)
     , m_readerPath(readerPath)
+    , m_projection(projection)
     , m_chunkMap()
 {
     for (const auto& fetch : fetches)
@@ -73,174 +86,466 @@ DataChunkState::~DataChunkState() { }
 
 
 
-Cache::Cache(const std::size_t maxBytes)
+Cache::Cache(
+        const std::size_t maxBytes,
+        const std::size_t fetchThreads,
+        const EvictionType eviction,
+        const std::size_t diskBytes)
     : m_maxBytes(std::max<std::size_t>(maxBytes, 1024 * 1024 * 16))
     , m_maxHierarchyBytes(m_maxBytes / 8)
-{ }
+    , m_eviction(eviction)
+    , m_diskBytes(diskBytes)
+    , m_activeBytes(0)
+    , m_shards(shardCount)
+    , m_fetchPool(fetchThreads)
+{
+    for (CacheShard& shard : m_shards)
+    {
+        shard.policy = EvictionPolicy::create(m_eviction);
+    }
+}
 
-void Cache::release(const Reader& reader)
+CacheStats Cache::stats(const std::string& readerPath) const
+{
+    CacheStats result;
+
+    for (const CacheShard& shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        const auto it(shard.stats.find(readerPath));
+        if (it == shard.stats.end()) continue;
+
+        result.hits += it->second.hits;
+        result.misses += it->second.misses;
+        result.evictions += it->second.evictions;
+    }
+
+    return result;
+}
+
+std::vector<std::size_t> Cache::shardBytes() const
 {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    if (!m_chunkManager.count(reader.path())) return;
-    LocalManager& localManager(m_chunkManager.at(reader.path()));
+    // Lock every shard at once, since chunks move between the active total
+    // and their shard under its lock.
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (const CacheShard& shard : m_shards) locks.emplace_back(shard.mutex);
+
+    std::vector<std::size_t> result;
+    for (const CacheShard& shard : m_shards) result.push_back(shard.bytes);
+    return result;
+}
 
-    auto it(m_inactiveList.begin());
+CacheShard& Cache::shard(const std::string& readerPath, const ChunkKey& key)
+{
+    const std::size_t h(
+            std::hash<std::string>()(readerPath) * 31 +
+            std::hash<Id>()(key.first) * 7 +
+            std::hash<const Projection*>()(key.second));
+
+    // Remix, since the hashes of similar Ids differ only in their low bits.
+    const uint64_t mixed(static_cast<uint64_t>(h) * 0x9e3779b97f4a7c15ULL);
+    return m_shards[(mixed >> 32) % m_shards.size()];
+}
+
+void Cache::notify()
+{
+    // Taking the lock orders this with a reservation about to wait.
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    m_cv.notify_all();
+}
 
-    while (it != m_inactiveList.end())
+void Cache::release(const Reader& reader)
+{
     {
-        if (it->path == reader.path())
+        std::unique_lock<std::mutex> lock(m_prefetchMutex);
+        m_prefetchCv.wait(lock, [this, &reader]()
         {
-            m_activeBytes -= localManager.at(it->id)->chunkReader->size();
-            localManager.erase(it->id);
-            it = m_inactiveList.erase(it);
-        }
-        else
+            return !m_prefetching.count(reader.path());
+        });
+    }
+
+    for (CacheShard& shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto managerIt(shard.chunkManager.find(reader.path()));
+        if (managerIt == shard.chunkManager.end()) continue;
+        LocalManager& localManager(managerIt->second);
+
+        auto it(localManager.begin());
+
+        while (it != localManager.end())
         {
-            ++it;
+            if (it->second->inactive)
+            {
+                shard.policy->drop(GlobalChunkInfo(reader.path(), it->first));
+
+                const std::size_t size(it->second->chunkReader->size());
+                shard.bytes -= size;
+                m_activeBytes -= size;
+
+                it = localManager.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
         }
-    }
 
-    assert(localManager.empty());
-    m_chunkManager.erase(reader.path());
+        assert(localManager.empty());
+        shard.chunkManager.erase(managerIt);
+    }
 
-    lock.unlock();
-    m_cv.notify_all();
+    notify();
 }
 
 std::unique_ptr<Block> Cache::acquire(
         const std::string& readerPath,
-        const FetchInfoSet& fetches)
+        const FetchInfoSet& fetches,
+        const Projection* projection)
 {
-    std::unique_ptr<Block> block(reserve(readerPath, fetches));
+    return acquireAsync(readerPath, fetches, projection)->get();
+}
 
-    bool success(true);
-    std::mutex mutex;
-    Pool pool(std::min<std::size_t>(2, fetches.size()));
+std::unique_ptr<PendingBlock> Cache::acquireAsync(
+        const std::string& readerPath,
+        const FetchInfoSet& fetches,
+        const Projection* projection,
+        const bool wait)
+{
+    Fresh fresh;
+    Pending pending;
+    std::unique_ptr<Block> block(
+            reserve(readerPath, fetches, projection, fresh, pending, wait));
 
-    for (const auto& f : fetches)
+    if (!block) return std::unique_ptr<PendingBlock>();
+
+    std::unique_ptr<Readahead> readahead(
+            submit(readerPath, projection, fresh));
+
+    return std::unique_ptr<PendingBlock>(
+            new PendingBlock(
+                std::move(block),
+                std::move(pending),
+                std::move(readahead)));
+}
+
+struct Cache::Prefetch
+{
+    Prefetch(Cache& cache, std::unique_ptr<Block> block)
+        : cache(cache)
+        , path(block->path())
+        , block(std::move(block))
+    { }
+
+    ~Prefetch()
+    {
+        // Our chunks become inactive, to be evicted as usual.
+        block.reset();
+        readahead.reset();
+
+        std::lock_guard<std::mutex> lock(cache.m_prefetchMutex);
+        if (!--cache.m_prefetching.at(path)) cache.m_prefetching.erase(path);
+        cache.m_prefetchCv.notify_all();
+    }
+
+    Cache& cache;
+    const std::string path;
+    std::unique_ptr<Block> block;
+    std::unique_ptr<Readahead> readahead;
+};
+
+bool Cache::prefetch(
+        const std::string& readerPath,
+        const FetchInfoSet& fetches,
+        const Projection* projection)
+{
+    Fresh fresh;
+    Pending pending;
+    std::unique_ptr<Block> block(
+            reserve(readerPath, fetches, projection, fresh, pending, false));
+
+    if (!block) return false;
+
+    // Anything already held, or being fetched, is released right away.
+    if (fresh.empty()) return true;
+
+    {
+        std::lock_guard<std::mutex> lock(m_prefetchMutex);
+        ++m_prefetching[readerPath];
+    }
+
+    auto hold(std::make_shared<Prefetch>(*this, std::move(block)));
+    hold->readahead = submit(readerPath, projection, fresh, hold);
+    return true;
+}
+
+std::unique_ptr<Readahead> Cache::submit(
+        const std::string& readerPath,
+        const Projection* projection,
+        const Fresh& fresh,
+        std::shared_ptr<Prefetch> hold)
+{
+    if (fresh.empty()) return std::unique_ptr<Readahead>();
+
+    // Put the reads of everything we'll fetch in flight at once, rather than
+    // as each fetch thread gets to it.
+    std::vector<Id> ids;
+    for (const auto& f : fresh) ids.push_back(f.first.id);
+
+    const Reader& reader(fresh.front().first.reader);
+    std::unique_ptr<Readahead> readahead(
+            reader.metadata().storage().readahead(reader.endpoint(), ids));
+
+    for (const auto& f : fresh)
     {
-        pool.add([this, &readerPath, &f, &block, &mutex, &success]()->void
+        const FetchInfo info(f.first);
+        const Promise promise(f.second);
+
+        auto task([this, readerPath, info, projection, promise, hold]()
         {
-            if (const ColdChunkReader* chunkReader = fetch(readerPath, f))
+            try
             {
-                std::lock_guard<std::mutex> lock(mutex);
-                block->set(f.id, chunkReader);
+                promise->set_value(fetch(readerPath, info, projection));
             }
-            else
+            catch (...)
             {
-                success = false;
+                promise->set_exception(std::current_exception());
             }
         });
+
+        m_fetchPool.add(readerPath, std::move(task));
+    }
+
+    return readahead;
+}
+
+PendingBlock::PendingBlock(
+        std::unique_ptr<Block> block,
+        Pending pending,
+        std::unique_ptr<Readahead> readahead)
+    : m_block(std::move(block))
+    , m_pending(std::move(pending))
+    , m_readahead(std::move(readahead))
+    , m_submitted(now())
+{ }
+
+PendingBlock::~PendingBlock()
+{
+    for (const auto& p : m_pending) p.second.wait();
+}
+
+bool PendingBlock::ready() const
+{
+    if (m_ready) return true;
+
+    for (const auto& p : m_pending)
+    {
+        const auto status(p.second.wait_for(std::chrono::seconds(0)));
+        if (status != std::future_status::ready) return false;
+    }
+
+    m_completed = now();
+    m_ready = true;
+    return true;
+}
+
+double PendingBlock::latency() const
+{
+    const TimePoint end(m_ready ? m_completed : now());
+    return std::chrono::duration<double>(end - m_submitted).count();
+}
+
+std::unique_ptr<Block> PendingBlock::get()
+{
+    if (!m_block) throw std::runtime_error("Pending block already taken");
+
+    // Await everything, even after a failure, since our readahead must
+    // outlive the fetches that may take from it.
+    bool success(true);
+
+    for (auto& p : m_pending)
+    {
+        try
+        {
+            m_block->set(p.first, p.second.get());
+        }
+        catch (std::exception& e)
+        {
+            std::cout << "Fetch failed: " << e.what() << std::endl;
+            success = false;
+        }
+        catch (...)
+        {
+            success = false;
+        }
     }
 
-    pool.join();
+    ready();
 
     if (!success)
     {
-        throw std::runtime_error("Invalid remote index state: " + readerPath);
+        const std::string path(m_block->path());
+        m_block.reset();
+        throw std::runtime_error("Invalid remote index state: " + path);
     }
 
-    return block;
+    return std::move(m_block);
 }
 
 void Cache::release(const Block& block)
 {
-    bool notify(false);
     const std::string path(block.path());
-
-    std::unique_lock<std::mutex> lock(m_mutex);
-
-    LocalManager& localManager(m_chunkManager.at(path));
+    std::set<CacheShard*> touched;
 
     for (const auto& c : block.chunkMap())
     {
-        const Id& id(c.first);
+        const ChunkKey key(c.first, block.projection());
+        CacheShard& shard(this->shard(path, key));
+        touched.insert(&shard);
 
-        std::unique_ptr<DataChunkState>& chunkState(localManager.at(id));
+        std::lock_guard<std::mutex> lock(shard.mutex);
 
-        if (chunkState)
-        {
-            if (!--chunkState->refs)
-            {
-                m_inactiveList.push_front(GlobalChunkInfo(path, id));
+        LocalManager& localManager(shard.chunkManager.at(path));
+        std::unique_ptr<DataChunkState>& chunkState(localManager.at(key));
 
-                chunkState->inactiveIt.reset(
-                        new InactiveList::iterator(m_inactiveList.begin()));
+        if (--chunkState->refs) continue;
 
-                notify = true;
-            }
+        if (chunkState->chunkReader)
+        {
+            shard.policy->add(GlobalChunkInfo(path, key));
+            chunkState->inactive = true;
         }
         else
         {
+            // Its fetch failed, so a later reservation will fetch it again.
             std::cout << "Removing a bad fetch" << std::endl;
-            localManager.erase(id);
-            if (localManager.empty()) m_chunkManager.erase(path);
+            localManager.erase(key);
+            if (localManager.empty()) shard.chunkManager.erase(path);
         }
     }
 
-    while (m_activeBytes > m_maxBytes && m_inactiveList.size())
-    {
-        const GlobalChunkInfo& toRemove(m_inactiveList.back());
+    if (m_activeBytes <= m_maxBytes) return;
 
-        LocalManager& localManager(m_chunkManager.at(toRemove.path));
-        m_activeBytes -= localManager.at(toRemove.id)->chunkReader->size();
-        localManager.erase(toRemove.id);
+    bool evicted(false);
 
-        if (localManager.empty()) m_chunkManager.erase(toRemove.path);
+    // Shards over their share of the budget give up chunks first, and then
+    // any shard with inactive chunks, so that we can't remain over budget
+    // while inactive chunks are held elsewhere.
+    for (CacheShard* shard : touched)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        evicted = evict(*shard, true) || evicted;
+    }
+
+    for (std::size_t i(0); i < m_shards.size(); ++i)
+    {
+        if (m_activeBytes <= m_maxBytes) break;
 
-        m_inactiveList.pop_back();
-        notify = true;
+        CacheShard& shard(m_shards[i]);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        evicted = evict(shard, false) || evicted;
     }
 
-    if (notify)
+    if (evicted) notify();
+}
+
+bool Cache::evict(CacheShard& shard, const bool fair)
+{
+    const std::size_t share(m_maxBytes / m_shards.size());
+    bool evicted(false);
+
+    while (
+            m_activeBytes > m_maxBytes &&
+            (!fair || shard.bytes > share) &&
+            !shard.policy->empty())
     {
-        /*
-        std::cout <<
-            "\tData: " << (m_activeBytes / 1024 / 1024) << "MB" <<
-            "\tFetches: " << block.chunkMap().size() <<
-            "\tChunks: " << m_inactiveList.size() << std::endl;
-        */
+        GlobalChunkInfo toRemove;
+        shard.policy->evict(toRemove);
+
+        LocalManager& localManager(shard.chunkManager.at(toRemove.path));
+        const std::size_t size(
+                localManager.at(toRemove.key)->chunkReader->size());
+        shard.bytes -= size;
+        m_activeBytes -= size;
 
-        lock.unlock();
-        m_cv.notify_all();
+        localManager.erase(toRemove.key);
+        if (localManager.empty()) shard.chunkManager.erase(toRemove.path);
+
+        ++shard.stats[toRemove.path].evictions;
+        evicted = true;
     }
+
+    return evicted;
 }
 
 std::unique_ptr<Block> Cache::reserve(
         const std::string& readerPath,
-        const FetchInfoSet& fetches)
+        const FetchInfoSet& fetches,
+        const Projection* projection,
+        Fresh& fresh,
+        Pending& pending,
+        const bool wait)
 {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    m_cv.wait(lock, [this, &fetches]()->bool
+    if (m_activeBytes >= m_maxBytes)
     {
-        return m_activeBytes < m_maxBytes;
-    });
+        if (!wait) return std::unique_ptr<Block>();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]()->bool
+        {
+            return m_activeBytes < m_maxBytes;
+        });
+    }
 
     // Make the Block responsible for these chunks now, so even if something
     // throws during the fetching, we won't hold inactive reservations.
-    std::unique_ptr<Block> block(new Block(*this, readerPath, fetches));
-
-    LocalManager& localManager(m_chunkManager[readerPath]);
+    std::unique_ptr<Block> block(
+            new Block(*this, readerPath, fetches, projection));
 
     // Reserve these fetches:
-    //      - Insert (sans actual data) into the GlobalManager if non-existent
+    //      - Insert (sans actual data) into its shard if non-existent,
+    //        along with the promise of its fetch
     //      - Increment the reference count - may be zero if inactive or new
-    //      - If already existed and inactive, remove from the inactive list
+    //      - If already existed and inactive, take it back from the eviction
+    //        policy
     for (const auto& f : fetches)
     {
-        std::unique_ptr<DataChunkState>& chunkState(localManager[f.id]);
+        const ChunkKey key(f.id, projection);
+        CacheShard& shard(this->shard(readerPath, key));
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        const GlobalChunkInfo info(readerPath, key);
+        shard.policy->touch(info);
+
+        std::unique_ptr<DataChunkState>& chunkState(
+                shard.chunkManager[readerPath][key]);
+        CacheStats& stats(shard.stats[readerPath]);
 
         if (!chunkState)
         {
+            ++stats.misses;
             chunkState.reset(new DataChunkState());
+
+            Promise promise(
+                    std::make_shared<std::promise<const ColdChunkReader*>>());
+            chunkState->fetched = promise->get_future().share();
+            fresh.emplace_back(f, promise);
         }
-        else if (chunkState->inactiveIt)
+        else
         {
-            m_inactiveList.erase(*chunkState->inactiveIt);
-            chunkState->inactiveIt.reset();
+            ++stats.hits;
+
+            if (chunkState->inactive)
+            {
+                shard.policy->hold(info);
+                chunkState->inactive = false;
+            }
         }
 
         ++chunkState->refs;
+        pending.emplace_back(f.id, chunkState->fetched);
     }
 
     return block;
@@ -248,32 +553,34 @@ std::unique_ptr<Block> Cache::reserve(
 
 const ColdChunkReader* Cache::fetch(
         const std::string& readerPath,
-        const FetchInfo& fetchInfo)
+        const FetchInfo& fetchInfo,
+        const Projection* projection)
 {
-    std::unique_lock<std::mutex> globalLock(m_mutex);
-    DataChunkState& chunkState(*m_chunkManager.at(readerPath).at(fetchInfo.id));
-    globalLock.unlock();
+    const Reader& reader(fetchInfo.reader);
 
-    std::lock_guard<std::mutex> lock(chunkState.mutex);
-
-    if (!chunkState.chunkReader)
-    {
-        const Reader& reader(fetchInfo.reader);
-        const Metadata& metadata(reader.metadata());
-        const std::string path(metadata.basename(fetchInfo.id));
-
-        chunkState.chunkReader = makeUnique<ColdChunkReader>(
-                metadata,
+    std::unique_ptr<ColdChunkReader> chunkReader(
+            makeUnique<ColdChunkReader>(
+                reader.metadata(),
                 reader.endpoint(),
                 reader.tmp(),
                 fetchInfo.bounds,
                 reader.pool(),
                 fetchInfo.id,
-                fetchInfo.depth);
+                fetchInfo.depth,
+                projection));
 
-        globalLock.lock();
-        m_activeBytes += chunkState.chunkReader->size();
-    }
+    // Our reservation is still held by whoever awaits this fetch, so the
+    // chunk state remains in place.
+    const ChunkKey key(fetchInfo.id, projection);
+    CacheShard& shard(this->shard(readerPath, key));
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    DataChunkState& chunkState(*shard.chunkManager.at(readerPath).at(key));
+
+    const std::size_t size(chunkReader->size());
+    shard.bytes += size;
+    m_activeBytes += size;
+    chunkState.chunkReader = std::move(chunkReader);
 
     return chunkState.chunkReader.get();
 }
@@ -332,7 +639,7 @@ void Cache::unrefHierarchy(
         const HierarchyReader::Slot* s(order.back());
         order.pop_back();
 
-        SpinGuard spinLock(s->spinner);
+        SpinGuard spinLock(s->spinner, hierarchySite);
         m_hierarchyBytes -= s->t->size();
         s->t.reset();
         slots.erase(s);
@@ -13,22 +13,30 @@
 #include <atomic>
 #include <condition_variable>
 #include <cstddef>
+#include <future>
 #include <list>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include <entwine/reader/eviction.hpp>
+#include <entwine/reader/fetch-pool.hpp>
 #include <entwine/reader/hierarchy-reader.hpp>
 #include <entwine/types/structure.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/util/time.hpp>
 
 namespace entwine
 {
 
 class Cache;
 class ColdChunkReader;
+class Projection;
+class Readahead;
 class Reader;
 class Schema;
 
@@ -52,18 +60,8 @@ typedef std::set<FetchInfo> FetchInfoSet;
 
 
 
-struct GlobalChunkInfo
-{
-    GlobalChunkInfo(const std::string& path, const Id& id)
-        : path(path)
-        , id(id)
-    { }
-
-    std::string path;
-    Id id;
-};
-
-typedef std::list<GlobalChunkInfo> InactiveList;
+// Resolves to the chunk once its fetch completes, or throws if it failed.
+using ChunkFuture = std::shared_future<const ColdChunkReader*>;
 
 
 
@@ -72,11 +70,15 @@ struct DataChunkState
     DataChunkState();
     ~DataChunkState();
 
+    // Set once the fetch completes.
     std::unique_ptr<ColdChunkReader> chunkReader;
-    std::unique_ptr<InactiveList::iterator> inactiveIt;
     std::atomic_size_t refs;
 
-    std::mutex mutex;
+    // True while held by the eviction policy of its shard.
+    bool inactive = false;
+
+    // Every reservation of this chunk awaits the single fetch behind this.
+    ChunkFuture fetched;
 };
 
 using SlotOrder = std::list<const HierarchyReader::Slot*>;
@@ -92,42 +94,135 @@ struct HierarchyCache
 
 
 
-typedef std::map<Id, std::unique_ptr<DataChunkState>> LocalManager;
+typedef std::map<ChunkKey, std::unique_ptr<DataChunkState>> LocalManager;
 typedef std::map<std::string, LocalManager> GlobalManager;
 typedef std::map<Id, const ColdChunkReader*> ChunkMap;
 
+// Counters for the chunks of a single reader path.  Reservations of chunks
+// already held, or already being fetched, are hits.
+struct CacheStats
+{
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+};
+
+// A segment of the chunk cache, selected by a hash of the reader path and
+// chunk key.  Each has its own lock and eviction policy, and a share of the
+// byte budget - see Cache::evict.
+struct CacheShard
+{
+    mutable std::mutex mutex;
+    GlobalManager chunkManager;
+    std::unique_ptr<EvictionPolicy> policy;
+    std::map<std::string, CacheStats> stats;
+    std::size_t bytes = 0;
+};
+
 class Block
 {
     friend class Cache;
+    friend class PendingBlock;
 
 public:
     ~Block();
     const ChunkMap& chunkMap() const { return m_chunkMap; }
     std::string path() const { return m_readerPath; }
+    const Projection* projection() const { return m_projection; }
 
 private:
     Block(
             Cache& cache,
             const std::string& readerPath,
-            const FetchInfoSet& fetches);
+            const FetchInfoSet& fetches,
+            const Projection* projection);
 
     void set(const Id& id, const ColdChunkReader* chunkReader);
 
     Cache& m_cache;
     std::string m_readerPath;
+    const Projection* m_projection;
     ChunkMap m_chunkMap;
 };
 
+// A block whose chunks are reserved and whose fetches are in flight.
+class PendingBlock
+{
+    friend class Cache;
+
+public:
+    using Pending = std::vector<std::pair<Id, ChunkFuture>>;
+
+    // Awaits any fetches still in flight, since they may take from our
+    // readahead.
+    ~PendingBlock();
+
+    // True once every fetch has completed, so get() won't wait.
+    bool ready() const;
+
+    // Await the fetches, throwing if any failed.  Call at most once.
+    std::unique_ptr<Block> get();
+
+    // Seconds from submission until the fetches were first seen to be
+    // complete, by ready() or get().
+    double latency() const;
+
+private:
+    PendingBlock(
+            std::unique_ptr<Block> block,
+            Pending pending,
+            std::unique_ptr<Readahead> readahead);
+
+    std::unique_ptr<Block> m_block;
+    Pending m_pending;
+    std::unique_ptr<Readahead> m_readahead;
+
+    const TimePoint m_submitted;
+    mutable TimePoint m_completed;
+    mutable bool m_ready = false;
+};
+
 class Cache
 {
     friend class Block;
 
 public:
-    Cache(std::size_t maxBytes);
-
+    // At most fetchThreads chunks are fetched at once, across all readers.
+    // Inactive chunks are evicted as chosen by the given policy.  If
+    // diskBytes is nonzero, readers of remote data with a local tmp endpoint
+    // also hold up to this many bytes of fetched files there - see DiskCache.
+    Cache(
+            std::size_t maxBytes,
+            std::size_t fetchThreads = 8,
+            EvictionType eviction = EvictionType::Lru,
+            std::size_t diskBytes = 0);
+
+    // If a projection is given, the chunks of the resulting block hold only
+    // its dimensions, except for those which are read in place.
+    //
+    // Chunks not yet held are fetched by our FetchPool, and chunks already
+    // being fetched for another block are awaited rather than fetched again.
     std::unique_ptr<Block> acquire(
             const std::string& readerPath,
-            const FetchInfoSet& fetches);
+            const FetchInfoSet& fetches,
+            const Projection* projection = nullptr);
+
+    // As above, but returns once the fetches are submitted rather than once
+    // they complete.  If wait is false and the cache is at its budget, this
+    // returns null rather than waiting for chunks to be released.
+    std::unique_ptr<PendingBlock> acquireAsync(
+            const std::string& readerPath,
+            const FetchInfoSet& fetches,
+            const Projection* projection = nullptr,
+            bool wait = true);
+
+    // Fetch these chunks into the cache without holding them once fetched,
+    // so they're likely to be hits for a later acquisition.  Returns false,
+    // fetching nothing, if the cache is at its budget.
+    bool prefetch(
+            const std::string& readerPath,
+            const FetchInfoSet& fetches,
+            const Projection* projection = nullptr);
 
     void refHierarchySlot(
             const std::string& name,
@@ -138,34 +233,88 @@ public:
             const HierarchyReader::Slots& slots);
 
     std::size_t maxBytes() const { return m_maxBytes; }
-    std::size_t activeBytes() const { return m_activeBytes; }
+    std::size_t activeBytes() const { return m_activeBytes.load(); }
+    std::size_t numShards() const { return m_shards.size(); }
+
+    // Bytes of fetched chunks held by each shard, which sum to activeBytes().
+    std::vector<std::size_t> shardBytes() const;
+    EvictionType eviction() const { return m_eviction; }
+    std::size_t diskBytes() const { return m_diskBytes; }
+
+    // Counters since the first reservation for this reader path.
+    CacheStats stats(const std::string& readerPath) const;
+    std::size_t fetchThreads() const { return m_fetchPool.numThreads(); }
 
     void release(const Reader& reader);
 
 private:
+    using Promise = std::shared_ptr<std::promise<const ColdChunkReader*>>;
+    using Fresh = std::vector<std::pair<FetchInfo, Promise>>;
+    using Pending = PendingBlock::Pending;
+
+    // Holds a prefetch's reservation until its last fetch completes.
+    struct Prefetch;
+
     void release(const Block& block);
 
+    // Fetches which aren't yet held, nor being fetched, are added to fresh,
+    // and must be fulfilled by the caller.  Every fetch is added to pending.
+    // Returns null if the cache is at its budget and we may not wait.
     std::unique_ptr<Block> reserve(
             const std::string& readerPath,
-            const FetchInfoSet& fetches);
+            const FetchInfoSet& fetches,
+            const Projection* projection,
+            Fresh& fresh,
+            Pending& pending,
+            bool wait = true);
+
+    // Submit the fresh fetches to our FetchPool, each holding a copy of
+    // hold until it completes.  The returned readahead must outlive them.
+    std::unique_ptr<Readahead> submit(
+            const std::string& readerPath,
+            const Projection* projection,
+            const Fresh& fresh,
+            std::shared_ptr<Prefetch> hold = std::shared_ptr<Prefetch>());
 
     const ColdChunkReader* fetch(
             const std::string& readerPath,
-            const FetchInfo& fetchInfo);
+            const FetchInfo& fetchInfo,
+            const Projection* projection);
+
+    CacheShard& shard(const std::string& readerPath, const ChunkKey& key);
+
+    // Evict inactive chunks from this shard, which must be locked, while the
+    // cache is over its budget.  If fair, only while the shard is also over
+    // its share of the budget.  Returns true if anything was evicted.
+    bool evict(CacheShard& shard, bool fair);
+
+    // Wake reservations waiting on the budget.
+    void notify();
 
     const std::size_t m_maxBytes;
     const std::size_t m_maxHierarchyBytes;
-    std::size_t m_activeBytes = 0;
+    const EvictionType m_eviction;
+    const std::size_t m_diskBytes;
+    std::atomic_size_t m_activeBytes;
     std::size_t m_hierarchyBytes = 0;
 
-    GlobalManager m_chunkManager;
-    InactiveList m_inactiveList;
+    std::vector<CacheShard> m_shards;
 
     std::map<std::string, HierarchyCache> m_hierarchyCache;
     std::mutex m_hierarchyMutex;
 
+    // Only used to wait for the budget, never held alongside a shard lock.
     std::mutex m_mutex;
     std::condition_variable m_cv;
+
+    // Prefetches in flight per reader path, which must complete before the
+    // reader is released.
+    std::map<std::string, std::size_t> m_prefetching;
+    std::mutex m_prefetchMutex;
+    std::condition_variable m_prefetchCv;
+
+    // Declared last, so its threads are joined before the rest is destroyed.
+    FetchPool m_fetchPool;
 };
 
 } // namespace entwine
@@ -34,16 +34,35 @@ ChunkReader::ChunkReader(
         const Bounds& bounds,
         PointPool& pool,
         const Id& id,
-        const std::size_t depth)
+        const std::size_t depth,
+        const Projection* projection)
     : m_endpoint(endpoint)
     , m_metadata(metadata)
-    , m_pool(pool.schema(), pool.delta(), poolBlockSize)
+    , m_schema(projection ? &projection->schema() : &metadata.schema())
+    , m_pool(*m_schema, pool.delta(), poolBlockSize)
     , m_bounds(bounds)
-    , m_schema(metadata.schema())
     , m_id(id)
     , m_depth(depth)
-    , m_cells(metadata.storage().deserialize(endpoint, tmp, m_pool, m_id))
-{ }
+    , m_cells(m_pool.cellPool())
+{
+    const Storage& storage(metadata.storage());
+
+    if (MappedChunk mapped = storage.map(endpoint, m_id))
+    {
+        // Mapped records are read in place, so projecting them would only
+        // cost a copy.
+        m_schema = &metadata.schema();
+        m_mapped.push_back(std::move(mapped));
+    }
+    else if (projection)
+    {
+        m_cells = storage.deserialize(endpoint, tmp, m_pool, m_id, *projection);
+    }
+    else
+    {
+        m_cells = storage.deserialize(endpoint, tmp, m_pool, m_id);
+    }
+}
 
 ChunkReader::ChunkReader(
         const Metadata& m,
@@ -52,9 +71,9 @@ ChunkReader::ChunkReader(
         PointPool& pool)
     : m_endpoint(ep)
     , m_metadata(m)
+    , m_schema(&m.schema())
     , m_pool(pool.schema(), pool.delta(), poolBlockSize)
     , m_bounds(m.boundsScaledCubic())
-    , m_schema(m.schema())
     , m_id(m.structure().baseIndexBegin())
     , m_depth(m.structure().baseDepthBegin())
     , m_cells(m_pool.cellPool())
@@ -62,11 +81,39 @@ ChunkReader::ChunkReader(
     const Structure& s(m.structure());
     if (m.slicedBase())
     {
-        for (std::size_t d(s.baseDepthBegin()); d < s.baseDepthBegin() + 3; ++d)
+        const std::size_t begin(s.baseDepthBegin());
+
+        // Map every slice, or else read them all.
+        for (std::size_t d(begin); d < begin + 3; ++d)
         {
             const auto id(ChunkInfo::calcLevelIndex(2, d));
-            m_cells.pushBack(m.storage().deserialize(ep, tmp, m_pool, id));
-            m_offsets.push_back(m_cells.size());
+            MappedChunk mapped(m.storage().map(ep, id));
+
+            if (!mapped)
+            {
+                m_mapped.clear();
+                break;
+            }
+
+            m_mapped.push_back(std::move(mapped));
+        }
+
+        std::size_t total(0);
+
+        for (std::size_t d(begin); d < begin + 3; ++d)
+        {
+            if (mapped())
+            {
+                total += m_mapped[d - begin].numPoints;
+            }
+            else
+            {
+                const auto id(ChunkInfo::calcLevelIndex(2, d));
+                m_cells.pushBack(m.storage().deserialize(ep, tmp, m_pool, id));
+                total = m_cells.size();
+            }
+
+            m_offsets.push_back(total);
         }
     }
     else initLegacyBase(tmp);
@@ -144,23 +191,24 @@ ColdChunkReader::ColdChunkReader(
         const Bounds& bounds,
         PointPool& pool,
         const Id& id,
-        std::size_t depth)
-    : m_chunk(m, ep, tmp, bounds, pool, id, depth)
+        std::size_t depth,
+        const Projection* projection)
+    : m_chunk(m, ep, tmp, bounds, pool, id, depth, projection)
 {
-    m_points.reserve(m_chunk.cells().size());
+    m_points.reserve(m_chunk.numPoints());
 
     const auto& globalBounds(m.boundsScaledCubic());
     std::size_t offset(0);
 
-    for (const auto& cell : m_chunk.cells())
+    m_chunk.forEachPoint([&](const Point& point, const char* data)
     {
         m_points.emplace_back(
                 offset,
-                cell.point(),
-                cell.uniqueData(),
-                Tube::calcTick(cell.point(), globalBounds, depth));
+                point,
+                data,
+                Tube::calcTick(point, globalBounds, depth));
         ++offset;
-    }
+    });
 
     std::sort(m_points.begin(), m_points.end());
 }
@@ -193,22 +241,23 @@ BaseChunkReader::BaseChunkReader(
     const auto& globalBounds(m.boundsScaledCubic());
     Climber climber(m);
 
+    const std::vector<std::size_t> offsets(m_chunk.offsets());
     std::size_t offset(0);
     std::size_t slice(0);
 
-    for (const auto& cell : m_chunk.cells())
+    m_chunk.forEachPoint([&](const Point& point, const char* data)
     {
         const std::size_t depth(slice + s.baseDepthBegin());
         climber.reset();
-        climber.magnifyTo(cell.point(), depth);
+        climber.magnifyTo(point, depth);
         m_points[climber.index()].emplace_back(
                 offset,
-                cell.point(),
-                cell.uniqueData(),
-                Tube::calcTick(cell.point(), globalBounds, depth));
+                point,
+                data,
+                Tube::calcTick(point, globalBounds, depth));
 
-        if (++offset == m_chunk.offsets().at(slice)) ++slice;
-    }
+        if (++offset == offsets.at(slice)) ++slice;
+    });
 }
 
 } // namespace entwine
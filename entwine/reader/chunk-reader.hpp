@@ -18,7 +18,9 @@
 
 #include <entwine/reader/append.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/point-columns.hpp>
 #include <entwine/types/point-pool.hpp>
+#include <entwine/types/storage.hpp>
 #include <entwine/types/structure.hpp>
 #include <entwine/types/vector-point-table.hpp>
 #include <entwine/util/io.hpp>
@@ -33,7 +35,8 @@ class Schema;
 class ChunkReader
 {
 public:
-    // Cold chunks.
+    // Cold chunks.  If a projection is given, then only its dimensions are
+    // held, unless the chunk is mapped, in which case the schema is native.
     ChunkReader(
             const Metadata& metadata,
             const arbiter::Endpoint& endpoint,
@@ -41,7 +44,8 @@ public:
             const Bounds& bounds,
             PointPool& pool,
             const Id& id,
-            std::size_t depth);
+            std::size_t depth,
+            const Projection* projection = nullptr);
 
     // Base chunks.
     ChunkReader(
@@ -53,13 +57,51 @@ public:
     ~ChunkReader();
 
     const Metadata& metadata() const { return m_metadata; }
-    const Schema& schema() const { return m_schema; }
+    const Schema& schema() const { return *m_schema; }
     const Id& id() const { return m_id; }
     std::size_t depth() const { return m_depth; }
     const Bounds& bounds() const { return m_bounds; }
-    const Cell::PooledStack& cells() const { return m_cells; }
     const std::vector<std::size_t> offsets() const { return m_offsets; }
 
+    // True if our points are read in place from mapped local files.
+    bool mapped() const { return !m_mapped.empty(); }
+
+    std::size_t numPoints() const
+    {
+        if (!mapped()) return m_cells.size();
+
+        std::size_t n(0);
+        for (const MappedChunk& m : m_mapped) n += m.numPoints;
+        return n;
+    }
+
+    // Call f(point, data) for each point in order, where data is the point's
+    // packed record.  For mapped chunks, data points into the mapping.
+    template<typename Fn>
+    void forEachPoint(Fn&& f) const
+    {
+        if (!mapped())
+        {
+            for (const Cell& cell : m_cells) f(cell.point(), cell.uniqueData());
+            return;
+        }
+
+        const std::size_t pointSize(m_schema->pointSize());
+
+        for (const MappedChunk& m : m_mapped)
+        {
+            PointColumns columns(*m_schema);
+            columns.appendCoordinates(m.data(), m.numPoints);
+
+            const char* pos(m.data());
+            for (std::size_t i(0); i < m.numPoints; ++i)
+            {
+                f(columns.point(i), pos);
+                pos += pointSize;
+            }
+        }
+    }
+
     Append& getOrCreateAppend(std::string name, const Schema& s) const
     {
         std::lock_guard<std::mutex> lock(m);
@@ -70,7 +112,7 @@ public:
                     name,
                     s,
                     m_id,
-                    m_cells.size());
+                    numPoints());
             m_appends[name] = std::move(append);
         }
         return *m_appends.at(name);
@@ -81,7 +123,7 @@ public:
         std::lock_guard<std::mutex> lock(m);
         if (m_appends.count(name)) return m_appends.at(name).get();
 
-        const auto np(m_cells.size());
+        const auto np(numPoints());
         if (auto a = Append::maybeCreate(m_endpoint, name, s, m_id, np))
         {
             m_appends[name] = std::move(a);
@@ -95,13 +137,16 @@ protected:
 
     const arbiter::Endpoint m_endpoint;
     const Metadata& m_metadata;
+    const Schema* m_schema;
     PointPool m_pool;
     const Bounds m_bounds;
-    const Schema& m_schema;
     const Id m_id;
     const std::size_t m_depth;
 
+    // Either our points are held in pooled cells, or read in place from
+    // mappings, one per file.
     Cell::PooledStack m_cells;
+    std::vector<MappedChunk> m_mapped;
     std::vector<std::size_t> m_offsets;
 
     mutable std::mutex m;
@@ -153,7 +198,8 @@ public:
             const Bounds& bounds,
             PointPool& pool,
             const Id& id,
-            std::size_t depth);
+            std::size_t depth,
+            const Projection* projection = nullptr);
 
     using It = TubeData::const_iterator;
     struct QueryRange
@@ -165,7 +211,7 @@ public:
     QueryRange candidates(const Bounds& queryBounds) const;
     std::size_t size() const
     {
-        return m_chunk.cells().size() * m_chunk.schema().pointSize();
+        return m_chunk.numPoints() * m_chunk.schema().pointSize();
     }
 
     ChunkReader& chunk() { return m_chunk; }
@@ -0,0 +1,386 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/eviction.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Chunks in order of recency, most recent first, with lookup by chunk.
+    class Ordered
+    {
+    public:
+        void push(const GlobalChunkInfo& chunk)
+        {
+            m_list.push_front(chunk);
+            m_its.insert(std::make_pair(chunk, m_list.begin()));
+        }
+
+        bool erase(const GlobalChunkInfo& chunk)
+        {
+            const auto it(m_its.find(chunk));
+            if (it == m_its.end()) return false;
+
+            m_list.erase(it->second);
+            m_its.erase(it);
+            return true;
+        }
+
+        // The least recent chunk.
+        const GlobalChunkInfo& back() const { return m_list.back(); }
+
+        GlobalChunkInfo pop()
+        {
+            const GlobalChunkInfo chunk(m_list.back());
+            m_its.erase(chunk);
+            m_list.pop_back();
+            return chunk;
+        }
+
+        std::size_t size() const { return m_list.size(); }
+        bool empty() const { return m_list.empty(); }
+
+    private:
+        using List = std::list<GlobalChunkInfo>;
+
+        List m_list;
+        std::map<GlobalChunkInfo, List::iterator> m_its;
+    };
+
+    class LruPolicy : public EvictionPolicy
+    {
+    public:
+        virtual void add(const GlobalChunkInfo& chunk) override
+        {
+            m_order.push(chunk);
+        }
+
+        virtual void hold(const GlobalChunkInfo& chunk) override
+        {
+            m_order.erase(chunk);
+        }
+
+        virtual void drop(const GlobalChunkInfo& chunk) override
+        {
+            m_order.erase(chunk);
+        }
+
+        virtual bool evict(GlobalChunkInfo& chunk) override
+        {
+            if (m_order.empty()) return false;
+            chunk = m_order.pop();
+            return true;
+        }
+
+        virtual std::size_t size() const override { return m_order.size(); }
+
+    private:
+        Ordered m_order;
+    };
+
+    class TwoQueuePolicy : public EvictionPolicy
+    {
+    public:
+        virtual void add(const GlobalChunkInfo& chunk) override
+        {
+            if (m_held.erase(chunk) || m_ghosts.erase(chunk))
+            {
+                m_main.push(chunk);
+            }
+            else
+            {
+                m_in.push(chunk);
+            }
+        }
+
+        virtual void hold(const GlobalChunkInfo& chunk) override
+        {
+            if (m_in.erase(chunk) || m_main.erase(chunk)) m_held.insert(chunk);
+        }
+
+        virtual void drop(const GlobalChunkInfo& chunk) override
+        {
+            if (!m_in.erase(chunk)) m_main.erase(chunk);
+        }
+
+        virtual bool evict(GlobalChunkInfo& chunk) override
+        {
+            const std::size_t total(size());
+            if (!total) return false;
+
+            // The FIFO gives up its chunks first while it holds more than a
+            // quarter of them.
+            if (m_main.empty() || m_in.size() * 4 > total)
+            {
+                chunk = m_in.pop();
+
+                m_ghosts.push(chunk);
+                const std::size_t maxGhosts(
+                        std::max<std::size_t>(total, 256));
+                while (m_ghosts.size() > maxGhosts) m_ghosts.pop();
+            }
+            else
+            {
+                chunk = m_main.pop();
+            }
+
+            return true;
+        }
+
+        virtual std::size_t size() const override
+        {
+            return m_in.size() + m_main.size();
+        }
+
+    private:
+        Ordered m_in;
+        Ordered m_main;
+
+        // Chunks recently evicted from the FIFO.
+        Ordered m_ghosts;
+
+        // Chunks in use which had been inactive.
+        std::set<GlobalChunkInfo> m_held;
+    };
+
+    // A count-min sketch of 4-bit counters, which are halved once the number
+    // of increments reaches ten times the width, so that old popularity
+    // fades.
+    class FrequencySketch
+    {
+    public:
+        explicit FrequencySketch(const std::size_t width = 4096)
+            : m_mask(width - 1)
+            , m_counters(depth * width, 0)
+        { }
+
+        void increment(const std::size_t hash)
+        {
+            for (std::size_t row(0); row < depth; ++row)
+            {
+                uint8_t& counter(m_counters[index(hash, row)]);
+                if (counter < 15) ++counter;
+            }
+
+            if (++m_samples >= 10 * (m_mask + 1))
+            {
+                for (uint8_t& counter : m_counters) counter >>= 1;
+                m_samples /= 2;
+            }
+        }
+
+        std::size_t estimate(const std::size_t hash) const
+        {
+            uint8_t result(15);
+            for (std::size_t row(0); row < depth; ++row)
+            {
+                result = std::min(result, m_counters[index(hash, row)]);
+            }
+            return result;
+        }
+
+    private:
+        static constexpr std::size_t depth = 4;
+
+        std::size_t index(const std::size_t hash, const std::size_t row) const
+        {
+            uint64_t h(
+                    (static_cast<uint64_t>(hash) + row) *
+                    0x9e3779b97f4a7c15ULL);
+            h ^= h >> 29;
+            return row * (m_mask + 1) + (h & m_mask);
+        }
+
+        const std::size_t m_mask;
+        std::vector<uint8_t> m_counters;
+        std::size_t m_samples = 0;
+    };
+
+    constexpr std::size_t FrequencySketch::depth;
+
+    class TinyLfuPolicy : public EvictionPolicy
+    {
+    public:
+        virtual void touch(const GlobalChunkInfo& chunk) override
+        {
+            m_sketch.increment(chunk.hash());
+        }
+
+        virtual void add(const GlobalChunkInfo& chunk) override
+        {
+            const auto it(m_held.find(chunk));
+
+            if (it == m_held.end() || it->second == Segment::Window)
+            {
+                if (it != m_held.end()) m_held.erase(it);
+                m_window.push(chunk);
+                admit();
+            }
+            else
+            {
+                // Used again from the main LRU, so protect it.
+                m_held.erase(it);
+                m_protected.push(chunk);
+
+                // Keep at least a fifth of the main LRU on probation.
+                while (m_protected.size() * 5 > main() * 4)
+                {
+                    m_probation.push(m_protected.pop());
+                }
+            }
+        }
+
+        virtual void hold(const GlobalChunkInfo& chunk) override
+        {
+            if (m_window.erase(chunk)) m_held[chunk] = Segment::Window;
+            else if (m_probation.erase(chunk)) m_held[chunk] = Segment::Main;
+            else if (m_protected.erase(chunk)) m_held[chunk] = Segment::Main;
+        }
+
+        virtual void drop(const GlobalChunkInfo& chunk) override
+        {
+            if (m_window.erase(chunk)) return;
+            if (m_probation.erase(chunk)) return;
+            m_protected.erase(chunk);
+        }
+
+        virtual bool evict(GlobalChunkInfo& chunk) override
+        {
+            if (!size()) return false;
+
+            Ordered* victims(mainVictims());
+
+            // The window's oldest chunk, whether it has been turned away from
+            // the main LRU or not, is evicted in place of the main LRU's
+            // oldest if it's used no more often.
+            if (!victims || (!m_window.empty() && !beats(m_window.back())))
+            {
+                chunk = m_window.pop();
+            }
+            else
+            {
+                chunk = victims->pop();
+            }
+
+            return true;
+        }
+
+        virtual std::size_t size() const override
+        {
+            return m_window.size() + main();
+        }
+
+    private:
+        enum class Segment { Window, Main };
+
+        std::size_t main() const
+        {
+            return m_probation.size() + m_protected.size();
+        }
+
+        Ordered* mainVictims()
+        {
+            if (!m_probation.empty()) return &m_probation;
+            if (!m_protected.empty()) return &m_protected;
+            return nullptr;
+        }
+
+        // True if this chunk is used more often than the next main victim.
+        bool beats(const GlobalChunkInfo& chunk) const
+        {
+            const Ordered* victims(
+                    m_probation.empty() ? &m_protected : &m_probation);
+            return victims->empty() ||
+                m_sketch.estimate(chunk.hash()) >
+                    m_sketch.estimate(victims->back().hash());
+        }
+
+        // Move chunks from an overfull window into the main LRU while they
+        // would displace less popular chunks there.  A chunk turned away
+        // stays at the back of the window, next in line for eviction.
+        void admit()
+        {
+            const std::size_t maxWindow(
+                    std::max<std::size_t>(size() / 100, 1));
+
+            while (m_window.size() > maxWindow && beats(m_window.back()))
+            {
+                m_probation.push(m_window.pop());
+            }
+        }
+
+        FrequencySketch m_sketch;
+
+        Ordered m_window;
+        Ordered m_probation;
+        Ordered m_protected;
+
+        // Chunks in use which had been inactive, and where they were held.
+        std::map<GlobalChunkInfo, Segment> m_held;
+    };
+}
+
+std::size_t GlobalChunkInfo::hash() const
+{
+    return
+        std::hash<std::string>()(path) * 31 +
+        std::hash<Id>()(key.first) * 7 +
+        std::hash<const Projection*>()(key.second);
+}
+
+std::string toString(const EvictionType type)
+{
+    switch (type)
+    {
+        case EvictionType::Lru: return "lru";
+        case EvictionType::TwoQueue: return "2q";
+        case EvictionType::TinyLfu: return "tinylfu";
+        default: throw std::runtime_error("Invalid eviction type");
+    }
+}
+
+EvictionType toEvictionType(const std::string& s)
+{
+    if (s == "lru") return EvictionType::Lru;
+    if (s == "2q") return EvictionType::TwoQueue;
+    if (s == "tinylfu") return EvictionType::TinyLfu;
+    throw std::runtime_error("Invalid eviction type: " + s);
+}
+
+std::unique_ptr<EvictionPolicy> EvictionPolicy::create(const EvictionType type)
+{
+    switch (type)
+    {
+        case EvictionType::Lru:
+            return makeUnique<LruPolicy>();
+        case EvictionType::TwoQueue:
+            return makeUnique<TwoQueuePolicy>();
+        case EvictionType::TinyLfu:
+            return makeUnique<TinyLfuPolicy>();
+        default:
+            throw std::runtime_error("Invalid eviction type");
+    }
+}
+
+} // namespace entwine
+
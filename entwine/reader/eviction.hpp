@@ -0,0 +1,96 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <entwine/types/id.hpp>
+
+namespace entwine
+{
+
+class Projection;
+
+// Chunks are cached per projection, where null means all dimensions.
+using ChunkKey = std::pair<Id, const Projection*>;
+
+struct GlobalChunkInfo
+{
+    GlobalChunkInfo() = default;
+    GlobalChunkInfo(const std::string& path, const ChunkKey& key)
+        : path(path)
+        , key(key)
+    { }
+
+    bool operator<(const GlobalChunkInfo& other) const
+    {
+        return path < other.path || (path == other.path && key < other.key);
+    }
+
+    std::size_t hash() const;
+
+    std::string path;
+    ChunkKey key;
+};
+
+// Lru evicts the least recently used chunk.  The others resist scans, where a
+// large query streams through many chunks it will never touch again, pushing
+// out the popular chunks that every query needs:
+//
+//      - TwoQueue (2Q) holds chunks used once in a FIFO, evicted first, and
+//        chunks used again in an LRU.  Evicted chunks are remembered for a
+//        while, and go straight to the LRU if they return.
+//
+//      - TinyLfu (W-TinyLFU) holds new chunks in a small LRU window.  Chunks
+//        leaving the window are only admitted into the main LRU if they've
+//        been used more often than the chunk they would displace, as
+//        estimated by a decaying count-min sketch of all recent reservations.
+enum class EvictionType { Lru, TwoQueue, TinyLfu };
+
+std::string toString(EvictionType type);
+EvictionType toEvictionType(const std::string& s);
+
+// Orders the inactive chunks of a cache shard for eviction.  A chunk is only
+// held by the policy while it's inactive, i.e. between add() and either
+// hold(), drop(), or its selection by evict().  Not thread-safe.
+class EvictionPolicy
+{
+public:
+    virtual ~EvictionPolicy() { }
+
+    static std::unique_ptr<EvictionPolicy> create(EvictionType type);
+
+    // Called for every reservation of a chunk, whether or not it's held.
+    virtual void touch(const GlobalChunkInfo& chunk) { }
+
+    // The chunk is no longer in use, so it may be evicted.
+    virtual void add(const GlobalChunkInfo& chunk) = 0;
+
+    // The chunk is in use again.  It will be added again once released.
+    virtual void hold(const GlobalChunkInfo& chunk) = 0;
+
+    // The chunk has been discarded by the cache.
+    virtual void drop(const GlobalChunkInfo& chunk) = 0;
+
+    // Select and remove the next chunk to evict, returning false if there
+    // are no inactive chunks.
+    virtual bool evict(GlobalChunkInfo& chunk) = 0;
+
+    // The number of inactive chunks.
+    virtual std::size_t size() const = 0;
+    bool empty() const { return !size(); }
+};
+
+} // namespace entwine
+
@@ -0,0 +1,107 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/fetch-pool.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace entwine
+{
+
+FetchPool::FetchPool(const std::size_t numThreads)
+{
+    const std::size_t n(std::max<std::size_t>(numThreads, 1));
+    for (std::size_t i(0); i < n; ++i)
+    {
+        m_threads.emplace_back([this]() { work(); });
+    }
+}
+
+FetchPool::~FetchPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+    }
+
+    m_cv.notify_all();
+    for (auto& t : m_threads) t.join();
+}
+
+void FetchPool::add(const std::string& readerPath, Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queues[readerPath].push_back(std::move(task));
+        ++m_pending;
+    }
+
+    m_cv.notify_one();
+}
+
+std::size_t FetchPool::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending;
+}
+
+bool FetchPool::take(Task& task)
+{
+    if (m_queues.empty()) return false;
+
+    auto it(m_queues.upper_bound(m_last));
+    if (it == m_queues.end()) it = m_queues.begin();
+
+    task = std::move(it->second.front());
+    it->second.pop_front();
+    --m_pending;
+
+    m_last = it->first;
+    if (it->second.empty()) m_queues.erase(it);
+
+    return true;
+}
+
+void FetchPool::work()
+{
+    Task task;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return m_done || m_pending; });
+
+            // Queued fetches are drained before stopping, since their callers
+            // are waiting on them.
+            if (!take(task)) return;
+        }
+
+        try
+        {
+            task();
+        }
+        catch (std::exception& e)
+        {
+            std::cout << "Fetch failed: " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::cout << "Fetch failed: unknown error" << std::endl;
+        }
+
+        task = Task();
+    }
+}
+
+} // namespace entwine
+
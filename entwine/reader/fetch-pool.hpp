@@ -0,0 +1,68 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <entwine/util/task.hpp>
+
+namespace entwine
+{
+
+// A long-lived set of threads which run chunk fetches for the Cache.  At most
+// numThreads fetches run at once across all readers.  Fetches are queued per
+// reader path, and idle threads take from those queues in turn, so a query
+// with many chunks to fetch can't starve the queries of other readers.
+//
+// Tasks should not throw - results, including failures, are delivered through
+// whatever the task captures.
+class FetchPool
+{
+public:
+    explicit FetchPool(std::size_t numThreads);
+    ~FetchPool();
+
+    void add(const std::string& readerPath, Task task);
+
+    std::size_t numThreads() const { return m_threads.size(); }
+
+    // Fetches queued but not yet started.
+    std::size_t pending() const;
+
+private:
+    void work();
+
+    // Pop the next task, rotating through the readers after m_last.
+    bool take(Task& task);
+
+    bool m_done = false;
+    std::map<std::string, std::deque<Task>> m_queues;
+    std::string m_last;
+    std::size_t m_pending = 0;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+
+    std::vector<std::thread> m_threads;
+
+    FetchPool(const FetchPool&) = delete;
+    FetchPool& operator=(const FetchPool&) = delete;
+};
+
+} // namespace entwine
+
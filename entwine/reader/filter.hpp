@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <set>
 #include <string>
 
 #include <json/json.h>
@@ -56,6 +57,9 @@ public:
         m_root.log("");
     }
 
+    // Names of the dimensions which this filter compares.
+    const std::set<std::string>& dims() const { return m_dims; }
+
 private:
     void build(LogicGate& gate, const Json::Value& json, const Delta* delta)
     {
@@ -83,6 +87,8 @@ private:
                 }
                 else if (!val.isObject() || val.size() == 1)
                 {
+                    addDim(key);
+
                     // a comparison query object.
                     active->push(
                             Comparison::create(m_metadata, key, val, delta));
@@ -98,6 +104,8 @@ private:
                     // There cannot be any further nested logical operators
                     // within val, since we've already selected a dimension.
                     //
+                    addDim(key);
+
                     for (const std::string& innerKey : val.getMemberNames())
                     {
                         Json::Value next;
@@ -125,9 +133,15 @@ private:
         }
     }
 
+    void addDim(const std::string& name)
+    {
+        m_dims.insert(name == "Path" ? "OriginId" : name);
+    }
+
     const Metadata& m_metadata;
     const Bounds m_queryBounds;
     LogicalAnd m_root;
+    std::set<std::string> m_dims;
 };
 
 } // namespace entwine
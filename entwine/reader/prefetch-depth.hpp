@@ -0,0 +1,68 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace entwine
+{
+
+// Chooses how many blocks a query keeps in flight ahead of the one it's
+// processing.  While a block is processed, the fetches behind it have that
+// long to complete, so to avoid waiting we need as many blocks in flight as
+// it takes to process blocks for the duration of one fetch.  Both durations
+// are smoothed, and the result is clamped to [1, max].
+class PrefetchDepth
+{
+public:
+    explicit PrefetchDepth(std::size_t max = 8, std::size_t initial = 2)
+        : m_max(std::max<std::size_t>(max, 1))
+        , m_initial(std::min(std::max<std::size_t>(initial, 1), m_max))
+    { }
+
+    // Seconds from the submission of a block's fetches until they completed.
+    void fetched(double seconds) { update(m_latency, seconds); }
+
+    // Seconds spent processing a block, once fetched.
+    void processed(double seconds) { update(m_processing, seconds); }
+
+    std::size_t get() const
+    {
+        if (m_latency < 0 || m_processing < 0) return m_initial;
+
+        const double processing(std::max(m_processing, 1e-6));
+        const double needed(std::ceil(m_latency / processing));
+
+        if (needed >= m_max) return m_max;
+        return std::max<std::size_t>(needed, 1);
+    }
+
+    std::size_t max() const { return m_max; }
+
+private:
+    static void update(double& average, const double seconds)
+    {
+        if (average < 0) average = seconds;
+        else average = 0.75 * average + 0.25 * seconds;
+    }
+
+    const std::size_t m_max;
+    const std::size_t m_initial;
+
+    // Negative until measured.
+    double m_latency = -1;
+    double m_processing = -1;
+};
+
+} // namespace entwine
+
@@ -103,6 +103,8 @@ public:
 
             m_nativeBounds = std::make_shared<Bounds>(q["nativeBounds"]);
         }
+
+        m_prefetchChildren = q["prefetchChildren"].asBool();
     }
 
     const Bounds& bounds() const { return m_bounds; }
@@ -113,6 +115,11 @@ public:
 
     const Bounds* nativeBounds() const { return m_nativeBounds.get(); }
 
+    // If true, the existing chunks one depth beyond our depth range, beneath
+    // the chunks we select, are fetched into the cache for the query that
+    // will likely follow, refining this one.
+    bool prefetchChildren() const { return m_prefetchChildren; }
+
 private:
     const Bounds m_bounds;
     const Delta m_delta;
@@ -121,6 +128,7 @@ private:
     const Json::Value m_filter;
 
     std::shared_ptr<Bounds> m_nativeBounds;
+    bool m_prefetchChildren = false;
 };
 
 } // namespace entwine
@@ -32,6 +32,27 @@ namespace
 {
     std::size_t fetchesPerIteration(6);
     std::size_t minPointsPerIteration(65536);
+
+    // The most blocks a query may have in flight beyond the one it's
+    // processing.
+    std::size_t maxPrefetchedBlocks(8);
+
+    // Remove and return the next batch of chunks to be acquired.
+    FetchInfoSet take(FetchInfoSet& chunks)
+    {
+        const auto begin(chunks.begin());
+        auto end(chunks.begin());
+        std::advance(end, std::min(fetchesPerIteration, chunks.size()));
+
+        FetchInfoSet fetches(begin, end);
+        chunks.erase(begin, end);
+        return fetches;
+    }
+
+    double seconds(const TimePoint start)
+    {
+        return std::chrono::duration<double>(now() - start).count();
+    }
 }
 
 Delta Query::localize(const Delta& out) const
@@ -98,9 +119,16 @@ Query::Query(const Reader& reader, const QueryParams& p)
     , m_depthEnd(p.de() ? p.de() : std::numeric_limits<uint32_t>::max())
     , m_filter(m_reader.metadata(), m_bounds, p.filter(), &m_delta)
     , m_table(m_reader.metadata().schema())
-    , m_pointRef(m_table, 0)
+    , m_active(&m_table)
+    , m_prefetchDepth(maxPrefetchedBlocks)
 {
-    if (!m_depthEnd || m_depthEnd > m_structure.coldDepthBegin())
+    project(std::set<std::string>());
+
+    // With children prefetched, our traversal reaches one depth further.
+    const std::size_t reach(
+            m_depthEnd + (m_params.prefetchChildren() ? 1 : 0));
+
+    if (!m_depthEnd || reach > m_structure.coldDepthBegin())
     {
         QueryChunkState chunkState(m_structure, m_metadata.boundsScaledCubic());
         getFetches(chunkState);
@@ -131,6 +159,35 @@ void Query::getFetches(const QueryChunkState& c)
         }
         else getFetches(c.getClimb());
     }
+    else if (m_params.prefetchChildren())
+    {
+        getChildren(c);
+    }
+}
+
+void Query::getChildren(const QueryChunkState& c)
+{
+    auto add([this](const QueryChunkState& child)
+    {
+        if (child.depth() < m_structure.coldDepthBegin()) return;
+        if (!m_filter.check(child.bounds())) return;
+        if (!m_reader.exists(child)) return;
+
+        m_children.emplace(
+                m_reader,
+                child.chunkId(),
+                child.bounds(),
+                child.depth());
+    });
+
+    if (c.allDirections())
+    {
+        for (std::size_t i(0); i < dirHalfEnd(); ++i)
+        {
+            add(c.getClimb(toDir(i)));
+        }
+    }
+    else add(c.getClimb());
 }
 
 bool Query::next()
@@ -147,6 +204,8 @@ bool Query::next()
 
             if (m_reader.base())
             {
+                select(m_reader.base()->chunk());
+
                 if (m_depthBegin < m_structure.baseDepthEnd())
                 {
                     chunk(m_reader.base()->chunk());
@@ -154,6 +213,9 @@ bool Query::next()
 
                 PointState ps(m_structure, m_metadata.boundsScaledCubic());
                 getBase(ps);
+
+                // With no chunks of our own, our children may still be due.
+                if (m_chunks.empty()) prefetch();
                 m_done = m_chunks.empty();
             }
         }
@@ -191,17 +253,79 @@ void Query::getBase(const PointState& pointState)
 
 void Query::maybeAcquire()
 {
-    if (m_block || m_chunks.empty()) return;
+    if (m_block)
+    {
+        prefetch();
+        return;
+    }
+
+    Cache& cache(m_reader.cache());
+
+    if (m_prefetched.empty() && !m_chunks.empty())
+    {
+        m_prefetched.push_back(
+                cache.acquireAsync(
+                    m_reader.path(),
+                    take(m_chunks),
+                    m_projection));
+    }
+
+    if (m_prefetched.empty()) return;
+
+    std::unique_ptr<PendingBlock> pending(std::move(m_prefetched.front()));
+    m_prefetched.pop_front();
+
+    // Put the following blocks in flight before waiting on this one.
+    prefetch();
+
+    m_block = pending->get();
+    m_prefetchDepth.fetched(pending->latency());
+
+    m_chunkReaderIt = m_block->chunkMap().begin();
+    m_blockStart = now();
+}
+
+void Query::prefetch()
+{
+    Cache& cache(m_reader.cache());
+
+    // Poll our blocks in flight, so their latencies are measured when they
+    // complete rather than when we get to them.
+    for (const auto& pending : m_prefetched) pending->ready();
 
-    const auto begin(m_chunks.begin());
-    auto end(m_chunks.begin());
-    std::advance(end, std::min(fetchesPerIteration, m_chunks.size()));
+    while (m_prefetched.size() < m_prefetchDepth.get() && !m_chunks.empty())
+    {
+        // Speculative, so rather than wait for room in the cache, we'll
+        // acquire these once we get to them.
+        const FetchInfoSet fetches(take(m_chunks));
+        std::unique_ptr<PendingBlock> pending(
+                cache.acquireAsync(
+                    m_reader.path(),
+                    fetches,
+                    m_projection,
+                    false));
+
+        if (!pending)
+        {
+            m_chunks.insert(fetches.begin(), fetches.end());
+            break;
+        }
 
-    FetchInfoSet fetches(begin, end);
-    m_block = m_reader.cache().acquire(m_reader.path(), fetches);
-    m_chunks.erase(begin, end);
+        m_prefetched.push_back(std::move(pending));
+    }
 
-    if (m_block) m_chunkReaderIt = m_block->chunkMap().begin();
+    if (m_chunks.empty() && !m_children.empty())
+    {
+        // Children that don't fit in the cache are skipped.
+        while (!m_children.empty())
+        {
+            const FetchInfoSet fetches(take(m_children));
+            if (!cache.prefetch(m_reader.path(), fetches, m_projection))
+            {
+                m_children.clear();
+            }
+        }
+    }
 }
 
 void Query::getChunked()
@@ -212,6 +336,7 @@ void Query::getChunked()
     {
         if (const ColdChunkReader* cr = m_chunkReaderIt->second)
         {
+            select(cr->chunk());
             chunk(cr->chunk());
 
             ColdChunkReader::QueryRange range(cr->candidates(m_bounds));
@@ -225,6 +350,7 @@ void Query::getChunked()
 
             if (++m_chunkReaderIt == m_block->chunkMap().end())
             {
+                m_prefetchDepth.processed(seconds(m_blockStart));
                 m_block.reset();
             }
         }
@@ -234,18 +360,39 @@ void Query::getChunked()
         }
     }
 
-    m_done = !m_block && m_chunks.empty();
+    m_done = !m_block && m_prefetched.empty() && m_chunks.empty();
 }
 
 void Query::processPoint(const PointInfo& info)
 {
     if (!m_bounds.contains(info.point())) return;
-    m_table.setPoint(info.data());
-    if (!m_filter.check(m_pointRef)) return;
+    m_active->setPoint(info.data());
+    if (!m_filter.check(pointRef())) return;
     process(info);
     ++m_numPoints;
 }
 
+void Query::project(std::set<std::string> names)
+{
+    names.insert(m_filter.dims().begin(), m_filter.dims().end());
+    m_projection = m_reader.projection(names);
+
+    if (m_projection)
+    {
+        m_projectedTable = makeUnique<BinaryPointTable>(m_projection->schema());
+    }
+    else m_projectedTable.reset();
+}
+
+void Query::select(const ChunkReader& cr)
+{
+    if (m_projectedTable && &cr.schema() == &m_projection->schema())
+    {
+        m_active = m_projectedTable.get();
+    }
+    else m_active = &m_table;
+}
+
 RegisteredSchema::RegisteredSchema(const Reader& r, const Schema& output)
     : m_original(output)
 {
@@ -276,7 +423,11 @@ ReadQuery::ReadQuery(
             params.nativeBounds() ?
                 m_delta.offset() :
                 m_metadata.boundsScaledCubic().mid())
-{ }
+{
+    std::set<std::string> names;
+    for (const DimInfo& dim : m_schema.dims()) names.insert(dim.name());
+    project(names);
+}
 
 void ReadQuery::chunk(const ChunkReader& cr)
 {
@@ -309,7 +460,7 @@ void ReadQuery::process(const PointInfo& info)
         }
         else if (dim.native())
         {
-            m_pointRef.getField(pos, dimInfo.id(), dimInfo.type());
+            pointRef().getField(pos, dimInfo.id(), dimInfo.type());
         }
         else if (Append* append = dim.append())
         {
@@ -13,12 +13,16 @@
 #include <algorithm>
 #include <cstddef>
 #include <deque>
+#include <memory>
+#include <set>
 #include <stdexcept>
+#include <string>
 
 #include <entwine/reader/cache.hpp>
 #include <entwine/reader/chunk-reader.hpp>
 #include <entwine/reader/comparison.hpp>
 #include <entwine/reader/filter.hpp>
+#include <entwine/reader/prefetch-depth.hpp>
 #include <entwine/reader/query-chunk-state.hpp>
 #include <entwine/reader/query-params.hpp>
 #include <entwine/types/binary-point-table.hpp>
@@ -26,6 +30,7 @@
 #include <entwine/types/dir.hpp>
 #include <entwine/types/point.hpp>
 #include <entwine/types/structure.hpp>
+#include <entwine/util/time.hpp>
 
 namespace entwine
 {
@@ -54,11 +59,22 @@ protected:
     virtual void chunk(const ChunkReader& cr) { }
 
     void getFetches(const QueryChunkState& c);
+    void getChildren(const QueryChunkState& c);
     void getBase(const PointState& pointState);
     void getChunked();
     void maybeAcquire();
+    void prefetch();
     void processPoint(const PointInfo& info);
 
+    // Hold only these dimensions, along with those which are filtered upon,
+    // for chunks which are fetched from here on.
+    void project(std::set<std::string> names);
+
+    // Select the point table matching the layout of a chunk's records.
+    void select(const ChunkReader& cr);
+
+    pdal::PointRef& pointRef() { return m_active->ref(); }
+
     const Reader& m_reader;
     const QueryParams m_params;
     const Metadata& m_metadata;
@@ -69,8 +85,12 @@ protected:
     const std::size_t m_depthEnd;
     const Filter m_filter;
 
+    // Null if every dimension is needed.
+    const Projection* m_projection = nullptr;
+
     BinaryPointTable m_table;
-    pdal::PointRef m_pointRef;
+    std::unique_ptr<BinaryPointTable> m_projectedTable;
+    BinaryPointTable* m_active;
 
 private:
     Delta localize(const Delta& out) const;
@@ -79,6 +99,15 @@ private:
     FetchInfoSet m_chunks;
     std::unique_ptr<Block> m_block;
     ChunkMap::const_iterator m_chunkReaderIt;
+    TimePoint m_blockStart;
+
+    // Blocks following m_block, in order, whose fetches are in flight.
+    std::deque<std::unique_ptr<PendingBlock>> m_prefetched;
+    PrefetchDepth m_prefetchDepth;
+
+    // Chunks beyond our depth range to be prefetched once ours are acquired,
+    // if our params ask for it.
+    FetchInfoSet m_children;
 
     std::size_t m_numPoints = 0;
     bool m_base = true;
@@ -172,7 +201,7 @@ private:
         if (m_params.nativeBounds())
         {
             d = Point::unscale(
-                    m_pointRef.getFieldAs<double>(dim.id()),
+                    pointRef().getFieldAs<double>(dim.id()),
                     m_metadata.delta()->scale()[dimNum],
                     m_metadata.delta()->offset()[dimNum]);
 
@@ -184,7 +213,7 @@ private:
         else
         {
             d = Point::scale(
-                    m_pointRef.getFieldAs<double>(dim.id()),
+                    pointRef().getFieldAs<double>(dim.id()),
                     m_mid[dimNum],
                     m_delta.scale()[dimNum],
                     m_delta.offset()[dimNum]);
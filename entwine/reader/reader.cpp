@@ -21,10 +21,12 @@
 #include <entwine/tree/climber.hpp>
 #include <entwine/tree/builder.hpp>
 #include <entwine/tree/registry.hpp>
+#include <entwine/types/archive.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/manifest.hpp>
 #include <entwine/types/reprojection.hpp>
 #include <entwine/types/schema.hpp>
+#include <entwine/types/storage.hpp>
 #include <entwine/types/structure.hpp>
 #include <entwine/types/subset.hpp>
 #include <entwine/util/compression.hpp>
@@ -69,6 +71,23 @@ namespace
     HierarchyCell::Pool hierarchyPool(4096);
 
     const std::size_t basePoolBlockSize(4096);
+
+    // Remote data is held in a disk cache beneath a local tmp endpoint, if
+    // the cache allows one.
+    std::unique_ptr<DiskCache::Attachment> attachDiskCache(
+            const arbiter::Endpoint& endpoint,
+            const arbiter::Endpoint& tmp,
+            const Cache& cache)
+    {
+        if (!cache.diskBytes() || endpoint.isLocal() || !tmp.isLocal())
+        {
+            return std::unique_ptr<DiskCache::Attachment>();
+        }
+
+        return makeUnique<DiskCache::Attachment>(
+                endpoint,
+                DiskCache::open(tmp, cache.diskBytes()));
+    }
 }
 
 Reader::Reader(const std::string path, const std::string tmp, Cache& cache)
@@ -78,6 +97,7 @@ Reader::Reader(const std::string path, const std::string tmp, Cache& cache)
     , m_metadata(m_endpoint)
     , m_pool(m_metadata.schema(), m_metadata.delta(), basePoolBlockSize)
     , m_cache(cache)
+    , m_diskCache(attachDiskCache(m_endpoint, m_tmp, m_cache))
     , m_hierarchy(
             makeUnique<HierarchyReader>(
                 hierarchyPool,
@@ -98,6 +118,7 @@ Reader::Reader(
     , m_metadata(m_endpoint)
     , m_pool(m_metadata.schema(), m_metadata.delta(), basePoolBlockSize)
     , m_cache(cache)
+    , m_diskCache(attachDiskCache(m_endpoint, m_tmp, m_cache))
     , m_hierarchy(
             makeUnique<HierarchyReader>(
                 hierarchyPool,
@@ -288,12 +309,30 @@ bool Reader::exists(const QueryChunkState& c) const
         val = false;
 
         const auto f(m_metadata.filename(c.chunkId()));
-        if (const auto size = m_endpoint.tryGetSize(f)) val = *size;
+        if (Archive* archive = m_metadata.storage().archive())
+        {
+            val = archive->size(m_endpoint, f);
+        }
+        else if (const auto size = m_endpoint.tryGetSize(f)) val = *size;
         std::cout << m_endpoint.prefixedRoot() << f << ": " << val << std::endl;
         return val;
     }
 }
 
+const Projection* Reader::projection(
+        const std::set<std::string>& names) const
+{
+    auto projection(makeUnique<Projection>(m_metadata.schema(), names));
+    if (projection->full()) return nullptr;
+
+    const std::string key(projection->schema().toString());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& interned(m_projections[key]);
+    if (!interned) interned = std::move(projection);
+    return interned.get();
+}
+
 Json::Value Reader::hierarchy(
         const Bounds& inBounds,
         const std::size_t depthBegin,
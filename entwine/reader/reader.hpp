@@ -23,6 +23,7 @@
 #include <entwine/types/metadata.hpp>
 #include <entwine/types/outer-scope.hpp>
 #include <entwine/types/structure.hpp>
+#include <entwine/util/disk-cache.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 
 namespace entwine
@@ -44,6 +45,7 @@ class BaseChunkReader;
 class Bounds;
 class Cache;
 class Hierarchy;
+class Projection;
 class Schema;
 
 class Reader
@@ -144,6 +146,11 @@ public:
     const arbiter::Endpoint& tmp() const { return m_tmp; }
     bool exists(const QueryChunkState& state) const;
 
+    // The projection of the native schema to these dimensions, which lives as
+    // long as this Reader, or null if every dimension would be kept.  Equal
+    // projections share an address, so they may key cached chunks.
+    const Projection* projection(const std::set<std::string>& names) const;
+
     std::map<std::string, Schema> appends() const
     {
         return appends(true);
@@ -200,6 +207,9 @@ private:
     mutable PointPool m_pool;
     Cache& m_cache;
 
+    // Attached before our hierarchy, which is fetched as it's constructed.
+    std::unique_ptr<DiskCache::Attachment> m_diskCache;
+
     std::unique_ptr<HierarchyReader> m_hierarchy;
     std::unique_ptr<BaseChunkReader> m_base;
 
@@ -211,6 +221,7 @@ private:
 
     mutable std::mutex m_mutex;
     mutable std::map<Id, bool> m_pre;
+    mutable std::map<std::string, std::unique_ptr<Projection>> m_projections;
 
     std::map<std::string, Schema> m_appends;
 };
@@ -19,14 +19,25 @@
     FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
     DEALINGS IN THE SOFTWARE.
 ******************************************************************************/
+
+// This is a vendored copy of splice-pool with local modifications, each of
+// which is delimited by "BEGIN ENTWINE PATCH" / "END ENTWINE PATCH" (or, for
+// single statements, an "ENTWINE PATCH" comment):
+//      - Optional per-thread magazines, off unless a magazine size is given.
+//      - Lock-free allocated/available counts.
+//      - Block ownership lookup, for returning nodes to their own pool.
+
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <deque>
 #include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <type_traits>
@@ -718,6 +729,21 @@ private:
     Stack<T> m_stack;
 };
 
+// BEGIN ENTWINE PATCH - per-thread magazines.
+//
+// Threads are assigned magazine slots round-robin on first use, so each of the
+// first maxMagazines threads has a magazine of its own in every pool.  Beyond
+// that, threads share slots, which remain correct since magazines are locked.
+const std::size_t maxMagazines(64);
+
+inline std::size_t magazineSlot()
+{
+    static std::atomic<std::size_t> next(0);
+    thread_local const std::size_t slot(next++ % maxMagazines);
+    return slot;
+}
+// END ENTWINE PATCH
+
 template<typename T>
 class SplicePool
 {
@@ -735,23 +761,91 @@ public:
         , m_allocated(0)
     { }
 
+    // BEGIN ENTWINE PATCH - per-thread magazines.
+    //
+    // Magazines are opt-in.  With a nonzero magazineSize, single nodes, and
+    // stacks of up to magazineSize nodes, are acquired from and released to a
+    // per-thread magazine of cached nodes.  The magazine is refilled from, and
+    // spills back into, the shared stack in bulk splices, so the shared lock
+    // is taken once per magazineSize/2 nodes or so rather than once per node.
+    SplicePool(std::size_t blockSize, std::size_t magazineSize)
+        : SplicePool(blockSize)
+    {
+        m_magazineSize = magazineSize;
+        if (magazineSize) m_magazines.reset(new Magazine[maxMagazines]);
+    }
+
+    std::size_t magazineSize() const { return m_magazineSize; }
+
+    // Acquisitions served by a thread's magazine are hits, and those which
+    // had to refill it from the shared stack are misses.
+    struct MagazineStats
+    {
+        std::size_t slot;
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t cached;
+
+        double hitRate() const
+        {
+            const std::size_t total(hits + misses);
+            return total ? static_cast<double>(hits) / total : 0;
+        }
+    };
+
+    // Statistics for each magazine slot that has been used.
+    std::vector<MagazineStats> magazineStats() const
+    {
+        std::vector<MagazineStats> stats;
+
+        for (std::size_t i(0); m_magazines && i < maxMagazines; ++i)
+        {
+            const Magazine& mag(m_magazines[i]);
+            std::lock_guard<const Magazine> lock(mag);
+
+            if (mag.hits || mag.misses)
+            {
+                stats.push_back(
+                        MagazineStats { i, mag.hits, mag.misses, mag.size() });
+            }
+        }
+
+        return stats;
+    }
+
+    // Return every cached node to the shared stack.
+    void flush()
+    {
+        for (std::size_t i(0); m_magazines && i < maxMagazines; ++i)
+        {
+            Magazine& mag(m_magazines[i]);
+            std::lock_guard<const Magazine> magLock(mag);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stack.push(mag.stack);
+        }
+    }
+    // END ENTWINE PATCH
+
     virtual ~SplicePool() { }
 
+    // ENTWINE PATCH - these counts are relaxed atomics, so that callers
+    // polling them never contend with the pool.  Nodes cached in magazines
+    // count as available.
     std::size_t allocated() const
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return m_allocated;
+        return m_allocated.load(std::memory_order_relaxed);
     }
 
     std::size_t used() const
     {
-        return allocated() - available();
+        const std::size_t available(this->available());
+        const std::size_t allocated(this->allocated());
+        return allocated > available ? allocated - available : 0;
     }
 
     std::size_t available() const
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return m_stack.size();
+        return m_available.load(std::memory_order_relaxed);
     }
 
     void release(UniqueNodeType&& node) { node.reset(); }
@@ -762,11 +856,19 @@ public:
         if (node)
         {
             reset(&node->val());
+            m_available.fetch_add(1, std::memory_order_relaxed);
+
+            // BEGIN ENTWINE PATCH - per-thread magazines.
+            if (m_magazines)
+            {
+                Magazine& mag(magazine());
+                std::lock_guard<const Magazine> lock(mag);
+                mag.stack.push(node);
+                spill(mag);
+                return;
+            }
+            // END ENTWINE PATCH
 
-            // TODO - For these single node releases, we could put them into a
-            // separate Stack to avoid blocking the entire pool, and only reach
-            // into it when some threshold is reached or the main stack is
-            // empty.
             std::lock_guard<std::mutex> lock(m_mutex);
             m_stack.push(node);
         }
@@ -782,6 +884,19 @@ public:
                 node = node->next();
             }
 
+            m_available.fetch_add(other.size(), std::memory_order_relaxed);
+
+            // BEGIN ENTWINE PATCH - per-thread magazines.
+            if (m_magazines && other.size() <= m_magazineSize)
+            {
+                Magazine& mag(magazine());
+                std::lock_guard<const Magazine> lock(mag);
+                mag.stack.push(other);
+                spill(mag);
+                return;
+            }
+            // END ENTWINE PATCH
+
             std::lock_guard<std::mutex> lock(m_mutex);
             m_stack.push(other);
         }
@@ -792,22 +907,23 @@ public:
     {
         UniqueNodeType node(*this);
 
+        // BEGIN ENTWINE PATCH - per-thread magazines.
+        if (m_magazines)
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            node.reset(m_stack.pop());
+            Magazine& mag(magazine());
+            std::lock_guard<const Magazine> lock(mag);
+            refill(mag, 1);
+            node.reset(mag.stack.pop());
         }
-
-        if (!node)
+        // END ENTWINE PATCH
+        else
         {
-            Stack<T> newStack(doAllocate(1));
-            node.reset(newStack.pop());
-
-            std::lock_guard<std::mutex> lock(m_mutex);
-
-            m_allocated += m_blockSize;
-            m_stack.push(newStack);
+            Stack<T> taken(take(1));
+            node.reset(taken.pop());
         }
 
+        m_available.fetch_sub(1, std::memory_order_relaxed);
+
         if (!std::is_pointer<T>::value)
         {
             node.get()->construct(std::forward<Args>(args)...);
@@ -820,35 +936,21 @@ public:
     {
         UniqueStackType other(*this);
 
-        std::unique_lock<std::mutex> lock(m_mutex);
-        if (count >= m_stack.size())
+        // BEGIN ENTWINE PATCH - per-thread magazines.
+        if (m_magazines && count && count <= m_magazineSize)
         {
-            other = UniqueStackType(*this, std::move(m_stack));
-
-            lock.unlock();
-
-            if (count > other.size())
-            {
-                const std::size_t numNodes(count - other.size());
-                const std::size_t numBlocks(numNodes / m_blockSize + 1);
-
-                Stack<T> alloc(doAllocate(numBlocks));
-
-                assert(alloc.size() == numBlocks * m_blockSize);
-
-                Stack<T> taken(alloc.popStack(numNodes));
-                other.push(taken);
-
-                lock.lock();
-                m_stack.push(alloc);
-                m_allocated += numBlocks * m_blockSize;
-            }
+            Magazine& mag(magazine());
+            std::lock_guard<const Magazine> lock(mag);
+            refill(mag, count);
+            other = UniqueStackType(*this, mag.stack.popStack(count));
         }
+        // END ENTWINE PATCH
         else
         {
-            other = UniqueStackType(*this, m_stack.popStack(count));
+            other = UniqueStackType(*this, take(count));
         }
 
+        m_available.fetch_sub(count, std::memory_order_relaxed);
         return other;
     }
 
@@ -869,10 +971,107 @@ private:
     SplicePool(const SplicePool&) = delete;
     SplicePool& operator=(const SplicePool&) = delete;
 
+    // Pop count nodes from the shared stack, allocating more blocks if it
+    // runs short.
+    Stack<T> take(const std::size_t count)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        Stack<T> other(m_stack.popStack(count));
+        lock.unlock();
+
+        if (count > other.size())
+        {
+            const std::size_t numNodes(count - other.size());
+            const std::size_t numBlocks(numNodes / m_blockSize + 1);
+            const std::size_t allocating(numBlocks * m_blockSize);
+
+            Stack<T> alloc(doAllocate(numBlocks));
+
+            assert(alloc.size() == allocating);
+
+            Stack<T> taken(alloc.popStack(numNodes));
+            other.push(taken);
+
+            lock.lock();
+            m_stack.push(alloc);
+            m_allocated.fetch_add(allocating, std::memory_order_relaxed);
+            m_available.fetch_add(allocating, std::memory_order_relaxed);
+        }
+
+        return other;
+    }
+
+    // BEGIN ENTWINE PATCH - per-thread magazines.
+    //
+    // Magazines are only contended if threads share a slot, or while stats
+    // are read, so they are guarded by a flag rather than a full mutex.
+    struct Magazine
+    {
+        Magazine() : flag(), stack(), hits(0), misses(0) { flag.clear(); }
+
+        std::size_t size() const { return stack.size(); }
+
+        void lock() const
+        {
+            while (flag.test_and_set(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        void unlock() const { flag.clear(std::memory_order_release); }
+
+        mutable std::atomic_flag flag;
+        Stack<T> stack;
+        std::size_t hits;
+        std::size_t misses;
+
+        // Keep neighboring magazines off of each other's cache lines.
+        char pad[64];
+    };
+
+    Magazine& magazine() { return m_magazines[magazineSlot()]; }
+
+    // Called with the magazine locked.  Ensure it holds at least count nodes,
+    // topping it up to magazineSize if it does not.
+    void refill(Magazine& mag, const std::size_t count)
+    {
+        if (mag.size() >= count)
+        {
+            ++mag.hits;
+        }
+        else
+        {
+            ++mag.misses;
+            Stack<T> taken(take(m_magazineSize - mag.size()));
+            mag.stack.push(taken);
+        }
+    }
+
+    // Called with the magazine locked.  Once it overflows, return all but
+    // half of a magazine's worth to the shared stack, leaving room for both
+    // acquisitions and releases before it needs the shared lock again.
+    void spill(Magazine& mag)
+    {
+        if (mag.size() > m_magazineSize)
+        {
+            const std::size_t keep(m_magazineSize / 2);
+            Stack<T> spilled(mag.stack.popStack(mag.size() - keep));
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stack.push(spilled);
+        }
+    }
+
+    std::size_t m_magazineSize = 0;
+    std::unique_ptr<Magazine[]> m_magazines;
+    // END ENTWINE PATCH
+
     Stack<T> m_stack;
     mutable std::mutex m_mutex;
 
-    std::size_t m_allocated;
+    std::atomic<std::size_t> m_allocated;
+    std::atomic<std::size_t> m_available = { 0 };
 };
 
 template<typename T>
@@ -885,6 +1084,14 @@ public:
         , m_mutex()
     { }
 
+    // BEGIN ENTWINE PATCH - per-thread magazines.
+    ObjectPool(std::size_t blockSize, std::size_t magazineSize)
+        : SplicePool<T>(blockSize, magazineSize)
+        , m_blocks()
+        , m_mutex()
+    { }
+    // END ENTWINE PATCH
+
 private:
     virtual Stack<T> doAllocate(std::size_t blocks) override
     {
@@ -910,6 +1117,13 @@ private:
 
         std::lock_guard<std::mutex> lock(m_mutex);
 
+        // BEGIN ENTWINE PATCH - ownership lookup.
+        for (auto& block : newBlocks)
+        {
+            m_ranges[block->data()] = block->data() + block->size();
+        }
+        // END ENTWINE PATCH
+
         m_blocks.insert(
                 m_blocks.end(),
                 std::make_move_iterator(newBlocks.begin()),
@@ -930,6 +1144,21 @@ private:
 
     std::deque<std::unique_ptr<std::vector<Node<T>>>> m_blocks;
     mutable std::mutex m_mutex;
+
+    // BEGIN ENTWINE PATCH - ownership lookup.
+public:
+    // True if this node was allocated by this pool.
+    bool owns(const Node<T>* node) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it(m_ranges.upper_bound(node));
+        return it != m_ranges.begin() && node < (--it)->second;
+    }
+
+private:
+    // Each block's begin and end.
+    std::map<const Node<T>*, const Node<T>*> m_ranges;
+    // END ENTWINE PATCH
 };
 
 template<typename T>
@@ -945,6 +1174,20 @@ public:
         , m_mutex()
     { }
 
+    // BEGIN ENTWINE PATCH - per-thread magazines.
+    BufferPool(
+            std::size_t bufferSize,
+            std::size_t blockSize,
+            std::size_t magazineSize)
+        : SplicePool<T*>(blockSize, magazineSize)
+        , m_bufferSize(bufferSize)
+        , m_bytesPerBlock(m_bufferSize * this->m_blockSize)
+        , m_bytes()
+        , m_nodes()
+        , m_mutex()
+    { }
+    // END ENTWINE PATCH
+
 private:
     virtual Stack<T*> doAllocate(std::size_t blocks) override
     {
@@ -980,6 +1223,13 @@ private:
 
         std::lock_guard<std::mutex> lock(m_mutex);
 
+        // BEGIN ENTWINE PATCH - ownership lookup.
+        for (auto& block : newNodes)
+        {
+            m_ranges[block->data()] = block->data() + block->size();
+        }
+        // END ENTWINE PATCH
+
         m_bytes.insert(
                 m_bytes.end(),
                 std::make_move_iterator(newBytes.begin()),
@@ -1004,6 +1254,21 @@ private:
     std::deque<std::unique_ptr<std::vector<T>>> m_bytes;
     std::deque<std::unique_ptr<std::vector<Node<T*>>>> m_nodes;
     mutable std::mutex m_mutex;
+
+    // BEGIN ENTWINE PATCH - ownership lookup.
+public:
+    // True if this node was allocated by this pool.
+    bool owns(const Node<T*>* node) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it(m_ranges.upper_bound(node));
+        return it != m_ranges.begin() && node < (--it)->second;
+    }
+
+private:
+    // Each block's begin and end.
+    std::map<const Node<T*>*, const Node<T*>*> m_ranges;
+    // END ENTWINE PATCH
 };
 
 } // namespace splicer
@@ -10,33 +10,41 @@
 
 #include <entwine/tree/builder.hpp>
 
+#include <algorithm>
 #include <chrono>
 #include <limits>
 #include <numeric>
 #include <random>
 #include <thread>
+#include <vector>
 
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/third/splice-pool/splice-pool.hpp>
 #include <entwine/tree/chunk.hpp>
 #include <entwine/tree/climber.hpp>
 #include <entwine/tree/clipper.hpp>
+#include <entwine/tree/descent.hpp>
 #include <entwine/tree/heuristics.hpp>
 #include <entwine/tree/hierarchy-block.hpp>
 #include <entwine/tree/registry.hpp>
 #include <entwine/tree/sequence.hpp>
+#include <entwine/tree/serializer.hpp>
 #include <entwine/tree/thread-pools.hpp>
 #include <entwine/tree/traverser.hpp>
+#include <entwine/types/archive.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/metadata.hpp>
+#include <entwine/types/morton.hpp>
 #include <entwine/types/pooled-point-table.hpp>
 #include <entwine/types/reprojection.hpp>
 #include <entwine/types/schema.hpp>
+#include <entwine/types/storage.hpp>
 #include <entwine/types/structure.hpp>
 #include <entwine/types/subset.hpp>
 #include <entwine/util/compression.hpp>
 #include <entwine/util/executor.hpp>
 #include <entwine/util/json.hpp>
+#include <entwine/util/numa.hpp>
 #include <entwine/util/pool.hpp>
 #include <entwine/util/unique.hpp>
 
@@ -60,7 +68,9 @@ Builder::Builder(
     : m_arbiter(outerScope.getArbiter())
     , m_outEndpoint(makeUnique<Endpoint>(m_arbiter->getEndpoint(outPath)))
     , m_tmpEndpoint(makeUnique<Endpoint>(m_arbiter->getEndpoint(tmpPath)))
-    , m_threadPools(makeUnique<ThreadPools>(workThreads, clipThreads))
+    , m_numa(outerScope.getNuma())
+    , m_threadPools(
+            makeUnique<ThreadPools>(workThreads, clipThreads, m_numa.get()))
     , m_metadata(([this, &metadata]()
     {
         auto m(clone(metadata));
@@ -69,8 +79,18 @@ Builder::Builder(
     })())
     , m_isContinuation(false)
     , m_pointPool(
-            outerScope.getPointPool(m_metadata->schema(), m_metadata->delta()))
+            outerScope.getPointPool(
+                m_metadata->schema(),
+                m_metadata->delta(),
+                heuristics::poolBlockSize,
+                heuristics::poolMagazineSize))
+    , m_pointPools(makePointPools())
     , m_hierarchyPool(outerScope.getHierarchyPool(heuristics::poolBlockSize))
+    , m_serializer(
+            makeUnique<Serializer>(
+                m_metadata->storage(),
+                m_threadPools->clipPool().numThreads(),
+                outerScope.getSerialization()))
     , m_hierarchy(makeUnique<Hierarchy>(
                 *m_hierarchyPool,
                 *m_metadata,
@@ -94,12 +114,24 @@ Builder::Builder(
     : m_arbiter(outerScope.getArbiter())
     , m_outEndpoint(makeUnique<Endpoint>(m_arbiter->getEndpoint(outPath)))
     , m_tmpEndpoint(makeUnique<Endpoint>(m_arbiter->getEndpoint(tmpPath)))
-    , m_threadPools(makeUnique<ThreadPools>(workThreads, clipThreads))
+    , m_numa(outerScope.getNuma())
+    , m_threadPools(
+            makeUnique<ThreadPools>(workThreads, clipThreads, m_numa.get()))
     , m_metadata(Metadata::create(*m_outEndpoint, subsetId))
     , m_isContinuation(true)
     , m_pointPool(
-            outerScope.getPointPool(m_metadata->schema(), m_metadata->delta()))
+            outerScope.getPointPool(
+                m_metadata->schema(),
+                m_metadata->delta(),
+                heuristics::poolBlockSize,
+                heuristics::poolMagazineSize))
+    , m_pointPools(makePointPools())
     , m_hierarchyPool(outerScope.getHierarchyPool(heuristics::poolBlockSize))
+    , m_serializer(
+            makeUnique<Serializer>(
+                m_metadata->storage(),
+                m_threadPools->clipPool().numThreads(),
+                outerScope.getSerialization()))
     , m_hierarchy(
             makeUnique<Hierarchy>(
                 *m_hierarchyPool,
@@ -173,19 +205,27 @@ void Builder::go(std::size_t max)
                         (manifest.pointStats().inserts() + alreadyInserted) /
                         (double)(m_metadata->structure().numPointsHint()));
 
-                const auto& d(pointPool().dataPool());
+                std::size_t allocated(0);
+                std::size_t available(0);
+
+                for (const auto& pool : m_pointPools)
+                {
+                    allocated += pool->dataPool().allocated();
+                    available += pool->dataPool().available();
+                }
 
                 const std::size_t used(
-                        100.0 - 100.0 * d.available() / (double)d.allocated());
+                        100.0 - 100.0 * available / (double)allocated);
 
                 std::cout <<
                     " T: " << commify(s) << "s" <<
                     " P: " << commify(inserts * 3600.0 / s / 1000000.0) <<
                         "M/h" <<
-                    " A: " << commify(d.allocated()) <<
+                    " A: " << commify(allocated) <<
                     " U: " << used << "%"  <<
                     " C: " << commify(Chunk::count()) <<
                     " H: " << commify(HierarchyBlock::count()) <<
+                    " S: " << m_serializer->summary() <<
                     " I: " << commify(inserts) <<
                     " P: " << std::round(progress * 100.0) << "%" <<
                     std::endl;
@@ -321,6 +361,10 @@ void Builder::insertPath(const Origin origin, FileInfo& info)
     Clipper clipper(*this, origin);
     Climber climber(*m_metadata, m_hierarchy.get());
 
+    // In NUMA mode, this file's points are allocated from the pool of the
+    // node running this task.
+    PointPool& pool(pointPool());
+
     auto inserter([this, origin, &clipper, &climber, &inserted]
     (Cell::PooledStack cells)
     {
@@ -329,9 +373,24 @@ void Builder::insertPath(const Origin origin, FileInfo& info)
         if (inserted > heuristics::sleepCount)
         {
             inserted = 0;
-            const float available(m_pointPool->dataPool().available());
-            const float allocated(m_pointPool->dataPool().allocated());
-            if (available / allocated < 0.5) clipper.clip();
+
+            // Points move between the per-node pools as they're inserted and
+            // released, so only the totals are meaningful.
+            float available(0);
+            float allocated(0);
+            for (const auto& p : m_pointPools)
+            {
+                available += p->dataPool().available();
+                allocated += p->dataPool().allocated();
+            }
+
+            if (available / allocated < 0.5)
+            {
+                // Clipping hands chunks to the serializer.  If it is already
+                // full, wait for it to drain rather than queueing more.
+                m_serializer->throttle();
+                clipper.clip();
+            }
         }
 
         return insertData(std::move(cells), origin, clipper, climber);
@@ -339,7 +398,7 @@ void Builder::insertPath(const Origin origin, FileInfo& info)
 
     std::unique_ptr<PooledPointTable> table(
             PooledPointTable::create(
-                *m_pointPool,
+                pool,
                 inserter,
                 m_metadata->delta(),
                 origin));
@@ -362,7 +421,7 @@ Cell::PooledStack Builder::insertData(
         Climber& climber)
 {
     PointStats pointStats;
-    Cell::PooledStack rejected(m_pointPool->cellPool());
+    Cell::PooledStack rejected(pointPool().cellPool());
 
     auto reject([&rejected](Cell::PooledNode& cell)
     {
@@ -370,8 +429,24 @@ Cell::PooledStack Builder::insertData(
     });
 
     const Bounds& boundsConforming(m_metadata->boundsScaledEpsilon());
+    const Bounds& boundsCubic(m_metadata->boundsScaledCubic());
     const auto boundsSubset(m_metadata->boundsScaledSubset());
     const std::size_t baseDepthBegin(m_metadata->structure().baseDepthBegin());
+    const bool is3d(m_metadata->structure().is3d());
+
+    struct Entry
+    {
+        Entry(uint64_t key, Cell::PooledNode&& cell)
+            : key(key)
+            , cell(std::move(cell))
+        { }
+
+        uint64_t key;
+        Cell::PooledNode cell;
+    };
+
+    std::vector<Entry> batch;
+    batch.reserve(cells.size());
 
     while (!cells.empty())
     {
@@ -382,18 +457,11 @@ Cell::PooledStack Builder::insertData(
         {
             if (!boundsSubset || boundsSubset->contains(point))
             {
-                climber.reset();
-                climber.magnifyTo(point, baseDepthBegin);
-
-                if (m_registry->addPoint(cell, climber, clipper))
-                {
-                    pointStats.addInsert();
-                }
-                else
-                {
-                    reject(cell);
-                    pointStats.addOverflow();
-                }
+                const uint64_t key(
+                        is3d ?
+                            morton::key3d(point, boundsCubic) :
+                            morton::key2d(point, boundsCubic));
+                batch.emplace_back(key, std::move(cell));
             }
             else
             {
@@ -407,7 +475,89 @@ Cell::PooledStack Builder::insertData(
         }
     }
 
+    // Chunks are split in the dimensions of the structure, two for quadtrees
+    // and three for octrees, so ordering the batch by the Morton code over the
+    // same dimensions makes the points of each chunk contiguous at every
+    // depth.  Runs of points then hit the same chunk in succession, which lets
+    // the Clipper hand back the chunk directly rather than looking up its slot
+    // per point.  Points that overflow into a deeper level remain in the same
+    // order, so they form runs of their own in the chunks below.
+    std::stable_sort(
+            batch.begin(),
+            batch.end(),
+            [](const Entry& a, const Entry& b) { return a.key < b.key; });
+
+    // Descend the whole batch at once through the levels where precomputed
+    // paths pay off.  If there are none, for example when chunks begin at the
+    // root, skip the extra pass entirely.
+    const std::size_t pathLevels(
+            Descent::levels(m_metadata->structure(), baseDepthBegin));
+
+    std::vector<Descent::Path> paths;
+
+    if (pathLevels)
+    {
+        std::vector<double> xs(batch.size());
+        std::vector<double> ys(batch.size());
+        std::vector<double> zs(batch.size());
+        paths.resize(batch.size());
+
+        for (std::size_t i(0); i < batch.size(); ++i)
+        {
+            const Point& point(batch[i].cell->point());
+            xs[i] = point.x;
+            ys[i] = point.y;
+            zs[i] = point.z;
+        }
+
+        Descent::paths(
+                xs.data(),
+                ys.data(),
+                zs.data(),
+                batch.size(),
+                boundsCubic,
+                pathLevels,
+                paths.data());
+    }
+
+    for (std::size_t i(0); i < batch.size(); ++i)
+    {
+        Cell::PooledNode& cell(batch[i].cell);
+
+        climber.reset();
+
+        if (pathLevels)
+        {
+            climber.magnifyTo(cell->point(), paths[i], baseDepthBegin);
+        }
+        else
+        {
+            climber.magnifyTo(cell->point(), baseDepthBegin);
+        }
+
+        if (m_registry->addPoint(cell, climber, clipper))
+        {
+            pointStats.addInsert();
+        }
+        else
+        {
+            reject(cell);
+            pointStats.addOverflow();
+        }
+    }
+
     if (origin != invalidOrigin) m_metadata->manifest().add(origin, pointStats);
+
+    // A rejected cell may have been swapped out of a tube by a point from
+    // another node, so in NUMA mode the rejected cells go back to the pools
+    // that allocated them rather than to this node's table for reuse.  The
+    // table refills from its own node's pool.
+    if (m_pointPools.size() > 1)
+    {
+        PointPool::release(m_pointPools, std::move(rejected));
+        return Cell::PooledStack(pointPool().cellPool());
+    }
+
     return rejected;
 }
 
@@ -425,6 +575,9 @@ void Builder::save(const arbiter::Endpoint& ep)
 {
     m_threadPools->cycle();
 
+    if (verbose()) std::cout << "Awaiting chunk serialization..." << std::endl;
+    m_serializer->await();
+
     if (verbose()) std::cout << "Saving hierarchy..." << std::endl;
     m_hierarchy->save(m_threadPools->clipPool());
 
@@ -448,6 +601,13 @@ void Builder::merge(Builder& other)
         m_threadPools->clipPool().join();
     }
 
+    if (Archive* archive = m_metadata->storage().archive())
+    {
+        Archive* otherArchive(other.m_metadata->storage().archive());
+        if (!otherArchive) throw std::runtime_error("Invalid archive merge");
+        archive->merge(*m_outEndpoint, *otherArchive);
+    }
+
     m_registry->merge(*other.m_registry);
     m_hierarchy->merge(*other.m_hierarchy, m_threadPools->workPool());
     if (other.exists())
@@ -488,6 +648,13 @@ void Builder::prepareEndpoints()
                 throw std::runtime_error("Couldn't create " + rootDir + "h");
             }
 
+            if (
+                    m_metadata->storage().archive() &&
+                    !arbiter::fs::mkdirp(rootDir + "a"))
+            {
+                throw std::runtime_error("Couldn't create " + rootDir + "a");
+            }
+
             if (
                     m_metadata->cesiumSettings() &&
                     !arbiter::fs::mkdirp(rootDir + "cesium"))
@@ -513,7 +680,11 @@ const Sequence& Builder::sequence() const { return *m_sequence; }
 
 ThreadPools& Builder::threadPools() const { return *m_threadPools; }
 
-PointPool& Builder::pointPool() const { return *m_pointPool; }
+PointPool& Builder::pointPool() const
+{
+    return *m_pointPools[Numa::currentNode() % m_pointPools.size()];
+}
+
 std::shared_ptr<PointPool> Builder::sharedPointPool() const
 {
     return m_pointPool;
@@ -529,6 +700,29 @@ const arbiter::Endpoint& Builder::tmpEndpoint() const { return *m_tmpEndpoint; }
 
 std::mutex& Builder::mutex() { return m_mutex; }
 
+std::vector<std::shared_ptr<PointPool>> Builder::makePointPools() const
+{
+    if (!m_numa)
+    {
+        return std::vector<std::shared_ptr<PointPool>>(1, m_pointPool);
+    }
+
+    // The pool of the outer scope may be shared with other builders, whose
+    // threads aren't pinned, so even node 0 gets a pool of its own.
+    std::vector<std::shared_ptr<PointPool>> pools;
+    for (std::size_t i(0); i < m_numa->numNodes(); ++i)
+    {
+        pools.push_back(
+                std::make_shared<PointPool>(
+                    m_metadata->schema(),
+                    m_metadata->delta(),
+                    heuristics::poolBlockSize,
+                    heuristics::poolMagazineSize));
+    }
+
+    return pools;
+}
+
 void Builder::append(const FileInfoList& fileInfo)
 {
     m_metadata->manifest().append(fileInfo);
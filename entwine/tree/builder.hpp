@@ -47,11 +47,13 @@ class Clipper;
 class Executor;
 class FileInfo;
 class Metadata;
+class Numa;
 class Pool;
 class Registry;
 class Reprojection;
 class Schema;
 class Sequence;
+class Serializer;
 class Structure;
 class Subset;
 class ThreadPools;
@@ -95,13 +97,29 @@ public:
     const Registry& registry() const;
     const Hierarchy& hierarchy() const;
     ThreadPools& threadPools() const;
+    Serializer& serializer() const { return *m_serializer; }
     arbiter::Arbiter& arbiter();
     const arbiter::Arbiter& arbiter() const;
     const Sequence& sequence() const;
     Sequence& sequence();
 
+    // In NUMA mode, each node has its own PointPool, and this returns the
+    // pool of the calling thread's node.
     PointPool& pointPool() const;
+
+    // The pool of the outer scope, which other builders may share.  In NUMA
+    // mode this build doesn't allocate from it, since its per-node pools are
+    // its own.
     std::shared_ptr<PointPool> sharedPointPool() const;
+
+    // Every PointPool of this build, one per NUMA node.
+    const std::vector<std::shared_ptr<PointPool>>& pointPools() const
+    {
+        return m_pointPools;
+    }
+
+    // The NUMA topology of this build, or nullptr if not in NUMA mode.
+    const Numa* numa() const { return m_numa.get(); }
     std::shared_ptr<HierarchyCell::Pool> sharedHierarchyPool() const;
 
     bool isContinuation() const { return m_isContinuation; }
@@ -159,6 +177,10 @@ private:
     // Validate sources.
     void prepareEndpoints();
 
+    // Our shared point pool, followed by one more for each additional NUMA
+    // node.
+    std::vector<std::shared_ptr<PointPool>> makePointPools() const;
+
     // Ensure that the file at this path is accessible locally for execution.
     // Return the local path.
     std::string localize(std::string path, Origin origin);
@@ -169,6 +191,7 @@ private:
     std::unique_ptr<arbiter::Endpoint> m_outEndpoint;
     std::unique_ptr<arbiter::Endpoint> m_tmpEndpoint;
 
+    std::shared_ptr<Numa> m_numa;
     std::unique_ptr<ThreadPools> m_threadPools;
     std::unique_ptr<Metadata> m_metadata;
 
@@ -176,8 +199,13 @@ private:
     bool m_isContinuation;
 
     mutable std::shared_ptr<PointPool> m_pointPool;
+    std::vector<std::shared_ptr<PointPool>> m_pointPools;
     mutable std::shared_ptr<HierarchyCell::Pool> m_hierarchyPool;
 
+    // Chunks in flight reference our point pools, so this must outlive them,
+    // and is joined before the registry, which clips into it, goes away.
+    std::unique_ptr<Serializer> m_serializer;
+
     std::unique_ptr<Hierarchy> m_hierarchy;
     std::unique_ptr<Sequence> m_sequence;
     std::unique_ptr<Registry> m_registry;
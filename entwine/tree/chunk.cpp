@@ -22,6 +22,8 @@
 #include <entwine/formats/cesium/tile-builder.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/tree/builder.hpp>
+#include <entwine/tree/descent.hpp>
+#include <entwine/tree/serializer.hpp>
 #include <entwine/types/binary-point-table.hpp>
 #include <entwine/types/storage.hpp>
 #include <entwine/types/metadata.hpp>
@@ -64,12 +66,40 @@ void Chunk::populate(Cell::PooledStack cells)
 {
     Climber climber(m_metadata);
 
+    // Descend the whole chunk at once, through the levels where precomputed
+    // paths pay off.
+    const std::size_t levels(
+            Descent::levels(m_metadata.structure(), m_depth));
+    const std::size_t size(cells.size());
+    std::vector<double> xs(size), ys(size), zs(size);
+    std::vector<Descent::Path> paths(size);
+
+    std::size_t i(0);
+    for (const Cell& cell : cells)
+    {
+        const Point& point(cell.point());
+        xs[i] = point.x;
+        ys[i] = point.y;
+        zs[i] = point.z;
+        ++i;
+    }
+
+    Descent::paths(
+            xs.data(),
+            ys.data(),
+            zs.data(),
+            size,
+            m_metadata.boundsScaledCubic(),
+            levels,
+            paths.data());
+
+    i = 0;
     while (!cells.empty())
     {
         Cell::PooledNode cell(cells.popOne());
 
         climber.reset();
-        climber.magnifyTo(cell->point(), m_depth);
+        climber.magnifyTo(cell->point(), paths[i++], m_depth);
 
         insert(climber, cell);
     }
@@ -77,7 +107,7 @@ void Chunk::populate(Cell::PooledStack cells)
 
 void Chunk::save()
 {
-    storage().serialize(*this);
+    m_builder.serializer().push(*this);
 }
 
 Chunk::~Chunk()
@@ -146,15 +176,7 @@ Cell::PooledStack SparseChunk::acquire()
 {
     Cell::PooledStack cells(m_pointPool.cellPool());
 
-    for (auto& outer : m_tubes)
-    {
-        Tube& tube(outer.second);
-
-        for (auto& inner : tube)
-        {
-            cells.push(std::move(inner.second));
-        }
-    }
+    for (auto& outer : m_tubes) outer.second.acquire(cells);
 
     return cells;
 }
@@ -223,6 +245,7 @@ ContiguousChunk::ContiguousChunk(
         const bool exists)
     : Chunk(builder, bounds, depth, id, maxPoints)
     , m_tubes(maxPoints.getSimple())
+    , m_columns(m_tubes.size())
 {
     if (exists)
     {
@@ -238,10 +261,7 @@ Cell::PooledStack ContiguousChunk::acquire()
 {
     Cell::PooledStack cells(m_pointPool.cellPool());
 
-    for (Tube& tube : m_tubes)
-    {
-        for (auto& inner : tube) cells.push(std::move(inner.second));
-    }
+    for (Tube& tube : m_tubes) tube.acquire(cells);
 
     return cells;
 }
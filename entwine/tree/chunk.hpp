@@ -77,7 +77,9 @@ public:
 
     virtual Cell::PooledStack acquire() = 0;
 
-    Tube::Insertion insert(const Climber& climber, Cell::PooledNode& cell)
+    virtual Tube::Insertion insert(
+            const Climber& climber,
+            Cell::PooledNode& cell)
     {
         return getTube(climber).insert(climber, cell);
     }
@@ -181,6 +183,14 @@ public:
 
     virtual cesium::TileInfo info() const override;
 
+    virtual Tube::Insertion insert(
+            const Climber& climber,
+            Cell::PooledNode& cell) override
+    {
+        const std::size_t i(normalize(climber.index()));
+        return m_tubes.at(i).insert(climber, cell, m_columns.at(i));
+    }
+
     bool empty() const
     {
         for (const auto& tube : m_tubes)
@@ -214,6 +224,7 @@ protected:
                 m_tubes.end(),
                 std::make_move_iterator(other.m_tubes.begin()),
                 std::make_move_iterator(other.m_tubes.end()));
+        m_columns.append(other.m_columns);
 
         m_maxPoints += other.maxPoints();
     }
@@ -222,10 +233,16 @@ protected:
     {
         m_id = endId();
         m_tubes.clear();
+        m_columns.clear();
         m_maxPoints = 0;
     }
 
     std::vector<Tube> m_tubes;
+
+    // The coordinates resident in our tubes' inline slots, so that insertion
+    // streams through these columns instead of through pooled cells.  Sparse
+    // chunks don't keep them - their tubes aren't contiguous anyway.
+    TubeColumns m_columns;
 };
 
 class BaseChunk : public Chunk
@@ -241,6 +258,13 @@ public:
 
     virtual void save() override;
 
+    virtual Tube::Insertion insert(
+            const Climber& climber,
+            Cell::PooledNode& cell) override
+    {
+        return m_chunks.at(climber.depth()).insert(climber, cell);
+    }
+
 private:
     virtual Cell::PooledStack acquire() override
     {
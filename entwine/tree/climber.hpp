@@ -10,11 +10,13 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <iomanip>
 #include <iostream>
 
+#include <entwine/tree/descent.hpp>
 #include <entwine/tree/hierarchy.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/dir.hpp>
@@ -67,7 +69,7 @@ public:
         }
 
         m_index <<= m_structure.dimensions();
-        ++m_index.data().front();
+        ++m_index;
         m_index += toIntegral(dir, m_structure.tubular());
 
         if (workingDepth > m_structure.nominalChunkDepth())
@@ -76,6 +78,58 @@ public:
         }
     }
 
+    // Equivalent to calling climb(point) once per level, for a point whose
+    // path from our original bounds has been computed by Descent.  Only valid
+    // while our bounds are still the original bounds, in other words, right
+    // after construction or reset().
+    //
+    // Rather than shifting and adding our BigUint index at every level, the
+    // index offset over all levels is accumulated in 64 bits and applied
+    // once.  Chunk descent, when it applies, still happens level by level.
+    void climb(
+            const Point& point,
+            const Descent::Path path,
+            const std::size_t levels)
+    {
+        assert(levels <= Descent::maxLevels());
+
+        const std::size_t dimensions(m_structure.dimensions());
+        const bool tubular(m_structure.tubular());
+
+        uint64_t offset(0);
+        std::size_t shift(0);
+        std::size_t used(0);
+
+        for (std::size_t i(0); i < levels; ++i)
+        {
+            if (++m_depth <= m_structure.startDepth()) continue;
+
+            const std::size_t workingDepth(depth());
+            const Dir dir(Descent::at(path, used++));
+            m_bounds.go(dir);
+
+            if (tubular && workingDepth <= Tube::maxTickDepth())
+            {
+                m_tick <<= 1;
+                if (isUp(dir)) ++m_tick;
+            }
+
+            offset = (offset << dimensions) + 1 + toIntegral(dir, tubular);
+            shift += dimensions;
+
+            if (workingDepth > m_structure.nominalChunkDepth())
+            {
+                chunkClimb(workingDepth, point);
+            }
+        }
+
+        if (shift)
+        {
+            m_index <<= shift;
+            m_index += offset;
+        }
+    }
+
     PointState getClimb(Dir dir) const
     {
         PointState s(*this);
@@ -124,7 +178,7 @@ protected:
             m_chunkBounds.go(dir, true);
 
             m_chunkId <<= m_structure.dimensions();
-            ++m_chunkId.data().front();
+            ++m_chunkId;
 
             m_chunkId += toIntegral(dir) * m_pointsPerChunk;
 
@@ -140,7 +194,7 @@ protected:
             m_chunkNum += m_structure.maxChunksPerDepth();
 
             m_chunkId <<= m_structure.dimensions();
-            ++m_chunkId.data().front();
+            ++m_chunkId;
 
             m_pointsPerChunk *= m_structure.factor();
         }
@@ -351,6 +405,29 @@ public:
         while (m_pointState.depth() < depth) magnify(point);
     }
 
+    // As above, using a path from Descent for as many levels as
+    // Descent::levels() allows.  Must follow a reset().
+    void magnifyTo(
+            const Point& point,
+            const Descent::Path path,
+            const std::size_t depth)
+    {
+        const std::size_t current(m_pointState.depth());
+
+        if (current < depth)
+        {
+            const std::size_t levels(
+                    std::min(
+                        depth - current,
+                        Descent::levels(m_metadata.structure(), depth)));
+
+            m_pointState.climb(point, path, levels);
+            m_hierarchyState.climb(point, path, levels);
+        }
+
+        magnifyTo(point, depth);
+    }
+
     void magnifyTo(const Bounds& bounds)
     {
         Bounds norm(bounds.min(), bounds.max());
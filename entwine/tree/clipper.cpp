@@ -11,6 +11,8 @@
 #include <entwine/tree/clipper.hpp>
 #include <entwine/tree/heuristics.hpp>
 
+#include <stdexcept>
+
 namespace entwine
 {
 
@@ -42,8 +44,19 @@ void Clipper::clip()
 
 void Clipper::clip(const Id& chunkId)
 {
-    m_builder.clip(chunkId, m_clips.at(chunkId).chunkNum, m_id, true);
-    m_clips.erase(chunkId);
+    auto it(m_clips.find(chunkId));
+    if (it == m_clips.end()) throw std::out_of_range("Chunk is not held");
+
+    for (auto& cached : m_fastCache)
+    {
+        if (cached == it) cached = m_clips.end();
+    }
+
+    // Remove it from our ordering as well, so clip() can't visit it later.
+    m_order.erase(*it->second.orderIt);
+
+    m_builder.clip(chunkId, it->second.chunkNum, m_id, true);
+    m_clips.erase(it);
 }
 
 } // namespace entwine
@@ -23,6 +23,8 @@
 namespace entwine
 {
 
+class Chunk;
+
 class Clipper
 {
 private:
@@ -31,17 +33,26 @@ private:
         using Map = std::map<Id, ClipInfo>;
         using Order = std::list<Map::iterator>;
 
-        ClipInfo() : chunkNum(0), fresh(true), orderIt() { }
+        ClipInfo()
+            : chunkNum(0)
+            , fresh(true)
+            , orderIt()
+            , chunk(nullptr)
+        { }
 
         explicit ClipInfo(std::size_t chunkNum)
             : chunkNum(chunkNum)
             , fresh(true)
             , orderIt()
+            , chunk(nullptr)
         { }
 
         std::size_t chunkNum;
         bool fresh;
         std::unique_ptr<Order::iterator> orderIt;
+
+        // Our reference keeps this chunk alive for as long as we hold it.
+        Chunk* chunk;
     };
 
 public:
@@ -73,12 +84,7 @@ public:
 
             if (it != m_clips.end() && it->first == chunkId)
             {
-                it->second.fresh = true;
-                m_order.splice(
-                        m_order.begin(),
-                        m_order,
-                        *it->second.orderIt);
-
+                touch(it);
                 return false;
             }
         }
@@ -88,13 +94,7 @@ public:
         if (it != m_clips.end())
         {
             if (depth < m_fastCache.size()) m_fastCache[depth] = it;
-
-            it->second.fresh = true;
-            m_order.splice(
-                    m_order.begin(),
-                    m_order,
-                    *it->second.orderIt);
-
+            touch(it);
             return false;
         }
         else
@@ -112,12 +112,54 @@ public:
         }
     }
 
+    // If chunkId is the chunk most recently inserted at this depth and its
+    // Chunk has been cached via setChunk(), refresh it as insert() would and
+    // return the Chunk.  Otherwise returns nullptr.  Since batches are
+    // inserted in spatial order, successive points usually land in the same
+    // chunk at each depth, so this skips both the Cold slot lookup and our
+    // own map lookup for most of them.
+    Chunk* chunk(const Id& chunkId, std::size_t depth)
+    {
+        assert(depth >= m_startDepth);
+        depth -= m_startDepth;
+        if (depth >= m_fastCache.size()) return nullptr;
+
+        auto& it(m_fastCache[depth]);
+
+        if (it != m_clips.end() && it->second.chunk && it->first == chunkId)
+        {
+            touch(it);
+            return it->second.chunk;
+        }
+
+        return nullptr;
+    }
+
+    // Must follow a call to insert() for this chunkId and depth.
+    void setChunk(const Id& chunkId, std::size_t depth, Chunk& chunk)
+    {
+        depth -= m_startDepth;
+        if (depth >= m_fastCache.size()) return;
+
+        auto& it(m_fastCache[depth]);
+        if (it != m_clips.end() && it->first == chunkId)
+        {
+            it->second.chunk = &chunk;
+        }
+    }
+
     void clip();
     void clip(const Id& chunkId);
     std::size_t id() const { return m_id; }
     std::size_t size() const { return m_clips.size(); }
 
 private:
+    void touch(ClipInfo::Map::iterator it)
+    {
+        it->second.fresh = true;
+        m_order.splice(m_order.begin(), m_order, *it->second.orderIt);
+    }
+
     Builder& m_builder;
     const std::size_t m_startDepth;
     const uint64_t m_id;
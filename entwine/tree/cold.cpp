@@ -37,6 +37,9 @@ namespace
     const auto createSleepTime(std::chrono::milliseconds(500));
 
     const std::size_t maxFastTrackers(std::pow(4, 12));
+
+    LockSite insertSite("cold-insert");
+    LockSite clipSite("cold-clip");
 }
 
 Cold::Cold(const Builder& builder, bool exists)
@@ -94,6 +97,11 @@ Tube::Insertion Cold::insert(
         return m_base.t->chunk->insert(climber, cell);
     }
 
+    if (Chunk* chunk = clipper.chunk(climber.chunkId(), climber.depth()))
+    {
+        return chunk->insert(climber, cell);
+    }
+
     auto& slot(getOrCreate(climber.chunkId(), climber.chunkNum()));
     std::unique_ptr<CountedChunk>& countedChunk(slot.t);
 
@@ -102,7 +110,7 @@ Tube::Insertion Cold::insert(
     // existence.
     if (clipper.insert(climber.chunkId(), climber.chunkNum(), climber.depth()))
     {
-        UniqueSpin slotLock(slot.spinner);
+        UniqueSpin slotLock(slot.spinner, insertSite);
 
         const bool alreadyExists(slot.exists);
         slot.exists = true;
@@ -120,7 +128,9 @@ Tube::Insertion Cold::insert(
         }
     }
 
-    return countedChunk->chunk->insert(climber, cell);
+    Chunk& chunk(*countedChunk->chunk);
+    clipper.setChunk(climber.chunkId(), climber.depth(), chunk);
+    return chunk.insert(climber, cell);
 }
 
 void Cold::ensureChunk(
@@ -259,7 +269,7 @@ void Cold::clip(
 
     auto unref([this, chunkId, &slot, id]()
     {
-        SpinGuard lock(slot.spinner);
+        SpinGuard lock(slot.spinner, clipSite);
         assert(slot.t);
 
         if (m_builder.metadata().cesiumSettings() && slot.t->unique())
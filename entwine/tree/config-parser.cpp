@@ -11,6 +11,7 @@
 #include <cmath>
 #include <limits>
 #include <numeric>
+#include <stdexcept>
 
 #include <entwine/tree/config-parser.hpp>
 
@@ -27,6 +28,7 @@
 #include <entwine/types/schema.hpp>
 #include <entwine/types/subset.hpp>
 #include <entwine/util/env.hpp>
+#include <entwine/util/numa.hpp>
 #include <entwine/util/unique.hpp>
 
 namespace entwine
@@ -54,6 +56,39 @@ namespace
 
         return settings;
     }
+
+    // The "numa" key may be a boolean, or a node count to emulate.  Zero or
+    // true uses the detected topology.
+    std::shared_ptr<Numa> getNuma(const Json::Value& json)
+    {
+        std::shared_ptr<Numa> numa;
+
+        if (json.isBool() && json.asBool())
+        {
+            numa = std::make_shared<Numa>(Numa::create());
+        }
+        else if (json.isIntegral())
+        {
+            numa = std::make_shared<Numa>(Numa::create(json.asUInt64()));
+        }
+
+        return numa;
+    }
+
+    // Zero, if unset, selects zstd's default level.
+    int getHierarchyLevel(const Json::Value& json)
+    {
+        if (json.isNull()) return 0;
+
+        if (!json.isIntegral() || json.asInt64() < 1 || json.asInt64() > 22)
+        {
+            throw std::runtime_error(
+                    "Invalid compressHierarchyLevel: must be an integer "
+                    "from 1 to 22");
+        }
+
+        return json.asInt();
+    }
 }
 
 Json::Value ConfigParser::defaults()
@@ -104,6 +139,7 @@ std::unique_ptr<Builder> ConfigParser::getBuilder(
     const std::string tmp(json["tmp"].asString());
     const std::vector<std::string> preserveSpatial(
             extract<std::string>(json["preserveSpatial"]));
+    const int hierarchyLevel(getHierarchyLevel(json["compressHierarchyLevel"]));
 
     std::size_t workThreads(0);
     std::size_t clipThreads(0);
@@ -364,7 +400,10 @@ std::unique_ptr<Builder> ConfigParser::getBuilder(
     }
 
     Structure hierarchyStructure(Hierarchy::structure(structure, subset.get()));
-    const HierarchyCompression hierarchyCompression(HierarchyCompression::Lzma);
+    const HierarchyCompression hierarchyCompression(
+            json.isMember("compressHierarchy") ?
+                toHierarchyCompression(json["compressHierarchy"]) :
+                HierarchyCompression::Lzma);
 
     const auto ep(arbiter->getEndpoint(json["output"].asString()));
     const Manifest manifest(fileInfo, ep);
@@ -378,6 +417,9 @@ std::unique_ptr<Builder> ConfigParser::getBuilder(
             trustHeaders,
             storage,
             hierarchyCompression,
+            hierarchyLevel,
+            json["archive"].asBool(),
+            json["quantize"].asBool(),
             density,
             reprojection.get(),
             subset.get(),
@@ -388,6 +430,8 @@ std::unique_ptr<Builder> ConfigParser::getBuilder(
 
     OuterScope outerScope;
     outerScope.setArbiter(arbiter);
+    outerScope.setNuma(getNuma(json["numa"]));
+    outerScope.setSerialization(json["serialization"]);
 
     auto builder = makeUnique<Builder>(
             metadata,
@@ -420,6 +464,8 @@ std::unique_ptr<Builder> ConfigParser::tryGetExisting(
 
     OuterScope os;
     os.setArbiter(arbiter);
+    os.setNuma(getNuma(config["numa"]));
+    os.setSerialization(config["serialization"]);
 
     return Builder::tryCreateExisting(
             outPath,
@@ -0,0 +1,191 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/tree/descent.hpp>
+
+#include <algorithm>
+
+#if !defined(ENTWINE_NO_SIMD) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define ENTWINE_DESCENT_AVX2
+#include <immintrin.h>
+#endif
+
+namespace entwine
+{
+
+namespace
+{
+#ifdef ENTWINE_DESCENT_AVX2
+    // Four points per iteration: each lane holds its own bounds, which are
+    // halved exactly as Bounds::go does - min + (max - min) / 2 - so that
+    // the results match the scalar climb bit-for-bit.
+    __attribute__((target("avx2")))
+    void pathsAvx2(
+            const double* x,
+            const double* y,
+            const double* z,
+            const std::size_t n,
+            const Bounds& bounds,
+            const std::size_t levels,
+            Descent::Path* out)
+    {
+        const __m256d two(_mm256_set1_pd(2.0));
+
+        const __m256d xMinStart(_mm256_set1_pd(bounds.min().x));
+        const __m256d yMinStart(_mm256_set1_pd(bounds.min().y));
+        const __m256d zMinStart(_mm256_set1_pd(bounds.min().z));
+        const __m256d xMaxStart(_mm256_set1_pd(bounds.max().x));
+        const __m256d yMaxStart(_mm256_set1_pd(bounds.max().y));
+        const __m256d zMaxStart(_mm256_set1_pd(bounds.max().z));
+
+        const std::size_t whole(n - n % 4);
+
+        for (std::size_t i(0); i < whole; i += 4)
+        {
+            const __m256d px(_mm256_loadu_pd(x + i));
+            const __m256d py(_mm256_loadu_pd(y + i));
+            const __m256d pz(_mm256_loadu_pd(z + i));
+
+            __m256d xMin(xMinStart), yMin(yMinStart), zMin(zMinStart);
+            __m256d xMax(xMaxStart), yMax(yMaxStart), zMax(zMaxStart);
+
+            __m256i path(_mm256_setzero_si256());
+
+            for (std::size_t level(0); level < levels; ++level)
+            {
+                const __m256d xMid(_mm256_add_pd(
+                            xMin,
+                            _mm256_div_pd(_mm256_sub_pd(xMax, xMin), two)));
+                const __m256d yMid(_mm256_add_pd(
+                            yMin,
+                            _mm256_div_pd(_mm256_sub_pd(yMax, yMin), two)));
+                const __m256d zMid(_mm256_add_pd(
+                            zMin,
+                            _mm256_div_pd(_mm256_sub_pd(zMax, zMin), two)));
+
+                const __m256d east(_mm256_cmp_pd(px, xMid, _CMP_GE_OQ));
+                const __m256d north(_mm256_cmp_pd(py, yMid, _CMP_GE_OQ));
+                const __m256d up(_mm256_cmp_pd(pz, zMid, _CMP_GE_OQ));
+
+                xMin = _mm256_blendv_pd(xMin, xMid, east);
+                xMax = _mm256_blendv_pd(xMid, xMax, east);
+                yMin = _mm256_blendv_pd(yMin, yMid, north);
+                yMax = _mm256_blendv_pd(yMid, yMax, north);
+                zMin = _mm256_blendv_pd(zMin, zMid, up);
+                zMax = _mm256_blendv_pd(zMid, zMax, up);
+
+                // Each comparison mask is all ones or all zeros - isolate
+                // the Dir bit that it represents and merge them.
+                const __m256i dir(
+                        _mm256_or_si256(
+                            _mm256_and_si256(
+                                _mm256_castpd_si256(east),
+                                _mm256_set1_epi64x(1)),
+                            _mm256_or_si256(
+                                _mm256_and_si256(
+                                    _mm256_castpd_si256(north),
+                                    _mm256_set1_epi64x(2)),
+                                _mm256_and_si256(
+                                    _mm256_castpd_si256(up),
+                                    _mm256_set1_epi64x(4)))));
+
+                path = _mm256_or_si256(
+                        path,
+                        _mm256_sll_epi64(
+                            dir,
+                            _mm_cvtsi32_si128(static_cast<int>(3 * level))));
+            }
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), path);
+        }
+
+        if (whole < n)
+        {
+            Descent::pathsScalar(
+                    x + whole,
+                    y + whole,
+                    z + whole,
+                    n - whole,
+                    bounds,
+                    levels,
+                    out + whole);
+        }
+    }
+
+    bool hasAvx2()
+    {
+        static const bool result(__builtin_cpu_supports("avx2"));
+        return result;
+    }
+#endif
+}
+
+void Descent::paths(
+        const double* x,
+        const double* y,
+        const double* z,
+        const std::size_t n,
+        const Bounds& bounds,
+        std::size_t levels,
+        Path* out)
+{
+    levels = std::min(levels, maxLevels());
+
+#ifdef ENTWINE_DESCENT_AVX2
+    if (hasAvx2())
+    {
+        pathsAvx2(x, y, z, n, bounds, levels, out);
+        return;
+    }
+#endif
+
+    pathsScalar(x, y, z, n, bounds, levels, out);
+}
+
+void Descent::pathsScalar(
+        const double* x,
+        const double* y,
+        const double* z,
+        const std::size_t n,
+        const Bounds& bounds,
+        std::size_t levels,
+        Path* out)
+{
+    levels = std::min(levels, maxLevels());
+
+    for (std::size_t i(0); i < n; ++i)
+    {
+        const Point p(x[i], y[i], z[i]);
+        Bounds current(bounds);
+        Path path(0);
+
+        for (std::size_t level(0); level < levels; ++level)
+        {
+            const Dir dir(getDirection(current.mid(), p));
+            current.go(dir);
+            path |= static_cast<Path>(toIntegral(dir)) << (3 * level);
+        }
+
+        out[i] = path;
+    }
+}
+
+bool Descent::vectorized()
+{
+#ifdef ENTWINE_DESCENT_AVX2
+    return hasAvx2();
+#else
+    return false;
+#endif
+}
+
+} // namespace entwine
+
@@ -0,0 +1,85 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/dir.hpp>
+#include <entwine/types/structure.hpp>
+
+namespace entwine
+{
+
+// Computes the octree paths of a batch of points at once.  A path holds the
+// Dir taken at each level while descending from the given bounds toward a
+// point - exactly as successive PointState::climb(point) calls would choose
+// them - packed three bits per level with the first level in the lowest bits.
+//
+// On x86 CPUs supporting AVX2, four points are descended per instruction.
+// Otherwise, or if ENTWINE_NO_SIMD is defined at build time, the scalar path
+// is used.  Both produce identical results, since the vectorized kernel
+// performs the same floating point operations as Bounds::go.
+class Descent
+{
+public:
+    using Path = uint64_t;
+
+    // Deep enough to cover the base and nominal chunk depths of any typical
+    // structure, while leaving headroom for PointState to accumulate indices
+    // over this many levels in 64 bits.
+    static constexpr std::size_t maxLevels() { return 20; }
+
+    // The number of levels, of the first depth levels from the root, worth
+    // descending by path.  Below the nominal chunk depth, every level still
+    // descends the BigUint chunk id one step at a time, which dominates the
+    // cost - there a path saves nothing and its extra pass over the batch is
+    // a net loss, so those levels are left to the per-level climb.
+    static std::size_t levels(const Structure& structure, std::size_t depth)
+    {
+        return std::min(
+                std::min(depth, maxLevels()),
+                structure.startDepth() + structure.nominalChunkDepth());
+    }
+
+    // Write the paths of n points, given as separate coordinate arrays, into
+    // out.  Levels beyond maxLevels() are not computed.
+    static void paths(
+            const double* x,
+            const double* y,
+            const double* z,
+            std::size_t n,
+            const Bounds& bounds,
+            std::size_t levels,
+            Path* out);
+
+    static void pathsScalar(
+            const double* x,
+            const double* y,
+            const double* z,
+            std::size_t n,
+            const Bounds& bounds,
+            std::size_t levels,
+            Path* out);
+
+    // True if paths() dispatches to the vectorized kernel on this machine.
+    static bool vectorized();
+
+    static Dir at(Path path, std::size_t level)
+    {
+        return toDir((path >> (3 * level)) & 7);
+    }
+};
+
+} // namespace entwine
+
@@ -29,10 +29,25 @@ const std::size_t clipCacheSize(64);
 // work threads to clip threads.
 const float defaultWorkToClipRatio(0.33);
 
+// Chunk serialization is pipelined: clip threads gather chunks, which are
+// then encoded and written by pools of their own.  Writes mostly wait on I/O,
+// so their concurrency is limited separately from that of the CPU-bound
+// encoding, which by default gets as many threads as clipping.
+const std::size_t serializeIoThreads(8);
+
+// The number of gathered chunks which may wait for each serialization stage
+// before the previous stage blocks.
+const std::size_t serializeQueueSize(8);
+
 // Pooled point cells, data, and hierarchy nodes come from the splice pool,
 // which allocates them in blocks.  This sets the block size.
 const std::size_t poolBlockSize(1024 * 1024);
 
+// Builder point pools cache up to this many nodes per thread, so that most
+// single-point acquisitions and releases skip the pool's shared lock.  Other
+// pools, e.g. those of the reader, don't use these per-thread magazines.
+const std::size_t poolMagazineSize(256);
+
 // Since hierarchy blocks simply count bucketed points, after the sparse depth
 // we don't expect to see much reduction in hierarchy block size - we just
 // expect their average magnitudes to decrease.  So keep splitting hierarchy
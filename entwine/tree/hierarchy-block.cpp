@@ -26,10 +26,66 @@ namespace entwine
 namespace
 {
     std::atomic_size_t chunkCount(0);
+
+    void pushVarint(std::vector<char>& data, uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            data.push_back(static_cast<char>((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+
+        data.push_back(static_cast<char>(v));
+    }
+
+    // Writes tubes in the compact format.  Tubes must be written in ascending
+    // order of their Ids.
+    class CompactWriter
+    {
+    public:
+        void write(const Id& id, const HierarchyTube& tube)
+        {
+            if (tube.empty()) return;
+
+            const Id delta(id - m_prev);
+            if (delta.trivial() && delta.getSimple() < (1ULL << 63))
+            {
+                pushVarint(m_data, delta.getSimple() << 1);
+            }
+            else
+            {
+                const std::vector<Id::Block> blocks(delta.blocks());
+                pushVarint(m_data, (blocks.size() << 1) | 1);
+                for (const Id::Block block : blocks) pushVarint(m_data, block);
+            }
+
+            pushVarint(m_data, tube.size());
+
+            uint64_t prev(0);
+            for (const auto& cell : tube)
+            {
+                pushVarint(m_data, cell.first - prev);
+                pushVarint(m_data, cell.second->val());
+                prev = cell.first;
+            }
+
+            m_prev = id;
+        }
+
+        std::vector<char>& data() { return m_data; }
+
+    private:
+        std::vector<char> m_data;
+        Id m_prev;
+    };
 }
 
 std::size_t HierarchyBlock::count() { return chunkCount; }
 
+LockSite HierarchyCell::s_lockSite("hierarchy-cell");
+LockSite ContiguousBlock::s_lockSite("hierarchy-contiguous");
+LockSite SparseBlock::s_lockSite("hierarchy-sparse");
+
 HierarchyBlock::HierarchyBlock(
         HierarchyCell::Pool& pool,
         const Metadata& metadata,
@@ -100,6 +156,12 @@ std::unique_ptr<HierarchyBlock> HierarchyBlock::create(
     {
         decompressed = Compression::decompressLzma(data);
     }
+#ifdef ENTWINE_HAVE_ZSTD
+    else if (compress == HierarchyCompression::Zstd)
+    {
+        decompressed = Compression::decompressZstd(data);
+    }
+#endif
 
     if (!id)
     {
@@ -109,29 +171,29 @@ std::unique_ptr<HierarchyBlock> HierarchyBlock::create(
                 outEndpoint,
                 decompressed ? *decompressed : data);
     }
-    else if (id < metadata.hierarchyStructure().mappedIndexBegin())
+    else if (readOnly)
     {
-        return makeUnique<ContiguousBlock>(
+        return makeUnique<ReadOnlyBlock>(
                 pool,
                 metadata,
                 id,
                 outEndpoint,
-                maxPoints.getSimple(),
+                maxPoints,
                 decompressed ? *decompressed : data);
     }
-    else if (!readOnly)
+    else if (id < metadata.hierarchyStructure().mappedIndexBegin())
     {
-        return makeUnique<SparseBlock>(
+        return makeUnique<ContiguousBlock>(
                 pool,
                 metadata,
                 id,
                 outEndpoint,
-                maxPoints,
+                maxPoints.getSimple(),
                 decompressed ? *decompressed : data);
     }
     else
     {
-        return makeUnique<ReadOnlySparseBlock>(
+        return makeUnique<SparseBlock>(
                 pool,
                 metadata,
                 id,
@@ -150,10 +212,60 @@ void HierarchyBlock::save(const arbiter::Endpoint& ep, const std::string pf)
     {
         data = *Compression::compressLzma(data);
     }
+#ifdef ENTWINE_HAVE_ZSTD
+    else if (type == HierarchyCompression::Zstd)
+    {
+        data = *Compression::compressZstd(
+                data,
+                m_metadata.storage().hierarchyCompressionLevel());
+    }
+#endif
 
     io::ensurePut(ep, m_id.str() + pf, data);
 }
 
+bool HierarchyBlock::compact() const
+{
+    return m_metadata.storage().hierarchyFormat() == HierarchyFormat::Compact;
+}
+
+void HierarchyBlock::parseCompact(const char* pos, const char* end)
+{
+    std::vector<Id::Block> blocks;
+    Id tube;
+
+    while (pos < end)
+    {
+        const uint64_t head(extractVarint(pos, end));
+
+        if (!(head & 1))
+        {
+            tube += head >> 1;
+        }
+        else
+        {
+            blocks.resize(head >> 1);
+            if (blocks.empty())
+            {
+                throw std::runtime_error(
+                        "Corrupt hierarchy block: " + m_id.str());
+            }
+
+            for (Id::Block& block : blocks) block = extractVarint(pos, end);
+            tube += Id(blocks.data(), blocks.data() + blocks.size());
+        }
+
+        const uint64_t cells(extractVarint(pos, end));
+        uint64_t tick(0);
+
+        for (uint64_t i(0); i < cells; ++i)
+        {
+            tick += extractVarint(pos, end);
+            insertCold(tube, tick, extractVarint(pos, end));
+        }
+    }
+}
+
 ContiguousBlock::ContiguousBlock(
         HierarchyCell::Pool& pool,
         const Metadata& metadata,
@@ -168,6 +280,12 @@ ContiguousBlock::ContiguousBlock(
     const char* pos(data.data());
     const char* end(data.data() + data.size());
 
+    if (compact())
+    {
+        parseCompact(pos, end);
+        return;
+    }
+
     uint64_t tube, tick, cell;
 
     while (pos < end)
@@ -182,6 +300,16 @@ ContiguousBlock::ContiguousBlock(
 
 std::vector<char> ContiguousBlock::combine()
 {
+    if (compact())
+    {
+        CompactWriter writer;
+        for (uint64_t tube(0); tube < m_tubes.size(); ++tube)
+        {
+            writer.write(tube, m_tubes[tube]);
+        }
+        return std::move(writer.data());
+    }
+
     std::vector<char> data;
 
     for (uint64_t tube(0); tube < m_tubes.size(); ++tube)
@@ -218,11 +346,19 @@ SparseBlock::SparseBlock(
     , m_spinner()
     , m_tubes()
 {
-    parse(data.data(), data.data() + data.size());
+    if (compact()) parseCompact(data.data(), data.data() + data.size());
+    else parse(data.data(), data.data() + data.size());
 }
 
 std::vector<char> SparseBlock::combine()
 {
+    if (compact())
+    {
+        CompactWriter writer;
+        for (const auto& pair : m_tubes) writer.write(pair.first, pair.second);
+        return std::move(writer.data());
+    }
+
     std::vector<char> data;
 
     for (const auto& pair : m_tubes)
@@ -232,8 +368,9 @@ std::vector<char> SparseBlock::combine()
 
         for (const auto& cell : tube)
         {
-            push(data, id.data().size());
-            for (const Id::Block block : id.data()) push(data, block);
+            const std::vector<Id::Block> blocks(id.blocks());
+            push(data, blocks.size());
+            for (const Id::Block block : blocks) push(data, block);
             push(data, cell.first);
             push(data, cell.second->val());
         }
@@ -311,9 +448,13 @@ BaseBlock::BaseBlock(
     const char* pos(data.data());
     const char* end(data.data() + data.size());
 
-    uint64_t tube, tick, cell;
+    if (compact())
+    {
+        parseCompact(pos, end);
+        return;
+    }
 
-    const std::size_t factor(m_metadata.hierarchyStructure().factor());
+    uint64_t tube, tick, cell;
 
     while (pos < end)
     {
@@ -321,16 +462,36 @@ BaseBlock::BaseBlock(
         tick = extract(pos, end);
         cell = extract(pos, end);
 
-        const std::size_t depth(ChunkInfo::calcDepth(factor, m_id + tube));
-
-        m_blocks.at(depth).count(m_id + tube, tick, cell);
+        insertCold(tube, tick, cell);
     }
 }
 
+void BaseBlock::insertCold(const Id& tube, uint64_t tick, uint64_t cell)
+{
+    const std::size_t factor(m_metadata.hierarchyStructure().factor());
+    const std::size_t depth(ChunkInfo::calcDepth(factor, m_id + tube));
+
+    m_blocks.at(depth).count(m_id + tube, tick, cell);
+}
+
 std::vector<char> BaseBlock::combine()
 {
     // Pretty much the same as ContiguousBlock::combine, but normalized
     // relative to our own ID.
+    if (compact())
+    {
+        CompactWriter writer;
+        for (const auto& block : m_blocks)
+        {
+            const auto& tubes(block.tubes());
+            for (std::size_t tube(0); tube < tubes.size(); ++tube)
+            {
+                writer.write(block.id() + tube, tubes[tube]);
+            }
+        }
+        return std::move(writer.data());
+    }
+
     std::vector<char> data;
 
     for (const auto& block : m_blocks)
@@ -405,7 +566,7 @@ std::set<Id> BaseBlock::merge(BaseBlock& other)
     return ids;
 }
 
-ReadOnlySparseBlock::ReadOnlySparseBlock(
+ReadOnlyBlock::ReadOnlyBlock(
         HierarchyCell::Pool& pool,
         const Metadata& metadata,
         const Id& id,
@@ -413,17 +574,75 @@ ReadOnlySparseBlock::ReadOnlySparseBlock(
         const Id& maxPoints,
         const std::vector<char>& data)
     : HierarchyBlock(pool, metadata, id, outEndpoint, maxPoints, data.size())
+    , m_sorted(true)
 {
-    // Assuming that all the Id values are within a 64-bit range, then we have
-    // four uint64 values per cell.
-    m_data.reserve(data.size() / 32);
-    parse(data.data(), data.data() + data.size());
+    const char* pos(data.data());
+    const char* end(data.data() + data.size());
 
-    if (!std::is_sorted(m_data.begin(), m_data.end()))
+    if (compact())
+    {
+        parseCompact(pos, end);
+    }
+    else if (id < metadata.hierarchyStructure().mappedIndexBegin())
+    {
+        // Contiguous blocks in the word format have three words per cell.
+        m_ticks.reserve(data.size() / 24);
+        m_counts.reserve(data.size() / 24);
+
+        uint64_t tube, tick, cell;
+
+        while (pos < end)
+        {
+            tube = extract(pos, end);
+            tick = extract(pos, end);
+            cell = extract(pos, end);
+
+            insertCold(tube, tick, cell);
+        }
+    }
+    else
+    {
+        // Assuming that all the Id values are within a 64-bit range, then we
+        // have four uint64 values per cell.
+        m_ticks.reserve(data.size() / 32);
+        m_counts.reserve(data.size() / 32);
+        parse(pos, end);
+    }
+
+    if (!m_sorted)
     {
         std::cout << "Unsorted hierarchy block found" << std::endl;
-        std::sort(m_data.begin(), m_data.end());
+        sort();
+    }
+
+    m_begins.push_back(m_ticks.size());
+}
+
+void ReadOnlyBlock::sort()
+{
+    std::vector<Cell> cells;
+    cells.reserve(m_ticks.size());
+
+    for (std::size_t t(0); t < m_tubes.size(); ++t)
+    {
+        const std::size_t end(
+                t + 1 < m_begins.size() ? m_begins[t + 1] : m_ticks.size());
+
+        for (std::size_t i(m_begins[t]); i < end; ++i)
+        {
+            cells.emplace_back(m_tubes[t], m_ticks[i], m_counts[i]);
+        }
     }
+
+    std::sort(cells.begin(), cells.end());
+
+    m_tubes.clear();
+    m_begins.clear();
+    m_ticks.clear();
+    m_counts.clear();
+
+    m_sorted = true;
+    for (const Cell& cell : cells) insertCold(cell.id, cell.tick, cell.count);
 }
 
 } // namespace entwine
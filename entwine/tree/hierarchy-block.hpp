@@ -46,7 +46,7 @@ public:
 
     HierarchyCell& count(int delta)
     {
-        SpinGuard lock(m_spinner);
+        SpinGuard lock(m_spinner, s_lockSite);
         m_val = static_cast<int>(m_val) + delta;
         return *this;
     }
@@ -56,6 +56,8 @@ public:
 private:
     uint64_t m_val;
     SpinLock m_spinner;
+
+    static LockSite s_lockSite;
 };
 
 using HierarchyTube = std::map<uint64_t, HierarchyCell::PooledNode>;
@@ -64,6 +66,23 @@ namespace arbiter { class Endpoint; }
 
 class Metadata;
 
+// A block of hierarchy counts, each stored per tube Id and tick.  Blocks are
+// stored in one of two formats, per the HierarchyFormat of the storage:
+//
+//      words   - three 64-bit words per cell, or for sparse blocks, a word
+//                count and the words of the tube Id in place of the first.
+//
+//      compact - tubes in ascending order, each written once as:
+//                      Id delta from the previous tube, or from zero
+//                      number of cells
+//                      per cell, in ascending tick order:
+//                          tick delta from the previous cell, or from zero
+//                          count
+//
+// In the compact format, every value is a varint.  An Id delta which fits in
+// 63 bits is written shifted left by one.  Otherwise the delta is written as
+// its number of 64-bit blocks, shifted left by one with the low bit set,
+// followed by each block.
 class HierarchyBlock
 {
 public:
@@ -131,6 +150,32 @@ protected:
         return v;
     }
 
+    uint64_t extractVarint(const char*& pos, const char* end) const
+    {
+        uint64_t v(0);
+
+        for (std::size_t shift(0); shift < 64; shift += 7)
+        {
+            if (pos >= end)
+            {
+                throw std::runtime_error(
+                        "Corrupt hierarchy block: " + m_id.str());
+            }
+
+            const uint8_t byte(*pos++);
+            v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return v;
+        }
+
+        throw std::runtime_error("Corrupt hierarchy block: " + m_id.str());
+    }
+
+    bool compact() const;
+
+    // Parse the compact format, inserting each cell in ascending order.
+    void parseCompact(const char* pos, const char* end);
+
+    // Parse the word format of sparse blocks.
     void parse(const char* pos, const char* end)
     {
         assert(pos <= end);
@@ -208,7 +253,7 @@ public:
 
         const std::size_t id(normalize(global).getSimple());
 
-        SpinGuard lock(m_spinners.at(id));
+        SpinGuard lock(m_spinners.at(id), s_lockSite);
         auto& tube(m_tubes.at(id));
         auto it(tube.find(tick));
         if (it == tube.end())
@@ -262,6 +307,11 @@ protected:
     }
 
 private:
+    virtual void insertCold(const Id& id, uint64_t tick, uint64_t cell) override
+    {
+        m_tubes.at(id.getSimple()).emplace(tick, m_pool.acquireOne(cell));
+    }
+
     virtual std::vector<char> combine() override;
 
     bool empty() const;
@@ -269,6 +319,8 @@ private:
 
     std::vector<HierarchyTube> m_tubes;
     std::vector<SpinLock> m_spinners;
+
+    static LockSite s_lockSite;
 };
 
 
@@ -309,6 +361,7 @@ public:
     const std::vector<ContiguousBlock>& blocks() const { return m_blocks; }
 
 private:
+    virtual void insertCold(const Id& id, uint64_t tick, uint64_t cell) override;
     virtual std::vector<char> combine() override;
 
     std::vector<ContiguousBlock> m_blocks;
@@ -345,7 +398,7 @@ public:
     {
         assert(id >= m_id && id < m_id + m_maxPoints);
 
-        SpinGuard lock(m_spinner);
+        SpinGuard lock(m_spinner, s_lockSite);
         auto& tube(m_tubes[normalize(id)]);
         auto it(tube.find(tick));
         if (it == tube.end())
@@ -383,35 +436,16 @@ private:
 
     SpinLock m_spinner;
     std::map<Id, HierarchyTube> m_tubes;
+
+    static LockSite s_lockSite;
 };
 
-class ReadOnlySparseBlock : public HierarchyBlock
+// A block which is only read, whatever its type, held as sorted arrays rather
+// than as pooled cells per tube.
+class ReadOnlyBlock : public HierarchyBlock
 {
 public:
-    struct Cell
-    {
-        Cell(const Id& id, uint64_t tick, uint64_t count = 0)
-            : id(id)
-            , tick(tick)
-            , count(count)
-        { }
-
-        Id id;
-        uint64_t tick;
-        uint64_t count;
-
-        bool operator==(const Cell& other) const
-        {
-            return id == other.id && tick == other.tick;
-        }
-
-        bool operator<(const Cell& other) const
-        {
-            return id < other.id || (id == other.id && tick < other.tick);
-        }
-    };
-
-    ReadOnlySparseBlock(
+    ReadOnlyBlock(
             HierarchyCell::Pool& pool,
             const Metadata& metadata,
             const Id& id,
@@ -421,10 +455,19 @@ public:
 
     virtual uint64_t get(const Id& id, uint64_t tick) const override
     {
-        Cell search(normalize(id), tick);
-        const auto lb(std::lower_bound(m_data.begin(), m_data.end(), search));
+        const Id tube(normalize(id));
+        const auto it(std::lower_bound(m_tubes.begin(), m_tubes.end(), tube));
+        if (it == m_tubes.end() || *it != tube) return 0;
 
-        if (lb != m_data.end() && *lb == search) return lb->count;
+        const std::size_t t(it - m_tubes.begin());
+        const auto begin(m_ticks.begin() + m_begins[t]);
+        const auto end(m_ticks.begin() + m_begins[t + 1]);
+
+        const auto cell(std::lower_bound(begin, end, tick));
+        if (cell != end && *cell == tick)
+        {
+            return m_counts[cell - m_ticks.begin()];
+        }
         else return 0;
     }
 
@@ -437,9 +480,38 @@ public:
     }
 
 private:
+    struct Cell
+    {
+        Cell(const Id& id, uint64_t tick, uint64_t count = 0)
+            : id(id)
+            , tick(tick)
+            , count(count)
+        { }
+
+        Id id;
+        uint64_t tick;
+        uint64_t count;
+
+        bool operator<(const Cell& other) const
+        {
+            return id < other.id || (id == other.id && tick < other.tick);
+        }
+    };
+
+    // Cells are expected in ascending order, as they're written.
     virtual void insertCold(const Id& id, uint64_t tick, uint64_t cell) override
     {
-        m_data.emplace_back(id, tick, cell);
+        if (m_tubes.empty() || m_tubes.back() != id)
+        {
+            if (!m_tubes.empty() && id < m_tubes.back()) m_sorted = false;
+
+            m_tubes.push_back(id);
+            m_begins.push_back(m_ticks.size());
+        }
+        else if (tick <= m_ticks.back()) m_sorted = false;
+
+        m_ticks.push_back(tick);
+        m_counts.push_back(cell);
     }
 
     virtual std::vector<char> combine() override
@@ -447,7 +519,17 @@ private:
         throw std::runtime_error("Cannot combine a read-only block");
     }
 
-    std::vector<Cell> m_data;
+    // Reinsert our cells in order.
+    void sort();
+
+    bool m_sorted;
+
+    // Tubes, and the index of the first tick of each, followed by the total
+    // number of ticks.  Ticks and counts are parallel.
+    std::vector<Id> m_tubes;
+    std::vector<std::size_t> m_begins;
+    std::vector<uint64_t> m_ticks;
+    std::vector<uint64_t> m_counts;
 };
 
 } // namespace entwine
@@ -13,6 +13,7 @@
 #include <entwine/tree/cold.hpp>
 #include <entwine/tree/heuristics.hpp>
 #include <entwine/types/subset.hpp>
+#include <entwine/util/disk-cache.hpp>
 #include <entwine/util/env.hpp>
 #include <entwine/util/io.hpp>
 #include <entwine/util/json.hpp>
@@ -26,6 +27,8 @@ namespace
     const bool shallow(
             env("TESTING_SHALLOW") &&
             *env("TESTING_SHALLOW") == "true");
+
+    LockSite slotSite("hierarchy-slot");
 }
 
 Hierarchy::Hierarchy(
@@ -65,7 +68,7 @@ Hierarchy::Hierarchy(
                 0,
                 m_outpoint.get(),
                 m_structure.baseIndexSpan(),
-                m_endpoint.getBinary("0" + metadata.postfix()),
+                getBinary("0" + metadata.postfix()),
                 m_readOnly);
     }
 
@@ -95,7 +98,7 @@ HierarchyCell& Hierarchy::count(const PointState& pointState, const int delta)
         auto& slot(getOrCreate(pointState.chunkId(), pointState.chunkNum()));
         std::unique_ptr<HierarchyBlock>& block(slot.t);
 
-        SpinGuard lock(slot.spinner);
+        SpinGuard lock(slot.spinner, slotSite);
         if (!block)
         {
             if (slot.exists)
@@ -106,7 +109,7 @@ HierarchyCell& Hierarchy::count(const PointState& pointState, const int delta)
                         pointState.chunkId(),
                         m_outpoint.get(),
                         pointState.pointsPerChunk(),
-                        m_endpoint.getBinary(
+                        getBinary(
                             pointState.chunkId().str() +
                             m_metadata.postfix(true)));
             }
@@ -140,7 +143,7 @@ HierarchyCell& Hierarchy::count(
         auto& slot(getOrCreate(chunkInfo.chunkId(), chunkInfo.chunkNum()));
         std::unique_ptr<HierarchyBlock>& block(slot.t);
 
-        SpinGuard lock(slot.spinner);
+        SpinGuard lock(slot.spinner, slotSite);
         if (!block)
         {
             if (slot.exists)
@@ -151,7 +154,7 @@ HierarchyCell& Hierarchy::count(
                         chunkInfo.chunkId(),
                         m_outpoint.get(),
                         chunkInfo.pointsPerChunk(),
-                        m_endpoint.getBinary(
+                        getBinary(
                             chunkInfo.chunkId().str() +
                             m_metadata.postfix(true)));
             }
@@ -180,7 +183,7 @@ uint64_t Hierarchy::tryGet(const PointState& s) const
 
         if (!slot.exists) return 0;
 
-        SpinGuard lock(slot.spinner);
+        SpinGuard lock(slot.spinner, slotSite);
         if (!block)
         {
             std::cout <<
@@ -194,7 +197,7 @@ uint64_t Hierarchy::tryGet(const PointState& s) const
                     s.chunkId(),
                     m_outpoint.get(),
                     s.pointsPerChunk(),
-                    m_endpoint.getBinary(
+                    getBinary(
                         s.chunkId().str() + m_metadata.postfix()),
                     m_readOnly);
 
@@ -210,6 +213,25 @@ uint64_t Hierarchy::tryGet(const PointState& s) const
     return 0;
 }
 
+std::vector<char> Hierarchy::getBinary(const std::string& path) const
+{
+    if (!m_endpoint.isLocal())
+    {
+        // Fetched just as below, with no retries, since we may be holding a
+        // slot's spin lock.
+        if (DiskCache* disk = DiskCache::find(m_endpoint))
+        {
+            return *disk->get(m_endpoint, path, [this, &path]()
+            {
+                return makeUnique<std::vector<char>>(
+                        m_endpoint.getBinary(path));
+            });
+        }
+    }
+
+    return m_endpoint.getBinary(path);
+}
+
 void Hierarchy::save(Pool& pool) const
 {
     if (!m_outpoint) return;
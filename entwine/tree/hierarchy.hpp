@@ -83,6 +83,9 @@ public:
     using Slots = std::set<const Slot*>;
 
 protected:
+    // Fetch a block, through the disk cache if there is one.
+    std::vector<char> getBinary(const std::string& path) const;
+
     HierarchyCell::Pool& m_pool;
     const Metadata& m_metadata;
     const Bounds& m_bounds;
@@ -0,0 +1,433 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/tree/serializer.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#include <entwine/tree/chunk.hpp>
+#include <entwine/tree/heuristics.hpp>
+#include <entwine/types/chunk-storage/chunk-storage.hpp>
+#include <entwine/types/storage.hpp>
+#include <entwine/util/time.hpp>
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    std::size_t get(
+            const Json::Value& json,
+            const std::string& key,
+            const std::size_t fallback)
+    {
+        const std::size_t v(
+                json.isMember(key) ? json[key].asUInt64() : fallback);
+        return std::max<std::size_t>(v, 1);
+    }
+
+    class StorageStages : public Serializer::Stages
+    {
+    public:
+        explicit StorageStages(const Storage& storage) : m_storage(storage) { }
+
+        virtual std::unique_ptr<ChunkWrite> gather(Chunk& chunk) const override
+        {
+            return m_storage.gather(chunk);
+        }
+
+        virtual void encode(ChunkWrite& write) const override
+        {
+            m_storage.encode(write);
+        }
+
+        virtual void put(ChunkWrite& write) const override
+        {
+            m_storage.put(write);
+        }
+
+        virtual bool putAsync(
+                ChunkWrite& write,
+                std::function<void(bool)> done) const override
+        {
+            return m_storage.putAsync(write, std::move(done));
+        }
+
+    private:
+        const Storage& m_storage;
+    };
+}
+
+Serializer::Serializer(
+        const Storage& storage,
+        const std::size_t clipThreads,
+        const Json::Value& json)
+    : Serializer(makeUnique<StorageStages>(storage), clipThreads, json)
+{ }
+
+Serializer::Serializer(
+        std::unique_ptr<Stages> stages,
+        const std::size_t clipThreads,
+        const Json::Value& json)
+    : m_stages(std::move(stages))
+    , m_queueSize(get(json, "queueSize", heuristics::serializeQueueSize))
+    , m_encodePool(get(json, "encodeThreads", clipThreads), m_queueSize)
+    , m_ioPool(
+            get(json, "ioThreads", heuristics::serializeIoThreads),
+            m_queueSize)
+    , m_gather()
+    , m_encode()
+    , m_put()
+    , m_inFlight(0)
+    , m_bytes(0)
+    , m_async(0)
+    , m_retries()
+    , m_errors()
+    , m_mutex()
+    , m_cv()
+{ }
+
+Serializer::~Serializer()
+{
+    // Failures are reported by await(), so any left here were never awaited.
+    // They can't be thrown from a destructor, so they're only logged.
+    try
+    {
+        // Encoding feeds the I/O pool, so it must finish first.
+        m_encodePool.join();
+        m_ioPool.join();
+        drain();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const std::string& err : m_errors)
+        {
+            std::cout << "Unawaited chunk write failure: " << err << std::endl;
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Exception destroying serializer: " << e.what() <<
+            std::endl;
+    }
+    catch (...)
+    {
+        std::cout << "Unknown exception destroying serializer" << std::endl;
+    }
+}
+
+template<typename Fn>
+void Serializer::run(Stage& stage, Fn&& f)
+{
+    ++stage.active;
+    const auto start(now());
+
+    try
+    {
+        f();
+    }
+    catch (...)
+    {
+        --stage.active;
+        throw;
+    }
+
+    stage.micros += since<std::chrono::microseconds>(start);
+    --stage.active;
+    ++stage.done;
+}
+
+void Serializer::push(Chunk& chunk)
+{
+    std::shared_ptr<ChunkWrite> write;
+    run(m_gather, [this, &chunk, &write]()
+    {
+        write = m_stages->gather(chunk);
+    });
+
+    push(write);
+}
+
+void Serializer::push(std::shared_ptr<ChunkWrite> write)
+{
+    ++m_inFlight;
+    m_bytes += write->data.size();
+
+    ++m_encode.queued;
+    m_encodePool.add([this, write]() { encode(write); });
+}
+
+void Serializer::encode(std::shared_ptr<ChunkWrite> write)
+{
+    --m_encode.queued;
+    const std::size_t gathered(write->data.size());
+
+    try
+    {
+        run(m_encode, [this, &write]() { m_stages->encode(*write); });
+    }
+    catch (std::exception& e)
+    {
+        m_bytes -= gathered;
+        fail(e.what());
+        return;
+    }
+    catch (...)
+    {
+        m_bytes -= gathered;
+        fail("Unknown error");
+        return;
+    }
+
+    m_bytes += write->data.size();
+    m_bytes -= gathered;
+
+    // Blocks while the I/O queue is full, holding up this stage in turn.
+    ++m_put.queued;
+    m_ioPool.add([this, write]() { put(write); });
+}
+
+void Serializer::put(std::shared_ptr<ChunkWrite> write)
+{
+    --m_put.queued;
+    retry();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_async;
+    }
+
+    ++m_put.active;
+    const auto start(now());
+
+    const bool submitted(
+            m_stages->putAsync(*write, [this, write, start](bool ok)
+            {
+                written(write, ok, since<std::chrono::microseconds>(start));
+            }));
+
+    if (submitted) return;
+
+    --m_put.active;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_async;
+    }
+
+    putNow(write);
+}
+
+void Serializer::putNow(std::shared_ptr<ChunkWrite> write)
+{
+    const std::size_t encoded(write->data.size());
+
+    try
+    {
+        run(m_put, [this, &write]() { m_stages->put(*write); });
+    }
+    catch (std::exception& e)
+    {
+        m_bytes -= encoded;
+        fail(e.what());
+        return;
+    }
+    catch (...)
+    {
+        m_bytes -= encoded;
+        fail("Unknown error");
+        return;
+    }
+
+    m_bytes -= encoded;
+    finish();
+}
+
+void Serializer::written(
+        std::shared_ptr<ChunkWrite> write,
+        const bool ok,
+        const uint64_t micros)
+{
+    --m_put.active;
+
+    if (ok)
+    {
+        m_put.micros += micros;
+        ++m_put.done;
+        m_bytes -= write->data.size();
+        --m_inFlight;
+    }
+
+    // This runs on the AsyncIo completion thread, so a failed write is left
+    // to be retried elsewhere rather than blocking here.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ok) --m_async;
+        else m_retries.push_back(write);
+    }
+
+    m_cv.notify_all();
+}
+
+void Serializer::retry()
+{
+    std::vector<std::shared_ptr<ChunkWrite>> retries;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        retries.swap(m_retries);
+    }
+
+    // A failed retry is recorded by putNow, so this doesn't throw.
+    for (auto& write : retries)
+    {
+        putNow(write);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_async;
+        }
+
+        m_cv.notify_all();
+    }
+}
+
+void Serializer::drain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (m_async)
+    {
+        m_cv.wait(lock, [this]() { return !m_async || !m_retries.empty(); });
+
+        lock.unlock();
+        retry();
+        lock.lock();
+    }
+}
+
+void Serializer::fail(const std::string& err)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_errors.push_back(err);
+    }
+
+    finish();
+}
+
+void Serializer::finish()
+{
+    --m_inFlight;
+
+    // Taking the lock ensures that a throttling thread is either waiting or
+    // has yet to check the pipeline's pressure, so this can't be missed.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+
+    m_cv.notify_all();
+}
+
+void Serializer::await()
+{
+    m_encodePool.await();
+    m_ioPool.await();
+    drain();
+
+    std::vector<std::string> errors;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        errors.swap(m_errors);
+    }
+
+    if (!errors.empty())
+    {
+        throw std::runtime_error(
+                "Failed to write " + std::to_string(errors.size()) +
+                " chunk(s): " + errors.front());
+    }
+}
+
+double Serializer::pressure() const
+{
+    const double capacity(
+            encodeThreads() + ioThreads() + 2 * m_queueSize);
+    return m_inFlight.load() / capacity;
+}
+
+void Serializer::throttle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // Failed writes hold up the pipeline until they're retried, so don't
+    // wait on them.
+    while (pressure() >= 1.0)
+    {
+        if (m_retries.empty()) m_cv.wait(lock);
+        else
+        {
+            lock.unlock();
+            retry();
+            lock.lock();
+        }
+    }
+}
+
+std::string Serializer::summary() const
+{
+    return
+        std::to_string(m_encode.queued.load()) + "/" +
+        std::to_string(m_put.queued.load());
+}
+
+void Serializer::report(std::ostream& os) const
+{
+    os << "Serialization:\n" <<
+        "\tEncode threads: " << encodeThreads() <<
+        ", I/O threads: " << ioThreads() <<
+        ", queue size: " << m_queueSize << "\n" <<
+        "\tIn flight: " << m_inFlight.load() << " chunks, " <<
+            m_bytes.load() << " bytes\n" <<
+        "\t" <<
+        std::left << std::setw(12) << "Stage" << std::right <<
+        std::setw(12) << "Done" <<
+        std::setw(10) << "Queued" <<
+        std::setw(10) << "Active" <<
+        std::setw(14) << "Avg (ms)" <<
+        std::setw(14) << "Total (s)" << "\n";
+
+    auto row([&os](const std::string& name, const Stage& stage)
+    {
+        const uint64_t done(stage.done.load());
+        const double micros(stage.micros.load());
+
+        os << "\t" <<
+            std::left << std::setw(12) << name << std::right <<
+            std::setw(12) << done <<
+            std::setw(10) << stage.queued.load() <<
+            std::setw(10) << stage.active.load() <<
+            std::fixed << std::setprecision(3) <<
+            std::setw(14) << (done ? micros / done / 1000.0 : 0.0) <<
+            std::setw(14) << micros / 1000000.0 << "\n";
+    });
+
+    row("Gather", m_gather);
+    row("Encode", m_encode);
+    row("Put", m_put);
+
+    os << std::endl;
+}
+
+} // namespace entwine
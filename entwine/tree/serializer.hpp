@@ -0,0 +1,173 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+#include <entwine/util/pool.hpp>
+
+namespace entwine
+{
+
+class Chunk;
+class Storage;
+struct ChunkWrite;
+
+// Pipelines the serialization of chunks which have been clipped.  The clip
+// thread which releases a chunk only gathers it, after which the chunk is
+// freed.  Encoding runs on a CPU-bound pool, and writing on an I/O pool whose
+// concurrency is sized separately, so slow or retried writes don't hold up
+// compression or clipping.
+//
+// Local writes are submitted asynchronously - see AsyncIo - so an I/O thread
+// doesn't wait on each one, and many may be in flight at once.  A write which
+// fails is retried with a blocking put.
+//
+// Each stage has a bounded queue.  Once it's full, the previous stage blocks,
+// which propagates back to the clip threads, and the builder may throttle
+// its insertion on pressure() before clipping more.
+//
+// Sizing is read from the "serialization" entry of the build configuration:
+//      { "encodeThreads": n, "ioThreads": n, "queueSize": n }
+// By default, there are as many encode threads as clip threads.
+//
+// A chunk which fails to be encoded or written is recorded rather than thrown
+// from the stage, and the failures are thrown from the next await().  So
+// await() must be called before destruction - failures left unawaited are only
+// logged.
+class Serializer
+{
+public:
+    // The work done by each stage.  For a build this is that of the Storage,
+    // see Storage::gather, encode, put, and putAsync.
+    class Stages
+    {
+    public:
+        virtual ~Stages() { }
+
+        virtual std::unique_ptr<ChunkWrite> gather(Chunk& chunk) const = 0;
+        virtual void encode(ChunkWrite& write) const = 0;
+        virtual void put(ChunkWrite& write) const = 0;
+        virtual bool putAsync(
+                ChunkWrite& write,
+                std::function<void(bool)> done) const = 0;
+    };
+
+    Serializer(
+            const Storage& storage,
+            std::size_t clipThreads,
+            const Json::Value& json = Json::nullValue);
+    Serializer(
+            std::unique_ptr<Stages> stages,
+            std::size_t clipThreads,
+            const Json::Value& json = Json::nullValue);
+    ~Serializer();
+
+    // Gather the chunk on the calling thread and queue it for encoding,
+    // blocking while the encode queue is full.
+    void push(Chunk& chunk);
+
+    // Queue a chunk which has already been gathered.
+    void push(std::shared_ptr<ChunkWrite> write);
+
+    // Wait for every pushed chunk to be written.  Chunks may continue to be
+    // pushed meanwhile.  Throws if any chunk pushed since the previous await()
+    // failed to be written.
+    void await();
+
+    // Chunks gathered but not yet written, as a fraction of the number the
+    // pipeline can hold before pushes block.
+    double pressure() const;
+
+    // Block the caller while the pipeline is full.
+    void throttle();
+
+    std::size_t encodeThreads() const { return m_encodePool.numThreads(); }
+    std::size_t ioThreads() const { return m_ioPool.numThreads(); }
+    std::size_t queueSize() const { return m_queueSize; }
+
+    // Chunks waiting on each stage, for progress output.
+    std::string summary() const;
+
+    // Per-stage counts, queue depths, and timings.
+    void report(std::ostream& os) const;
+
+private:
+    struct Stage
+    {
+        Stage() : queued(0), active(0), done(0), micros(0) { }
+
+        std::atomic<uint64_t> queued;
+        std::atomic<uint64_t> active;
+        std::atomic<uint64_t> done;
+        std::atomic<uint64_t> micros;
+    };
+
+    template<typename Fn> void run(Stage& stage, Fn&& f);
+
+    void encode(std::shared_ptr<ChunkWrite> write);
+    void put(std::shared_ptr<ChunkWrite> write);
+
+    // Blocking put.
+    void putNow(std::shared_ptr<ChunkWrite> write);
+
+    // An asynchronous put has completed.
+    void written(std::shared_ptr<ChunkWrite> write, bool ok, uint64_t micros);
+
+    // Retry failed asynchronous puts on the calling thread.  A retry which
+    // fails again is recorded for await() rather than thrown.
+    void retry();
+
+    // Wait for asynchronous puts, retrying any which fail.
+    void drain();
+
+    // A chunk has failed to be written, and has left the pipeline.
+    void fail(const std::string& err);
+
+    // A chunk has left the pipeline, written or not.
+    void finish();
+
+    const std::unique_ptr<Stages> m_stages;
+    const std::size_t m_queueSize;
+
+    Pool m_encodePool;
+    Pool m_ioPool;
+
+    Stage m_gather;
+    Stage m_encode;
+    Stage m_put;
+
+    std::atomic<uint64_t> m_inFlight;
+    std::atomic<uint64_t> m_bytes;
+
+    // Asynchronous puts not yet written, including failures awaiting retry.
+    std::size_t m_async;
+    std::vector<std::shared_ptr<ChunkWrite>> m_retries;
+
+    // Failures since the last await().
+    std::vector<std::string> m_errors;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
+
+} // namespace entwine
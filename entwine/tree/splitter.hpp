@@ -12,10 +12,11 @@
 
 #include <cassert>
 #include <memory>
-#include <mutex>
+#include <set>
 
 #include <entwine/types/structure.hpp>
 #include <entwine/util/pool.hpp>
+#include <entwine/util/sharded-map.hpp>
 #include <entwine/util/unique.hpp>
 
 namespace entwine
@@ -41,18 +42,16 @@ public:
         : m_structure(structure)
         , m_base()
         , m_fast(getNumFastTrackers(structure))
-        , m_slow()
+        , m_slow(slowShards, slowSite())
         , m_faux()
-        , m_slowMutex()
     { }
 
     Splitter(const Structure& structure, std::size_t maxFastTrackers)
         : m_structure(structure)
         , m_base()
         , m_fast(std::min(maxFastTrackers, getNumFastTrackers(structure)))
-        , m_slow()
+        , m_slow(slowShards, slowSite())
         , m_faux()
-        , m_slowMutex()
     { }
 
 
@@ -76,8 +75,7 @@ public:
         }
         else
         {
-            std::lock_guard<std::mutex> lock(m_slowMutex);
-            return m_slow[chunkId];
+            return m_slow.get(chunkId);
         }
     }
 
@@ -89,7 +87,6 @@ public:
         }
         else
         {
-            std::lock_guard<std::mutex> lock(m_slowMutex);
             return m_slow.at(chunkId);
         }
     }
@@ -103,7 +100,7 @@ public:
         const Slot* slot(nullptr);
         if (isWithinBase(depth)) slot = &m_base;
         else if (chunkNum < m_fast.size()) slot = &m_fast[chunkNum];
-        else if (m_slow.count(chunkId)) slot = &m_slow.at(chunkId);
+        else slot = m_slow.find(chunkId);
         return slot;
     }
 
@@ -122,10 +119,17 @@ public:
     template<typename Op>
     void iterateCold(Op op, Pool* pool = nullptr) const
     {
-        pool = nullptr;
-        auto call([&op, pool](const Id& id, std::size_t n, const Slot& slot)
+        TaskGroup group;
+
+        auto call([&op, &group, pool](
+                    const Id& id,
+                    std::size_t n,
+                    const Slot& slot)
         {
-            if (pool) pool->add([&op, id, n, &slot]() { op(id, n, slot); });
+            if (pool)
+            {
+                pool->add(group, [&op, id, n, &slot]() { op(id, n, slot); });
+            }
             else op(id, n, slot);
         });
 
@@ -137,9 +141,13 @@ public:
             }
         }
 
-        for (const auto& p : m_slow) call(p.first, m_fast.size(), p.second);
+        const std::size_t slowNum(m_fast.size());
+        m_slow.forEach([&call, slowNum](const Id& id, const Slot& slot)
+        {
+            call(id, slowNum, slot);
+        });
 
-        if (pool) pool->cycle();
+        group.wait();
     }
 
     Slot& base() { return m_base; }
@@ -174,15 +182,25 @@ protected:
         return count;
     }
 
+    // Chunks beyond the fast-tracker range are spread over this many
+    // independently locked shards, since on deep or lossless builds most
+    // insertions land there.
+    static constexpr std::size_t slowShards = 64;
+
+    static LockSite& slowSite()
+    {
+        static LockSite site("splitter-slow");
+        return site;
+    }
+
     const Structure& m_structure;
 
     Slot m_base;
     std::vector<Slot> m_fast;
-    std::map<Id, Slot> m_slow;
+    ShardedMap<Id, Slot> m_slow;
     std::set<Id> m_faux;
-
-    std::mutex m_slowMutex;
 };
 
+
 } // namespace entwine
 
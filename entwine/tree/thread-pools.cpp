@@ -11,15 +11,31 @@
 #include <cmath>
 
 #include <entwine/tree/thread-pools.hpp>
+#include <entwine/util/numa.hpp>
 
 namespace entwine
 {
 
+namespace
+{
+    Scheduler::Init pinner(const Numa* numa)
+    {
+        if (!numa) return Scheduler::Init();
+
+        return [numa](const std::size_t index)
+        {
+            numa->pin(index % numa->numNodes());
+        };
+    }
+}
+
 ThreadPools::ThreadPools(
         const std::size_t workThreads,
-        const std::size_t clipThreads)
-    : m_workPool(std::max<std::size_t>(1, workThreads))
-    , m_clipPool(std::max<std::size_t>(4, clipThreads))
+        const std::size_t clipThreads,
+        const Numa* numa)
+    : m_numa(numa)
+    , m_workPool(std::max<std::size_t>(1, workThreads), 1, pinner(numa))
+    , m_clipPool(std::max<std::size_t>(4, clipThreads), 1, pinner(numa))
 { }
 
 std::size_t ThreadPools::getWorkThreads(
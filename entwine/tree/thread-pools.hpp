@@ -16,10 +16,17 @@
 namespace entwine
 {
 
+class Numa;
+
 class ThreadPools
 {
 public:
-    ThreadPools(std::size_t workThreads, std::size_t clipThreads);
+    // If a NUMA topology is supplied, the threads of each pool are pinned
+    // round-robin across its nodes.  It must outlive this object.
+    ThreadPools(
+            std::size_t workThreads,
+            std::size_t clipThreads,
+            const Numa* numa = nullptr);
 
     Pool& workPool() { return m_workPool; }
     Pool& clipPool() { return m_clipPool; }
@@ -27,6 +34,8 @@ public:
     const Pool& workPool() const { return m_workPool; }
     const Pool& clipPool() const { return m_clipPool; }
 
+    const Numa* numa() const { return m_numa; }
+
     std::size_t size() const
     {
         return m_workPool.numThreads() + m_clipPool.numThreads();
@@ -59,6 +68,8 @@ public:
             double workToClipRatio = heuristics::defaultWorkToClipRatio);
 
 private:
+    const Numa* m_numa;
+
     Pool m_workPool;
     Pool m_clipPool;
 };
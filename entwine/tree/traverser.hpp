@@ -12,6 +12,7 @@
 
 #include <chrono>
 #include <mutex>
+#include <queue>
 #include <set>
 #include <thread>
 
@@ -0,0 +1,367 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/archive.hpp>
+
+#include <set>
+#include <stdexcept>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/defs.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/util/io.hpp>
+#include <entwine/util/json.hpp>
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Packs are sealed once they reach this size.  Remote packs are held in
+    // memory until then, so this also bounds memory use per writer.
+    const std::size_t defaultPackSize(128 * 1024 * 1024);
+}
+
+Archive::Archive(const Metadata& metadata)
+    : Archive([&metadata]() { return metadata.postfix(); }, defaultPackSize)
+{ }
+
+Archive::Archive(
+        std::function<std::string()> postfix,
+        const std::size_t packSize)
+    : m_postfix(std::move(postfix))
+    , m_packSize(packSize)
+    , m_loaded(false)
+    , m_packs()
+    , m_entries()
+    , m_open()
+    , m_sealing()
+    , m_mutex()
+{ }
+
+Archive::~Archive() { }
+
+void Archive::put(
+        const arbiter::Endpoint& out,
+        const std::string& path,
+        const std::vector<char>& data)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    load(out);
+
+    PackLock packLock;
+    std::shared_ptr<Pack> pack(acquire(out, packLock));
+    lock.unlock();
+
+    const std::size_t offset(pack->size);
+
+    if (out.isLocal())
+    {
+        pack->file.write(data.data(), data.size());
+        pack->file.flush();
+
+        if (!pack->file)
+        {
+            // The file no longer matches the pack's size, so seal the pack as
+            // of its last whole put and let later puts start another.  Any
+            // bytes of this put which reached the file lie past every entry,
+            // so they're never read.
+            pack->file.close();
+            pack->sealed = true;
+
+            lock.lock();
+            m_open.erase(pack->index);
+
+            throw std::runtime_error("Could not write pack " + pack->name);
+        }
+    }
+    else
+    {
+        pack->data.insert(pack->data.end(), data.begin(), data.end());
+    }
+
+    pack->size += data.size();
+    const bool full(pack->size >= m_packSize);
+
+    // Nothing blocks on a pack while holding our mutex, so it's safe to take
+    // it here.
+    lock.lock();
+    m_entries[path] = Entry(pack->index, offset, data.size());
+
+    if (!full) return;
+
+    // Sealing a remote pack uploads it, so do that while holding only the
+    // pack's lock.  Until it's sealed, reads of its entries find it among
+    // the sealing packs, and wait on its lock.
+    m_open.erase(pack->index);
+    m_sealing[pack->index] = pack;
+    lock.unlock();
+
+    seal(out, *pack);
+    packLock.unlock();
+
+    lock.lock();
+    m_sealing.erase(pack->index);
+}
+
+std::unique_ptr<std::vector<char>> Archive::get(
+        const arbiter::Endpoint& out,
+        const std::string& path)
+{
+    Entry entry;
+    std::string name;
+    std::shared_ptr<Pack> pack;
+
+    if (!find(out, path, entry, name, pack))
+    {
+        throw std::runtime_error("Not archived: " + path);
+    }
+
+    if (pack && !out.isLocal())
+    {
+        PackLock packLock(pack->mutex);
+        if (!pack->sealed)
+        {
+            const auto begin(pack->data.begin() + entry.offset);
+            return makeUnique<std::vector<char>>(begin, begin + entry.size);
+        }
+    }
+
+    return io::ensureGet(out, name, entry.offset, entry.size);
+}
+
+std::unique_ptr<MappedFile> Archive::map(
+        const arbiter::Endpoint& out,
+        const std::string& path)
+{
+    Entry entry;
+    std::string name;
+    std::shared_ptr<Pack> pack;
+
+    if (!out.isLocal() || !find(out, path, entry, name, pack)) return nullptr;
+
+    // Local packs are flushed after every put, so open ones may be mapped.
+    const std::string full(out.fullPath(name));
+    return makeUnique<MappedFile>(full, entry.offset, entry.size);
+}
+
+std::size_t Archive::size(
+        const arbiter::Endpoint& out,
+        const std::string& path)
+{
+    Entry entry;
+    std::string name;
+    std::shared_ptr<Pack> pack;
+
+    return find(out, path, entry, name, pack) ? entry.size : 0;
+}
+
+void Archive::save(const arbiter::Endpoint& out)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    load(out);
+
+    // Packs which a put is sealing are sealed here too, if that put failed,
+    // or waited on otherwise.
+    auto open(m_open);
+    open.insert(m_sealing.begin(), m_sealing.end());
+    lock.unlock();
+
+    for (const auto& p : open)
+    {
+        Pack& pack(*p.second);
+        PackLock packLock(pack.mutex);
+        seal(out, pack);
+    }
+
+    lock.lock();
+    for (const auto& p : open)
+    {
+        m_open.erase(p.first);
+        m_sealing.erase(p.first);
+    }
+
+    Json::Value json;
+    for (const auto& name : m_packs) json["packs"].append(name);
+
+    Json::Value& chunks(json["chunks"]);
+    for (const auto& p : m_entries)
+    {
+        const Entry& entry(p.second);
+
+        Json::Value& value(chunks[p.first]);
+        value.append(static_cast<Json::UInt64>(entry.pack));
+        value.append(static_cast<Json::UInt64>(entry.offset));
+        value.append(static_cast<Json::UInt64>(entry.size));
+    }
+
+    io::ensurePut(out, indexName(), toFastString(json));
+}
+
+void Archive::merge(const arbiter::Endpoint& out, Archive& other)
+{
+    if (&other == this) return;
+
+    std::lock(m_mutex, other.m_mutex);
+    std::lock_guard<std::mutex> lock(m_mutex, std::adopt_lock);
+    std::lock_guard<std::mutex> otherLock(other.m_mutex, std::adopt_lock);
+
+    load(out);
+    other.load(out);
+
+    if (!other.m_open.empty() || !other.m_sealing.empty())
+    {
+        throw std::runtime_error("Cannot merge an archive with open packs");
+    }
+
+    const std::size_t shift(m_packs.size());
+    m_packs.insert(m_packs.end(), other.m_packs.begin(), other.m_packs.end());
+
+    for (const auto& p : other.m_entries)
+    {
+        const Entry& e(p.second);
+        m_entries[p.first] = Entry(e.pack + shift, e.offset, e.size);
+    }
+}
+
+void Archive::load(const arbiter::Endpoint& out)
+{
+    if (m_loaded) return;
+    m_loaded = true;
+
+    // A missing index is an empty archive.
+    const auto data(out.tryGet(indexName()));
+    if (!data) return;
+
+    const Json::Value json(parse(*data));
+
+    for (const auto& name : json["packs"]) m_packs.push_back(name.asString());
+
+    const Json::Value& chunks(json["chunks"]);
+    for (const auto& path : chunks.getMemberNames())
+    {
+        const Json::Value& value(chunks[path]);
+        const Entry entry(
+                value[0].asUInt64(),
+                value[1].asUInt64(),
+                value[2].asUInt64());
+
+        if (entry.pack >= m_packs.size())
+        {
+            throw std::runtime_error("Invalid archive index entry: " + path);
+        }
+
+        m_entries[path] = entry;
+    }
+}
+
+std::string Archive::indexName() const
+{
+    return "a/index" + m_postfix();
+}
+
+std::string Archive::nextName() const
+{
+    // Names need only be unique among our own packs, since those of other
+    // subsets carry their postfix.
+    const std::set<std::string> names(m_packs.begin(), m_packs.end());
+    const std::string postfix(m_postfix());
+
+    std::size_t n(m_packs.size());
+    while (names.count("a/" + std::to_string(n) + postfix)) ++n;
+    return "a/" + std::to_string(n) + postfix;
+}
+
+std::shared_ptr<Archive::Pack> Archive::acquire(
+        const arbiter::Endpoint& out,
+        PackLock& lock)
+{
+    for (auto& p : m_open)
+    {
+        PackLock attempt(p.second->mutex, std::try_to_lock);
+        if (attempt.owns_lock() && !p.second->sealed)
+        {
+            lock = std::move(attempt);
+            return p.second;
+        }
+    }
+
+    // Every open pack is busy, so start another.
+    auto pack(std::make_shared<Pack>());
+    pack->index = m_packs.size();
+    pack->name = nextName();
+
+    if (out.isLocal())
+    {
+        pack->file.open(
+                out.fullPath(pack->name),
+                std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!pack->file)
+        {
+            throw std::runtime_error("Could not create pack " + pack->name);
+        }
+    }
+
+    // Nothing else can see this pack yet, so trying always succeeds, and our
+    // mutex is still only ever held while trying a pack's lock.
+    lock = PackLock(pack->mutex, std::try_to_lock);
+
+    m_open[pack->index] = pack;
+    m_packs.push_back(pack->name);
+
+    return pack;
+}
+
+void Archive::seal(const arbiter::Endpoint& out, Pack& pack) const
+{
+    if (pack.sealed) return;
+
+    if (out.isLocal())
+    {
+        pack.file.close();
+    }
+    else
+    {
+        io::ensurePut(out, pack.name, pack.data);
+        std::vector<char>().swap(pack.data);
+    }
+
+    pack.sealed = true;
+}
+
+bool Archive::find(
+        const arbiter::Endpoint& out,
+        const std::string& path,
+        Entry& entry,
+        std::string& name,
+        std::shared_ptr<Pack>& pack)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    load(out);
+
+    const auto it(m_entries.find(path));
+    if (it == m_entries.end()) return false;
+
+    entry = it->second;
+    name = m_packs[entry.pack];
+
+    const auto open(m_open.find(entry.pack));
+    if (open != m_open.end()) pack = open->second;
+
+    const auto sealing(m_sealing.find(entry.pack));
+    if (sealing != m_sealing.end()) pack = sealing->second;
+
+    return true;
+}
+
+} // namespace entwine
+
@@ -0,0 +1,150 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <entwine/util/mapped-file.hpp>
+
+namespace entwine
+{
+
+namespace arbiter { class Endpoint; }
+
+class Metadata;
+
+// Chunks appended to a small number of large pack files rather than written
+// as one file each, along with an index of their locations, saved as
+// "a/index" plus the metadata postfix.  Packs are written to "a/" alongside
+// it.
+//
+// Concurrent puts go to separate packs, so writers never wait on each other.
+// A pack is sealed once it's large enough, after which it's never written
+// again.  Local packs are appended in place as chunks arrive, and remote ones
+// are buffered and written whole when sealed.
+//
+// The index is read lazily, on first use.
+class Archive
+{
+public:
+    explicit Archive(const Metadata& metadata);
+
+    // Files are postfixed with the result of postfix at the time they're
+    // named, which for the metadata's postfix changes as subsets are merged.
+    // Packs are sealed once they reach packSize bytes.
+    Archive(std::function<std::string()> postfix, std::size_t packSize);
+    ~Archive();
+
+    // Throws if the data could not be written, in which case the pack it
+    // was written to is sealed without it.
+    void put(
+            const arbiter::Endpoint& out,
+            const std::string& path,
+            const std::vector<char>& data);
+
+    // Throws if the path isn't archived.
+    std::unique_ptr<std::vector<char>> get(
+            const arbiter::Endpoint& out,
+            const std::string& path);
+
+    // Map an archived file in place from a local endpoint.  Null if the
+    // endpoint is remote or the path isn't archived.
+    std::unique_ptr<MappedFile> map(
+            const arbiter::Endpoint& out,
+            const std::string& path);
+
+    // The size of an archived file, or zero if the path isn't archived.
+    std::size_t size(const arbiter::Endpoint& out, const std::string& path);
+
+    // Seal every pack and write the index.
+    void save(const arbiter::Endpoint& out);
+
+    // Take in the index of another archive of the same output, whose packs
+    // must not be written afterward.
+    void merge(const arbiter::Endpoint& out, Archive& other);
+
+private:
+    Archive(const Archive&) = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    struct Entry
+    {
+        Entry() = default;
+        Entry(std::size_t pack, std::size_t offset, std::size_t size)
+            : pack(pack), offset(offset), size(size)
+        { }
+
+        std::size_t pack = 0;
+        std::size_t offset = 0;
+        std::size_t size = 0;
+    };
+
+    struct Pack
+    {
+        std::mutex mutex;
+        std::size_t index = 0;
+        std::string name;
+        std::size_t size = 0;
+        bool sealed = false;
+
+        // Local packs are written as we go, and remote ones buffered.
+        std::ofstream file;
+        std::vector<char> data;
+    };
+
+    using PackLock = std::unique_lock<std::mutex>;
+
+    // Must be called while holding our mutex.
+    void load(const arbiter::Endpoint& out);
+    std::string indexName() const;
+    std::string nextName() const;
+
+    // Returns a pack, locked, which no other put is writing.  Must be called
+    // while holding our mutex.
+    std::shared_ptr<Pack> acquire(const arbiter::Endpoint& out, PackLock& lock);
+
+    // Must be called while holding the pack's mutex.  Our own mutex may be
+    // taken while holding a pack's, but never the reverse, except by trying.
+    void seal(const arbiter::Endpoint& out, Pack& pack) const;
+
+    // Find an entry, and its pack if that pack is still open or sealing.
+    bool find(
+            const arbiter::Endpoint& out,
+            const std::string& path,
+            Entry& entry,
+            std::string& name,
+            std::shared_ptr<Pack>& pack);
+
+    const std::function<std::string()> m_postfix;
+    const std::size_t m_packSize;
+
+    bool m_loaded;
+    std::vector<std::string> m_packs;
+    std::map<std::string, Entry> m_entries;
+
+    // Packs which are still being written, by index.
+    std::map<std::size_t, std::shared_ptr<Pack>> m_open;
+
+    // Full packs which a put is sealing outside of our mutex, by index.
+    std::map<std::size_t, std::shared_ptr<Pack>> m_sealing;
+
+    mutable std::mutex m_mutex;
+};
+
+} // namespace entwine
+
@@ -14,6 +14,8 @@
 
 #include <entwine/types/binary-point-table.hpp>
 #include <entwine/types/chunk-storage/chunk-storage.hpp>
+#include <entwine/types/point-columns.hpp>
+#include <entwine/types/quantization.hpp>
 
 namespace entwine
 {
@@ -40,13 +42,25 @@ public:
         }
     }
 
-    virtual void write(Chunk& chunk) const override
+    virtual void gather(ChunkWrite& write, Chunk& chunk) const override
     {
-        auto data(buildData(chunk));
-        const auto& schema(chunk.schema());
-        const std::size_t numPoints(data.size() / schema.pointSize());
-        append(data, buildTail(chunk, numPoints));
-        ensurePut(chunk, m_metadata.basename(chunk.id()), data);
+        write.data = buildData(chunk);
+        write.numPoints = write.data.size() / chunk.schema().pointSize();
+    }
+
+    virtual void encode(ChunkWrite& write) const override
+    {
+        if (quantized())
+        {
+            quantize(write, m_metadata.schema()).append(write.data);
+        }
+
+        append(write.data, buildTail(write, write.data.size()));
+    }
+
+    virtual void put(ChunkWrite& write) const override
+    {
+        ensurePut(write, m_metadata.basename(write.id));
     }
 
     virtual Cell::PooledStack read(
@@ -55,18 +69,79 @@ public:
             PointPool& pool,
             const Id& id) const override
     {
-        auto data(io::ensureGet(out, m_metadata.basename(id)));
+        auto data(ensureGet(out, m_metadata.basename(id)));
+        const Tail tail(*data, m_tailFields);
+
+        const std::size_t numPoints(unpack(*data, tail, pool.schema()));
+        return cells(data->data(), numPoints, pool);
+    }
+
+    virtual Cell::PooledStack readProjected(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            PointPool& pool,
+            const Id& id,
+            const Projection& projection) const override
+    {
+        auto data(ensureGet(out, m_metadata.basename(id)));
         const Tail tail(*data, m_tailFields);
-        const char* pos(data->data());
 
-        const Schema& schema(pool.schema());
+        const std::size_t numPoints(
+                unpack(*data, tail, projection.native()));
+
+        const std::vector<char> projected(
+                projection.apply(data->data(), numPoints));
+
+        return cells(projected.data(), numPoints, pool);
+    }
+
+    virtual MappedChunk map(
+            const arbiter::Endpoint& out,
+            const Id& id) const override
+    {
+        MappedChunk mapped;
+        if (!out.isLocal() || !MappedFile::supported()) return mapped;
+
+        // Quantized records must be decoded, so can't be used in place.
+        if (quantized()) return mapped;
+
+        // If the file can't be mapped, leave it to read() to retry or report.
+        try
+        {
+            mapped.file = mapFile(out, m_metadata.basename(id));
+        }
+        catch (...)
+        {
+            return mapped;
+        }
+
+        std::size_t size(mapped.file->size());
+        const Tail tail(mapped.file->data(), size, m_tailFields);
+        mapped.numPoints = validate(size, tail, m_metadata.schema());
+        return mapped;
+    }
+
+    virtual Json::Value toJson() const override
+    {
+        Json::Value json;
+        for (const TailField f : m_tailFields) json["tail"].append(toString(f));
+        return json;
+    }
+
+protected:
+    // Check the records, sized without their tail or anything else which
+    // follows them, against the tail.  Returns the number of points.
+    std::size_t validate(
+            const std::size_t size,
+            const Tail& tail,
+            const Schema& schema,
+            const std::size_t extra = 0) const
+    {
         const std::size_t pointSize(schema.pointSize());
-        const std::size_t numPoints(data->size() / pointSize);
-        const std::size_t numBytes(data->size() + tail.size());
-        BinaryPointTable table(schema);
-        pdal::PointRef pointRef(table, 0);
+        const std::size_t numPoints(size / pointSize);
+        const std::size_t numBytes(size + extra + tail.size());
 
-        if (pointSize * numPoints != data->size())
+        if (pointSize * numPoints != size)
         {
             throw std::runtime_error("Invalid binary chunk size");
         }
@@ -79,58 +154,96 @@ public:
             throw std::runtime_error("Invalid binary chunk numBytes");
         }
 
-        Data::PooledStack dataStack(pool.dataPool().acquire(numPoints));
-        Cell::PooledStack cellStack(pool.cellPool().acquire(numPoints));
+        return numPoints;
+    }
+
+    // Validate a chunk, stripped of its tail, and decode its records in place
+    // to the native schema if they're quantized.  Returns the number of
+    // points.
+    std::size_t unpack(
+            std::vector<char>& data,
+            const Tail& tail,
+            const Schema& native) const
+    {
+        if (!quantized()) return validate(data.size(), tail, native);
+
+        const Quantization quantization(data);
+        const std::size_t numPoints(
+                validate(
+                    data.size(),
+                    tail,
+                    quantization.schema(native),
+                    Quantization::footerSize));
 
-        for (Cell& cell : cellStack)
+        if (!quantization.empty())
         {
-            table.setPoint(pos);
-            Data::PooledNode dataNode(dataStack.popOne());
-            std::copy(pos, pos + pointSize, *dataNode);
+            data = quantization.decode(native, data.data(), numPoints);
+        }
+
+        return numPoints;
+    }
+
+    bool quantized() const { return m_metadata.storage().quantize(); }
+
+    // Choose a quantization for the gathered records of this schema, and
+    // narrow them accordingly.
+    Quantization quantize(ChunkWrite& write, const Schema& schema) const
+    {
+        const Quantization quantization(
+                schema,
+                write.bounds,
+                write.data.data(),
+                write.numPoints);
 
-            cell.set(pointRef, std::move(dataNode));
-            pos += pointSize;
+        if (!quantization.empty())
+        {
+            write.data = quantization.encode(
+                    schema,
+                    write.data.data(),
+                    write.numPoints);
         }
 
-        assert(dataStack.empty());
-        return cellStack;
+        return quantization;
     }
 
-    virtual Json::Value toJson() const override
+    // Pooled cells from packed records laid out per the pool's schema.
+    Cell::PooledStack cells(
+            const char* data,
+            const std::size_t numPoints,
+            PointPool& pool) const
     {
-        Json::Value json;
-        for (const TailField f : m_tailFields) json["tail"].append(toString(f));
-        return json;
+        PointColumns columns(pool.schema());
+        columns.append(data, numPoints);
+        return columns.cells(pool);
     }
 
-protected:
     std::vector<char> buildData(Chunk& chunk) const
     {
         Cell::PooledStack cellStack(chunk.acquire());
-        Data::PooledStack dataStack(chunk.pool().dataPool());
-        for (Cell& cell : cellStack) dataStack.push(cell.acquire());
-        cellStack.release();
-
         const std::size_t pointSize(chunk.schema().pointSize());
 
         std::vector<char> data;
-        data.reserve(
-                dataStack.size() * pointSize +
-                buildTail(chunk, dataStack.size()).size());
+        data.reserve(cellStack.size() * pointSize);
 
-        for (const char* d : dataStack)
+        for (const Cell& cell : cellStack)
         {
-            data.insert(data.end(), d, d + pointSize);
+            for (const char* d : cell)
+            {
+                data.insert(data.end(), d, d + pointSize);
+            }
         }
 
+        PointPool::release(chunk.builder().pointPools(), std::move(cellStack));
         return data;
     }
 
+    // If numBytes is zero, the data is taken to be unencoded.
     std::vector<char> buildTail(
-            const Chunk& chunk,
-            const std::size_t numPoints,
+            const ChunkWrite& write,
             std::size_t numBytes = 0) const
     {
+        const std::size_t numPoints(write.numPoints);
+
         using Data = std::vector<char>;
         Data tail;
 
@@ -149,7 +262,7 @@ protected:
             }
         }
 
-        if (!numBytes) numBytes = numPoints * chunk.schema().pointSize();
+        if (!numBytes) numBytes = numPoints * m_metadata.schema().pointSize();
         numBytes += tailSize;
 
         for (TailField field : m_tailFields)
@@ -157,7 +270,7 @@ protected:
             switch (field)
             {
                 case TailField::ChunkType:
-                    append(tail, Data{ static_cast<char>(chunk.type()) });
+                    append(tail, Data{ static_cast<char>(write.type) });
                     break;
                 case TailField::NumPoints:
                     append(tail, numPoints);
@@ -10,9 +10,16 @@
 
 #include <entwine/types/chunk-storage/chunk-storage.hpp>
 
+#include <entwine/types/archive.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/util/async-io.hpp>
+#include <entwine/util/disk-cache.hpp>
 #include <entwine/types/chunk-storage/binary.hpp>
 #include <entwine/types/chunk-storage/lazperf.hpp>
 #include <entwine/types/chunk-storage/laszip.hpp>
+#ifdef ENTWINE_HAVE_ZSTD
+#include <entwine/types/chunk-storage/zstd.hpp>
+#endif
 #include <entwine/util/unique.hpp>
 
 namespace entwine
@@ -28,9 +35,92 @@ std::unique_ptr<ChunkStorage> ChunkStorage::create(
         case ChunkStorageType::LazPerf: return makeUnique<LazPerfStorage>(m, j);
         case ChunkStorageType::LasZip: return makeUnique<LasZipStorage>(m, j);
         case ChunkStorageType::Binary: return makeUnique<BinaryStorage>(m, j);
+#ifdef ENTWINE_HAVE_ZSTD
+        case ChunkStorageType::Zstd: return makeUnique<ZstdStorage>(m, j);
+#else
+        case ChunkStorageType::Zstd:
+            throw std::runtime_error("Entwine was built without zstd");
+#endif
         default: throw std::runtime_error("Invalid chunk compression type");
     }
 }
 
+bool ChunkStorage::putAsync(
+        ChunkWrite& write,
+        std::function<void(bool)> done) const
+{
+    // Archived puts share pack files, so they're written in place.
+    if (m_metadata.storage().archive() || !write.out.isLocal()) return false;
+
+    const std::vector<char>& data(write.data);
+    AsyncIo::instance().write(
+            write.out.fullPath(filename(write.id)),
+            data.data(),
+            data.size(),
+            std::move(done));
+
+    return true;
+}
+
+void ChunkStorage::ensurePut(
+        const ChunkWrite& write,
+        const std::string& path) const
+{
+    if (Archive* archive = m_metadata.storage().archive())
+    {
+        archive->put(write.out, path, write.data);
+    }
+    else
+    {
+        io::ensurePut(write.out, path, write.data);
+    }
+}
+
+std::unique_ptr<std::vector<char>> ChunkStorage::ensureGet(
+        const arbiter::Endpoint& out,
+        const std::string& path) const
+{
+    if (Archive* archive = m_metadata.storage().archive())
+    {
+        return archive->get(out, path);
+    }
+
+    // Use a read submitted ahead of time if there is one, or else retry it
+    // here if it failed.
+    std::unique_ptr<std::vector<char>> data;
+    if (out.isLocal() && Readahead::take(out.fullPath(path), data) && data)
+    {
+        return data;
+    }
+
+    // Remote chunks may have been fetched earlier and held on local disk.
+    if (!out.isLocal())
+    {
+        if (DiskCache* disk = DiskCache::find(out))
+        {
+            return disk->get(out, path, [&out, &path]()
+            {
+                return io::ensureGet(out, path);
+            });
+        }
+    }
+
+    return io::ensureGet(out, path);
+}
+
+std::unique_ptr<MappedFile> ChunkStorage::mapFile(
+        const arbiter::Endpoint& out,
+        const std::string& path) const
+{
+    if (Archive* archive = m_metadata.storage().archive())
+    {
+        auto mapped(archive->map(out, path));
+        if (!mapped) throw std::runtime_error("Not archived: " + path);
+        return mapped;
+    }
+
+    return makeUnique<MappedFile>(out.fullPath(path));
+}
+
 } // namespace entwine
 
@@ -10,17 +10,78 @@
 
 #pragma once
 
+#include <functional>
+
 #include <json/json.h>
 
 #include <entwine/tree/builder.hpp>
 #include <entwine/tree/chunk.hpp>
 #include <entwine/types/point-pool.hpp>
+#include <entwine/types/storage.hpp>
 #include <entwine/types/storage-types.hpp>
 #include <entwine/util/io.hpp>
 
 namespace entwine
 {
 
+// A chunk in flight through serialization, which happens in three stages that
+// may each run on a different thread:
+//      gather - take everything needed from the chunk, after which the chunk
+//               itself may be destroyed,
+//      encode - produce the serialized chunk,
+//      put    - write it to the output endpoint.
+struct ChunkWrite
+{
+    explicit ChunkWrite(Chunk& chunk)
+        : ChunkWrite(
+                chunk.id(),
+                chunk.bounds(),
+                chunk.type(),
+                chunk.builder().outEndpoint(),
+                chunk.builder().tmpEndpoint(),
+                chunk.pool(),
+                chunk.builder().pointPools())
+    { }
+
+    ChunkWrite(
+            const Id& id,
+            const Bounds& bounds,
+            ChunkType type,
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            PointPool& pool,
+            const std::vector<std::shared_ptr<PointPool>>& pools)
+        : id(id)
+        , bounds(bounds)
+        , type(type)
+        , out(out)
+        , tmp(tmp)
+        , pool(pool)
+        , pools(pools)
+        , numPoints(0)
+        , data()
+        , cells(pool.cellPool())
+    { }
+
+    const Id id;
+    const Bounds bounds;
+    const ChunkType type;
+    const arbiter::Endpoint& out;
+    const arbiter::Endpoint& tmp;
+    PointPool& pool;
+
+    // Gathered cells go back to these, see PointPool::release.
+    const std::vector<std::shared_ptr<PointPool>>& pools;
+
+    std::size_t numPoints;
+
+    // Gathered, and then encoded, bytes.
+    std::vector<char> data;
+
+    // Gathered points, for storage types which encode from cells.
+    Cell::PooledStack cells;
+};
+
 class ChunkStorage
 {
 public:
@@ -32,13 +93,49 @@ public:
             ChunkStorageType storageType,
             const Json::Value& json = Json::nullValue);
 
-    virtual void write(Chunk& chunk) const = 0;
+    // Run every serialization stage on the calling thread.
+    void write(Chunk& chunk) const
+    {
+        ChunkWrite write(chunk);
+        gather(write, chunk);
+        encode(write);
+        put(write);
+    }
+
+    // The stages of serialization, described by ChunkWrite.
+    virtual void gather(ChunkWrite& write, Chunk& chunk) const = 0;
+    virtual void encode(ChunkWrite& write) const { }
+    virtual void put(ChunkWrite& write) const = 0;
+
+    // Submit the put without waiting for it, calling done once the write
+    // completes with whether it succeeded.  The write must outlive the call.
+    // Returns false, having done nothing, if this put can't be asynchronous,
+    // in which case put must be used instead.
+    virtual bool putAsync(
+            ChunkWrite& write,
+            std::function<void(bool)> done) const;
+
     virtual Cell::PooledStack read(
             const arbiter::Endpoint& out,
             const arbiter::Endpoint& tmp,
             PointPool& pool,
             const Id& id) const = 0;
 
+    // Read only the dimensions of the projection, into a pool whose schema is
+    // the projected one.
+    virtual Cell::PooledStack readProjected(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            PointPool& pool,
+            const Id& id,
+            const Projection& projection) const = 0;
+
+    // Empty unless this storage type holds uncompressed records.
+    virtual MappedChunk map(const arbiter::Endpoint& out, const Id& id) const
+    {
+        return MappedChunk();
+    }
+
     virtual Json::Value toJson() const { return Json::nullValue; }
     virtual std::string filename(const Id& id) const
     {
@@ -46,20 +143,17 @@ public:
     }
 
 protected:
-    void ensurePut(
-            const Chunk& chunk,
-            const std::string& path,
-            const std::vector<char>& data) const
-    {
-        io::ensurePut(chunk.builder().outEndpoint(), path, data);
-    }
+    // Chunk I/O, which goes through the archive if chunks are archived.
+    void ensurePut(const ChunkWrite& write, const std::string& path) const;
 
     std::unique_ptr<std::vector<char>> ensureGet(
-            const Chunk& chunk,
-            const std::string& path) const
-    {
-        return io::ensureGet(chunk.builder().outEndpoint(), path);
-    }
+            const arbiter::Endpoint& out,
+            const std::string& path) const;
+
+    // Throws if the file can't be mapped.
+    std::unique_ptr<MappedFile> mapFile(
+            const arbiter::Endpoint& out,
+            const std::string& path) const;
 
     const Metadata& m_metadata;
 };
@@ -0,0 +1,162 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <pdal/SpatialReference.hpp>
+#include <pdal/io/LasReader.hpp>
+#include <pdal/io/LasWriter.hpp>
+
+// The LAS reader and writer here redirect PDAL's file I/O to memory by
+// overriding members of LasReader and LasWriter which aren't part of PDAL's
+// public API.  Overridden virtuals are checked by their override specifiers,
+// and the members they use by the static_asserts below, so a PDAL which
+// changes any of them fails to build here rather than misbehaving at runtime.
+
+namespace entwine
+{
+
+// A seekable input stream over a buffer which it does not own.
+class BufferStream : public std::istream
+{
+public:
+    explicit BufferStream(const std::vector<char>& data)
+        : std::istream(nullptr)
+        , m_buffer(data)
+    {
+        rdbuf(&m_buffer);
+    }
+
+private:
+    class Buffer : public std::streambuf
+    {
+    public:
+        explicit Buffer(const std::vector<char>& data)
+        {
+            char* begin(const_cast<char*>(data.data()));
+            setg(begin, begin, begin + data.size());
+        }
+
+    protected:
+        virtual pos_type seekoff(
+                off_type off,
+                std::ios_base::seekdir dir,
+                std::ios_base::openmode which) override
+        {
+            char* pos(
+                    dir == std::ios_base::beg ? eback() :
+                    dir == std::ios_base::cur ? gptr() :
+                    egptr());
+
+            pos += off;
+            if (pos < eback() || pos > egptr()) return pos_type(-1);
+
+            setg(eback(), pos, egptr());
+            return pos_type(pos - eback());
+        }
+
+        virtual pos_type seekpos(
+                pos_type pos,
+                std::ios_base::openmode which) override
+        {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
+    };
+
+    Buffer m_buffer;
+};
+
+// Reads LAS or LAZ from memory rather than from the file named by its
+// options, which must still be set.
+class BufferLasReader : public pdal::LasReader
+{
+public:
+    explicit BufferLasReader(const std::vector<char>& data)
+        : m_data(data)
+    { }
+
+private:
+    class StreamIf : public pdal::LasStreamIf
+    {
+    public:
+        explicit StreamIf(const std::vector<char>& data)
+        {
+            m_istream = new BufferStream(data);
+        }
+
+        static_assert(
+                std::is_same<decltype(m_istream), std::istream*>::value,
+                "Unsupported PDAL: LasStreamIf::m_istream has changed");
+    };
+
+    static_assert(
+            std::is_same<
+                decltype(m_streamIf),
+                std::unique_ptr<pdal::LasStreamIf>>::value,
+            "Unsupported PDAL: LasReader::m_streamIf has changed");
+
+    virtual void createStream() override
+    {
+        m_streamIf.reset(new StreamIf(m_data));
+    }
+
+    const std::vector<char>& m_data;
+};
+
+// Writes LAS or LAZ to memory rather than to the file named by its options,
+// in the same way as PDAL's NITF writer, which wraps LAS data.
+class BufferLasWriter : public pdal::LasWriter
+{
+public:
+    std::vector<char> data() const
+    {
+        const std::string s(m_stream.str());
+        return std::vector<char>(s.begin(), s.end());
+    }
+
+private:
+    static_assert(
+            std::is_same<
+                decltype(&BufferLasWriter::prepOutput),
+                void (pdal::LasWriter::*)(
+                    std::ostream*,
+                    const pdal::SpatialReference&)>::value,
+            "Unsupported PDAL: LasWriter::prepOutput has changed");
+
+    static_assert(
+            std::is_same<
+                decltype(&BufferLasWriter::finishOutput),
+                void (pdal::LasWriter::*)()>::value,
+            "Unsupported PDAL: LasWriter::finishOutput has changed");
+
+    virtual void readyFile(
+            const std::string& filename,
+            const pdal::SpatialReference& srs) override
+    {
+        prepOutput(&m_stream, srs);
+    }
+
+    virtual void doneFile() override
+    {
+        finishOutput();
+    }
+
+    std::ostringstream m_stream;
+};
+
+} // namespace entwine
@@ -10,8 +10,7 @@
 
 #include <entwine/types/chunk-storage/laszip.hpp>
 
-#include <pdal/io/LasWriter.hpp>
-
+#include <entwine/types/chunk-storage/las-buffer.hpp>
 #include <entwine/types/pooled-point-table.hpp>
 #include <entwine/types/reprojection.hpp>
 #include <entwine/util/executor.hpp>
@@ -19,35 +18,33 @@
 namespace entwine
 {
 
-void LasZipStorage::write(Chunk& chunk) const
+void LasZipStorage::gather(ChunkWrite& write, Chunk& chunk) const
 {
-    Cell::PooledStack cellStack(chunk.acquire());
-    const Schema& schema(chunk.schema());
-
     if (!m_metadata.delta())
     {
         throw std::runtime_error("Laszip storage requires scaling.");
     }
 
+    write.cells = chunk.acquire();
+    write.numPoints = write.cells.size();
+}
+
+void LasZipStorage::encode(ChunkWrite& write) const
+{
+    const Schema& schema(m_metadata.schema());
     const Delta& delta(*m_metadata.delta());
 
     CellTable cellTable(
-            chunk.pool(),
-            std::move(cellStack),
+            write.pool,
+            std::move(write.cells),
             makeUnique<Schema>(Schema::normalize(schema)));
 
     StreamReader reader(cellTable);
 
-    const auto& outEndpoint(chunk.builder().outEndpoint());
-    const auto& tmpEndpoint(chunk.builder().tmpEndpoint());
-
-    const std::string localDir = outEndpoint.isLocal() ?
-        outEndpoint.prefixedRoot() : tmpEndpoint.prefixedRoot();
-
-    const std::string filename(m_metadata.basename(chunk.id()) + ".laz");
+    const std::string path(filename(write.id));
 
     const auto offset = Point::unscale(
-            chunk.bounds().mid(),
+            write.bounds.mid(),
             delta.scale(),
             delta.offset())
         .apply([](double d) { return std::floor(d); });
@@ -57,7 +54,7 @@ void LasZipStorage::write(Chunk& chunk) const
     uint64_t colorMask(schema.hasColor() ? 2 : 0);
 
     pdal::Options options;
-    options.add("filename", localDir + filename);
+    options.add("filename", path);
     options.add("minor_version", 4);
     options.add("extra_dims", "all");
     options.add("software_id", "Entwine " + currentVersion().toString());
@@ -72,26 +69,20 @@ void LasZipStorage::write(Chunk& chunk) const
     options.add("offset_y", offset.y);
     options.add("offset_z", offset.z);
 
-    if (auto r = m_metadata.reprojection()) options.add("a_srs", r->out());
-    else if (m_metadata.srs().size()) options.add("a_srs", m_metadata.srs());
-
-    auto lock(Executor::getLock());
-
-    pdal::LasWriter writer;
+    BufferLasWriter writer;
     writer.setOptions(options);
+    writer.setSpatialReference(srs());
     writer.setInput(reader);
     writer.prepare(cellTable);
-
-    lock.unlock();
-
     writer.execute(cellTable);
 
-    if (!outEndpoint.isLocal())
-    {
-        io::ensurePut(outEndpoint, filename, tmpEndpoint.getBinary(filename));
+    write.data = writer.data();
+    PointPool::release(write.pools, cellTable.acquire());
+}
 
-        arbiter::fs::remove(tmpEndpoint.prefixedRoot() + filename);
-    }
+void LasZipStorage::put(ChunkWrite& write) const
+{
+    ensurePut(write, filename(write.id));
 }
 
 Cell::PooledStack LasZipStorage::read(
@@ -100,34 +91,51 @@ Cell::PooledStack LasZipStorage::read(
         PointPool& pool,
         const Id& id) const
 {
-    const std::string basename(m_metadata.basename(id) + ".laz");
-    std::string localFile(out.prefixedRoot() + basename);
-    bool copied(false);
+    const std::string path(filename(id));
+    auto data(ensureGet(out, path));
 
-    if (!out.isLocal() && out.tryGetSize(basename))
+    CellTable table(pool, makeUnique<Schema>(Schema::normalize(pool.schema())));
+
+    // Chunks carry the SRS of the output, which we don't need here.
+    pdal::Options options;
+    options.add("filename", path);
+    options.add("nosrs", true);
+
+    BufferLasReader reader(*data);
+    reader.setOptions(options);
+
+    try
+    {
+        reader.prepare(table);
+        table.resize(reader.header().pointCount());
+        reader.execute(table);
+    }
+    catch (pdal::pdal_error& e)
     {
-        localFile = arbiter::util::join(
-                tmp.prefixedRoot(),
-                arbiter::crypto::encodeAsHex(
-                    out.prefixedRoot()) + "-" + basename);
-        copied = true;
-
-        static const arbiter::drivers::Fs fs;
-        fs.put(localFile, *io::ensureGet(out, basename));
+        throw std::runtime_error(
+                "Laszip read failure: " + path + ": " + e.what());
     }
 
-    CellTable table(pool, makeUnique<Schema>(Schema::normalize(pool.schema())));
+    return table.acquire();
+}
+
+pdal::SpatialReference LasZipStorage::srs() const
+{
+    const Reprojection* r(m_metadata.reprojection());
+    const std::string input(r ? r->out() : m_metadata.srs());
 
-    if (auto preview = Executor::get().preview(localFile))
+    std::lock_guard<std::mutex> lock(m_srsMutex);
+
+    if (input != m_srsInput)
     {
-        table.resize(preview->numPoints);
+        // Parsing the SRS is the only part of preparing our stages which
+        // touches global state.
+        auto executorLock(Executor::getLock());
+        m_srs = pdal::SpatialReference(input);
+        m_srsInput = input;
     }
 
-    const bool good(Executor::get().run(table, localFile));
-    if (copied) arbiter::fs::remove(localFile);
-    if (!good) throw std::runtime_error("Laszip read failure: " + localFile);
-
-    return table.acquire();
+    return m_srs;
 }
 
 } // namespace entwine
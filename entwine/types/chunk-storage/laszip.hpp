@@ -10,11 +10,17 @@
 
 #pragma once
 
+#include <mutex>
+#include <string>
+
+#include <pdal/SpatialReference.hpp>
+
 #include <entwine/types/chunk-storage/chunk-storage.hpp>
 
 namespace entwine
 {
 
+// LAZ files, which are encoded and decoded in memory.
 class LasZipStorage : public ChunkStorage
 {
 public:
@@ -22,7 +28,9 @@ public:
         : ChunkStorage(m)
     { }
 
-    virtual void write(Chunk& chunk) const override;
+    virtual void gather(ChunkWrite& write, Chunk& chunk) const override;
+    virtual void encode(ChunkWrite& write) const override;
+    virtual void put(ChunkWrite& write) const override;
 
     virtual Cell::PooledStack read(
             const arbiter::Endpoint& out,
@@ -30,10 +38,29 @@ public:
             PointPool& pool,
             const Id& id) const override;
 
+    // The reader fills only the dimensions of the pool's schema.
+    virtual Cell::PooledStack readProjected(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            PointPool& pool,
+            const Id& id,
+            const Projection& projection) const override
+    {
+        return read(out, tmp, pool, id);
+    }
+
     virtual std::string filename(const Id& id) const override
     {
         return m_metadata.basename(id) + ".laz";
     }
+
+private:
+    // The output SRS, parsed once rather than for every chunk.
+    pdal::SpatialReference srs() const;
+
+    mutable std::mutex m_srsMutex;
+    mutable std::string m_srsInput;
+    mutable pdal::SpatialReference m_srs;
 };
 
 } // namespace entwine
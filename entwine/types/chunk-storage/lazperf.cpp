@@ -13,16 +13,23 @@
 namespace entwine
 {
 
-void LazPerfStorage::write(Chunk& chunk) const
+void LazPerfStorage::encode(ChunkWrite& write) const
 {
-    const std::vector<char> data(buildData(chunk));
-    const auto& schema(chunk.schema());
+    const auto& schema(m_metadata.schema());
+    const Quantization quantization(
+            quantized() ? quantize(write, schema) : Quantization());
 
-    auto comp(Compression::compress(data.data(), data.size(), schema));
+    const auto& data(write.data);
+    auto comp(
+            Compression::compress(
+                data.data(),
+                data.size(),
+                quantization.schema(schema)));
 
-    const std::size_t numPoints(data.size() / schema.pointSize());
-    append(*comp, buildTail(chunk, numPoints, comp->size()));
-    ensurePut(chunk, m_metadata.basename(chunk.id()), *comp);
+    if (quantized()) quantization.append(*comp);
+
+    append(*comp, buildTail(write, comp->size()));
+    write.data = std::move(*comp);
 }
 
 Cell::PooledStack LazPerfStorage::read(
@@ -31,7 +38,74 @@ Cell::PooledStack LazPerfStorage::read(
         PointPool& pool,
         const Id& id) const
 {
-    auto compressed(io::ensureGet(out, m_metadata.basename(id)));
+    std::unique_ptr<std::vector<char>> compressed;
+    const std::size_t numPoints(fetch(out, id, compressed));
+
+    if (!quantized())
+    {
+        return Compression::decompress(*compressed, numPoints, pool);
+    }
+
+    const std::vector<char> records(
+            dequantize(*compressed, pool.schema(), numPoints));
+
+    return cells(records.data(), numPoints, pool);
+}
+
+Cell::PooledStack LazPerfStorage::readProjected(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        PointPool& pool,
+        const Id& id,
+        const Projection& projection) const
+{
+    std::unique_ptr<std::vector<char>> compressed;
+    const std::size_t numPoints(fetch(out, id, compressed));
+
+    if (quantized())
+    {
+        const std::vector<char> records(
+                dequantize(*compressed, projection.native(), numPoints));
+
+        const std::vector<char> projected(
+                projection.apply(records.data(), numPoints));
+
+        return cells(projected.data(), numPoints, pool);
+    }
+
+    auto records(
+            Compression::decompress(
+                *compressed,
+                projection.native(),
+                &projection.schema(),
+                numPoints));
+
+    return cells(records->data(), numPoints, pool);
+}
+
+std::vector<char> LazPerfStorage::dequantize(
+        std::vector<char>& compressed,
+        const Schema& native,
+        const std::size_t numPoints) const
+{
+    const Quantization quantization(compressed);
+
+    auto records(
+            Compression::decompress(
+                compressed,
+                quantization.schema(native),
+                numPoints));
+
+    if (quantization.empty()) return std::move(*records);
+    return quantization.decode(native, records->data(), numPoints);
+}
+
+std::size_t LazPerfStorage::fetch(
+        const arbiter::Endpoint& out,
+        const Id& id,
+        std::unique_ptr<std::vector<char>>& compressed) const
+{
+    compressed = ensureGet(out, m_metadata.basename(id));
     const Tail tail(*compressed, m_tailFields);
 
     const std::size_t numPoints(tail.numPoints());
@@ -47,7 +121,7 @@ Cell::PooledStack LazPerfStorage::read(
         throw std::runtime_error("Invalid lazperf chunk numBytes");
     }
 
-    return Compression::decompress(*compressed, numPoints, pool);
+    return numPoints;
 }
 
 } // namespace entwine
@@ -23,13 +23,43 @@ public:
         : BinaryStorage(m, json)
     { }
 
-    virtual void write(Chunk& chunk) const override;
+    virtual void encode(ChunkWrite& write) const override;
 
     virtual Cell::PooledStack read(
             const arbiter::Endpoint& out,
             const arbiter::Endpoint& tmp,
             PointPool& pool,
             const Id& id) const override;
+
+    // Every dimension is decompressed, but only the projection is kept.
+    virtual Cell::PooledStack readProjected(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            PointPool& pool,
+            const Id& id,
+            const Projection& projection) const override;
+
+    // Compressed, so there's nothing to map.
+    virtual MappedChunk map(
+            const arbiter::Endpoint& out,
+            const Id& id) const override
+    {
+        return MappedChunk();
+    }
+
+private:
+    // Fetch a chunk, stripping its tail.  Returns its number of points.
+    std::size_t fetch(
+            const arbiter::Endpoint& out,
+            const Id& id,
+            std::unique_ptr<std::vector<char>>& compressed) const;
+
+    // Strip the quantization from the end of a fetched chunk and decompress
+    // it to packed records of the native schema.
+    std::vector<char> dequantize(
+            std::vector<char>& compressed,
+            const Schema& native,
+            std::size_t numPoints) const;
 };
 
 } // namespace entwine
@@ -0,0 +1,362 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/chunk-storage/zstd.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <entwine/util/compression.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    using DimType = pdal::Dimension::Type;
+
+    // Split a strided field into a column of byte planes - the low byte of
+    // every value, then the next, and so on - adding a shift to each value.
+    // Arithmetic wraps, so the shift is reversible whatever the values.  The
+    // high bytes of most fields vary little, which compresses far better than
+    // whole values do.
+    template<typename T>
+    void splitAs(
+            const char* pos,
+            const std::size_t numPoints,
+            const std::size_t stride,
+            const uint64_t shift,
+            char* out)
+    {
+        unsigned char* planes(reinterpret_cast<unsigned char*>(out));
+        T v;
+
+        for (std::size_t i(0); i < numPoints; ++i)
+        {
+            std::memcpy(&v, pos, sizeof(T));
+            v = static_cast<T>(v + static_cast<T>(shift));
+
+            for (std::size_t b(0); b < sizeof(T); ++b)
+            {
+                planes[b * numPoints + i] = static_cast<unsigned char>(
+                        v >> (8 * b));
+            }
+
+            pos += stride;
+        }
+    }
+
+    // The inverse of splitAs.
+    template<typename T>
+    void joinAs(
+            const char* in,
+            const std::size_t numPoints,
+            const std::size_t stride,
+            const uint64_t shift,
+            char* pos)
+    {
+        const unsigned char* planes(
+                reinterpret_cast<const unsigned char*>(in));
+
+        for (std::size_t i(0); i < numPoints; ++i)
+        {
+            T v(0);
+            for (std::size_t b(0); b < sizeof(T); ++b)
+            {
+                v |= static_cast<T>(planes[b * numPoints + i]) << (8 * b);
+            }
+
+            v = static_cast<T>(v + static_cast<T>(shift));
+            std::memcpy(pos, &v, sizeof(T));
+
+            pos += stride;
+        }
+    }
+
+    void split(
+            const char* pos,
+            const std::size_t numPoints,
+            const std::size_t stride,
+            const std::size_t size,
+            const int64_t shift,
+            char* out)
+    {
+        const uint64_t u(static_cast<uint64_t>(shift));
+
+        switch (size)
+        {
+            case 1: splitAs<uint8_t>(pos, numPoints, stride, u, out); break;
+            case 2: splitAs<uint16_t>(pos, numPoints, stride, u, out); break;
+            case 4: splitAs<uint32_t>(pos, numPoints, stride, u, out); break;
+            case 8: splitAs<uint64_t>(pos, numPoints, stride, u, out); break;
+            default: throw std::runtime_error("Invalid dimension size");
+        }
+    }
+
+    void join(
+            const char* in,
+            const std::size_t numPoints,
+            const std::size_t stride,
+            const std::size_t size,
+            const int64_t shift,
+            char* pos)
+    {
+        const uint64_t u(static_cast<uint64_t>(shift));
+
+        switch (size)
+        {
+            case 1: joinAs<uint8_t>(in, numPoints, stride, u, pos); break;
+            case 2: joinAs<uint16_t>(in, numPoints, stride, u, pos); break;
+            case 4: joinAs<uint32_t>(in, numPoints, stride, u, pos); break;
+            case 8: joinAs<uint64_t>(in, numPoints, stride, u, pos); break;
+            default: throw std::runtime_error("Invalid dimension size");
+        }
+    }
+
+    bool integral(const DimType type)
+    {
+        return type != DimType::Double && type != DimType::Float;
+    }
+
+    // Index of X, Y, or Z, otherwise -1.
+    int axis(const std::string& name)
+    {
+        if (name == "X") return 0;
+        if (name == "Y") return 1;
+        if (name == "Z") return 2;
+        return -1;
+    }
+
+    // Floating coordinates can't be shifted losslessly, so aren't shifted.
+    int64_t base(const DimInfo& dim, const Bounds& bounds)
+    {
+        const int a(axis(dim.name()));
+        if (a < 0 || !integral(dim.type())) return 0;
+
+        const double min(std::floor(bounds.min()[a]));
+        if (std::abs(min) >= std::pow(2.0, 62)) return 0;
+        return static_cast<int64_t>(min);
+    }
+
+    template<typename T>
+    void store(std::vector<char>& data, const T v)
+    {
+        const char* pos(reinterpret_cast<const char*>(&v));
+        data.insert(data.end(), pos, pos + sizeof(T));
+    }
+
+    template<typename T>
+    T load(const char*& pos)
+    {
+        T v;
+        std::memcpy(&v, pos, sizeof(T));
+        pos += sizeof(T);
+        return v;
+    }
+}
+
+void ZstdStorage::encode(ChunkWrite& write) const
+{
+    std::vector<char> packed(
+            pack(
+                m_metadata.schema(),
+                write.bounds,
+                write.data.data(),
+                write.numPoints));
+
+    append(packed, buildTail(write, packed.size()));
+    write.data = std::move(packed);
+}
+
+Cell::PooledStack ZstdStorage::read(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        PointPool& pool,
+        const Id& id) const
+{
+    std::unique_ptr<std::vector<char>> compressed;
+    const std::size_t numPoints(fetch(out, id, compressed));
+
+    const std::vector<char> records(
+            unpack(pool.schema(), compressed->data(), compressed->size()));
+
+    return cells(records.data(), check(records, pool, numPoints), pool);
+}
+
+Cell::PooledStack ZstdStorage::readProjected(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        PointPool& pool,
+        const Id& id,
+        const Projection& projection) const
+{
+    std::unique_ptr<std::vector<char>> compressed;
+    const std::size_t numPoints(fetch(out, id, compressed));
+
+    const std::vector<char> records(
+            unpack(projection, compressed->data(), compressed->size()));
+
+    return cells(records.data(), check(records, pool, numPoints), pool);
+}
+
+std::size_t ZstdStorage::fetch(
+        const arbiter::Endpoint& out,
+        const Id& id,
+        std::unique_ptr<std::vector<char>>& compressed) const
+{
+    compressed = ensureGet(out, m_metadata.basename(id));
+    const Tail tail(*compressed, m_tailFields);
+
+    const std::size_t numBytes(compressed->size() + tail.size());
+    if (tail.numBytes() && tail.numBytes() != numBytes)
+    {
+        throw std::runtime_error("Invalid zstd chunk numBytes");
+    }
+
+    return tail.numPoints();
+}
+
+std::size_t ZstdStorage::check(
+        const std::vector<char>& records,
+        const PointPool& pool,
+        const std::size_t expected) const
+{
+    const std::size_t numPoints(records.size() / pool.schema().pointSize());
+    if (expected && expected != numPoints)
+    {
+        throw std::runtime_error("Invalid zstd chunk numPoints");
+    }
+
+    return numPoints;
+}
+
+std::vector<char> ZstdStorage::pack(
+        const Schema& schema,
+        const Bounds& bounds,
+        const char* data,
+        const std::size_t numPoints)
+{
+    const std::size_t pointSize(schema.pointSize());
+
+    std::vector<char> out;
+    std::vector<char> column;
+    std::vector<uint64_t> ends;
+    int64_t bases[3] = { 0, 0, 0 };
+
+    std::size_t offset(0);
+
+    for (const DimInfo& dim : schema.dims())
+    {
+        const std::size_t size(dim.size());
+        column.resize(numPoints * size);
+
+        const int64_t b(base(dim, bounds));
+        if (b) bases[axis(dim.name())] = b;
+
+        split(data + offset, numPoints, pointSize, size, -b, column.data());
+
+        Compression::compressZstd(column.data(), column.size(), out);
+        ends.push_back(out.size());
+        offset += size;
+    }
+
+    store<uint64_t>(out, numPoints);
+    for (const int64_t b : bases) store<int64_t>(out, b);
+    for (const uint64_t end : ends) store<uint64_t>(out, end);
+
+    return out;
+}
+
+std::vector<char> ZstdStorage::unpack(
+        const Schema& schema,
+        const char* data,
+        const std::size_t size)
+{
+    return unpack(schema, schema, data, size);
+}
+
+std::vector<char> ZstdStorage::unpack(
+        const Projection& projection,
+        const char* data,
+        const std::size_t size)
+{
+    return unpack(projection.native(), projection.schema(), data, size);
+}
+
+std::vector<char> ZstdStorage::unpack(
+        const Schema& native,
+        const Schema& schema,
+        const char* data,
+        const std::size_t size)
+{
+    const std::size_t pointSize(schema.pointSize());
+    const std::size_t numDims(native.dims().size());
+    const std::size_t tableSize(sizeof(uint64_t) * (4 + numDims));
+
+    if (size < tableSize) throw std::runtime_error("Invalid zstd chunk size");
+
+    const std::size_t columnsSize(size - tableSize);
+    const char* pos(data + columnsSize);
+
+    const std::size_t numPoints(load<uint64_t>(pos));
+
+    int64_t bases[3];
+    for (int64_t& b : bases) b = load<int64_t>(pos);
+
+    std::vector<char> records(numPoints * pointSize);
+    std::vector<char> column;
+
+    std::size_t begin(0);
+    std::size_t offset(0);
+
+    for (const DimInfo& dim : native.dims())
+    {
+        const std::size_t end(load<uint64_t>(pos));
+        if (end < begin || end > columnsSize)
+        {
+            throw std::runtime_error("Invalid zstd chunk column offsets");
+        }
+
+        if (!schema.contains(dim.name()))
+        {
+            begin = end;
+            continue;
+        }
+
+        const std::size_t dimSize(dim.size());
+        column.resize(numPoints * dimSize);
+
+        Compression::decompressZstd(
+                data + begin,
+                end - begin,
+                column.data(),
+                column.size());
+
+        const int a(axis(dim.name()));
+        const int64_t shift(a >= 0 && integral(dim.type()) ? bases[a] : 0);
+
+        join(
+                column.data(),
+                numPoints,
+                pointSize,
+                dimSize,
+                shift,
+                records.data() + offset);
+
+        begin = end;
+        offset += dimSize;
+    }
+
+    return records;
+}
+
+} // namespace entwine
+
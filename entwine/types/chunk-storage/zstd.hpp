@@ -0,0 +1,105 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <entwine/types/chunk-storage/binary.hpp>
+
+namespace entwine
+{
+
+// Columnar chunks.  Records are split into one column per dimension, each of
+// which is stored as byte planes and compressed as its own zstd frame, so that
+// similar bytes are adjacent.  Integral XYZ values are stored relative to the
+// minimum corner of the chunk bounds, which leaves their high bytes mostly
+// zero.  A chunk is laid out as:
+//
+//      column 0 ... column n-1     zstd frames, in schema order
+//      numPoints                   uint64
+//      XYZ bases                   3 x int64
+//      column ends                 n x uint64, offsets from the first column
+//      tail                        as for binary storage
+class ZstdStorage : public BinaryStorage
+{
+public:
+    ZstdStorage(const Metadata& m, const Json::Value& json = Json::nullValue)
+        : BinaryStorage(m, json)
+    { }
+
+    virtual void encode(ChunkWrite& write) const override;
+
+    virtual Cell::PooledStack read(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            PointPool& pool,
+            const Id& id) const override;
+
+    // Columns outside of the projection are skipped without decompression.
+    virtual Cell::PooledStack readProjected(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            PointPool& pool,
+            const Id& id,
+            const Projection& projection) const override;
+
+    // Compressed, so there's nothing to map.
+    virtual MappedChunk map(
+            const arbiter::Endpoint& out,
+            const Id& id) const override
+    {
+        return MappedChunk();
+    }
+
+    // Columnize and compress packed records, excluding the tail.
+    static std::vector<char> pack(
+            const Schema& schema,
+            const Bounds& bounds,
+            const char* data,
+            std::size_t numPoints);
+
+    // The inverse of pack, resulting in packed records.  Size excludes the
+    // tail.
+    static std::vector<char> unpack(
+            const Schema& schema,
+            const char* data,
+            std::size_t size);
+
+    // As above, resulting in packed records of the projected schema.
+    static std::vector<char> unpack(
+            const Projection& projection,
+            const char* data,
+            std::size_t size);
+
+private:
+    // Fetch a chunk, stripping its tail.  Returns its number of points, or
+    // zero if the tail doesn't record it.
+    std::size_t fetch(
+            const arbiter::Endpoint& out,
+            const Id& id,
+            std::unique_ptr<std::vector<char>>& compressed) const;
+
+    // Returns the number of unpacked records, which must match the expected
+    // count if there is one.
+    std::size_t check(
+            const std::vector<char>& records,
+            const PointPool& pool,
+            std::size_t expected) const;
+
+    // Unpack the columns of the native schema which are also contained in the
+    // output schema, a subset of the native dimensions in their native order.
+    static std::vector<char> unpack(
+            const Schema& native,
+            const Schema& schema,
+            const char* data,
+            std::size_t size);
+};
+
+} // namespace entwine
+
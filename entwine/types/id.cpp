@@ -0,0 +1,191 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/id.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace entwine
+{
+
+namespace
+{
+    // Shift by a whole block.  If the inline word is only a single block wide,
+    // this shifts the entire value out.
+    Id::Word up(const Id::Word w)
+    {
+        return Id::wordBlocks > 1 ? w << (Id::bitsPerBlock % Id::wordBits) : 0;
+    }
+
+    Id::Word down(const Id::Word w)
+    {
+        return Id::wordBlocks > 1 ? w >> (Id::bitsPerBlock % Id::wordBits) : 0;
+    }
+}
+
+Id::Id(const Block* begin, const Block* end)
+    : m_word(0)
+    , m_big()
+{
+    assert(begin <= end);
+
+    // Leading zero blocks don't affect the value, so ignore them when
+    // deciding whether it fits.
+    while (end - begin > 1 && !*(end - 1)) --end;
+
+    if (static_cast<std::size_t>(end - begin) <= wordBlocks)
+    {
+        for (const Block* b(end); b != begin; )
+        {
+            --b;
+            m_word = up(m_word) | *b;
+        }
+    }
+    else
+    {
+        m_big.reset(new BigUint(begin, end));
+    }
+}
+
+Id::Id(const char* begin, const char* end)
+    : m_word(0)
+    , m_big()
+{
+    assert(begin <= end);
+    assert((end - begin) % bytesPerBlock == 0);
+
+    std::vector<Block> blocks((end - begin) / bytesPerBlock);
+    if (blocks.size()) std::memcpy(blocks.data(), begin, end - begin);
+    else blocks.push_back(0);
+
+    *this = Id(blocks.data(), blocks.data() + blocks.size());
+}
+
+std::size_t Id::blockSize() const
+{
+    if (m_big) return m_big->blockSize();
+
+    std::size_t size(1);
+    for (Word w(down(m_word)); w; w = down(w)) ++size;
+    return size;
+}
+
+std::vector<Id::Block> Id::blocks() const
+{
+    if (m_big)
+    {
+        const auto& data(m_big->data());
+        return std::vector<Block>(data.begin(), data.end());
+    }
+
+    std::vector<Block> result;
+    Word w(m_word);
+
+    do
+    {
+        result.push_back(static_cast<Block>(w));
+        w = down(w);
+    }
+    while (w);
+
+    return result;
+}
+
+BigUint Id::big() const
+{
+    if (m_big) return *m_big;
+
+    const std::vector<Block> b(blocks());
+    return BigUint(b.data(), b.data() + b.size());
+}
+
+std::string Id::str() const
+{
+    if (trivial()) return std::to_string(getSimple());
+    return big().str();
+}
+
+std::pair<Id, Id> Id::divMod(const Id& d) const
+{
+    if (fixed() && d.fixed() && d.m_word)
+    {
+        return std::make_pair(Id(*this) /= d, Id(*this) %= d);
+    }
+
+    const auto result(big().divMod(d.big()));
+    return std::make_pair(Id(result.first), Id(result.second));
+}
+
+Id::Block Id::log2(const Id& val)
+{
+    if (val.m_big) return BigUint::log2(*val.m_big);
+
+    Block result(0);
+    for (Word w(val.m_word >> 1); w; w >>= 1) ++result;
+    return result;
+}
+
+std::size_t Id::hash() const
+{
+    if (m_big) return std::hash<BigUint>()(*m_big);
+
+    // Mix both halves of the word - a variant of the MurmurHash3 finalizer.
+    uint64_t h(static_cast<uint64_t>(m_word));
+    if (wordBlocks > 1)
+    {
+        h ^= static_cast<uint64_t>(m_word >> (wordBits / 2)) *
+            0x9e3779b97f4a7c15ULL;
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    return h;
+}
+
+Id& Id::fallback(const Op op, const Id& rhs)
+{
+    BigUint result(big());
+
+    switch (op)
+    {
+        case Op::Add:       result += rhs.big(); break;
+        case Op::Subtract:  result -= rhs.big(); break;
+        case Op::Multiply:  result *= rhs.big(); break;
+        case Op::Divide:    result /= rhs.big(); break;
+        case Op::Modulo:    result %= rhs.big(); break;
+        case Op::And:       result &= rhs.big(); break;
+        case Op::Or:        result |= rhs.big(); break;
+        case Op::ShiftLeft: result <<= rhs.getSimple(); break;
+        case Op::ShiftRight: result >>= rhs.getSimple(); break;
+    }
+
+    assign(result);
+    return *this;
+}
+
+void Id::assign(const BigUint& big)
+{
+    const auto& data(big.data());
+    *this = Id(data.data(), data.data() + data.size());
+}
+
+std::ostream& operator<<(std::ostream& out, const Id& id)
+{
+    return out << id.str();
+}
+
+} // namespace entwine
+
@@ -0,0 +1,360 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <entwine/third/bigint/little-big-int.hpp>
+
+namespace entwine
+{
+
+// An unsigned integer index into the tree.  Values which fit in a fixed-width
+// inline word - 128 bits where the compiler supports it, otherwise 64 - are
+// stored and operated on directly, without allocation.  Operations whose
+// results don't fit transparently fall back to BigUint, which is only
+// reached by trees of extreme depth.
+//
+// The interface mirrors BigUint, except that raw block access is read-only
+// via blocks().
+class Id
+{
+public:
+    using Block = BigUint::Block;
+    static constexpr std::size_t bytesPerBlock = BigUint::bytesPerBlock;
+    static constexpr std::size_t bitsPerBlock = BigUint::bitsPerBlock;
+
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 Word;
+#else
+    typedef uint64_t Word;
+#endif
+
+    static constexpr std::size_t wordBits = sizeof(Word) * CHAR_BIT;
+    static constexpr std::size_t wordBlocks = sizeof(Word) / sizeof(Block);
+
+    Id() noexcept : m_word(0), m_big() { }
+    Id(Block v) noexcept : m_word(v), m_big() { }
+    explicit Id(const std::string& s) : Id(BigUint(s)) { }
+    explicit Id(const BigUint& big) : m_word(0), m_big() { assign(big); }
+
+    Id(const Block* begin, const Block* end);
+    Id(const char* begin, const char* end);
+
+    Id(const Id& other)
+        : m_word(other.m_word)
+        , m_big(other.m_big ? new BigUint(*other.m_big) : nullptr)
+    { }
+
+    Id(Id&& other) noexcept
+        : m_word(other.m_word)
+        , m_big(std::move(other.m_big))
+    { }
+
+    Id& operator=(const Id& other)
+    {
+        m_word = other.m_word;
+        if (other.m_big) m_big.reset(new BigUint(*other.m_big));
+        else m_big.reset();
+        return *this;
+    }
+
+    Id& operator=(Id&& other) noexcept
+    {
+        m_word = other.m_word;
+        m_big = std::move(other.m_big);
+        return *this;
+    }
+
+    // True if this value is stored inline, and so operations on it are cheap.
+    bool fixed() const { return !m_big; }
+
+    bool zero() const { return fixed() && !m_word; }
+    explicit operator bool() const { return !zero(); }
+
+    // True if this value fits in a single Block.
+    bool trivial() const
+    {
+        return fixed() && m_word <= std::numeric_limits<Block>::max();
+    }
+
+    std::size_t blockSize() const;
+
+    // Throws std::overflow_error if !trivial().
+    unsigned long long getSimple() const
+    {
+        if (trivial()) return static_cast<Block>(m_word);
+        throw std::overflow_error("This Id is too large to get as long.");
+    }
+
+    std::string str() const;
+
+    // Little-endian blocks, with no leading zero blocks - identical to the
+    // data() of the equivalent BigUint.
+    std::vector<Block> blocks() const;
+
+    BigUint big() const;
+
+    std::pair<Id, Id> divMod(const Id& denominator) const;
+
+    static Block log2(const Id& val);
+
+    Id& operator+=(const Id& rhs)
+    {
+        if (fixed() && rhs.fixed())
+        {
+            const Word result(m_word + rhs.m_word);
+            if (result >= m_word) { m_word = result; return *this; }
+        }
+
+        return fallback(Op::Add, rhs);
+    }
+
+    Id& operator-=(const Id& rhs)
+    {
+        if (fixed() && rhs.fixed() && m_word >= rhs.m_word)
+        {
+            m_word -= rhs.m_word;
+            return *this;
+        }
+
+        return fallback(Op::Subtract, rhs);
+    }
+
+    Id& operator*=(const Id& rhs)
+    {
+        if (fixed() && rhs.fixed())
+        {
+            Word result;
+            if (!multiplyOverflows(m_word, rhs.m_word, result))
+            {
+                m_word = result;
+                return *this;
+            }
+        }
+
+        return fallback(Op::Multiply, rhs);
+    }
+
+    Id& operator/=(const Id& rhs)
+    {
+        if (fixed() && rhs.fixed() && rhs.m_word)
+        {
+            m_word /= rhs.m_word;
+            return *this;
+        }
+
+        return fallback(Op::Divide, rhs);
+    }
+
+    Id& operator%=(const Id& rhs)
+    {
+        if (fixed() && rhs.fixed() && rhs.m_word)
+        {
+            m_word %= rhs.m_word;
+            return *this;
+        }
+
+        return fallback(Op::Modulo, rhs);
+    }
+
+    Id& operator&=(const Id& rhs)
+    {
+        if (fixed() && rhs.fixed()) { m_word &= rhs.m_word; return *this; }
+        return fallback(Op::And, rhs);
+    }
+
+    Id& operator|=(const Id& rhs)
+    {
+        if (fixed() && rhs.fixed()) { m_word |= rhs.m_word; return *this; }
+        return fallback(Op::Or, rhs);
+    }
+
+    Id& operator<<=(const Block shift)
+    {
+        if (fixed())
+        {
+            if (!m_word) return *this;
+
+            if (
+                    shift < wordBits &&
+                    (!shift || !(m_word >> (wordBits - shift))))
+            {
+                m_word <<= shift;
+                return *this;
+            }
+        }
+
+        return fallback(Op::ShiftLeft, shift);
+    }
+
+    Id& operator>>=(const Block shift)
+    {
+        if (fixed())
+        {
+            m_word = shift < wordBits ? m_word >> shift : 0;
+            return *this;
+        }
+
+        return fallback(Op::ShiftRight, shift);
+    }
+
+    Id& operator++()
+    {
+        if (fixed() && m_word != ~Word(0)) ++m_word;
+        else *this += 1;
+        return *this;
+    }
+
+    Id& operator--()
+    {
+        if (fixed() && m_word) --m_word;
+        else *this -= 1;
+        return *this;
+    }
+
+    Id operator++(int) { Id prev(*this); ++*this; return prev; }
+    Id operator--(int) { Id prev(*this); --*this; return prev; }
+
+    friend bool operator==(const Id& lhs, const Id& rhs);
+    friend bool operator<(const Id& lhs, const Id& rhs);
+
+    std::size_t hash() const;
+
+private:
+    enum class Op
+    {
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Modulo,
+        And,
+        Or,
+        ShiftLeft,
+        ShiftRight
+    };
+
+    // Perform an operation whose result, or either operand, doesn't fit
+    // inline.  Errors such as negative results or division by zero are
+    // thrown here, by BigUint.
+    Id& fallback(Op op, const Id& rhs);
+
+    // Store this value, inline if it fits.
+    void assign(const BigUint& big);
+
+    static bool multiplyOverflows(Word a, Word b, Word& result)
+    {
+#ifdef __GNUC__
+        return __builtin_mul_overflow(a, b, &result);
+#else
+        if (a && b > ~Word(0) / a) return true;
+        result = a * b;
+        return false;
+#endif
+    }
+
+    Word m_word;
+    std::unique_ptr<BigUint> m_big;
+};
+
+inline Id operator+(const Id& lhs, const Id& rhs)
+{
+    Id result(lhs); result += rhs; return result;
+}
+
+inline Id operator-(const Id& lhs, const Id& rhs)
+{
+    Id result(lhs); result -= rhs; return result;
+}
+
+inline Id operator*(const Id& lhs, const Id& rhs)
+{
+    Id result(lhs); result *= rhs; return result;
+}
+
+inline Id operator/(const Id& lhs, const Id& rhs)
+{
+    Id result(lhs); result /= rhs; return result;
+}
+
+inline Id operator%(const Id& lhs, const Id& rhs)
+{
+    Id result(lhs); result %= rhs; return result;
+}
+
+inline Id operator&(const Id& lhs, const Id& rhs)
+{
+    Id result(lhs); result &= rhs; return result;
+}
+
+inline Id operator|(const Id& lhs, const Id& rhs)
+{
+    Id result(lhs); result |= rhs; return result;
+}
+
+inline Id operator<<(const Id& lhs, Id::Block rhs)
+{
+    Id result(lhs); result <<= rhs; return result;
+}
+
+inline Id operator>>(const Id& lhs, Id::Block rhs)
+{
+    Id result(lhs); result >>= rhs; return result;
+}
+
+inline bool operator==(const Id& lhs, const Id& rhs)
+{
+    if (lhs.fixed() && rhs.fixed()) return lhs.m_word == rhs.m_word;
+    if (lhs.fixed() != rhs.fixed()) return false;
+    return *lhs.m_big == *rhs.m_big;
+}
+
+// Values are only stored as BigUint if they don't fit inline, so any such
+// value is greater than every inline value.
+inline bool operator<(const Id& lhs, const Id& rhs)
+{
+    if (lhs.fixed() && rhs.fixed()) return lhs.m_word < rhs.m_word;
+    if (lhs.fixed() != rhs.fixed()) return lhs.fixed();
+    return *lhs.m_big < *rhs.m_big;
+}
+
+inline bool operator!=(const Id& lhs, const Id& rhs) { return !(lhs == rhs); }
+inline bool operator> (const Id& lhs, const Id& rhs) { return rhs < lhs; }
+inline bool operator<=(const Id& lhs, const Id& rhs) { return !(rhs < lhs); }
+inline bool operator>=(const Id& lhs, const Id& rhs) { return !(lhs < rhs); }
+
+inline bool operator!(const Id& val) { return val.zero(); }
+
+std::ostream& operator<<(std::ostream& out, const Id& id);
+
+} // namespace entwine
+
+namespace std
+{
+
+template<> struct hash<entwine::Id>
+{
+    std::size_t operator()(const entwine::Id& id) const { return id.hash(); }
+};
+
+} // namespace std
+
@@ -199,12 +199,14 @@ Json::Value Manifest::toJson() const
 
 void Manifest::awakenAll(Pool& pool) const
 {
+    TaskGroup group;
+
     for (std::size_t i(0); i < m_fileInfo.size(); i += m_chunkSize)
     {
-        pool.add([this, i]() { awaken(i); });
+        pool.add(group, [this, i]() { awaken(i); });
     }
 
-    pool.cycle();
+    group.wait();
 
     if (std::any_of(
                 m_remote.begin(),
@@ -40,6 +40,9 @@ Metadata::Metadata(
         const bool trustHeaders,
         const ChunkStorageType chunkStorage,
         const HierarchyCompression hierarchyCompress,
+        const int hierarchyLevel,
+        const bool archive,
+        const bool quantize,
         const double density,
         const Reprojection* reprojection,
         const Subset* subset,
@@ -60,7 +63,14 @@ Metadata::Metadata(
     , m_structure(makeUnique<Structure>(structure))
     , m_hierarchyStructure(makeUnique<Structure>(hierarchyStructure))
     , m_manifest(makeUnique<Manifest>(manifest))
-    , m_storage(makeUnique<Storage>(*this, chunkStorage, hierarchyCompress))
+    , m_storage(
+            makeUnique<Storage>(
+                *this,
+                chunkStorage,
+                hierarchyCompress,
+                hierarchyLevel,
+                archive,
+                quantize))
     , m_reprojection(maybeClone(reprojection))
     , m_subset(maybeClone(subset))
     , m_transformation(maybeClone(transformation))
@@ -258,6 +268,9 @@ Json::Value Metadata::toJson() const
 
 void Metadata::save(const arbiter::Endpoint& endpoint) const
 {
+    // The archive index must exist before the metadata which refers to it.
+    m_storage->save(endpoint);
+
     const auto json(toJson());
     io::ensurePut(endpoint, "entwine" + postfix(), json.toStyledString());
 
@@ -52,6 +52,9 @@ public:
             bool trustHeaders,
             ChunkStorageType chunkStorage,
             HierarchyCompression hierarchyCompress,
+            int hierarchyLevel,
+            bool archive,
+            bool quantize,
             double density,
             const Reprojection* reprojection = nullptr,
             const Subset* subset = nullptr,
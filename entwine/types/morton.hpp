@@ -0,0 +1,88 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/point.hpp>
+
+namespace entwine
+{
+namespace morton
+{
+
+// Interleave the bits of v with zeros: abcd -> 0a0b0c0d.
+inline uint64_t spread2(uint32_t v)
+{
+    uint64_t x(v);
+    x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+    x = (x | (x << 8))  & 0x00ff00ff00ff00ffULL;
+    x = (x | (x << 4))  & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x << 2))  & 0x3333333333333333ULL;
+    x = (x | (x << 1))  & 0x5555555555555555ULL;
+    return x;
+}
+
+// Interleave the low 21 bits of v with pairs of zeros: abc -> 00a00b00c.
+inline uint64_t spread3(uint32_t v)
+{
+    uint64_t x(v & 0x1fffff);
+    x = (x | (x << 32)) & 0x001f00000000ffffULL;
+    x = (x | (x << 16)) & 0x001f0000ff0000ffULL;
+    x = (x | (x << 8))  & 0x100f00f00f00f00fULL;
+    x = (x | (x << 4))  & 0x10c30c30c30c30c3ULL;
+    x = (x | (x << 2))  & 0x1249249249249249ULL;
+    return x;
+}
+
+// Quantize a coordinate into one of 2^32 equal steps across [min, min+span].
+// Values outside of that range are clamped.
+inline uint32_t quantize(double v, double min, double span)
+{
+    const double n((v - min) / span);
+    if (!(n > 0)) return 0;
+    if (n >= 1) return 0xffffffff;
+    return static_cast<uint32_t>(n * 4294967296.0);
+}
+
+// The 2D Morton code of a point within the given bounds.  X occupies the even
+// bits and Y the odd bits, so each pair of bits from the top down matches the
+// integral value of the 2D Dir taken at that depth (East is +1, North is +2).
+//
+// Since every quadtree node covers a contiguous range of these codes, sorting
+// points by this key groups them by chunk at every depth at once.
+inline uint64_t key2d(const Point& p, const Bounds& bounds)
+{
+    const Point& min(bounds.min());
+
+    return
+        spread2(quantize(p.x, min.x, bounds.width())) |
+        (spread2(quantize(p.y, min.y, bounds.depth())) << 1);
+}
+
+// The 3D Morton code of a point within the given bounds, for octrees.  Each
+// coordinate keeps its top 21 bits, and X, Y, and Z occupy the low, middle,
+// and high bit of each triple, so each triple of bits from bit 62 down
+// matches the integral value of the 3D Dir taken at that depth (Up is +4).
+inline uint64_t key3d(const Point& p, const Bounds& bounds)
+{
+    const Point& min(bounds.min());
+
+    return
+        spread3(quantize(p.x, min.x, bounds.width()) >> 11) |
+        (spread3(quantize(p.y, min.y, bounds.depth()) >> 11) << 1) |
+        (spread3(quantize(p.z, min.z, bounds.height()) >> 11) << 2);
+}
+
+} // namespace morton
+} // namespace entwine
+
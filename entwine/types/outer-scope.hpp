@@ -10,8 +10,11 @@
 
 #pragma once
 
+#include <json/json.h>
+
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/point-pool.hpp>
+#include <entwine/util/numa.hpp>
 
 namespace entwine
 {
@@ -34,6 +37,18 @@ public:
         m_hierarchyPool = hierarchyPool;
     }
 
+    // If set, builds run in NUMA mode over this topology.
+    void setNuma(std::shared_ptr<Numa> numa)
+    {
+        m_numa = numa;
+    }
+
+    // Sizing of the chunk serialization pipeline - see Serializer.
+    void setSerialization(const Json::Value& json)
+    {
+        m_serialization = json;
+    }
+
     template<class... Args>
     std::shared_ptr<arbiter::Arbiter> getArbiter(Args&&... args) const
     {
@@ -70,6 +85,9 @@ public:
         return m_hierarchyPool;
     }
 
+    std::shared_ptr<Numa> getNuma() const { return m_numa; }
+    const Json::Value& getSerialization() const { return m_serialization; }
+
     arbiter::Arbiter* getArbiterPtr() const { return m_arbiter.get(); }
     PointPool* getPointPoolPtr() const { return m_pointPool.get(); }
     HierarchyCell::Pool* getHierarchyPoolPtr() const
@@ -81,6 +99,8 @@ private:
     mutable std::shared_ptr<arbiter::Arbiter> m_arbiter;
     mutable std::shared_ptr<PointPool> m_pointPool;
     mutable std::shared_ptr<HierarchyCell::Pool> m_hierarchyPool;
+    std::shared_ptr<Numa> m_numa;
+    Json::Value m_serialization;
 };
 
 } // namespace entwine
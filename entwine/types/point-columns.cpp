@@ -0,0 +1,190 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/point-columns.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace entwine
+{
+
+namespace
+{
+    template<typename T>
+    void decodeAs(
+            const char* pos,
+            const std::size_t numPoints,
+            const std::size_t stride,
+            double* out)
+    {
+        T v;
+        for (std::size_t i(0); i < numPoints; ++i)
+        {
+            std::memcpy(&v, pos, sizeof(T));
+            out[i] = static_cast<double>(v);
+            pos += stride;
+        }
+    }
+}
+
+PointColumns::PointColumns(const Schema& schema)
+    : m_pointSize(0)
+    , m_offsets()
+    , m_types()
+    , m_x()
+    , m_y()
+    , m_z()
+    , m_records()
+{
+    // Records are packed in the order of the schema's dimensions.
+    const std::array<std::string, 3> names{ { "X", "Y", "Z" } };
+
+    for (const DimInfo& dim : schema.dims())
+    {
+        for (std::size_t i(0); i < names.size(); ++i)
+        {
+            if (dim.name() == names[i])
+            {
+                m_offsets[i] = m_pointSize;
+                m_types[i] = dim.type();
+            }
+        }
+
+        m_pointSize += dim.size();
+    }
+
+    for (const auto& name : names)
+    {
+        if (!schema.contains(name))
+        {
+            throw std::runtime_error("Schema has no " + name + " dimension");
+        }
+    }
+}
+
+void PointColumns::reserve(const std::size_t numPoints)
+{
+    m_x.reserve(numPoints);
+    m_y.reserve(numPoints);
+    m_z.reserve(numPoints);
+    m_records.reserve(numPoints * m_pointSize);
+}
+
+void PointColumns::clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_z.clear();
+    m_records.clear();
+}
+
+void PointColumns::append(const char* pos, const std::size_t numPoints)
+{
+    appendCoordinates(pos, numPoints);
+    m_records.insert(m_records.end(), pos, pos + numPoints * m_pointSize);
+}
+
+void PointColumns::appendCoordinates(
+        const char* pos,
+        const std::size_t numPoints)
+{
+    const std::size_t begin(size());
+
+    m_x.resize(begin + numPoints);
+    m_y.resize(begin + numPoints);
+    m_z.resize(begin + numPoints);
+
+    decode(pos, numPoints, 0, m_x.data() + begin);
+    decode(pos, numPoints, 1, m_y.data() + begin);
+    decode(pos, numPoints, 2, m_z.data() + begin);
+}
+
+Cell::PooledStack PointColumns::cells(PointPool& pool) const
+{
+    const std::size_t numPoints(size());
+
+    Data::PooledStack dataStack(pool.dataPool().acquire(numPoints));
+    Cell::PooledStack cellStack(pool.cellPool().acquire(numPoints));
+
+    std::size_t slot(0);
+
+    for (Cell& cell : cellStack)
+    {
+        Data::PooledNode dataNode(dataStack.popOne());
+        const char* pos(record(slot));
+        std::copy(pos, pos + m_pointSize, *dataNode);
+
+        cell.set(point(slot), std::move(dataNode));
+        ++slot;
+    }
+
+    assert(dataStack.empty());
+    return cellStack;
+}
+
+std::vector<char> PointColumns::release()
+{
+    std::vector<char> records(std::move(m_records));
+    clear();
+    return records;
+}
+
+void PointColumns::decode(
+        const char* pos,
+        const std::size_t numPoints,
+        const std::size_t dim,
+        double* out) const
+{
+    using Type = pdal::Dimension::Type;
+
+    pos += m_offsets[dim];
+
+    switch (m_types[dim])
+    {
+        case Type::Double:
+            decodeAs<double>(pos, numPoints, m_pointSize, out);
+            break;
+        case Type::Float:
+            decodeAs<float>(pos, numPoints, m_pointSize, out);
+            break;
+        case Type::Signed8:
+            decodeAs<int8_t>(pos, numPoints, m_pointSize, out);
+            break;
+        case Type::Signed16:
+            decodeAs<int16_t>(pos, numPoints, m_pointSize, out);
+            break;
+        case Type::Signed32:
+            decodeAs<int32_t>(pos, numPoints, m_pointSize, out);
+            break;
+        case Type::Signed64:
+            decodeAs<int64_t>(pos, numPoints, m_pointSize, out);
+            break;
+        case Type::Unsigned8:
+            decodeAs<uint8_t>(pos, numPoints, m_pointSize, out);
+            break;
+        case Type::Unsigned16:
+            decodeAs<uint16_t>(pos, numPoints, m_pointSize, out);
+            break;
+        case Type::Unsigned32:
+            decodeAs<uint32_t>(pos, numPoints, m_pointSize, out);
+            break;
+        case Type::Unsigned64:
+            decodeAs<uint64_t>(pos, numPoints, m_pointSize, out);
+            break;
+        default:
+            throw std::runtime_error("Invalid spatial dimension type");
+    }
+}
+
+} // namespace entwine
+
@@ -0,0 +1,95 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <entwine/types/point-pool.hpp>
+#include <entwine/types/point.hpp>
+#include <entwine/types/schema.hpp>
+
+namespace entwine
+{
+
+// Structure-of-arrays storage for a run of points, typically the contents of
+// a single chunk.  Coordinates are held in three contiguous columns so that
+// batch operations, like Descent::paths, stream through them, and the full
+// packed records are held in a side buffer indexed by the same slot.
+//
+// This is used where packed records are read in bulk - chunk deserialization
+// and mapped reader chunks - to decode coordinates with one strided pass per
+// column rather than a PDAL PointRef per point.  During a build, points live
+// in pooled Cells, which move between chunks as they're displaced, and only
+// the coordinates of those resident in contiguous chunks are held in columns -
+// see TubeColumns.
+class PointColumns
+{
+public:
+    explicit PointColumns(const Schema& schema);
+
+    std::size_t size() const { return m_x.size(); }
+    bool empty() const { return m_x.empty(); }
+    std::size_t pointSize() const { return m_pointSize; }
+
+    void reserve(std::size_t numPoints);
+    void clear();
+
+    // Append numPoints contiguous packed records, as laid out by our schema.
+    void append(const char* pos, std::size_t numPoints);
+
+    // Decode only the coordinates of numPoints packed records, for callers
+    // which keep the records in place themselves.  Records for these slots
+    // are not retained, so record() must not be used with them.
+    void appendCoordinates(const char* pos, std::size_t numPoints);
+
+    // Create a pooled cell for each slot, in slot order.
+    Cell::PooledStack cells(PointPool& pool) const;
+
+    const double* x() const { return m_x.data(); }
+    const double* y() const { return m_y.data(); }
+    const double* z() const { return m_z.data(); }
+
+    Point point(std::size_t slot) const
+    {
+        return Point(m_x[slot], m_y[slot], m_z[slot]);
+    }
+
+    const char* record(std::size_t slot) const
+    {
+        return m_records.data() + slot * m_pointSize;
+    }
+
+    const std::vector<char>& records() const { return m_records; }
+
+    // Move the packed records out, leaving this object empty.
+    std::vector<char> release();
+
+private:
+    void decode(
+            const char* pos,
+            std::size_t numPoints,
+            std::size_t dim,
+            double* out) const;
+
+    std::size_t m_pointSize;
+    std::array<std::size_t, 3> m_offsets;
+    std::array<pdal::Dimension::Type, 3> m_types;
+
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_z;
+    std::vector<char> m_records;
+};
+
+} // namespace entwine
+
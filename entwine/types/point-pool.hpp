@@ -13,6 +13,8 @@
 #include <cassert>
 #include <cstddef>
 #include <cstring>
+#include <memory>
+#include <vector>
 
 #include <pdal/PointRef.hpp>
 
@@ -101,6 +103,12 @@ public:
         m_dataStack.push(dataNode.release());
     }
 
+    void set(const Point& point, Data::PooledNode&& dataNode)
+    {
+        m_point = point;
+        m_dataStack.push(dataNode.release());
+    }
+
 private:
     Point m_point;
     Data::RawStack m_dataStack;
@@ -125,10 +133,23 @@ public:
         , m_cellPool(blockSize)
     { }
 
+    PointPool(
+            const Schema& schema,
+            const Delta* delta,
+            std::size_t blockSize,
+            std::size_t magazineSize)
+        : m_schema(schema)
+        , m_delta(delta)
+        , m_dataPool(schema.pointSize(), blockSize, magazineSize)
+        , m_cellPool(blockSize, magazineSize)
+    { }
+
     const Schema& schema() const { return m_schema; }
     const Delta* delta() const { return m_delta; }
     Data::Pool& dataPool() { return m_dataPool; }
     Cell::Pool& cellPool() { return m_cellPool; }
+    const Data::Pool& dataPool() const { return m_dataPool; }
+    const Cell::Pool& cellPool() const { return m_cellPool; }
 
     void release(Cell::PooledStack cells)
     {
@@ -136,7 +157,74 @@ public:
         for (auto& cell : cells) dataStack.push(cell.acquire());
     }
 
+    // Return cells, and each of their data nodes, to whichever of these pools
+    // allocated them.  A NUMA build keeps a pool per node, and points from
+    // all of them end up in the same chunks, so releasing everything to one
+    // pool would drain the others and skew every pool's counts.  Nodes that
+    // none of them allocated go to the first.
+    static void release(
+            const std::vector<std::shared_ptr<PointPool>>& pools,
+            Cell::PooledStack cells)
+    {
+        if (pools.size() == 1)
+        {
+            pools.front()->release(std::move(cells));
+            return;
+        }
+
+        std::vector<Cell::RawStack> cellStacks(pools.size());
+        std::vector<Data::RawStack> dataStacks(pools.size());
+
+        Cell::RawStack raw(cells.release());
+        std::size_t cellOwner(0);
+        std::size_t dataOwner(0);
+
+        while (Cell::RawNode* cellNode = raw.pop())
+        {
+            Data::RawStack data(cellNode->val().acquire());
+
+            while (Data::RawNode* dataNode = data.pop())
+            {
+                dataOwner = owner(pools, dataOwner, [dataNode](PointPool& p)
+                {
+                    return p.dataPool().owns(dataNode);
+                });
+                dataStacks[dataOwner].push(dataNode);
+            }
+
+            cellOwner = owner(pools, cellOwner, [cellNode](PointPool& p)
+            {
+                return p.cellPool().owns(cellNode);
+            });
+            cellStacks[cellOwner].push(cellNode);
+        }
+
+        for (std::size_t i(0); i < pools.size(); ++i)
+        {
+            pools[i]->dataPool().release(std::move(dataStacks[i]));
+            pools[i]->cellPool().release(std::move(cellStacks[i]));
+        }
+    }
+
 private:
+    // Neighboring nodes usually share an owner, so the last one is tried
+    // first.
+    template<typename Owns>
+    static std::size_t owner(
+            const std::vector<std::shared_ptr<PointPool>>& pools,
+            const std::size_t last,
+            Owns owns)
+    {
+        if (owns(*pools[last])) return last;
+
+        for (std::size_t i(0); i < pools.size(); ++i)
+        {
+            if (i != last && owns(*pools[i])) return i;
+        }
+
+        return 0;
+    }
+
     const Schema& m_schema;
     const Delta* m_delta;
 
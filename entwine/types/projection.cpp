@@ -0,0 +1,89 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/projection.hpp>
+
+#include <cstring>
+
+namespace entwine
+{
+
+namespace
+{
+    bool keep(const DimInfo& dim, const std::set<std::string>& names)
+    {
+        return
+            dim.name() == "X" || dim.name() == "Y" || dim.name() == "Z" ||
+            names.count(dim.name()) ||
+            pdal::Dimension::id(dim.name()) == pdal::Dimension::Id::Unknown;
+    }
+
+    DimList select(const Schema& native, const std::set<std::string>& names)
+    {
+        DimList dims;
+        for (const DimInfo& dim : native.dims())
+        {
+            if (keep(dim, names)) dims.push_back(dim);
+        }
+        return dims;
+    }
+}
+
+Projection::Projection(
+        const Schema& native,
+        const std::set<std::string>& names)
+    : m_native(native)
+    , m_schema(select(native, names))
+{
+    std::size_t offset(0);
+
+    for (const DimInfo& dim : native.dims())
+    {
+        if (keep(dim, names))
+        {
+            if (m_runs.size() &&
+                    m_runs.back().first + m_runs.back().second == offset)
+            {
+                m_runs.back().second += dim.size();
+            }
+            else
+            {
+                m_runs.emplace_back(offset, dim.size());
+            }
+        }
+
+        offset += dim.size();
+    }
+}
+
+std::vector<char> Projection::apply(
+        const char* data,
+        const std::size_t numPoints) const
+{
+    const std::size_t nativeSize(m_native.pointSize());
+    std::vector<char> out(numPoints * m_schema.pointSize());
+    char* pos(out.data());
+
+    for (std::size_t i(0); i < numPoints; ++i)
+    {
+        for (const auto& run : m_runs)
+        {
+            std::memcpy(pos, data + run.first, run.second);
+            pos += run.second;
+        }
+
+        data += nativeSize;
+    }
+
+    return out;
+}
+
+} // namespace entwine
+
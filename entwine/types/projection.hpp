@@ -0,0 +1,62 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <entwine/types/schema.hpp>
+
+namespace entwine
+{
+
+// A subset of the dimensions of a native schema, in their native order, so
+// that readers may decode and hold only the dimensions they need.  XYZ are
+// always kept.  So are dimensions without a PDAL-defined id, whose ids are
+// assigned in order of registration - keeping all of them means that every
+// kept dimension has the same id in both layouts, so a projected record may be
+// read with the ids of the native schema.
+class Projection
+{
+public:
+    Projection(const Schema& native, const std::set<std::string>& names);
+
+    const Schema& native() const { return m_native; }
+    const Schema& schema() const { return m_schema; }
+
+    // True if every native dimension is kept.
+    bool full() const
+    {
+        return m_schema.dims().size() == m_native.dims().size();
+    }
+
+    bool contains(const std::string& name) const
+    {
+        return m_schema.contains(name);
+    }
+
+    // Copy the kept dimensions of packed native records.
+    std::vector<char> apply(const char* data, std::size_t numPoints) const;
+
+private:
+    const Schema& m_native;
+    const Schema m_schema;
+
+    // Offsets and lengths of the byte ranges to keep from each native record,
+    // with adjacent ranges merged.
+    std::vector<std::pair<std::size_t, std::size_t>> m_runs;
+};
+
+} // namespace entwine
+
@@ -0,0 +1,340 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/quantization.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <entwine/types/bounds.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    using DimType = pdal::Dimension::Type;
+
+    // Index of X, Y, or Z, otherwise -1.
+    int axis(const DimInfo& dim)
+    {
+        if (dim.name() == "X") return 0;
+        if (dim.name() == "Y") return 1;
+        if (dim.name() == "Z") return 2;
+        return -1;
+    }
+
+    // Unsigned 64-bit values may not fit in our signed bases, so they're
+    // left alone along with floating point ones.
+    bool quantizable(const DimType type)
+    {
+        switch (type)
+        {
+            case DimType::Signed8:
+            case DimType::Signed16:
+            case DimType::Signed32:
+            case DimType::Signed64:
+            case DimType::Unsigned8:
+            case DimType::Unsigned16:
+            case DimType::Unsigned32:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    template<typename T>
+    int64_t getAs(const char* pos)
+    {
+        T v;
+        std::memcpy(&v, pos, sizeof(T));
+        return static_cast<int64_t>(v);
+    }
+
+    template<typename T>
+    void setAs(char* pos, const int64_t v)
+    {
+        const T t(static_cast<T>(v));
+        std::memcpy(pos, &t, sizeof(T));
+    }
+
+    int64_t get(const char* pos, const DimType type)
+    {
+        switch (type)
+        {
+            case DimType::Signed8: return getAs<int8_t>(pos);
+            case DimType::Signed16: return getAs<int16_t>(pos);
+            case DimType::Signed32: return getAs<int32_t>(pos);
+            case DimType::Signed64: return getAs<int64_t>(pos);
+            case DimType::Unsigned8: return getAs<uint8_t>(pos);
+            case DimType::Unsigned16: return getAs<uint16_t>(pos);
+            case DimType::Unsigned32: return getAs<uint32_t>(pos);
+            default: throw std::runtime_error("Invalid quantized type");
+        }
+    }
+
+    void set(char* pos, const DimType type, const int64_t v)
+    {
+        switch (type)
+        {
+            case DimType::Signed8: setAs<int8_t>(pos, v); break;
+            case DimType::Signed16: setAs<int16_t>(pos, v); break;
+            case DimType::Signed32: setAs<int32_t>(pos, v); break;
+            case DimType::Signed64: setAs<int64_t>(pos, v); break;
+            case DimType::Unsigned8: setAs<uint8_t>(pos, v); break;
+            case DimType::Unsigned16: setAs<uint16_t>(pos, v); break;
+            case DimType::Unsigned32: setAs<uint32_t>(pos, v); break;
+            default: throw std::runtime_error("Invalid quantized type");
+        }
+    }
+
+    DimType narrowed(const uint8_t width)
+    {
+        switch (width)
+        {
+            case 1: return DimType::Unsigned8;
+            case 2: return DimType::Unsigned16;
+            case 4: return DimType::Unsigned32;
+            default: throw std::runtime_error("Invalid quantized width");
+        }
+    }
+
+    // A dimension of a record, which is quantized if it has a width.
+    struct Field
+    {
+        std::size_t size = 0;
+        DimType type = DimType::None;
+        int a = -1;
+        uint8_t width = 0;
+    };
+
+    std::vector<Field> fields(
+            const Schema& native,
+            const std::array<uint8_t, 3>& widths)
+    {
+        std::vector<Field> result;
+
+        for (const DimInfo& dim : native.dims())
+        {
+            Field f;
+            f.size = dim.size();
+            f.type = dim.type();
+            f.a = axis(dim);
+            if (f.a >= 0) f.width = widths[f.a];
+            result.push_back(f);
+        }
+
+        return result;
+    }
+
+    template<typename T>
+    void store(std::vector<char>& data, const T v)
+    {
+        const char* pos(reinterpret_cast<const char*>(&v));
+        data.insert(data.end(), pos, pos + sizeof(T));
+    }
+
+    template<typename T>
+    T load(const char*& pos)
+    {
+        T v;
+        std::memcpy(&v, pos, sizeof(T));
+        pos += sizeof(T);
+        return v;
+    }
+}
+
+Quantization::Quantization()
+    : m_bases()
+    , m_widths()
+{
+    m_bases.fill(0);
+    m_widths.fill(0);
+}
+
+Quantization::Quantization(
+        const Schema& schema,
+        const Bounds& bounds,
+        const char* data,
+        const std::size_t numPoints)
+    : Quantization()
+{
+    if (!numPoints) return;
+
+    const std::size_t pointSize(schema.pointSize());
+    std::size_t offset(0);
+
+    for (const DimInfo& dim : schema.dims())
+    {
+        const int a(axis(dim));
+
+        if (a >= 0 && quantizable(dim.type()))
+        {
+            int64_t lo(std::numeric_limits<int64_t>::max());
+            int64_t hi(std::numeric_limits<int64_t>::min());
+
+            const char* pos(data + offset);
+            for (std::size_t i(0); i < numPoints; ++i)
+            {
+                const int64_t v(get(pos, dim.type()));
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+                pos += pointSize;
+            }
+
+            // Offsets are taken from the chunk bounds, unless some point lies
+            // outside of them.
+            const double min(std::floor(bounds.min()[a]));
+            int64_t base(lo);
+            if (std::abs(min) < std::pow(2.0, 62))
+            {
+                base = std::min(lo, static_cast<int64_t>(min));
+            }
+
+            const uint64_t range(
+                    static_cast<uint64_t>(hi) - static_cast<uint64_t>(base));
+
+            uint8_t width(0);
+            if (range <= 0xff) width = 1;
+            else if (range <= 0xffff) width = 2;
+            else if (range <= 0xffffffff) width = 4;
+
+            if (width && width < dim.size())
+            {
+                m_bases[a] = base;
+                m_widths[a] = width;
+            }
+        }
+
+        offset += dim.size();
+    }
+}
+
+Quantization::Quantization(std::vector<char>& data)
+    : Quantization()
+{
+    if (data.size() < footerSize)
+    {
+        throw std::runtime_error("Invalid quantized chunk size");
+    }
+
+    const char* pos(data.data() + data.size() - footerSize);
+    for (int64_t& base : m_bases) base = load<int64_t>(pos);
+    for (uint8_t& width : m_widths)
+    {
+        width = load<uint8_t>(pos);
+        if (width) narrowed(width);
+    }
+
+    data.resize(data.size() - footerSize);
+}
+
+bool Quantization::empty() const
+{
+    return !m_widths[0] && !m_widths[1] && !m_widths[2];
+}
+
+Schema Quantization::schema(const Schema& native) const
+{
+    if (empty()) return native;
+
+    DimList dims;
+    for (const DimInfo& dim : native.dims())
+    {
+        const int a(axis(dim));
+        if (a >= 0 && m_widths[a])
+        {
+            dims.emplace_back(dim.name(), dim.id(), narrowed(m_widths[a]));
+        }
+        else dims.push_back(dim);
+    }
+
+    return Schema(dims);
+}
+
+std::vector<char> Quantization::encode(
+        const Schema& native,
+        const char* data,
+        const std::size_t numPoints) const
+{
+    const std::vector<Field> fs(fields(native, m_widths));
+    std::vector<char> out(numPoints * schema(native).pointSize());
+
+    const char* in(data);
+    char* pos(out.data());
+
+    for (std::size_t i(0); i < numPoints; ++i)
+    {
+        for (const Field& f : fs)
+        {
+            if (f.width)
+            {
+                const int64_t v(get(in, f.type) - m_bases[f.a]);
+                set(pos, narrowed(f.width), v);
+                pos += f.width;
+            }
+            else
+            {
+                std::copy(in, in + f.size, pos);
+                pos += f.size;
+            }
+
+            in += f.size;
+        }
+    }
+
+    return out;
+}
+
+std::vector<char> Quantization::decode(
+        const Schema& native,
+        const char* data,
+        const std::size_t numPoints) const
+{
+    const std::vector<Field> fs(fields(native, m_widths));
+    std::vector<char> out(numPoints * native.pointSize());
+
+    const char* in(data);
+    char* pos(out.data());
+
+    for (std::size_t i(0); i < numPoints; ++i)
+    {
+        for (const Field& f : fs)
+        {
+            if (f.width)
+            {
+                const int64_t v(get(in, narrowed(f.width)) + m_bases[f.a]);
+                set(pos, f.type, v);
+                in += f.width;
+            }
+            else
+            {
+                std::copy(in, in + f.size, pos);
+                in += f.size;
+            }
+
+            pos += f.size;
+        }
+    }
+
+    return out;
+}
+
+void Quantization::append(std::vector<char>& data) const
+{
+    for (const int64_t base : m_bases) store(data, base);
+    for (const uint8_t width : m_widths) store(data, width);
+}
+
+} // namespace entwine
+
@@ -0,0 +1,81 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <entwine/types/schema.hpp>
+
+namespace entwine
+{
+
+class Bounds;
+
+// Integral XYZ values of a chunk stored as unsigned offsets from the minimum
+// corner of its bounds, each axis in the narrowest of 1, 2, or 4 bytes which
+// holds all of its offsets.  Chunk bounds shrink by half with each depth, so
+// deep chunks need far fewer bytes per coordinate than the schema does.
+//
+// Values are unchanged apart from their width, so quantization is lossless.
+// Floating point coordinates are never quantized.  A quantization is stored
+// as a fixed-size footer at the end of its chunk data:
+//
+//      XYZ bases   3 x int64
+//      XYZ widths  3 x uint8, where zero means the axis is stored natively
+class Quantization
+{
+public:
+    // Every axis stored natively.
+    Quantization();
+
+    // Choose the bases and widths for these packed records.
+    Quantization(
+            const Schema& schema,
+            const Bounds& bounds,
+            const char* data,
+            std::size_t numPoints);
+
+    // Extract a quantization from the end of this data, which is then
+    // resized to exclude it.
+    explicit Quantization(std::vector<char>& data);
+
+    // True if every axis is stored natively.
+    bool empty() const;
+
+    // The schema of quantized records.
+    Schema schema(const Schema& native) const;
+
+    // Packed records of the native schema to quantized ones, and back.
+    std::vector<char> encode(
+            const Schema& native,
+            const char* data,
+            std::size_t numPoints) const;
+
+    std::vector<char> decode(
+            const Schema& native,
+            const char* data,
+            std::size_t numPoints) const;
+
+    // Append our footer, for extraction as above.
+    void append(std::vector<char>& data) const;
+
+    static constexpr std::size_t footerSize = 3 * 8 + 3;
+
+private:
+    std::array<int64_t, 3> m_bases;
+    std::array<uint8_t, 3> m_widths;
+};
+
+} // namespace entwine
+
@@ -25,15 +25,42 @@ namespace entwine
 
 enum class ChunkType : char { Sparse = 0, Contiguous, Invalid };
 enum class TailField { ChunkType, NumPoints, NumBytes };
-enum class ChunkStorageType { Binary, LasZip, LazPerf };
-enum class HierarchyCompression { None, Lzma };
+enum class ChunkStorageType { Binary, LasZip, LazPerf, Zstd };
+enum class HierarchyCompression { None, Lzma, Zstd };
+
+// Hierarchy blocks were originally stored as runs of 64-bit words per cell.
+// The compact format stores each tube once, with its cells following it, as
+// varints - see HierarchyBlock.
+enum class HierarchyFormat { Words, Compact };
 
 using TailFieldList = std::vector<TailField>;
 
 class Tail
 {
 public:
+    // Extract the tail from the end of this data, which is then resized to
+    // exclude it.
     Tail(std::vector<char>& data, TailFieldList fields)
+    {
+        std::size_t size(data.size());
+        parse(data.data(), size, fields);
+        data.resize(size);
+    }
+
+    // As above, for data which can't be resized, e.g. a mapped file.  Size is
+    // reduced to exclude the tail.
+    Tail(const char* data, std::size_t& size, TailFieldList fields)
+    {
+        parse(data, size, fields);
+    }
+
+    std::size_t size() const { return m_size; }
+    ChunkType type() const { return m_type; }
+    std::size_t numPoints() const { return m_numPoints; }
+    std::size_t numBytes() const { return m_numBytes; }
+
+private:
+    void parse(const char* data, std::size_t& size, const TailFieldList& fields)
     {
         // Fields are in reverse order as we extract.
         for (auto it(fields.rbegin()); it != fields.rend(); ++it)
@@ -41,13 +68,13 @@ public:
             switch (*it)
             {
                 case TailField::ChunkType:
-                    m_type = static_cast<ChunkType>(extract<char>(data));
+                    m_type = static_cast<ChunkType>(extract<char>(data, size));
                     break;
                 case TailField::NumPoints:
-                    m_numPoints = extract<uint64_t>(data);
+                    m_numPoints = extract<uint64_t>(data, size);
                     break;
                 case TailField::NumBytes:
-                    m_numBytes = extract<uint64_t>(data);
+                    m_numBytes = extract<uint64_t>(data, size);
                     break;
                 default:
                     throw std::runtime_error("Invalid tail field value");
@@ -55,24 +82,18 @@ public:
         }
     }
 
-    std::size_t size() const { return m_size; }
-    ChunkType type() const { return m_type; }
-    std::size_t numPoints() const { return m_numPoints; }
-    std::size_t numBytes() const { return m_numBytes; }
-
-private:
     template<typename T>
-    T extract(std::vector<char>& data)
+    T extract(const char* data, std::size_t& size)
     {
         T v(0);
-        const auto size(sizeof(T));
-        m_size += size;
+        const auto n(sizeof(T));
+        m_size += n;
 
-        if (data.size() < size) throw std::runtime_error("Invalid chunk size");
-        const char* pos(data.data() + data.size() - size);
-        std::copy(pos, pos + size, reinterpret_cast<char*>(&v));
+        if (size < n) throw std::runtime_error("Invalid chunk size");
+        const char* pos(data + size - n);
+        std::copy(pos, pos + n, reinterpret_cast<char*>(&v));
 
-        data.resize(data.size() - size);
+        size -= n;
         return v;
     }
 
@@ -90,6 +111,7 @@ inline std::string toString(ChunkStorageType c)
         case ChunkStorageType::LasZip: return "laszip";
         case ChunkStorageType::LazPerf: return "lazperf";
         case ChunkStorageType::Binary: return "binary";
+        case ChunkStorageType::Zstd: return "zstd";
         default: throw std::runtime_error("Invalid ChunkStorageType value");
     }
 }
@@ -104,6 +126,7 @@ inline ChunkStorageType toChunkStorageType(const Json::Value& j)
     const std::string s(j.asString());
     if (s == "laszip") return ChunkStorageType::LasZip;
     if (s == "lazperf") return ChunkStorageType::LazPerf;
+    if (s == "zstd") return ChunkStorageType::Zstd;
     throw std::runtime_error("Invalid compression: " + j.toStyledString());
 }
 
@@ -132,6 +155,7 @@ inline std::string toString(HierarchyCompression c)
     {
         case HierarchyCompression::None: return "none";
         case HierarchyCompression::Lzma: return "lzma";
+        case HierarchyCompression::Zstd: return "zstd";
         default: throw std::runtime_error("Invalid HierarchyCompression value");
     }
 }
@@ -139,6 +163,7 @@ inline std::string toString(HierarchyCompression c)
 inline HierarchyCompression toHierarchyCompression(const std::string& s)
 {
     if (s == "lzma") return HierarchyCompression::Lzma;
+    if (s == "zstd") return HierarchyCompression::Zstd;
     if (s == "none") return HierarchyCompression::None;
     throw std::runtime_error("Invalid hierarchy compression: " + s);
 }
@@ -148,5 +173,28 @@ inline HierarchyCompression toHierarchyCompression(const Json::Value& j)
     return toHierarchyCompression(j.asString());
 }
 
+inline std::string toString(HierarchyFormat f)
+{
+    switch (f)
+    {
+        case HierarchyFormat::Words: return "words";
+        case HierarchyFormat::Compact: return "compact";
+        default: throw std::runtime_error("Invalid HierarchyFormat value");
+    }
+}
+
+inline HierarchyFormat toHierarchyFormat(const std::string& s)
+{
+    if (s == "words") return HierarchyFormat::Words;
+    if (s == "compact") return HierarchyFormat::Compact;
+    throw std::runtime_error("Invalid hierarchy format: " + s);
+}
+
+// Indexes which predate the compact format don't specify one.
+inline HierarchyFormat toHierarchyFormat(const Json::Value& j)
+{
+    return j.isNull() ? HierarchyFormat::Words : toHierarchyFormat(j.asString());
+}
+
 } // namespace entwine
 
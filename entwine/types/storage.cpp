@@ -15,11 +15,14 @@
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/tree/builder.hpp>
 #include <entwine/tree/chunk.hpp>
+#include <entwine/types/archive.hpp>
 #include <entwine/types/binary-point-table.hpp>
 #include <entwine/types/metadata.hpp>
 #include <entwine/types/pooled-point-table.hpp>
 #include <entwine/types/reprojection.hpp>
+#include <entwine/util/async-io.hpp>
 #include <entwine/util/compression.hpp>
+#include <entwine/util/env.hpp>
 #include <entwine/util/unique.hpp>
 
 #include <entwine/types/chunk-storage/chunk-storage.hpp>
@@ -27,13 +30,35 @@
 namespace entwine
 {
 
+namespace
+{
+    // Rejected up front, rather than when the first hierarchy block is saved.
+    HierarchyCompression available(const HierarchyCompression c)
+    {
+#ifndef ENTWINE_HAVE_ZSTD
+        if (c == HierarchyCompression::Zstd)
+        {
+            throw std::runtime_error("Entwine was built without zstd");
+        }
+#endif
+        return c;
+    }
+}
+
 Storage::Storage(
         const Metadata& metadata,
         const ChunkStorageType chunkStorageType,
-        const HierarchyCompression hierarchyCompression)
+        const HierarchyCompression hierarchyCompression,
+        const int hierarchyLevel,
+        const bool archive,
+        const bool quantize)
     : m_metadata(metadata)
     , m_chunkStorageType(chunkStorageType)
-    , m_hierarchyCompression(hierarchyCompression)
+    , m_hierarchyCompression(available(hierarchyCompression))
+    , m_hierarchyLevel(hierarchyLevel)
+    , m_hierarchyFormat(HierarchyFormat::Compact)
+    , m_quantize(quantize)
+    , m_archive(archive ? makeUnique<Archive>(metadata) : nullptr)
 {
     m_storage = ChunkStorage::create(m_metadata, m_chunkStorageType);
 }
@@ -42,7 +67,13 @@ Storage::Storage(const Metadata& metadata, const Json::Value& json)
     : m_metadata(metadata)
     , m_json(json)
     , m_chunkStorageType(toChunkStorageType(json["storage"]))
-    , m_hierarchyCompression(toHierarchyCompression(json["compressHierarchy"]))
+    , m_hierarchyCompression(
+            available(toHierarchyCompression(json["compressHierarchy"])))
+    , m_hierarchyLevel(json["compressHierarchyLevel"].asInt())
+    , m_hierarchyFormat(toHierarchyFormat(json["hierarchyFormat"]))
+    , m_quantize(json["quantize"].asBool())
+    , m_archive(
+            json["archive"].asBool() ? makeUnique<Archive>(metadata) : nullptr)
 {
     m_storage = ChunkStorage::create(m_metadata, m_chunkStorageType, m_json);
 }
@@ -52,6 +83,10 @@ Storage::Storage(const Metadata& metadata, const Storage& other)
     , m_json(other.m_json)
     , m_chunkStorageType(other.m_chunkStorageType)
     , m_hierarchyCompression(other.m_hierarchyCompression)
+    , m_hierarchyLevel(other.m_hierarchyLevel)
+    , m_hierarchyFormat(other.m_hierarchyFormat)
+    , m_quantize(other.m_quantize)
+    , m_archive(other.m_archive ? makeUnique<Archive>(metadata) : nullptr)
 {
     m_storage = ChunkStorage::create(m_metadata, m_chunkStorageType, m_json);
 }
@@ -63,6 +98,10 @@ Json::Value Storage::toJson() const
     Json::Value json;
     json["storage"] = toString(m_chunkStorageType);
     json["compressHierarchy"] = toString(m_hierarchyCompression);
+    json["hierarchyFormat"] = toString(m_hierarchyFormat);
+    if (m_hierarchyLevel) json["compressHierarchyLevel"] = m_hierarchyLevel;
+    if (m_archive) json["archive"] = true;
+    if (m_quantize) json["quantize"] = true;
 
     const auto s(m_storage->toJson());
     for (const auto f : s.getMemberNames()) json[f] = s[f];
@@ -70,12 +109,43 @@ Json::Value Storage::toJson() const
     return json;
 }
 
+void Storage::save(const arbiter::Endpoint& out) const
+{
+    if (m_archive) m_archive->save(out);
+}
+
 void Storage::serialize(Chunk& chunk) const
 {
     if (m_metadata.cesiumSettings()) chunk.tile();
     m_storage->write(chunk);
 }
 
+std::unique_ptr<ChunkWrite> Storage::gather(Chunk& chunk) const
+{
+    if (m_metadata.cesiumSettings()) chunk.tile();
+
+    auto write(makeUnique<ChunkWrite>(chunk));
+    m_storage->gather(*write, chunk);
+    return write;
+}
+
+void Storage::encode(ChunkWrite& write) const
+{
+    m_storage->encode(write);
+}
+
+void Storage::put(ChunkWrite& write) const
+{
+    m_storage->put(write);
+}
+
+bool Storage::putAsync(
+        ChunkWrite& write,
+        std::function<void(bool)> done) const
+{
+    return m_storage->putAsync(write, std::move(done));
+}
+
 Cell::PooledStack Storage::deserialize(
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
@@ -85,6 +155,50 @@ Cell::PooledStack Storage::deserialize(
     return m_storage->read(out, tmp, pool, chunkId);
 }
 
+Cell::PooledStack Storage::deserialize(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        PointPool& pool,
+        const Id& chunkId,
+        const Projection& projection) const
+{
+    return m_storage->readProjected(out, tmp, pool, chunkId, projection);
+}
+
+MappedChunk Storage::map(
+        const arbiter::Endpoint& out,
+        const Id& chunkId) const
+{
+    if (!mapping()) return MappedChunk();
+    return m_storage->map(out, chunkId);
+}
+
+std::unique_ptr<Readahead> Storage::readahead(
+        const arbiter::Endpoint& out,
+        const std::vector<Id>& ids) const
+{
+    // Mapped chunks aren't read at all, and archived ones are read by range.
+    if (!out.isLocal() || m_archive || ids.empty()) return nullptr;
+    if (
+            m_chunkStorageType == ChunkStorageType::Binary &&
+            !m_quantize &&
+            mapping())
+    {
+        return nullptr;
+    }
+
+    std::vector<std::string> paths;
+    for (const Id& id : ids) paths.push_back(out.fullPath(filename(id)));
+
+    return makeUnique<Readahead>(AsyncIo::instance(), paths);
+}
+
+bool Storage::mapping() const
+{
+    const auto setting(env("ENTWINE_MMAP"));
+    return MappedFile::supported() && (!setting || *setting != "false");
+}
+
 const Metadata& Storage::metadata() const { return m_metadata; }
 const Schema& Storage::schema() const { return m_metadata.schema(); }
 std::string Storage::filename(const Id& id) const
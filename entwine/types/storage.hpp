@@ -11,6 +11,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <set>
 #include <string>
@@ -21,8 +22,10 @@
 #include <entwine/types/defs.hpp>
 #include <entwine/types/delta.hpp>
 #include <entwine/types/point-pool.hpp>
+#include <entwine/types/projection.hpp>
 #include <entwine/types/schema.hpp>
 #include <entwine/types/storage-types.hpp>
+#include <entwine/util/mapped-file.hpp>
 #include <entwine/util/unique.hpp>
 
 namespace entwine
@@ -30,9 +33,25 @@ namespace entwine
 
 namespace arbiter { class Endpoint; }
 
+class Archive;
 class Chunk;
 class ChunkStorage;
+struct ChunkWrite;
 class Metadata;
+class Readahead;
+
+// A chunk of packed, uncompressed point records, mapped in place.
+struct MappedChunk
+{
+    explicit operator bool() const { return !!file; }
+
+    // The records begin at the start of the file, and are followed by the
+    // chunk's tail.
+    const char* data() const { return file->data(); }
+
+    std::unique_ptr<MappedFile> file;
+    std::size_t numPoints = 0;
+};
 
 class Storage
 {
@@ -40,7 +59,10 @@ public:
     Storage(
             const Metadata& metadata,
             ChunkStorageType compression = ChunkStorageType::LasZip,
-            HierarchyCompression hc = HierarchyCompression::Lzma);
+            HierarchyCompression hc = HierarchyCompression::Lzma,
+            int hierarchyLevel = 0,
+            bool archive = false,
+            bool quantize = false);
     Storage(const Metadata& metadata, const Storage& other);
     Storage(const Metadata& metadata, const Json::Value& json);
     Storage(const Storage&) = delete;
@@ -48,31 +70,87 @@ public:
 
     Json::Value toJson() const;
 
+    // Write anything which isn't written as chunks are serialized - for now,
+    // the archive index.
+    void save(const arbiter::Endpoint& out) const;
+
+    // Run every stage of serialization on the calling thread.
     void serialize(Chunk& chunk) const;
+
+    // Serialization in stages, for pipelining - see ChunkWrite.  After
+    // gather returns, the chunk is no longer needed.
+    std::unique_ptr<ChunkWrite> gather(Chunk& chunk) const;
+    void encode(ChunkWrite& write) const;
+    void put(ChunkWrite& write) const;
+
+    // Put without waiting on the write, if possible - see ChunkStorage.
+    bool putAsync(ChunkWrite& write, std::function<void(bool)> done) const;
+
     Cell::PooledStack deserialize(
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
         PointPool& pool,
         const Id& chunkId) const;
 
+    // Read only the dimensions of a projection of the native schema.  The
+    // pool's schema must be that of the projection.
+    Cell::PooledStack deserialize(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        PointPool& pool,
+        const Id& chunkId,
+        const Projection& projection) const;
+
+    // Map a chunk from a local endpoint rather than reading it, if its storage
+    // type holds uncompressed, unquantized records.  Otherwise, or if mapping is disabled
+    // by setting ENTWINE_MMAP=false, the result is empty.
+    MappedChunk map(const arbiter::Endpoint& out, const Id& chunkId) const;
+
+    // Submit reads of these chunks together, to be taken by the
+    // deserializations which follow while the result exists.  Null if the
+    // chunks aren't read as whole local files.
+    std::unique_ptr<Readahead> readahead(
+            const arbiter::Endpoint& out,
+            const std::vector<Id>& ids) const;
+
     ChunkStorageType chunkStorageType() const { return m_chunkStorageType; }
     HierarchyCompression hierarchyCompression() const
     {
         return m_hierarchyCompression;
     }
 
+    // The zstd compression level of hierarchy blocks, where zero selects the
+    // zstd default.  LZMA always uses the same preset.
+    int hierarchyCompressionLevel() const { return m_hierarchyLevel; }
+
+    HierarchyFormat hierarchyFormat() const { return m_hierarchyFormat; }
+
+    // Null unless chunks are packed into an archive rather than written as
+    // individual files.
+    Archive* archive() const { return m_archive.get(); }
+
+    // True if binary and lazperf chunks store their XYZ values quantized to
+    // their chunk bounds - see Quantization.
+    bool quantize() const { return m_quantize; }
+
     const Metadata& metadata() const;
     const Schema& schema() const;
     std::string filename(const Id& id) const;
 
 private:
+    bool mapping() const;
+
     const Metadata& m_metadata;
     const Json::Value m_json;
 
     ChunkStorageType m_chunkStorageType;
     HierarchyCompression m_hierarchyCompression;
+    int m_hierarchyLevel;
+    HierarchyFormat m_hierarchyFormat;
+    bool m_quantize;
 
     std::unique_ptr<ChunkStorage> m_storage;
+    std::unique_ptr<Archive> m_archive;
 };
 
 } // namespace entwine
@@ -8,56 +8,292 @@
 *
 ******************************************************************************/
 
-#include <entwine/tree/climber.hpp>
 #include <entwine/types/tube.hpp>
 
+#include <entwine/tree/climber.hpp>
+
 namespace entwine
 {
 
-Tube::Insertion Tube::insert(const Climber& climber, Cell::PooledNode& cell)
+namespace
 {
-    Insertion result;
+    LockSite overflowSite("tube-overflow");
+}
 
-    SpinGuard lock(m_spinner);
+Tube::~Tube()
+{
+    clear();
+}
 
-    const auto it(m_cells.find(climber.tick()));
+Tube::Tube(Tube&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+Tube& Tube::operator=(Tube&& other) noexcept
+{
+    if (this == &other) return *this;
+
+    clear();
 
-    if (it != m_cells.end())
+    // Moves only happen while a chunk is being constructed or resized, never
+    // concurrently with insertions, so relaxed transfers are sufficient here.
+    for (std::size_t i(0); i < inlineSlots(); ++i)
     {
-        Cell::PooledNode& curr(it->second);
+        Slot& ours(m_slots[i]);
+        Slot& theirs(other.m_slots[i]);
+
+        ours.tick.store(theirs.tick.load());
+        ours.cell.store(theirs.cell.load());
 
-        if (cell->point() != curr->point())
+        theirs.tick.store(emptyTick());
+        theirs.cell.store(nullptr);
+    }
+
+    m_overflow.store(other.m_overflow.exchange(nullptr));
+    m_pool.store(other.m_pool.exchange(nullptr));
+
+    return *this;
+}
+
+Tube::Insertion Tube::insert(
+        const Climber& climber,
+        Cell::PooledNode& cell,
+        const Residents residents)
+{
+    return insert(
+            climber.tick(),
+            climber.bounds().mid(),
+            climber.pointSize(),
+            cell,
+            residents);
+}
+
+Tube::Insertion Tube::insert(
+        const uint64_t tick,
+        const Point& center,
+        const std::size_t pointSize,
+        Cell::PooledNode& cell,
+        Residents residents)
+{
+    if (tick != emptyTick())
+    {
+        for (std::size_t i(0); i < numSlots; ++i)
         {
-            const Point& center(climber.bounds().mid());
+            Slot& slot(m_slots[i]);
+            uint64_t current(slot.tick.load(std::memory_order_acquire));
+
+            if (current == emptyTick())
+            {
+                if (slot.tick.compare_exchange_strong(
+                            current,
+                            tick,
+                            std::memory_order_acq_rel))
+                {
+                    // This slot is ours - its cell pointer stays null until
+                    // we publish it, so nobody else can touch it until then.
+                    setPool(cell);
+                    if (residents) residents.set(i, cell->point());
 
-            const auto a(cell->point().sqDist3d(center));
-            const auto b(curr->point().sqDist3d(center));
+                    Insertion result;
+                    result.setDone(cell->size());
+                    slot.cell.store(cell.release(), std::memory_order_release);
+                    return result;
+                }
 
-            if (a < b || (a == b && ltChained(cell->point(), curr->point())))
+                // Else someone else claimed this slot first - current now
+                // holds their tick, which may be the same as ours.
+            }
+
+            if (current == tick)
             {
-                // We are inserting cell, and extracting curr.  Store our new
-                // cell, and send the previous one further down the tree.
-                result.setDelta(
-                        static_cast<int>(cell->size()) -
-                        static_cast<int>(curr->size()));
-                std::swap(cell, curr);
+                // Take exclusive ownership of this cell by swapping a nullptr
+                // into its place.  A nullptr here means another thread is
+                // either still publishing the slot or operating on its cell.
+                Backoff backoff;
+                RawCell* curr(nullptr);
+
+                while (!(curr = slot.cell.exchange(
+                                nullptr,
+                                std::memory_order_acquire)))
+                {
+                    backoff.pause();
+                }
+
+                // While we hold the cell, its resident coordinates are ours
+                // too - they're published along with the cell pointer.
+                const RawCell* prev(curr);
+                const Insertion result(
+                        resolve(
+                            curr,
+                            residents ? residents.get(i) : curr->val().point(),
+                            center,
+                            pointSize,
+                            cell));
+
+                if (residents && curr != prev)
+                {
+                    residents.set(i, curr->val().point());
+                }
+
+                slot.cell.store(curr, std::memory_order_release);
+                return result;
             }
-            // Else, the default-constructed result is correct.
+        }
+    }
+
+    return insertOverflow(tick, center, pointSize, cell);
+}
+
+Tube::Insertion Tube::insertOverflow(
+        const uint64_t tick,
+        const Point& center,
+        const std::size_t pointSize,
+        Cell::PooledNode& cell)
+{
+    Overflow* overflow(m_overflow.load(std::memory_order_acquire));
+
+    if (!overflow)
+    {
+        Overflow* created(new Overflow());
+
+        if (m_overflow.compare_exchange_strong(
+                    overflow,
+                    created,
+                    std::memory_order_acq_rel))
+        {
+            overflow = created;
         }
         else
         {
-            result.setDone(cell->size());
-            it->second->push(std::move(cell), climber.pointSize());
+            delete created;
         }
     }
+
+    SpinGuard lock(overflow->spinner, overflowSite);
+
+    auto it(overflow->cells.find(tick));
+
+    if (it != overflow->cells.end())
+    {
+        return resolve(
+                it->second,
+                it->second->val().point(),
+                center,
+                pointSize,
+                cell);
+    }
+
+    setPool(cell);
+
+    Insertion result;
+    result.setDone(cell->size());
+    overflow->cells.emplace(tick, cell.release());
+    return result;
+}
+
+Tube::Insertion Tube::resolve(
+        RawCell*& curr,
+        const Point& resident,
+        const Point& center,
+        const std::size_t pointSize,
+        Cell::PooledNode& cell)
+{
+    Insertion result;
+
+    if (cell->point() != resident)
+    {
+        const auto a(cell->point().sqDist3d(center));
+        const auto b(resident.sqDist3d(center));
+
+        if (a < b || (a == b && ltChained(cell->point(), resident)))
+        {
+            // We are inserting cell, and extracting curr.  Store our new
+            // cell, and send the previous one further down the tree.  In a
+            // NUMA build the two may come from different nodes' pools, so
+            // wherever curr ends up - saved with a chunk or rejected by the
+            // builder - it's released to the pool which allocated it, see
+            // PointPool::release, rather than that of cell's handle.
+            result.setDelta(
+                    static_cast<int>(cell->size()) -
+                    static_cast<int>(curr->val().size()));
+
+            RawCell* incoming(cell.release());
+            cell.reset(curr);
+            curr = incoming;
+        }
+        // Else, the default-constructed result is correct.
+    }
     else
     {
         result.setDone(cell->size());
-        m_cells.emplace(std::make_pair(climber.tick(), std::move(cell)));
+        curr->val().push(std::move(cell), pointSize);
     }
 
     return result;
 }
 
+bool Tube::empty() const
+{
+    for (const Slot& slot : m_slots)
+    {
+        if (slot.tick.load(std::memory_order_acquire) != emptyTick())
+        {
+            return false;
+        }
+    }
+
+    if (const Overflow* overflow = m_overflow.load(std::memory_order_acquire))
+    {
+        SpinGuard lock(overflow->spinner, overflowSite);
+        return overflow->cells.empty();
+    }
+
+    return true;
+}
+
+void Tube::acquire(Cell::PooledStack& cells)
+{
+    for (Slot& slot : m_slots)
+    {
+        if (slot.tick.load() != emptyTick())
+        {
+            cells.push(slot.cell.exchange(nullptr));
+            slot.tick.store(emptyTick());
+        }
+    }
+
+    if (Overflow* overflow = m_overflow.exchange(nullptr))
+    {
+        for (auto& p : overflow->cells) cells.push(p.second);
+        delete overflow;
+    }
+}
+
+void Tube::clear()
+{
+    CellPool* pool(m_pool.load());
+
+    for (Slot& slot : m_slots)
+    {
+        if (RawCell* node = slot.cell.exchange(nullptr))
+        {
+            if (pool) pool->release(node);
+        }
+
+        slot.tick.store(emptyTick());
+    }
+
+    if (Overflow* overflow = m_overflow.exchange(nullptr))
+    {
+        if (pool)
+        {
+            for (auto& p : overflow->cells) pool->release(p.second);
+        }
+
+        delete overflow;
+    }
+}
+
 } // namespace entwine
 
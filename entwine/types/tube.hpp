@@ -10,11 +10,17 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <limits>
 #include <map>
-#include <mutex>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include <entwine/types/bounds.hpp>
@@ -28,6 +34,11 @@ namespace entwine
 
 class Climber;
 
+// A Tube holds the cells for a single index, bucketed by tick.  Most tubes
+// only ever see one or two ticks, so those are held in a small inline array of
+// slots which are claimed with a CAS on their tick - no lock is taken for the
+// common case.  Once the inline slots are exhausted, further ticks spill into
+// a lazily allocated, locked overflow map.
 class Tube
 {
 public:
@@ -52,6 +63,42 @@ public:
         int m_delta;
     };
 
+    // The coordinates of the points in a tube's inline slots, held by its
+    // chunk in contiguous TubeColumns rather than only in the slots' pooled
+    // cells.  When given to insert, a slot's resident point is read from here,
+    // so an insertion which is rejected by an inline slot never touches the
+    // resident cell.
+    class Residents
+    {
+    public:
+        Residents() : m_x(nullptr), m_y(nullptr), m_z(nullptr) { }
+
+        Residents(double* x, double* y, double* z)
+            : m_x(x)
+            , m_y(y)
+            , m_z(z)
+        { }
+
+        explicit operator bool() const { return m_x; }
+
+        Point get(std::size_t slot) const
+        {
+            return Point(m_x[slot], m_y[slot], m_z[slot]);
+        }
+
+        void set(std::size_t slot, const Point& point)
+        {
+            m_x[slot] = point.x;
+            m_y[slot] = point.y;
+            m_z[slot] = point.z;
+        }
+
+    private:
+        double* m_x;
+        double* m_y;
+        double* m_z;
+    };
+
     // If result.done() == true, then this cell has been consumed and may no
     // longer be accessed.
     //
@@ -61,11 +108,24 @@ public:
     // If result.done() == false, the cell should be reinserted.  In this case,
     // it's possible that the cell was swapped with another - so cell values
     // should not be cached through calls to insert.
-    Insertion insert(const Climber& climber, Cell::PooledNode& cell);
+    //
+    // If residents are given, they must be the same for every insertion into
+    // this tube.
+    Insertion insert(
+            const Climber& climber,
+            Cell::PooledNode& cell,
+            Residents residents = Residents());
 
-    using Cells = std::map<uint64_t, Cell::PooledNode>;
+    // Climber-free version of the above, for callers that have already
+    // computed the tick and the center of the bounds for this tube.
+    Insertion insert(
+            uint64_t tick,
+            const Point& center,
+            std::size_t pointSize,
+            Cell::PooledNode& cell,
+            Residents residents = Residents());
 
-    bool empty() const { return m_cells.empty(); }
+    bool empty() const;
     static constexpr std::size_t maxTickDepth() { return 64; }
 
     static std::size_t calcTick(
@@ -79,28 +139,236 @@ public:
                     (bounds.max().z - bounds.min().z));
     }
 
-    Cells::iterator begin() { return m_cells.begin(); }
-    Cells::iterator end() { return m_cells.end(); }
-    Cells::const_iterator begin() const { return m_cells.begin(); }
-    Cells::const_iterator end() const { return m_cells.end(); }
+    // Move all of our cells onto the given stack, leaving this tube empty.
+    // Not thread-safe - insertions must be complete.
+    void acquire(Cell::PooledStack& cells);
+
+    class ConstIterator;
+
+    ConstIterator begin() const;
+    ConstIterator end() const;
 
     Tube() = default;
+    ~Tube();
+
+    Tube(Tube&& other) noexcept;
+    Tube& operator=(Tube&& other) noexcept;
+
+    static constexpr std::size_t inlineSlots() { return numSlots; }
 
-    Tube(Tube&& other) noexcept
+private:
+    static constexpr std::size_t numSlots = 2;
+
+    using RawCell = Cell::RawNode;
+    using CellPool = splicer::SplicePool<Cell>;
+
+    static constexpr uint64_t emptyTick()
     {
-        m_cells = std::move(other.m_cells);
+        return std::numeric_limits<uint64_t>::max();
     }
 
-    Tube& operator=(Tube&& other) noexcept
+    struct Slot
     {
-        m_cells = std::move(other.m_cells);
+        Slot() : tick(emptyTick()), cell(nullptr) { }
+
+        // Once claimed, a slot's tick never changes until the Tube is
+        // acquired.  While a thread is operating on the cell of a claimed
+        // slot, it holds the cell pointer and leaves a nullptr in its place,
+        // which other threads wait on.
+        std::atomic<uint64_t> tick;
+        std::atomic<RawCell*> cell;
+    };
+
+    struct Overflow
+    {
+        mutable SpinLock spinner;
+        std::map<uint64_t, RawCell*> cells;
+    };
+
+    static Insertion resolve(
+            RawCell*& curr,
+            const Point& resident,
+            const Point& center,
+            std::size_t pointSize,
+            Cell::PooledNode& cell);
+
+    Insertion insertOverflow(
+            uint64_t tick,
+            const Point& center,
+            std::size_t pointSize,
+            Cell::PooledNode& cell);
+
+    void setPool(Cell::PooledNode& cell)
+    {
+        if (!m_pool.load(std::memory_order_relaxed))
+        {
+            m_pool.store(&cell.pool(), std::memory_order_relaxed);
+        }
+    }
+
+    void clear();
+
+    std::array<Slot, numSlots> m_slots;
+    std::atomic<Overflow*> m_overflow = { nullptr };
+    std::atomic<CellPool*> m_pool = { nullptr };
+};
+
+// Iterates over (tick, const Cell*) pairs in order of increasing tick, as the
+// previous map-based Tube did.  Not thread-safe with respect to concurrent
+// insertions - an inline slot whose cell is still being published is skipped.
+class Tube::ConstIterator
+{
+    friend class Tube;
+
+public:
+    using value_type = std::pair<uint64_t, const Cell*>;
+    using reference = const value_type&;
+    using pointer = const value_type*;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    reference operator*() const { return m_current; }
+    pointer operator->() const { return &m_current; }
+
+    ConstIterator& operator++()
+    {
+        if (m_fromInline) ++m_next;
+        else ++m_it;
+
+        settle();
         return *this;
     }
 
+    bool operator==(const ConstIterator& other) const
+    {
+        if (m_done || other.m_done) return m_done == other.m_done;
+
+        return
+            m_next == other.m_next &&
+            (!m_overflow || m_it == other.m_it);
+    }
+
+    bool operator!=(const ConstIterator& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    using OverflowIt = std::map<uint64_t, RawCell*>::const_iterator;
+
+    ConstIterator(const Tube& tube, bool end)
+        : m_overflow(tube.m_overflow.load(std::memory_order_acquire))
+    {
+        if (!end)
+        {
+            for (const Slot& s : tube.m_slots)
+            {
+                const uint64_t tick(s.tick.load(std::memory_order_acquire));
+                if (tick == emptyTick()) continue;
+
+                const RawCell* cell(s.cell.load(std::memory_order_acquire));
+                if (cell)
+                {
+                    m_inline[m_inlineSize++] = value_type(tick, &cell->val());
+                }
+            }
+
+            std::sort(
+                    m_inline.begin(),
+                    m_inline.begin() + m_inlineSize,
+                    [](const value_type& a, const value_type& b)
+                    {
+                        return a.first < b.first;
+                    });
+        }
+
+        if (m_overflow)
+        {
+            m_it = end ? m_overflow->cells.end() : m_overflow->cells.begin();
+        }
+
+        settle();
+    }
+
+    // Select the lower tick of the next inline slot and the next overflow
+    // entry, which are each sorted.
+    void settle()
+    {
+        const bool inlined(m_next < m_inlineSize);
+        const bool overflowed(m_overflow && m_it != m_overflow->cells.end());
+
+        if (inlined && (!overflowed || m_inline[m_next].first < m_it->first))
+        {
+            m_current = m_inline[m_next];
+            m_fromInline = true;
+        }
+        else if (overflowed)
+        {
+            m_current = value_type(m_it->first, &m_it->second->val());
+            m_fromInline = false;
+        }
+        else m_done = true;
+    }
+
+    const Overflow* m_overflow;
+    OverflowIt m_it;
+
+    std::array<value_type, numSlots> m_inline;
+    std::size_t m_inlineSize = 0;
+    std::size_t m_next = 0;
+
+    bool m_fromInline = false;
+    bool m_done = false;
+    value_type m_current;
+};
+
+// The resident coordinates of the inline slots of a run of tubes, as three
+// contiguous columns indexed by (tube * Tube::inlineSlots() + slot).
+class TubeColumns
+{
+public:
+    explicit TubeColumns(std::size_t tubes = 0)
+        : m_x(tubes * Tube::inlineSlots())
+        , m_y(m_x.size())
+        , m_z(m_x.size())
+    { }
+
+    Tube::Residents at(std::size_t tube)
+    {
+        const std::size_t i(tube * Tube::inlineSlots());
+        assert(i < m_x.size());
+        return Tube::Residents(&m_x[i], &m_y[i], &m_z[i]);
+    }
+
+    void append(const TubeColumns& other)
+    {
+        m_x.insert(m_x.end(), other.m_x.begin(), other.m_x.end());
+        m_y.insert(m_y.end(), other.m_y.begin(), other.m_y.end());
+        m_z.insert(m_z.end(), other.m_z.begin(), other.m_z.end());
+    }
+
+    void clear()
+    {
+        m_x.clear();
+        m_y.clear();
+        m_z.clear();
+    }
+
 private:
-    Cells m_cells;
-    SpinLock m_spinner;
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_z;
 };
 
+inline Tube::ConstIterator Tube::begin() const
+{
+    return ConstIterator(*this, false);
+}
+
+inline Tube::ConstIterator Tube::end() const
+{
+    return ConstIterator(*this, true);
+}
+
 } // namespace entwine
 
@@ -0,0 +1,678 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/async-io.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#include <entwine/util/env.hpp>
+#include <entwine/util/pool.hpp>
+#include <entwine/util/unique.hpp>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __NR_io_uring_setup
+#define ENTWINE_IO_URING
+#endif
+#endif
+#endif
+
+namespace entwine
+{
+
+struct AsyncIo::Op
+{
+    bool write = false;
+    std::string path;
+
+    // Reads fill data, and writes are from source.
+    std::unique_ptr<Data> data;
+    const char* source = nullptr;
+
+    std::size_t size = 0;
+    std::size_t done = 0;
+
+    ReadDone readDone;
+    WriteDone writeDone;
+};
+
+class AsyncIo::Backend
+{
+public:
+    explicit Backend(AsyncIo& io) : m_io(io) { }
+    virtual ~Backend() { }
+
+    virtual void submit(std::unique_ptr<Op> op) = 0;
+    virtual bool uring() const = 0;
+
+protected:
+    void complete(std::unique_ptr<Op> op, bool ok)
+    {
+        m_io.complete(std::move(op), ok);
+    }
+
+    AsyncIo& m_io;
+};
+
+namespace
+{
+    const std::size_t fallbackThreads(8);
+
+    // Blocking I/O on a pool of threads.
+    class Threaded : public AsyncIo::Backend
+    {
+    public:
+        Threaded(AsyncIo& io, const std::size_t depth)
+            : Backend(io)
+            , m_pool(std::min(depth, fallbackThreads), depth)
+        { }
+
+        virtual void submit(std::unique_ptr<AsyncIo::Op> op) override
+        {
+            AsyncIo::Op* raw(op.release());
+            m_pool.add([this, raw]()
+            {
+                std::unique_ptr<AsyncIo::Op> op(raw);
+                const bool ok(op->write ? write(*op) : read(*op));
+                complete(std::move(op), ok);
+            });
+        }
+
+        virtual bool uring() const override { return false; }
+
+    private:
+        bool read(AsyncIo::Op& op) const
+        {
+            std::ifstream file(op.path, std::ios::binary | std::ios::ate);
+            if (!file) return false;
+
+            op.size = file.tellg();
+            op.data->resize(op.size);
+
+            file.seekg(0);
+            return !!file.read(op.data->data(), op.size);
+        }
+
+        bool write(AsyncIo::Op& op) const
+        {
+            std::ofstream file(op.path, std::ios::binary | std::ios::trunc);
+            return file && file.write(op.source, op.size);
+        }
+
+        Pool m_pool;
+    };
+
+#ifdef ENTWINE_IO_URING
+    int enter(int fd, unsigned submit, unsigned wait, unsigned flags)
+    {
+        return syscall(
+                __NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0);
+    }
+
+    // Operations on an io_uring.  Files are opened and sized on the
+    // submitting thread, and their data transferred asynchronously, with any
+    // short transfers resubmitted until they're whole.  A single thread reaps
+    // completions.
+    //
+    // Errors from the ring itself are never thrown, since resubmission runs on
+    // the reaper thread.  An op which can't be submitted completes as failed,
+    // and if the ring can no longer be waited upon, every outstanding op is
+    // failed and the ring is stopped, after which each submission fails.
+    class Uring : public AsyncIo::Backend
+    {
+    public:
+        Uring(AsyncIo& io, const std::size_t depth)
+            : Backend(io)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+
+            m_fd = syscall(__NR_io_uring_setup, depth, &params);
+            if (m_fd < 0) throw std::runtime_error("No io_uring");
+
+            m_sqSize =
+                params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            m_cqSize =
+                params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+            bool single(false);
+#ifdef IORING_FEAT_SINGLE_MMAP
+            single = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single) m_sqSize = m_cqSize = std::max(m_sqSize, m_cqSize);
+#endif
+
+            m_sq = map(m_sqSize, IORING_OFF_SQ_RING);
+            m_cq = single ? m_sq : map(m_cqSize, IORING_OFF_CQ_RING);
+            m_sqes = static_cast<io_uring_sqe*>(
+                    map(m_sqesSize, IORING_OFF_SQES));
+
+            if (!m_sq || !m_cq || !m_sqes)
+            {
+                unmap();
+                throw std::runtime_error("Could not map io_uring");
+            }
+
+            char* sq(static_cast<char*>(m_sq));
+            m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            m_sqMask = *reinterpret_cast<unsigned*>(
+                    sq + params.sq_off.ring_mask);
+            m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+            char* cq(static_cast<char*>(m_cq));
+            m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            m_cqMask = *reinterpret_cast<unsigned*>(
+                    cq + params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+            m_reaper = std::thread([this]() { reap(); });
+        }
+
+        // Everything submitted must have completed.
+        ~Uring()
+        {
+            // A zero user_data stops the reaper.  If the ring has stopped, so
+            // has the reaper.
+            push(IORING_OP_NOP, -1, nullptr, 0, 0);
+            m_reaper.join();
+            unmap();
+        }
+
+        virtual void submit(std::unique_ptr<AsyncIo::Op> op) override
+        {
+            const int flags(
+                    op->write ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY);
+            const int fd(open(op->path.c_str(), flags | O_CLOEXEC, 0644));
+
+            if (fd < 0) return complete(std::move(op), false);
+
+            if (!op->write)
+            {
+                struct stat s;
+                if (fstat(fd, &s))
+                {
+                    close(fd);
+                    return complete(std::move(op), false);
+                }
+
+                op->size = s.st_size;
+                op->data->resize(op->size);
+            }
+
+            if (!op->size)
+            {
+                close(fd);
+                return complete(std::move(op), true);
+            }
+
+            std::unique_ptr<Request> r(makeUnique<Request>());
+            r->op = std::move(op);
+            r->fd = fd;
+            push(r.release());
+        }
+
+        virtual bool uring() const override { return true; }
+
+    private:
+        struct Request
+        {
+            std::unique_ptr<AsyncIo::Op> op;
+            int fd = -1;
+            iovec iov;
+        };
+
+        void* map(const std::size_t size, const off_t offset) const
+        {
+            void* p(
+                    mmap(
+                        nullptr,
+                        size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE,
+                        m_fd,
+                        offset));
+            return p == MAP_FAILED ? nullptr : p;
+        }
+
+        void unmap()
+        {
+            if (m_sqes) munmap(m_sqes, m_sqesSize);
+            if (m_cq && m_cq != m_sq) munmap(m_cq, m_cqSize);
+            if (m_sq) munmap(m_sq, m_sqSize);
+            close(m_fd);
+        }
+
+        // Submit the remainder of a request's transfer, or if that fails,
+        // complete it as failed.
+        void push(Request* r)
+        {
+            AsyncIo::Op& op(*r->op);
+            char* base(
+                    op.write ?
+                        const_cast<char*>(op.source) : op.data->data());
+
+            r->iov.iov_base = base + op.done;
+            r->iov.iov_len = op.size - op.done;
+
+            const bool pushed(
+                    push(
+                        op.write ? IORING_OP_WRITEV : IORING_OP_READV,
+                        r->fd,
+                        &r->iov,
+                        op.done,
+                        reinterpret_cast<uint64_t>(r)));
+
+            if (!pushed) finish(r, false);
+        }
+
+        // Our depth is at most that of the ring, and each request has at most
+        // one entry outstanding, so there's always room.  Returns false if the
+        // ring has stopped or the entry could not be submitted, in which case
+        // the entry is withdrawn.
+        bool push(
+                const uint8_t opcode,
+                const int fd,
+                const iovec* iov,
+                const uint64_t offset,
+                const uint64_t user)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopped) return false;
+
+            const unsigned tail(*m_sqTail);
+            const unsigned index(tail & m_sqMask);
+
+            io_uring_sqe& sqe(m_sqes[index]);
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = opcode;
+            sqe.fd = fd;
+            sqe.addr = reinterpret_cast<uint64_t>(iov);
+            sqe.len = iov ? 1 : 0;
+            sqe.off = offset;
+            sqe.user_data = user;
+
+            m_sqArray[index] = index;
+            __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+            // Tracked before submission, since it may complete at once.
+            Request* r(reinterpret_cast<Request*>(user));
+            if (r) m_requests.insert(r);
+
+            while (enter(m_fd, 1, 0, 0) < 0)
+            {
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                {
+                    // Nothing was consumed, so withdraw the entry rather than
+                    // leaving it to be submitted along with a later one.
+                    __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+                    if (r) m_requests.erase(r);
+                    return false;
+                }
+
+                std::this_thread::yield();
+            }
+
+            return true;
+        }
+
+        void reap()
+        {
+            bool stop(false);
+
+            while (!stop)
+            {
+                if (enter(m_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0)
+                {
+                    if (errno == EINTR) continue;
+
+                    // The ring is short of resources until completions are
+                    // reaped, so reap those which have been posted.
+                    if (errno != EAGAIN && errno != EBUSY) return fail();
+                }
+
+                unsigned head(*m_cqHead);
+                const unsigned tail(
+                        __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE));
+
+                while (head != tail)
+                {
+                    const io_uring_cqe& cqe(m_cqes[head & m_cqMask]);
+                    const uint64_t user(cqe.user_data);
+                    const int res(cqe.res);
+
+                    // Free the slot before handling, which may resubmit.
+                    __atomic_store_n(m_cqHead, ++head, __ATOMIC_RELEASE);
+
+                    if (user) handle(reinterpret_cast<Request*>(user), res);
+                    else stop = true;
+                }
+            }
+        }
+
+        void handle(Request* r, const int res)
+        {
+            AsyncIo::Op& op(*r->op);
+
+            if (res == -EINTR || res == -EAGAIN) return push(r);
+
+            // A read which ends early means the file has shrunk beneath us.
+            if (res > 0)
+            {
+                op.done += res;
+                if (op.done < op.size) return push(r);
+            }
+
+            finish(r, res > 0 && op.done == op.size);
+        }
+
+        void finish(Request* r, const bool ok)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_requests.erase(r);
+            }
+
+            std::unique_ptr<Request> owned(r);
+            close(owned->fd);
+            complete(std::move(owned->op), ok);
+        }
+
+        // The ring can't be waited upon, so fail everything outstanding, and
+        // stop accepting submissions.  Failures reach each op's callback.
+        void fail()
+        {
+            std::set<Request*> requests;
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopped = true;
+                requests.swap(m_requests);
+            }
+
+            for (Request* r : requests) finish(r, false);
+        }
+
+        int m_fd = -1;
+
+        void* m_sq = nullptr;
+        void* m_cq = nullptr;
+        io_uring_sqe* m_sqes = nullptr;
+        std::size_t m_sqSize = 0;
+        std::size_t m_cqSize = 0;
+        std::size_t m_sqesSize = 0;
+
+        unsigned* m_sqTail = nullptr;
+        unsigned m_sqMask = 0;
+        unsigned* m_sqArray = nullptr;
+
+        unsigned* m_cqHead = nullptr;
+        unsigned* m_cqTail = nullptr;
+        unsigned m_cqMask = 0;
+        io_uring_cqe* m_cqes = nullptr;
+
+        // Requests submitted and not yet completed, and whether the ring has
+        // stopped.
+        std::set<Request*> m_requests;
+        bool m_stopped = false;
+
+        std::mutex m_mutex;
+        std::thread m_reaper;
+    };
+#endif
+
+    bool uringEnabled()
+    {
+        const auto setting(env("ENTWINE_IO_URING"));
+        return !setting || *setting != "false";
+    }
+
+    // Reads ahead, by path.
+    std::mutex readaheadMutex;
+    std::multimap<std::string, std::shared_ptr<void>> readaheads;
+}
+
+AsyncIo::AsyncIo(const std::size_t depth, const bool uring)
+    : m_depth(std::max<std::size_t>(depth, 1))
+    , m_inFlight(0)
+    , m_mutex()
+    , m_cv()
+    , m_backend()
+{
+#ifdef ENTWINE_IO_URING
+    if (uring && uringEnabled())
+    {
+        try
+        {
+            m_backend = makeUnique<Uring>(*this, m_depth);
+        }
+        catch (...)
+        {
+            // Fall back to threads.
+        }
+    }
+#endif
+
+    if (!m_backend) m_backend = makeUnique<Threaded>(*this, m_depth);
+}
+
+AsyncIo::~AsyncIo()
+{
+    await();
+    m_backend.reset();
+}
+
+AsyncIo& AsyncIo::instance()
+{
+    static AsyncIo io;
+    return io;
+}
+
+void AsyncIo::read(const std::string& path, ReadDone done)
+{
+    std::unique_ptr<Op> op(makeUnique<Op>());
+    op->path = path;
+    op->data = makeUnique<Data>();
+    op->readDone = std::move(done);
+    submit(std::move(op));
+}
+
+void AsyncIo::write(
+        const std::string& path,
+        const char* data,
+        const std::size_t size,
+        WriteDone done)
+{
+    std::unique_ptr<Op> op(makeUnique<Op>());
+    op->write = true;
+    op->path = path;
+    op->source = data;
+    op->size = size;
+    op->writeDone = std::move(done);
+    submit(std::move(op));
+}
+
+std::unique_ptr<AsyncIo::Data> AsyncIo::read(const std::string& path)
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done(false);
+    std::unique_ptr<Data> result;
+
+    read(path, [&](std::unique_ptr<Data> data)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        result = std::move(data);
+        done = true;
+        cv.notify_all();
+    });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&done]() { return done; });
+    return result;
+}
+
+bool AsyncIo::write(
+        const std::string& path,
+        const char* data,
+        const std::size_t size)
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done(false);
+    bool result(false);
+
+    write(path, data, size, [&](bool ok)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        result = ok;
+        done = true;
+        cv.notify_all();
+    });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&done]() { return done; });
+    return result;
+}
+
+void AsyncIo::await()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]() { return !m_inFlight; });
+}
+
+bool AsyncIo::uring() const
+{
+    return m_backend->uring();
+}
+
+void AsyncIo::submit(std::unique_ptr<Op> op)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]() { return m_inFlight < m_depth; });
+    ++m_inFlight;
+    lock.unlock();
+
+    m_backend->submit(std::move(op));
+}
+
+void AsyncIo::complete(std::unique_ptr<Op> op, const bool ok)
+{
+    try
+    {
+        if (op->write) op->writeDone(ok);
+        else op->readDone(ok ? std::move(op->data) : nullptr);
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Async I/O callback failed: " << e.what() << std::endl;
+    }
+    catch (...)
+    {
+        std::cout << "Async I/O callback failed" << std::endl;
+    }
+
+    op.reset();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    --m_inFlight;
+    m_cv.notify_all();
+}
+
+
+
+struct Readahead::Pending
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    std::unique_ptr<AsyncIo::Data> data;
+};
+
+Readahead::Readahead(AsyncIo& io, const std::vector<std::string>& paths)
+    : m_io(io)
+    , m_pending()
+{
+    for (const std::string& path : paths)
+    {
+        auto pending(std::make_shared<Pending>());
+        m_pending.emplace_back(path, pending);
+
+        {
+            std::lock_guard<std::mutex> lock(readaheadMutex);
+            readaheads.emplace(path, pending);
+        }
+
+        m_io.read(path, [pending](std::unique_ptr<AsyncIo::Data> data)
+        {
+            std::lock_guard<std::mutex> lock(pending->mutex);
+            pending->data = std::move(data);
+            pending->done = true;
+            pending->cv.notify_all();
+        });
+    }
+}
+
+Readahead::~Readahead()
+{
+    std::lock_guard<std::mutex> lock(readaheadMutex);
+
+    for (const auto& p : m_pending)
+    {
+        auto range(readaheads.equal_range(p.first));
+        for (auto it(range.first); it != range.second; ++it)
+        {
+            if (it->second == p.second)
+            {
+                readaheads.erase(it);
+                break;
+            }
+        }
+    }
+}
+
+bool Readahead::take(
+        const std::string& path,
+        std::unique_ptr<AsyncIo::Data>& data)
+{
+    std::shared_ptr<Pending> pending;
+
+    {
+        std::lock_guard<std::mutex> lock(readaheadMutex);
+        const auto it(readaheads.find(path));
+        if (it == readaheads.end()) return false;
+
+        pending = std::static_pointer_cast<Pending>(it->second);
+        readaheads.erase(it);
+    }
+
+    std::unique_lock<std::mutex> lock(pending->mutex);
+    pending->cv.wait(lock, [&pending]() { return pending->done; });
+    data = std::move(pending->data);
+    return true;
+}
+
+} // namespace entwine
+
@@ -0,0 +1,122 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace entwine
+{
+
+// Asynchronous reads and writes of whole local files.  Callers submit
+// operations and are called back once they complete, so that many operations
+// may be in flight without a thread blocked on each of them.
+//
+// On Linux, operations are submitted to an io_uring, and completions reaped
+// by a single thread.  Where io_uring is unavailable - off of Linux, on
+// older kernels, or where it is disallowed - or if it is disabled by setting
+// ENTWINE_IO_URING=false, blocking I/O runs on a small pool of threads
+// instead.
+//
+// Callbacks run on an internal thread, so they should be brief, and must not
+// submit or wait on other operations of the same instance.
+class AsyncIo
+{
+public:
+    using Data = std::vector<char>;
+
+    // Null on failure.
+    using ReadDone = std::function<void(std::unique_ptr<Data>)>;
+    using WriteDone = std::function<void(bool)>;
+
+    // At most depth operations are in flight at once - submissions beyond
+    // that block until one completes.
+    explicit AsyncIo(std::size_t depth = 256, bool uring = true);
+    ~AsyncIo();
+
+    // The instance used for chunk I/O.
+    static AsyncIo& instance();
+
+    void read(const std::string& path, ReadDone done);
+
+    // The data must remain valid until done is called.  Existing files are
+    // truncated.
+    void write(
+            const std::string& path,
+            const char* data,
+            std::size_t size,
+            WriteDone done);
+
+    // Blocking versions.
+    std::unique_ptr<Data> read(const std::string& path);
+    bool write(const std::string& path, const char* data, std::size_t size);
+
+    // Wait for every operation submitted so far to complete.
+    void await();
+
+    bool uring() const;
+    std::size_t depth() const { return m_depth; }
+
+    // Internal.
+    class Backend;
+    struct Op;
+
+private:
+    AsyncIo(const AsyncIo&) = delete;
+    AsyncIo& operator=(const AsyncIo&) = delete;
+
+    void submit(std::unique_ptr<Op> op);
+    void complete(std::unique_ptr<Op> op, bool ok);
+
+    const std::size_t m_depth;
+    std::size_t m_inFlight;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+
+    std::unique_ptr<Backend> m_backend;
+};
+
+// Reads of a set of local files submitted together, so that they're all in
+// flight at once, and then taken as they're needed.  While it exists, its
+// reads may be taken by path from anywhere with AsyncIo-backed reads - see
+// take().  Reads not taken are discarded on destruction.
+class Readahead
+{
+public:
+    Readahead(AsyncIo& io, const std::vector<std::string>& paths);
+    ~Readahead();
+
+    // If a read of this path is ahead, wait for it and take its data, which
+    // is null if the read failed.  Otherwise returns false.
+    static bool take(
+            const std::string& path,
+            std::unique_ptr<AsyncIo::Data>& data);
+
+private:
+    Readahead(const Readahead&) = delete;
+    Readahead& operator=(const Readahead&) = delete;
+
+    struct Pending;
+
+    AsyncIo& m_io;
+    std::vector<std::pair<std::string, std::shared_ptr<Pending>>> m_pending;
+};
+
+} // namespace entwine
+
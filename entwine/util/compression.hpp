@@ -59,6 +59,34 @@ public:
     static std::unique_ptr<std::vector<char>> decompressLzma(
             const std::vector<char>& data);
 
+#ifdef ENTWINE_HAVE_ZSTD
+    // Zstandard frames.  These record their decompressed size, so that it
+    // needn't be known in advance.
+    static std::unique_ptr<std::vector<char>> compressZstd(
+            const std::vector<char>& data,
+            int level = zstdLevel);
+
+    static std::unique_ptr<std::vector<char>> decompressZstd(
+            const std::vector<char>& data);
+
+    // Append a frame to out, returning its size.  Compression contexts are
+    // kept per thread.
+    static std::size_t compressZstd(
+            const char* data,
+            std::size_t size,
+            std::vector<char>& out,
+            int level = zstdLevel);
+
+    // Decompress a single frame, which must expand to exactly outSize bytes.
+    static void decompressZstd(
+            const char* data,
+            std::size_t size,
+            char* out,
+            std::size_t outSize);
+#endif
+
+    static constexpr int zstdLevel = 3;
+
     Compression() = delete;
 };
 
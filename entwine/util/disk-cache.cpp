@@ -0,0 +1,404 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/disk-cache.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <tuple>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Entries end with their key, the key size, the data size, and this.
+    const uint64_t magic(0x656e7477696e6563ULL);
+    const std::size_t trailerSize(3 * sizeof(uint64_t));
+
+    const std::string tmpSuffix(".tmp");
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::map<std::string, std::weak_ptr<DiskCache>> opened;
+        std::list<std::pair<std::string, DiskCache*>> attached;
+    };
+
+    Registry& registry()
+    {
+        static Registry r;
+        return r;
+    }
+
+    bool endsWith(const std::string& s, const std::string& end)
+    {
+        return s.size() >= end.size() &&
+            s.compare(s.size() - end.size(), end.size(), end) == 0;
+    }
+
+    void push(std::vector<char>& data, const uint64_t v)
+    {
+        const char* pos(reinterpret_cast<const char*>(&v));
+        data.insert(data.end(), pos, pos + sizeof(v));
+    }
+
+    uint64_t extract(const std::vector<char>& data, const std::size_t offset)
+    {
+        uint64_t v;
+        std::memcpy(&v, data.data() + offset, sizeof(v));
+        return v;
+    }
+
+    std::unique_ptr<std::vector<char>> readFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.good()) return std::unique_ptr<std::vector<char>>();
+
+        return makeUnique<std::vector<char>>(
+                (std::istreambuf_iterator<char>(file)),
+                std::istreambuf_iterator<char>());
+    }
+
+    // Flushed to disk before returning, so that it may be renamed into place.
+    bool writeFile(const std::string& path, const std::vector<char>& data)
+    {
+#ifndef _WIN32
+        const int fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+        if (fd < 0) return false;
+
+        const char* pos(data.data());
+        std::size_t remaining(data.size());
+
+        while (remaining)
+        {
+            const ssize_t n(::write(fd, pos, remaining));
+            if (n <= 0)
+            {
+                ::close(fd);
+                return false;
+            }
+
+            pos += n;
+            remaining -= n;
+        }
+
+        const bool synced(::fsync(fd) == 0);
+        return ::close(fd) == 0 && synced;
+#else
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), data.size());
+        file.close();
+        return file.good();
+#endif
+    }
+
+    // Size and modification time, or zeros if the file doesn't exist.
+    std::pair<std::size_t, std::time_t> stat(const std::string& path)
+    {
+#ifndef _WIN32
+        struct stat s;
+        if (::stat(path.c_str(), &s) == 0)
+        {
+            return std::make_pair(s.st_size, s.st_mtime);
+        }
+        return std::make_pair(0, 0);
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        const std::streamoff size(file.good() ? file.tellg() : 0);
+        return std::make_pair(static_cast<std::size_t>(size), 0);
+#endif
+    }
+
+    std::string uniqueSuffix()
+    {
+        static std::atomic<uint64_t> counter(0);
+        const std::size_t thread(
+                std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+        return "." + std::to_string(thread) + "-" +
+            std::to_string(counter++) + tmpSuffix;
+    }
+}
+
+DiskCache::DiskCache(const std::string& dir, const std::size_t maxBytes)
+    : m_dir(dir.empty() || dir.back() == '/' ? dir : dir + '/')
+    , m_maxBytes(maxBytes)
+{
+    if (!arbiter::fs::mkdirp(m_dir))
+    {
+        throw std::runtime_error("Could not create disk cache: " + m_dir);
+    }
+
+    adopt();
+}
+
+std::shared_ptr<DiskCache> DiskCache::open(
+        const arbiter::Endpoint& tmp,
+        const std::size_t maxBytes)
+{
+    if (!tmp.isLocal())
+    {
+        throw std::runtime_error("Disk cache must be local");
+    }
+
+    const std::string dir(tmp.fullPath("entwine-cache/"));
+
+    Registry& r(registry());
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    std::shared_ptr<DiskCache> cache(r.opened[dir].lock());
+    if (!cache)
+    {
+        cache = std::make_shared<DiskCache>(dir, maxBytes);
+        r.opened[dir] = cache;
+    }
+
+    return cache;
+}
+
+DiskCache::Attachment::Attachment(
+        const arbiter::Endpoint& endpoint,
+        std::shared_ptr<DiskCache> cache)
+    : m_cache(cache)
+{
+    Registry& r(registry());
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    r.attached.emplace_front(endpoint.prefixedRoot(), m_cache.get());
+    m_it = r.attached.begin();
+}
+
+DiskCache::Attachment::~Attachment()
+{
+    Registry& r(registry());
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.attached.erase(m_it);
+}
+
+DiskCache* DiskCache::find(const arbiter::Endpoint& endpoint)
+{
+    Registry& r(registry());
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.attached.empty()) return nullptr;
+
+    const std::string root(endpoint.prefixedRoot());
+    for (const auto& a : r.attached)
+    {
+        if (root.compare(0, a.first.size(), a.first) == 0) return a.second;
+    }
+
+    return nullptr;
+}
+
+std::unique_ptr<DiskCache::Data> DiskCache::get(
+        const std::string& key,
+        const Fetch& fetch)
+{
+    if (auto data = find(key))
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_hits;
+        return data;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_misses;
+    }
+
+    std::unique_ptr<Data> data(fetch());
+    if (data) put(key, *data);
+    return data;
+}
+
+std::unique_ptr<DiskCache::Data> DiskCache::get(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        const Fetch& fetch)
+{
+    return get(endpoint.prefixedRoot() + path, fetch);
+}
+
+std::unique_ptr<DiskCache::Data> DiskCache::find(const std::string& key)
+{
+    const std::string name(filename(key));
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it(m_entries.find(name));
+        if (it == m_entries.end()) return std::unique_ptr<Data>();
+
+        m_order.splice(m_order.begin(), m_order, it->second.it);
+    }
+
+    std::unique_ptr<Data> data(readFile(m_dir + name));
+
+    // The key is checked in case of a hash collision.
+    bool valid(data && data->size() >= trailerSize);
+    if (valid)
+    {
+        const std::size_t end(data->size() - trailerSize);
+        const uint64_t keySize(extract(*data, end));
+        const uint64_t dataSize(extract(*data, end + sizeof(uint64_t)));
+
+        // The sizes are checked before the key is compared, so a shorter key
+        // stored at the end of the file is never read past.
+        valid =
+            extract(*data, end + 2 * sizeof(uint64_t)) == magic &&
+            keySize == key.size() &&
+            keySize + dataSize == end &&
+            std::equal(key.begin(), key.end(), data->begin() + dataSize);
+
+        if (valid) data->resize(dataSize);
+    }
+
+    if (!valid)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_entries.count(name)) erase(name);
+        return std::unique_ptr<Data>();
+    }
+
+    return data;
+}
+
+void DiskCache::put(const std::string& key, const Data& data)
+{
+    Data entry;
+    entry.reserve(data.size() + key.size() + trailerSize);
+    entry.insert(entry.end(), data.begin(), data.end());
+    entry.insert(entry.end(), key.begin(), key.end());
+    push(entry, key.size());
+    push(entry, data.size());
+    push(entry, magic);
+
+    if (entry.size() > m_maxBytes) return;
+
+    const std::string name(filename(key));
+    const std::string path(m_dir + name);
+    const std::string tmp(path + uniqueSuffix());
+
+    if (!writeFile(tmp, entry) || std::rename(tmp.c_str(), path.c_str()))
+    {
+        std::remove(tmp.c_str());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    insert(name, entry.size());
+    evict();
+}
+
+std::size_t DiskCache::bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+std::size_t DiskCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+std::size_t DiskCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+std::size_t DiskCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+std::string DiskCache::filename(const std::string& key) const
+{
+    static const char digits[] = "0123456789abcdef";
+
+    uint64_t h(std::hash<std::string>()(key));
+    std::string name(16, '0');
+    for (std::size_t i(0); i < name.size(); ++i, h >>= 4)
+    {
+        name[name.size() - i - 1] = digits[h & 0xf];
+    }
+
+    return name;
+}
+
+void DiskCache::adopt()
+{
+    std::vector<std::tuple<std::time_t, std::string, std::size_t>> found;
+
+    for (const std::string& path : arbiter::fs::glob(m_dir + "*"))
+    {
+        // Left by an interrupted write.
+        if (endsWith(path, tmpSuffix))
+        {
+            arbiter::fs::remove(path);
+            continue;
+        }
+
+        const auto s(stat(path));
+        const std::string name(path.substr(path.rfind('/') + 1));
+        found.emplace_back(s.second, name, s.first);
+    }
+
+    std::sort(found.begin(), found.end());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& f : found) insert(std::get<1>(f), std::get<2>(f));
+    evict();
+}
+
+void DiskCache::insert(const std::string& name, const std::size_t size)
+{
+    if (m_entries.count(name)) erase(name);
+
+    m_order.push_front(name);
+    m_entries[name] = Entry { m_order.begin(), size };
+    m_bytes += size;
+}
+
+void DiskCache::erase(const std::string& name)
+{
+    const auto it(m_entries.find(name));
+
+    std::remove((m_dir + name).c_str());
+    m_bytes -= it->second.size;
+    m_order.erase(it->second.it);
+    m_entries.erase(it);
+}
+
+void DiskCache::evict()
+{
+    while (m_bytes > m_maxBytes && !m_order.empty()) erase(m_order.back());
+}
+
+} // namespace entwine
+
@@ -0,0 +1,140 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace entwine
+{
+
+namespace arbiter { class Endpoint; }
+
+// A size-capped local directory of files fetched from remote endpoints, so
+// that chunks and hierarchy blocks evicted from memory can be read again
+// without another network round trip.  Files are stored as fetched, keyed by
+// the endpoint root and path, and the least recently used are removed once
+// the total exceeds the cap.
+//
+// Each file is written to a temporary name, flushed, and then renamed, so an
+// interrupted write never leaves a partial entry in place.  Entries carry
+// their key and size, which are checked as they're read - invalid entries
+// are removed and fetched again.  Entries left by an earlier process are
+// adopted on construction, oldest first, and orphaned temporary files are
+// removed.
+class DiskCache
+{
+public:
+    using Data = std::vector<char>;
+    using Fetch = std::function<std::unique_ptr<Data>()>;
+
+    DiskCache(const std::string& dir, std::size_t maxBytes);
+
+    // The disk cache in the entwine-cache directory of this local endpoint,
+    // shared with everyone else using it.  If it isn't open, it's opened with
+    // this cap.
+    static std::shared_ptr<DiskCache> open(
+            const arbiter::Endpoint& tmp,
+            std::size_t maxBytes);
+
+    // While it exists, fetches from this endpoint and those beneath it go
+    // through the given disk cache - see find().
+    class Attachment
+    {
+    public:
+        Attachment(
+                const arbiter::Endpoint& endpoint,
+                std::shared_ptr<DiskCache> cache);
+        ~Attachment();
+
+    private:
+        using List = std::list<std::pair<std::string, DiskCache*>>;
+
+        std::shared_ptr<DiskCache> m_cache;
+        List::iterator m_it;
+
+        Attachment(const Attachment&) = delete;
+        Attachment& operator=(const Attachment&) = delete;
+
+        friend class DiskCache;
+    };
+
+    // The disk cache attached to this endpoint, or to one above it, if any.
+    static DiskCache* find(const arbiter::Endpoint& endpoint);
+
+    // Get a file from the cache if it's held, or else fetch and hold it.
+    std::unique_ptr<Data> get(const std::string& key, const Fetch& fetch);
+
+    // As above, keyed by this path of the endpoint.  The fetch is the
+    // caller's own read of the path, so a miss behaves, retries and all, just
+    // as it would without the cache.
+    std::unique_ptr<Data> get(
+            const arbiter::Endpoint& endpoint,
+            const std::string& path,
+            const Fetch& fetch);
+
+    // Null if not held.
+    std::unique_ptr<Data> find(const std::string& key);
+
+    // Failed writes are ignored, leaving the entry unheld.
+    void put(const std::string& key, const Data& data);
+
+    const std::string& dir() const { return m_dir; }
+    std::size_t maxBytes() const { return m_maxBytes; }
+    std::size_t bytes() const;
+    std::size_t size() const;
+
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+private:
+    using Order = std::list<std::string>;
+
+    struct Entry
+    {
+        Order::iterator it;
+        std::size_t size;
+    };
+
+    std::string filename(const std::string& key) const;
+
+    void adopt();
+
+    // Call with the lock held.
+    void insert(const std::string& name, std::size_t size);
+    void erase(const std::string& name);
+    void evict();
+
+    const std::string m_dir;
+    const std::size_t m_maxBytes;
+    std::size_t m_bytes = 0;
+
+    // File names, most recently used first.
+    Order m_order;
+    std::map<std::string, Entry> m_entries;
+
+    std::size_t m_hits = 0;
+    std::size_t m_misses = 0;
+
+    mutable std::mutex m_mutex;
+
+    DiskCache(const DiskCache&) = delete;
+    DiskCache& operator=(const DiskCache&) = delete;
+};
+
+} // namespace entwine
+
@@ -11,6 +11,10 @@
 #pragma once
 
 #include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <entwine/util/unique.hpp>
 
 namespace entwine
 {
@@ -11,12 +11,14 @@
 #include <entwine/util/io.hpp>
 
 #include <chrono>
+#include <fstream>
 #include <iostream>
 #include <mutex>
 #include <thread>
 
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/tree/chunk.hpp>
+#include <entwine/util/unique.hpp>
 
 namespace
 {
@@ -43,6 +45,36 @@ namespace
 
         throw std::runtime_error("Fatal error - could not " + method);
     }
+
+    std::unique_ptr<std::vector<char>> tryGetRange(
+            const entwine::arbiter::Endpoint& endpoint,
+            const std::string& path,
+            const std::size_t offset,
+            const std::size_t size)
+    {
+        using Data = std::vector<char>;
+
+        if (!size) return entwine::makeUnique<Data>();
+
+        if (endpoint.isLocal())
+        {
+            std::ifstream file(endpoint.fullPath(path), std::ios::binary);
+            if (!file.seekg(offset)) return std::unique_ptr<Data>();
+
+            auto data(entwine::makeUnique<Data>(size));
+            if (!file.read(data->data(), size)) data.reset();
+            return data;
+        }
+
+        entwine::arbiter::http::Headers headers;
+        headers["Range"] =
+            "bytes=" + std::to_string(offset) + "-" +
+            std::to_string(offset + size - 1);
+
+        auto data(endpoint.tryGetBinary(path, headers));
+        if (data && data->size() != size) data.reset();
+        return data;
+    }
 }
 
 namespace entwine
@@ -106,6 +138,27 @@ std::unique_ptr<std::vector<char>> ensureGet(
     return data;
 }
 
+std::unique_ptr<std::vector<char>> ensureGet(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        const std::size_t offset,
+        const std::size_t size)
+{
+    std::unique_ptr<std::vector<char>> data;
+    std::size_t tried(0);
+
+    while (!(data = tryGetRange(endpoint, path, offset, size)))
+    {
+        if (++tried < retries)
+        {
+            sleep(tried, "GET", endpoint.prefixedRoot() + path);
+        }
+        else suicide("GET");
+    }
+
+    return data;
+}
+
 std::string ensureGetString(
         const arbiter::Endpoint& endpoint,
         const std::string& path)
@@ -39,6 +39,14 @@ std::unique_ptr<std::vector<char>> ensureGet(
         const arbiter::Endpoint& endpoint,
         const std::string& path);
 
+// Get a byte range of a file.  Local files are read directly, and others by
+// an HTTP range request.
+std::unique_ptr<std::vector<char>> ensureGet(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        std::size_t offset,
+        std::size_t size);
+
 std::string ensureGetString(
         const arbiter::Endpoint& endpoint,
         const std::string& path);
@@ -12,20 +12,25 @@
 
 #include <atomic>
 
+#include <entwine/util/spin-lock.hpp>
+
 namespace entwine
 {
 
+// Scoped lock over a bare atomic_flag.  Prefer SpinLock, which parks waiters
+// rather than yielding them indefinitely - this remains for very short critical
+// sections guarded by existing flags.
 class Locker
 {
 public:
     explicit Locker(std::atomic_flag& flag)
         : m_flag(flag)
     {
-        while (m_flag.test_and_set())
-            ;
+        Backoff backoff;
+        while (m_flag.test_and_set(std::memory_order_acquire)) backoff.pause();
     }
 
-    ~Locker() { m_flag.clear(); }
+    ~Locker() { m_flag.clear(std::memory_order_release); }
 
 private:
     std::atomic_flag& m_flag;
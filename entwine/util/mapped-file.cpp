@@ -0,0 +1,123 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/mapped-file.hpp>
+
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace entwine
+{
+
+MappedFile::MappedFile(const std::string& path)
+    : m_data(nullptr)
+    , m_size(0)
+    , m_base(nullptr)
+    , m_mapSize(0)
+{
+    map(path, 0, true);
+}
+
+MappedFile::MappedFile(
+        const std::string& path,
+        const std::size_t offset,
+        const std::size_t size)
+    : m_data(nullptr)
+    , m_size(size)
+    , m_base(nullptr)
+    , m_mapSize(0)
+{
+    map(path, offset, false);
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (m_base) ::munmap(const_cast<char*>(m_base), m_mapSize);
+#endif
+}
+
+void MappedFile::map(
+        const std::string& path,
+        const std::size_t offset,
+        const bool whole)
+{
+#ifndef _WIN32
+    const int fd(::open(path.c_str(), O_RDONLY));
+    if (fd < 0) throw std::runtime_error("Could not open " + path);
+
+    struct stat info;
+    if (::fstat(fd, &info))
+    {
+        ::close(fd);
+        throw std::runtime_error("Could not stat " + path);
+    }
+
+    const std::size_t fileSize(info.st_size);
+    if (whole) m_size = fileSize;
+
+    if (offset + m_size > fileSize)
+    {
+        ::close(fd);
+        throw std::runtime_error("Invalid range of " + path);
+    }
+
+    // Mappings must begin on a page boundary.
+    static const std::size_t pageSize(::sysconf(_SC_PAGESIZE));
+    const std::size_t slack(offset % pageSize);
+    m_mapSize = m_size + slack;
+
+    // Zero-length mappings are invalid, but there's nothing to map anyway.
+    if (m_size)
+    {
+        void* p(
+                ::mmap(
+                    nullptr,
+                    m_mapSize,
+                    PROT_READ,
+                    MAP_PRIVATE,
+                    fd,
+                    offset - slack));
+
+        if (p == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("Could not map " + path);
+        }
+
+        // Chunks are consumed front to back as soon as they're mapped.
+        ::madvise(p, m_mapSize, MADV_WILLNEED);
+        m_base = static_cast<const char*>(p);
+        m_data = m_base + slack;
+    }
+
+    // The mapping holds its own reference to the file.
+    ::close(fd);
+#else
+    throw std::runtime_error("Memory mapping is not supported: " + path);
+#endif
+}
+
+bool MappedFile::supported()
+{
+#ifndef _WIN32
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace entwine
@@ -0,0 +1,56 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace entwine
+{
+
+// A read-only memory mapping of a local file, or of a byte range of one.
+// Pages are read in by the kernel on first access, and are reclaimable page
+// cache rather than anonymous memory, so a mapped file costs neither a copy
+// nor a heap allocation.  The file must not be truncated while it's mapped.
+class MappedFile
+{
+public:
+    // Throws if the file cannot be opened or mapped.
+    explicit MappedFile(const std::string& path);
+
+    // Map only the given range, which must lie within the file.
+    MappedFile(const std::string& path, std::size_t offset, std::size_t size);
+
+    ~MappedFile();
+
+    // False where mapping isn't implemented, in which case construction
+    // always throws.
+    static bool supported();
+
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void map(const std::string& path, std::size_t offset, bool whole);
+
+    const char* m_data;
+    std::size_t m_size;
+
+    // The mapping itself, which begins on a page boundary at or before our
+    // data.
+    const char* m_base;
+    std::size_t m_mapSize;
+};
+
+} // namespace entwine
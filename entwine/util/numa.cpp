@@ -0,0 +1,187 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/numa.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace entwine
+{
+
+namespace
+{
+    thread_local std::size_t currentNodeIndex(0);
+
+    // CPUs on which this process may run.
+    std::vector<int> availableCpus()
+    {
+        std::vector<int> cpus;
+
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+
+        if (!sched_getaffinity(0, sizeof(set), &set))
+        {
+            for (int i(0); i < CPU_SETSIZE; ++i)
+            {
+                if (CPU_ISSET(i, &set)) cpus.push_back(i);
+            }
+        }
+#endif
+
+        if (cpus.empty())
+        {
+            const int n(std::max<int>(std::thread::hardware_concurrency(), 1));
+            for (int i(0); i < n; ++i) cpus.push_back(i);
+        }
+
+        return cpus;
+    }
+
+    // Parse a kernel CPU list, e.g. "0-3,8-11".
+    std::vector<int> parseCpuList(const std::string& s)
+    {
+        std::vector<int> cpus;
+        std::istringstream stream(s);
+        std::string range;
+
+        while (std::getline(stream, range, ','))
+        {
+            if (range.empty() || range == "\n") continue;
+
+            const std::size_t dash(range.find('-'));
+            const int begin(std::stoi(range.substr(0, dash)));
+            const int end(
+                    dash == std::string::npos ?
+                        begin : std::stoi(range.substr(dash + 1)));
+
+            for (int i(begin); i <= end; ++i) cpus.push_back(i);
+        }
+
+        return cpus;
+    }
+}
+
+Numa::Numa(std::vector<std::vector<int>> nodes, const bool emulated)
+    : m_nodes(std::move(nodes))
+    , m_emulated(emulated)
+{
+    if (m_nodes.empty()) m_nodes.push_back(availableCpus());
+}
+
+Numa Numa::detect()
+{
+    const std::vector<int> available(availableCpus());
+    std::vector<std::vector<int>> nodes;
+
+#ifdef __linux__
+    for (std::size_t node(0); ; ++node)
+    {
+        std::ifstream file(
+                "/sys/devices/system/node/node" + std::to_string(node) +
+                "/cpulist");
+
+        if (!file.good()) break;
+
+        std::string list;
+        std::getline(file, list);
+
+        std::vector<int> cpus;
+        for (const int cpu : parseCpuList(list))
+        {
+            if (std::count(available.begin(), available.end(), cpu))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+
+        // Nodes without CPUs, or whose CPUs we may not use, are skipped.
+        if (!cpus.empty()) nodes.push_back(cpus);
+    }
+#endif
+
+    return Numa(nodes, false);
+}
+
+Numa Numa::emulate(const std::size_t numNodes)
+{
+    if (!numNodes) throw std::runtime_error("Cannot emulate zero NUMA nodes");
+
+    const std::vector<int> available(availableCpus());
+    std::vector<std::vector<int>> nodes(numNodes);
+
+    if (available.size() >= numNodes)
+    {
+        // Contiguous runs, as physical nodes typically are.
+        for (std::size_t i(0); i < available.size(); ++i)
+        {
+            nodes[i * numNodes / available.size()].push_back(available[i]);
+        }
+    }
+    else
+    {
+        for (std::size_t i(0); i < numNodes; ++i)
+        {
+            nodes[i].push_back(available[i % available.size()]);
+        }
+    }
+
+    return Numa(nodes, true);
+}
+
+Numa Numa::create(const std::size_t numNodes)
+{
+    Numa detected(detect());
+    if (!numNodes || numNodes == detected.numNodes()) return detected;
+    return emulate(numNodes);
+}
+
+bool Numa::pin(const std::size_t node) const
+{
+    const std::vector<int>& nodeCpus(cpus(node));
+    currentNodeIndex = node;
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int cpu : nodeCpus) CPU_SET(cpu, &set);
+
+    // Zero applies to the calling thread only.
+    return !sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)nodeCpus;
+    return true;
+#endif
+}
+
+std::size_t Numa::currentNode()
+{
+    return currentNodeIndex;
+}
+
+std::string Numa::toString() const
+{
+    std::string s(std::to_string(numNodes()));
+    s += numNodes() == 1 ? " node" : " nodes";
+    if (m_emulated) s += " (emulated)";
+    return s;
+}
+
+} // namespace entwine
+
@@ -0,0 +1,69 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace entwine
+{
+
+// The NUMA topology used to lay out a build: a set of CPUs per node.  Threads
+// pinned to a node record it, so that allocations they make may be routed to
+// that node's pools.  Memory placement then follows from first-touch - pool
+// blocks are allocated and initialized by the pinned thread that needs them.
+//
+// A topology may be emulated by splitting the available CPUs evenly into any
+// number of nodes, which allows NUMA mode to be exercised on a single-node
+// machine.  Off of Linux, every topology has a single node and pinning only
+// records the node.
+class Numa
+{
+public:
+    // Read the topology of this machine, restricted to the CPUs that this
+    // process may run on.  Results in a single node if it can't be read.
+    static Numa detect();
+
+    // Split the available CPUs into numNodes nodes.  If there are fewer CPUs
+    // than nodes, CPUs are shared round-robin.
+    static Numa emulate(std::size_t numNodes);
+
+    // The detected topology if numNodes is zero or matches the detected node
+    // count, otherwise an emulated one.
+    static Numa create(std::size_t numNodes = 0);
+
+    std::size_t numNodes() const { return m_nodes.size(); }
+    bool emulated() const { return m_emulated; }
+    const std::vector<int>& cpus(std::size_t node) const
+    {
+        return m_nodes.at(node);
+    }
+
+    // Restrict the calling thread to the CPUs of the given node, and record
+    // it as the thread's current node.  The node is recorded even if the
+    // thread could not be restricted, in which case false is returned.
+    bool pin(std::size_t node) const;
+
+    // The node most recently pinned by the calling thread, or zero.
+    static std::size_t currentNode();
+
+    std::string toString() const;
+
+private:
+    Numa(std::vector<std::vector<int>> nodes, bool emulated);
+
+    std::vector<std::vector<int>> m_nodes;
+    bool m_emulated;
+};
+
+} // namespace entwine
+
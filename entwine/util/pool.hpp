@@ -10,25 +10,32 @@
 
 #pragma once
 
-#include <condition_variable>
 #include <cstddef>
-#include <functional>
-#include <mutex>
-#include <queue>
-#include <thread>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include <entwine/util/scheduler.hpp>
+
 namespace entwine
 {
 
+// A facade over a work-stealing Scheduler which preserves the interface of
+// the original single-queue thread pool.
 class Pool
 {
 public:
     // After numThreads tasks are actively running, and queueSize tasks have
     // been enqueued to wait for an available worker thread, subsequent calls
-    // to Pool::add will block until an enqueued task has been popped from the
-    // queue.
-    Pool(std::size_t numThreads, std::size_t queueSize = 1);
+    // to Pool::add will block until an enqueued task has been started.  Tasks
+    // added from within a running task never block.
+    //
+    // If supplied, init is run on each worker thread as it starts.
+    Pool(
+            std::size_t numThreads,
+            std::size_t queueSize = 1,
+            Scheduler::Init init = Scheduler::Init());
     ~Pool();
 
     // Start worker threads
@@ -36,8 +43,8 @@ public:
 
     // Wait for all currently running tasks to complete.
     void join();
-    bool running() const { return m_running; }
-    bool joined() const { return !m_running; }
+    bool running() const { return m_scheduler.running(); }
+    bool joined() const { return !m_scheduler.running(); }
 
     void cycle() { join(); go(); }
 
@@ -49,34 +56,48 @@ public:
     void await();
 
     // Not thread-safe, pool should be joined before calling.
-    const std::vector<std::string>& errors() const { return m_errors; }
+    const std::vector<std::string>& errors() const
+    {
+        return m_scheduler.errors();
+    }
 
     // Add a threaded task, blocking until a thread is available.  If join() is
     // called, add() may not be called again until go() is called and completes.
-    void add(std::function<void()> task);
-
-    std::size_t size() const { return m_numThreads; }
-    std::size_t numThreads() const { return m_numThreads; }
+    //
+    // The task is stored without a heap allocation if its captures fit within
+    // Task::inlineSize() bytes.
+    template<typename Fn>
+    void add(Fn&& task)
+    {
+        push(std::forward<Fn>(task), nullptr);
+    }
+
+    // Add a task which also counts toward the given group, so that a subset of
+    // tasks may be awaited via group.wait() without joining the pool.
+    template<typename Fn>
+    void add(TaskGroup& group, Fn&& task)
+    {
+        push(std::forward<Fn>(task), &group);
+    }
+
+    std::size_t size() const { return m_scheduler.numThreads(); }
+    std::size_t numThreads() const { return m_scheduler.numThreads(); }
 
 private:
-    // Worker thread function.  Wait for a task and run it - or if stop() is
-    // called, complete any outstanding task and return.
-    void work();
-
-    std::size_t m_numThreads;
-    std::size_t m_queueSize;
-    std::vector<std::thread> m_threads;
-    std::queue<std::function<void()>> m_tasks;
-
-    std::vector<std::string> m_errors;
-    std::mutex m_errorMutex;
-
-    std::size_t m_outstanding = 0;
-    bool m_running = false;
-
-    mutable std::mutex m_mutex;
-    std::condition_variable m_produceCv;
-    std::condition_variable m_consumeCv;
+    template<typename Fn>
+    void push(Fn&& task, TaskGroup* group)
+    {
+        if (!running())
+        {
+            throw std::runtime_error(
+                    "Attempted to add a task to a stopped Pool");
+        }
+
+        m_scheduler.add(std::forward<Fn>(task), group, m_queueSize);
+    }
+
+    const std::size_t m_queueSize;
+    Scheduler m_scheduler;
 
     // Disable copy/assignment.
     Pool(const Pool& other);
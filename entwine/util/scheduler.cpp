@@ -0,0 +1,332 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/scheduler.hpp>
+
+#include <iostream>
+#include <stdexcept>
+
+namespace entwine
+{
+
+namespace
+{
+    // Identifies the scheduler, if any, that owns the current thread.
+    thread_local Scheduler* currentScheduler(nullptr);
+    thread_local std::size_t currentIndex(0);
+
+    // Rounds of stealing attempts before an idle worker parks.
+    const std::size_t idleRounds(8);
+
+    LockSite dequeSite("scheduler-deque");
+}
+
+void TaskGroup::wait()
+{
+    if (Scheduler* scheduler = currentScheduler)
+    {
+        Backoff backoff;
+
+        while (m_outstanding.load())
+        {
+            if (scheduler->runOne()) backoff.reset();
+            else backoff.pause();
+        }
+
+        // The final done() call may still hold our mutex - wait for it to
+        // let go so we can't be destroyed out from under it.
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    else
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return !m_outstanding.load(); });
+    }
+}
+
+void TaskGroup::fail(const std::string& error)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_errors.push_back(error);
+}
+
+void TaskGroup::done()
+{
+    // Decrements that can't complete the group are lock-free.  The final one
+    // is made under the lock, so a waiter that sees the count reach zero can
+    // synchronize with us before the group is destroyed.
+    std::size_t current(m_outstanding.load());
+
+    while (current > 1)
+    {
+        if (m_outstanding.compare_exchange_weak(current, current - 1))
+        {
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_outstanding.fetch_sub(1) == 1) m_cv.notify_all();
+}
+
+Scheduler::Scheduler(const std::size_t numThreads, Init init)
+    : m_numThreads(std::max<std::size_t>(numThreads, 1))
+    , m_init(std::move(init))
+{
+    resize(m_numThreads);
+}
+
+Scheduler::~Scheduler()
+{
+    stop();
+}
+
+void Scheduler::resize(const std::size_t numThreads)
+{
+    if (running())
+    {
+        throw std::runtime_error("Cannot resize a running Scheduler");
+    }
+
+    // Any tasks still queued (added while stopped) move to the new workers.
+    std::vector<Job> leftover;
+    for (auto& worker : m_workers)
+    {
+        for (auto& job : worker->jobs) leftover.push_back(std::move(job));
+    }
+
+    m_numThreads = std::max<std::size_t>(numThreads, 1);
+    m_workers.clear();
+
+    for (std::size_t i(0); i < m_numThreads; ++i)
+    {
+        m_workers.emplace_back(new Worker());
+    }
+
+    for (std::size_t i(0); i < leftover.size(); ++i)
+    {
+        m_workers[i % m_numThreads]->jobs.push_back(std::move(leftover[i]));
+    }
+}
+
+void Scheduler::start()
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    if (running()) return;
+
+    m_stopping = false;
+    m_running = true;
+
+    for (std::size_t i(0); i < m_numThreads; ++i)
+    {
+        m_threads.emplace_back([this, i]() { work(i); });
+    }
+}
+
+void Scheduler::stop()
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    if (!running()) return;
+
+    m_running = false;
+
+    {
+        std::lock_guard<std::mutex> sleepLock(m_sleepMutex);
+        m_stopping = true;
+    }
+
+    m_sleepCv.notify_all();
+
+    {
+        std::lock_guard<std::mutex> produceLock(m_produceMutex);
+        m_produceCv.notify_all();
+    }
+
+    for (auto& t : m_threads) t.join();
+    m_threads.clear();
+}
+
+bool Scheduler::isWorker() const
+{
+    return currentScheduler == this;
+}
+
+void Scheduler::push(Job&& job)
+{
+    m_all.add();
+    if (job.group) job.group->add();
+
+    // Workers push onto their own deque, where they'll pop it LIFO while it's
+    // still cache-hot.  Everyone else spreads tasks across the workers.
+    const std::size_t index(
+            isWorker() ?
+                currentIndex :
+                m_next.fetch_add(1, std::memory_order_relaxed) % m_numThreads);
+
+    Worker& worker(*m_workers[index]);
+
+    {
+        SpinGuard lock(worker.spinner, dequeSite);
+        worker.jobs.push_back(std::move(job));
+        m_pending.fetch_add(1);
+    }
+
+    if (m_sleeping.load())
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_sleepCv.notify_one();
+    }
+}
+
+void Scheduler::pushBounded(Job&& job, const std::size_t maxPending)
+{
+    std::unique_lock<std::mutex> lock(m_produceMutex);
+
+    if (m_pending.load() >= maxPending)
+    {
+        m_producing.fetch_add(1);
+        m_produceCv.wait(lock, [this, maxPending]()
+        {
+            return m_pending.load() < maxPending || !running();
+        });
+        m_producing.fetch_sub(1);
+    }
+
+    push(std::move(job));
+}
+
+bool Scheduler::take(const std::size_t index, Job& job)
+{
+    Worker& worker(*m_workers[index]);
+
+    SpinGuard lock(worker.spinner, dequeSite);
+    if (worker.jobs.empty()) return false;
+
+    job = std::move(worker.jobs.back());
+    worker.jobs.pop_back();
+    m_pending.fetch_sub(1);
+    return true;
+}
+
+bool Scheduler::steal(const std::size_t thief, Job& job)
+{
+    for (std::size_t i(1); i < m_numThreads; ++i)
+    {
+        Worker& victim(*m_workers[(thief + i) % m_numThreads]);
+
+        SpinGuard lock(victim.spinner, dequeSite);
+        if (victim.jobs.empty()) continue;
+
+        job = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+        m_pending.fetch_sub(1);
+        return true;
+    }
+
+    return false;
+}
+
+bool Scheduler::runOne()
+{
+    Job job;
+
+    if (take(currentIndex, job) || steal(currentIndex, job))
+    {
+        run(job);
+        return true;
+    }
+
+    return false;
+}
+
+void Scheduler::run(Job& job)
+{
+    if (m_producing.load())
+    {
+        std::lock_guard<std::mutex> lock(m_produceMutex);
+        m_produceCv.notify_all();
+    }
+
+    std::string err;
+    try { job.task(); }
+    catch (std::exception& e) { err = e.what(); }
+    catch (...) { err = "Unknown error"; }
+
+    // Release any captured state before signaling completion, since a waiter
+    // may destroy things that the task refers to as soon as it wakes.
+    job.task.reset();
+
+    if (err.size())
+    {
+        std::cout << "Exception in pool task: " << err << std::endl;
+        m_all.fail(err);
+        if (job.group) job.group->fail(err);
+    }
+
+    if (job.group) job.group->done();
+    m_all.done();
+}
+
+void Scheduler::awaitCapacity(const std::size_t maxPending)
+{
+    if (isWorker() || m_pending.load() < maxPending) return;
+
+    std::unique_lock<std::mutex> lock(m_produceMutex);
+    m_producing.fetch_add(1);
+    m_produceCv.wait(lock, [this, maxPending]()
+    {
+        return m_pending.load() < maxPending || !running();
+    });
+    m_producing.fetch_sub(1);
+}
+
+void Scheduler::work(const std::size_t index)
+{
+    currentScheduler = this;
+    currentIndex = index;
+
+    if (m_init) m_init(index);
+
+    Job job;
+
+    while (true)
+    {
+        bool found(false);
+        Backoff backoff;
+
+        for (std::size_t i(0); !found && i < idleRounds; ++i)
+        {
+            found = take(index, job) || steal(index, job);
+            if (!found) backoff.pause();
+        }
+
+        if (found)
+        {
+            run(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+
+        m_sleeping.fetch_add(1);
+        m_sleepCv.wait(lock, [this]()
+        {
+            return m_pending.load() || m_stopping.load();
+        });
+        m_sleeping.fetch_sub(1);
+
+        if (m_stopping.load() && !m_pending.load()) break;
+    }
+
+    currentScheduler = nullptr;
+}
+
+} // namespace entwine
+
@@ -0,0 +1,194 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <entwine/util/spin-lock.hpp>
+#include <entwine/util/task.hpp>
+
+namespace entwine
+{
+
+class Scheduler;
+
+// A set of tasks which may be awaited together, independently of any other
+// tasks running on the same Scheduler.  Tasks may be added to a group while
+// another thread is waiting on it - the wait completes once the group's
+// outstanding count reaches zero.
+class TaskGroup
+{
+    friend class Scheduler;
+
+public:
+    TaskGroup() = default;
+
+    // Block until every task added to this group has completed.  If called
+    // from a Scheduler worker thread, the caller runs queued tasks while it
+    // waits rather than blocking, so nested waits can't starve the pool.
+    void wait();
+
+    std::size_t outstanding() const { return m_outstanding.load(); }
+
+    // Not thread-safe, the group should be awaited before calling.
+    const std::vector<std::string>& errors() const { return m_errors; }
+
+private:
+    void add() { m_outstanding.fetch_add(1); }
+    void fail(const std::string& error);
+    void done();
+
+    std::atomic<std::size_t> m_outstanding = { 0 };
+    std::vector<std::string> m_errors;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+};
+
+// A work-stealing task scheduler.  Each worker owns a deque of tasks: it
+// pushes and pops its own tasks at the back, and when it runs dry it steals
+// from the front of another worker's deque.  Tasks added from outside of the
+// workers are distributed round-robin.  Idle workers park on a condition
+// variable rather than spinning.
+class Scheduler
+{
+    friend class TaskGroup;
+
+public:
+    // Called on each worker thread as it starts, with the worker's index.
+    using Init = std::function<void(std::size_t index)>;
+
+    explicit Scheduler(std::size_t numThreads, Init init = Init());
+    ~Scheduler();
+
+    // Start worker threads.  No-op if already running.
+    void start();
+
+    // Wait for all queued and running tasks to complete, then join the
+    // worker threads.  Tasks may not be added until start() is called again.
+    void stop();
+
+    // Not thread-safe.  The scheduler must be stopped.
+    void resize(std::size_t numThreads);
+
+    bool running() const { return m_running.load(); }
+    std::size_t numThreads() const { return m_numThreads; }
+
+    // Tasks that have been added but not yet started.
+    std::size_t pending() const { return m_pending.load(); }
+
+    // Queue a task, which counts toward the given group (if any) as well as
+    // toward await() for this scheduler.
+    template<typename Fn>
+    void add(Fn&& f, TaskGroup* group = nullptr)
+    {
+        push(Job(Task(std::forward<Fn>(f)), group));
+    }
+
+    // As above, but if called from outside of our workers, first block until
+    // fewer than maxPending tasks are waiting to be started.  The check and
+    // the insertion are made under one lock, so concurrent producers can't
+    // overshoot the bound together.
+    template<typename Fn>
+    void add(Fn&& f, TaskGroup* group, std::size_t maxPending)
+    {
+        Job job(Task(std::forward<Fn>(f)), group);
+        if (isWorker()) push(std::move(job));
+        else pushBounded(std::move(job), maxPending);
+    }
+
+    // Wait for all tasks added to this scheduler to complete.
+    void await() { m_all.wait(); }
+
+    // Block the calling thread until fewer than maxPending tasks are waiting
+    // to be started.  Returns immediately if called from one of our workers.
+    void awaitCapacity(std::size_t maxPending);
+
+    // True if the calling thread is one of this scheduler's workers.
+    bool isWorker() const;
+
+    // Errors from all tasks since construction.  Not thread-safe - the
+    // scheduler should be awaited or stopped before calling.
+    const std::vector<std::string>& errors() const { return m_all.errors(); }
+
+private:
+    struct Job
+    {
+        Job() : task(), group(nullptr) { }
+        Job(Task&& task, TaskGroup* group)
+            : task(std::move(task))
+            , group(group)
+        { }
+
+        Task task;
+        TaskGroup* group;
+    };
+
+    struct Worker
+    {
+        SpinLock spinner;
+        std::deque<Job> jobs;
+    };
+
+    void push(Job&& job);
+    void pushBounded(Job&& job, std::size_t maxPending);
+
+    // Pop from our own deque, or steal from another.
+    bool take(std::size_t index, Job& job);
+    bool steal(std::size_t thief, Job& job);
+
+    // Run a single queued task if one is available.  Used by waiting workers.
+    bool runOne();
+
+    void run(Job& job);
+    void work(std::size_t index);
+
+    std::size_t m_numThreads;
+    const Init m_init;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+
+    std::atomic<bool> m_running = { false };
+    std::atomic<bool> m_stopping = { false };
+    std::atomic<std::size_t> m_pending = { 0 };
+    std::atomic<std::size_t> m_next = { 0 };
+
+    // Parking for idle workers.
+    std::atomic<std::size_t> m_sleeping = { 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCv;
+
+    // Parking for producers waiting on awaitCapacity().
+    std::atomic<std::size_t> m_producing = { 0 };
+    std::mutex m_produceMutex;
+    std::condition_variable m_produceCv;
+
+    std::mutex m_stateMutex;
+    TaskGroup m_all;
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+};
+
+} // namespace entwine
+
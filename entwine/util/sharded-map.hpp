@@ -0,0 +1,196 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <entwine/util/spin-lock.hpp>
+
+namespace entwine
+{
+
+// A hash map split into independently locked shards, so that threads
+// operating on different keys rarely contend.  Values are never moved once
+// created, so references returned from get() and at() remain valid until the
+// map is cleared or destroyed, and may be used without holding any lock.
+//
+// Chunk slots are created once and kept for the lifetime of the build, but
+// entries may be erased individually, which invalidates references to that
+// value only.
+template<typename K, typename V, typename Hash = std::hash<K>>
+class ShardedMap
+{
+public:
+    explicit ShardedMap(
+            std::size_t numShards = 64,
+            LockSite& site = LockSite::unnamed())
+        : m_bits(log2Ceil(numShards))
+        , m_shards(std::size_t(1) << m_bits)
+        , m_hash()
+        , m_site(site)
+    { }
+
+    // Get the value for this key, default-constructing it if necessary.
+    V& get(const K& key)
+    {
+        const std::size_t h(m_hash(key));
+        Shard& shard(m_shards[shardIndex(h)]);
+
+        SpinGuard lock(shard.spinner, m_site);
+        return shard.map[key];
+    }
+
+    // Throws std::out_of_range if the key does not exist.
+    V& at(const K& key)
+    {
+        if (V* v = find(key)) return *v;
+        throw std::out_of_range("Key not found in ShardedMap");
+    }
+
+    const V& at(const K& key) const
+    {
+        if (const V* v = find(key)) return *v;
+        throw std::out_of_range("Key not found in ShardedMap");
+    }
+
+    // Returns nullptr if the key does not exist.
+    V* find(const K& key)
+    {
+        const ShardedMap& self(*this);
+        return const_cast<V*>(self.find(key));
+    }
+
+    const V* find(const K& key) const
+    {
+        const std::size_t h(m_hash(key));
+        const Shard& shard(m_shards[shardIndex(h)]);
+
+        SpinGuard lock(shard.spinner, m_site);
+        const auto it(shard.map.find(key));
+        return it != shard.map.end() ? &it->second : nullptr;
+    }
+
+    std::size_t count(const K& key) const { return find(key) ? 1 : 0; }
+
+    // Returns the number of entries erased, which is zero or one.
+    std::size_t erase(const K& key)
+    {
+        const std::size_t h(m_hash(key));
+        Shard& shard(m_shards[shardIndex(h)]);
+
+        SpinGuard lock(shard.spinner, m_site);
+        return shard.map.erase(key);
+    }
+
+    std::size_t size() const
+    {
+        std::size_t result(0);
+
+        for (const Shard& shard : m_shards)
+        {
+            SpinGuard lock(shard.spinner, m_site);
+            result += shard.map.size();
+        }
+
+        return result;
+    }
+
+    bool empty() const { return !size(); }
+    std::size_t numShards() const { return m_shards.size(); }
+
+    // Call op(const K&, V&) for each entry, in no particular order.  Each
+    // shard is snapshotted under its lock, but op is called with no locks
+    // held, so it may safely access this map.  Entries inserted concurrently
+    // with the iteration may or may not be visited.
+    template<typename Op>
+    void forEach(Op op)
+    {
+        for (Shard& shard : m_shards)
+        {
+            for (const auto& p : snapshot(shard)) op(*p.first, *p.second);
+        }
+    }
+
+    template<typename Op>
+    void forEach(Op op) const
+    {
+        for (const Shard& shard : m_shards)
+        {
+            for (const auto& p : snapshot(const_cast<Shard&>(shard)))
+            {
+                op(*p.first, static_cast<const V&>(*p.second));
+            }
+        }
+    }
+
+    // Not thread-safe.
+    void clear()
+    {
+        for (Shard& shard : m_shards) shard.map.clear();
+    }
+
+private:
+    struct Shard
+    {
+        mutable SpinLock spinner;
+        std::unordered_map<K, V, Hash> map;
+
+        // Keep neighbouring shards' locks off of each other's cache lines.
+        char padding[64];
+    };
+
+    using Entries = std::vector<std::pair<const K*, V*>>;
+
+    Entries snapshot(Shard& shard) const
+    {
+        Entries entries;
+
+        SpinGuard lock(shard.spinner, m_site);
+        entries.reserve(shard.map.size());
+        for (auto& p : shard.map) entries.emplace_back(&p.first, &p.second);
+
+        return entries;
+    }
+
+    // The low bits of the hash choose the bucket within a shard's map, so
+    // select the shard from a remix of the high bits to keep them independent.
+    std::size_t shardIndex(const std::size_t h) const
+    {
+        if (!m_bits) return 0;
+        return (static_cast<uint64_t>(h) * 0x9e3779b97f4a7c15ULL) >>
+            (64 - m_bits);
+    }
+
+    static std::size_t log2Ceil(std::size_t n)
+    {
+        std::size_t bits(0);
+        while ((std::size_t(1) << bits) < n) ++bits;
+        return bits;
+    }
+
+    const std::size_t m_bits;
+    std::vector<Shard> m_shards;
+    Hash m_hash;
+    LockSite& m_site;
+
+    ShardedMap(const ShardedMap&) = delete;
+    ShardedMap& operator=(const ShardedMap&) = delete;
+};
+
+} // namespace entwine
+
@@ -0,0 +1,215 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/spin-lock.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace entwine
+{
+
+namespace
+{
+    std::mutex& registryMutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    std::vector<LockSite*>& registry()
+    {
+        static std::vector<LockSite*> sites;
+        return sites;
+    }
+
+    std::atomic<std::size_t> nextStripe(0);
+
+    void park(std::atomic<uint32_t>& state, const uint32_t expected)
+    {
+#ifdef __linux__
+        // Sleeps only if the state still equals the expected value, so a
+        // release between our exchange and this call can't be missed.
+        syscall(
+                SYS_futex,
+                reinterpret_cast<uint32_t*>(&state),
+                FUTEX_WAIT_PRIVATE,
+                expected,
+                nullptr,
+                nullptr,
+                0);
+#else
+        (void)state;
+        (void)expected;
+        std::this_thread::yield();
+#endif
+    }
+
+    void unpark(std::atomic<uint32_t>& state)
+    {
+#ifdef __linux__
+        syscall(
+                SYS_futex,
+                reinterpret_cast<uint32_t*>(&state),
+                FUTEX_WAKE_PRIVATE,
+                1,
+                nullptr,
+                nullptr,
+                0);
+#else
+        (void)state;
+#endif
+    }
+}
+
+std::atomic<bool> LockSite::s_enabled(false);
+LockSite LockSite::s_unnamed("(unnamed)");
+
+LockSite::LockSite(std::string name)
+    : m_name(name)
+    , m_stripes()
+{
+    std::lock_guard<std::mutex> lock(registryMutex());
+    registry().push_back(this);
+}
+
+void LockSite::clear()
+{
+    for (Counters& c : m_stripes)
+    {
+        c.acquisitions.store(0);
+        c.contended.store(0);
+        c.spins.store(0);
+        c.parks.store(0);
+    }
+}
+
+std::size_t LockSite::stripe()
+{
+    static thread_local const std::size_t index(
+            nextStripe.fetch_add(1, std::memory_order_relaxed) % numStripes);
+    return index;
+}
+
+void LockSite::report(std::ostream& os)
+{
+    std::vector<const LockSite*> sites;
+
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        for (const LockSite* site : registry())
+        {
+            if (site->acquisitions()) sites.push_back(site);
+        }
+    }
+
+    std::sort(
+            sites.begin(),
+            sites.end(),
+            [](const LockSite* a, const LockSite* b)
+            {
+                return a->contended() > b->contended();
+            });
+
+    os << "Lock contention:\n";
+
+    if (sites.empty())
+    {
+        os << "\t(no acquisitions recorded)" << std::endl;
+        return;
+    }
+
+    os << "\t" <<
+        std::left << std::setw(24) << "Site" << std::right <<
+        std::setw(16) << "Acquired" <<
+        std::setw(16) << "Contended" <<
+        std::setw(10) << "%" <<
+        std::setw(16) << "Spins" <<
+        std::setw(12) << "Parks" << "\n";
+
+    for (const LockSite* site : sites)
+    {
+        const uint64_t acquisitions(site->acquisitions());
+        const uint64_t contended(site->contended());
+
+        os << "\t" <<
+            std::left << std::setw(24) << site->name() << std::right <<
+            std::setw(16) << acquisitions <<
+            std::setw(16) << contended <<
+            std::setw(10) << std::fixed << std::setprecision(3) <<
+                100.0 * contended / acquisitions <<
+            std::setw(16) << site->spins() <<
+            std::setw(12) << site->parks() << "\n";
+    }
+
+    os << std::endl;
+}
+
+void SpinLock::lockSlow(LockSite& site)
+{
+    Backoff backoff;
+    std::size_t spins(0);
+    std::size_t parks(0);
+    uint32_t expected(0);
+
+    // Spin while the lock is held without parked waiters - if it's released
+    // soon, we avoid the syscalls on both sides.
+    for (std::size_t round(0); round < maxSpinRounds(); ++round)
+    {
+        expected = m_state.load(std::memory_order_relaxed);
+
+        if (expected == 0)
+        {
+            if (m_state.compare_exchange_weak(
+                        expected,
+                        1,
+                        std::memory_order_acquire,
+                        std::memory_order_relaxed))
+            {
+                if (LockSite::enabled()) site.record(true, spins);
+                return;
+            }
+        }
+        else if (expected == 2)
+        {
+            // Others are already parked, so queue up behind them.
+            break;
+        }
+
+        spins += backoff.pause();
+    }
+
+    // Mark the lock as having waiters and park until it's released.  Since
+    // we can't know whether other waiters remain once we acquire it, we
+    // leave it in the contended state so our release wakes one of them.
+    while (m_state.exchange(2, std::memory_order_acquire) != 0)
+    {
+        park(m_state, 2);
+        ++parks;
+    }
+
+    if (LockSite::enabled()) site.record(true, spins, parks);
+}
+
+void SpinLock::wake()
+{
+    unpark(m_state);
+}
+
+} // namespace entwine
+
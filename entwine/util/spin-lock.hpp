@@ -10,49 +10,149 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
-#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
 
 namespace entwine
 {
 
-class SpinLock
+// Exponential backoff for spin-waiting.  Each call to pause() waits for twice
+// as many CPU pause instructions as the previous call, up to a ceiling, after
+// which the remainder of the thread's time slice is yielded instead.
+class Backoff
 {
-    friend class SpinGuard;
-    friend class UniqueSpin;
-
 public:
-    SpinLock() = default;
+    Backoff() : m_count(1) { }
 
-private:
-    std::mutex m_mutex;
-    std::mutex& mutex() { return m_mutex; }
+    // Returns the number of pause instructions issued, or zero if the thread
+    // yielded instead.
+    std::size_t pause()
+    {
+        if (m_count <= maxPauses())
+        {
+            const std::size_t count(m_count);
+            for (std::size_t i(0); i < count; ++i) relax();
+            m_count <<= 1;
+            return count;
+        }
+        else
+        {
+            std::this_thread::yield();
+            return 0;
+        }
+    }
 
-    SpinLock(const SpinLock& other) = delete;
-};
+    void reset() { m_count = 1; }
 
-class SpinGuard
-{
-public:
-    SpinGuard(SpinLock& m) : m_lock(m.mutex()) { }
+    static void relax()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield" ::: "memory");
+#endif
+    }
 
 private:
-    std::lock_guard<std::mutex> m_lock;
+    static constexpr std::size_t maxPauses() { return 64; }
+
+    std::size_t m_count;
 };
 
-class UniqueSpin
+// Contention counters for a single lock site - a place in the code at which a
+// lock is taken.  Counting is disabled by default, in which case the only cost
+// is a single relaxed load per acquisition.  When enabled via
+// LockSite::enable(), each acquisition increments a thread-striped counter so
+// the counters themselves don't become a source of contention.
+class LockSite
 {
 public:
-    UniqueSpin(SpinLock& m) : m_lock(m.mutex()) { }
+    // Sites must have static storage duration - they are registered globally
+    // for the lifetime of the process.
+    explicit LockSite(std::string name);
+
+    const std::string& name() const { return m_name; }
+
+    // Called for every acquisition when counting is enabled.  Spins are
+    // measured in pause instructions.
+    void record(bool contended, std::size_t spins = 0, std::size_t parks = 0)
+    {
+        Counters& c(m_stripes[stripe()]);
+        c.acquisitions.fetch_add(1, std::memory_order_relaxed);
+
+        if (contended)
+        {
+            c.contended.fetch_add(1, std::memory_order_relaxed);
+            c.spins.fetch_add(spins, std::memory_order_relaxed);
+            c.parks.fetch_add(parks, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t acquisitions() const { return sum(&Counters::acquisitions); }
+    uint64_t contended() const { return sum(&Counters::contended); }
+    uint64_t spins() const { return sum(&Counters::spins); }
+    uint64_t parks() const { return sum(&Counters::parks); }
 
-    void lock() { m_lock.lock(); }
-    void unlock() { m_lock.unlock(); }
+    void clear();
+
+    static bool enabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    static void enable(bool on = true) { s_enabled.store(on); }
+
+    // Write a table of the counters for every site that has been used.
+    static void report(std::ostream& os);
+
+    // Counts acquisitions for which no more specific site was supplied.
+    static LockSite& unnamed() { return s_unnamed; }
 
 private:
-    std::unique_lock<std::mutex> m_lock;
+    struct alignas(64) Counters
+    {
+        std::atomic<uint64_t> acquisitions = { 0 };
+        std::atomic<uint64_t> contended = { 0 };
+        std::atomic<uint64_t> spins = { 0 };
+        std::atomic<uint64_t> parks = { 0 };
+    };
+
+    static constexpr std::size_t numStripes = 16;
+    static std::size_t stripe();
+
+    uint64_t sum(std::atomic<uint64_t> Counters::*field) const
+    {
+        uint64_t total(0);
+        for (const Counters& c : m_stripes)
+        {
+            total += (c.*field).load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    LockSite(const LockSite&) = delete;
+    LockSite& operator=(const LockSite&) = delete;
+
+    const std::string m_name;
+    std::array<Counters, numStripes> m_stripes;
+
+    static std::atomic<bool> s_enabled;
+    static LockSite s_unnamed;
 };
 
-/*
+// An adaptive lock.  Acquisition first tries a single CAS, then spins with
+// exponential backoff for a short while, and finally parks the thread in the
+// kernel (a futex on Linux) until the holder releases it.  Uncontended
+// acquisition and release are each a single atomic operation, and the lock
+// occupies four bytes.
+//
+// The state is 0 when unlocked, 1 when locked with no parked waiters, and 2
+// when locked with possible parked waiters.
 class SpinLock
 {
     friend class SpinGuard;
@@ -62,10 +162,36 @@ public:
     SpinLock() = default;
 
 private:
-    void lock() { while (m_flag.test_and_set()) ; }
-    void unlock() { m_flag.clear(); }
+    void lock(LockSite& site)
+    {
+        uint32_t expected(0);
+        if (m_state.compare_exchange_strong(
+                    expected,
+                    1,
+                    std::memory_order_acquire,
+                    std::memory_order_relaxed))
+        {
+            if (LockSite::enabled()) site.record(false);
+        }
+        else
+        {
+            lockSlow(site);
+        }
+    }
+
+    void unlock()
+    {
+        if (m_state.exchange(0, std::memory_order_release) == 2) wake();
+    }
+
+    void lockSlow(LockSite& site);
+    void wake();
+
+    // Backoff rounds to spend spinning before parking.  The first seven
+    // rounds pause for 127 instructions in total, the rest yield.
+    static constexpr std::size_t maxSpinRounds() { return 10; }
 
-    std::atomic_flag m_flag = ATOMIC_FLAG_INIT;
+    std::atomic<uint32_t> m_state = { 0 };
 
     SpinLock(const SpinLock& other) = delete;
 };
@@ -73,33 +199,45 @@ private:
 class SpinGuard
 {
 public:
-    SpinGuard(SpinLock& m) : m_spinner(m) { m_spinner.lock(); }
+    SpinGuard(SpinLock& m, LockSite& site = LockSite::unnamed())
+        : m_spinner(m)
+    {
+        m_spinner.lock(site);
+    }
+
     ~SpinGuard() { m_spinner.unlock(); }
 
 private:
     SpinLock& m_spinner;
+
+    SpinGuard(const SpinGuard&) = delete;
+    SpinGuard& operator=(const SpinGuard&) = delete;
 };
 
 class UniqueSpin
 {
 public:
-    UniqueSpin(SpinLock& m)
+    UniqueSpin(SpinLock& m, LockSite& site = LockSite::unnamed())
         : m_spinner(m)
+        , m_site(site)
         , m_locked(true)
     {
-        m_spinner.lock();
+        m_spinner.lock(m_site);
     }
 
     ~UniqueSpin() { if (m_locked) m_spinner.unlock(); }
 
-    void lock() { m_spinner.lock(); m_locked = true; }  // Undefined if locked.
+    void lock() { m_spinner.lock(m_site); m_locked = true; } // UB if locked.
     void unlock() { m_spinner.unlock(); m_locked = false; }
 
 private:
     SpinLock& m_spinner;
+    LockSite& m_site;
     bool m_locked;
+
+    UniqueSpin(const UniqueSpin&) = delete;
+    UniqueSpin& operator=(const UniqueSpin&) = delete;
 };
-*/
 
 } // namespace entwine
 
@@ -0,0 +1,182 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace entwine
+{
+
+namespace detail
+{
+    constexpr std::size_t taskInlineSize(64);
+
+    template<typename Fn>
+    struct TaskStoredInline : std::integral_constant<
+        bool,
+        sizeof(Fn) <= taskInlineSize &&
+        alignof(Fn) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible<Fn>::value>
+    { };
+}
+
+// A move-only, type-erased void() callable.  Unlike std::function, callables
+// of up to inlineSize() bytes are stored inline, so constructing a Task from a
+// typical lambda performs no heap allocation.  Larger callables are still
+// accepted, but are heap-allocated.
+class Task
+{
+public:
+    Task() noexcept : m_ops(nullptr) { }
+
+    template<
+        typename Fn,
+        typename = typename std::enable_if<
+            !std::is_same<typename std::decay<Fn>::type, Task>::value>::type>
+    Task(Fn&& f)
+        : m_ops(&Ops<typename std::decay<Fn>::type>::table)
+    {
+        Ops<typename std::decay<Fn>::type>::create(
+                storage(),
+                std::forward<Fn>(f));
+    }
+
+    Task(Task&& other) noexcept : m_ops(other.m_ops)
+    {
+        if (m_ops)
+        {
+            m_ops->move(other.storage(), storage());
+            other.m_ops = nullptr;
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+
+            if ((m_ops = other.m_ops))
+            {
+                m_ops->move(other.storage(), storage());
+                other.m_ops = nullptr;
+            }
+        }
+
+        return *this;
+    }
+
+    ~Task() { reset(); }
+
+    void operator()() { m_ops->invoke(storage()); }
+    explicit operator bool() const { return m_ops != nullptr; }
+
+    void reset()
+    {
+        if (m_ops)
+        {
+            m_ops->destroy(storage());
+            m_ops = nullptr;
+        }
+    }
+
+    static constexpr std::size_t inlineSize()
+    {
+        return detail::taskInlineSize;
+    }
+
+    template<typename Fn>
+    static constexpr bool storedInline()
+    {
+        return detail::TaskStoredInline<Fn>::value;
+    }
+
+private:
+    struct Table
+    {
+        void (*invoke)(void*);
+        void (*move)(void* src, void* dst);
+        void (*destroy)(void*);
+    };
+
+    template<typename Fn, bool Inline = detail::TaskStoredInline<Fn>::value>
+    struct Ops;
+
+    void* storage() { return &m_storage; }
+
+    const Table* m_ops;
+    typename std::aligned_storage<
+        detail::taskInlineSize,
+        alignof(std::max_align_t)>::type m_storage;
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+};
+
+template<typename Fn>
+struct Task::Ops<Fn, true>
+{
+    template<typename T>
+    static void create(void* p, T&& f) { new (p) Fn(std::forward<T>(f)); }
+
+    static void invoke(void* p) { (*static_cast<Fn*>(p))(); }
+
+    static void move(void* src, void* dst)
+    {
+        new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+        static_cast<Fn*>(src)->~Fn();
+    }
+
+    static void destroy(void* p) { static_cast<Fn*>(p)->~Fn(); }
+
+    static const Table table;
+};
+
+template<typename Fn>
+struct Task::Ops<Fn, false>
+{
+    template<typename T>
+    static void create(void* p, T&& f)
+    {
+        *static_cast<Fn**>(p) = new Fn(std::forward<T>(f));
+    }
+
+    static void invoke(void* p) { (**static_cast<Fn**>(p))(); }
+
+    static void move(void* src, void* dst)
+    {
+        *static_cast<Fn**>(dst) = *static_cast<Fn**>(src);
+    }
+
+    static void destroy(void* p) { delete *static_cast<Fn**>(p); }
+
+    static const Table table;
+};
+
+template<typename Fn>
+const Task::Table Task::Ops<Fn, true>::table = {
+    &Task::Ops<Fn, true>::invoke,
+    &Task::Ops<Fn, true>::move,
+    &Task::Ops<Fn, true>::destroy
+};
+
+template<typename Fn>
+const Task::Table Task::Ops<Fn, false>::table = {
+    &Task::Ops<Fn, false>::invoke,
+    &Task::Ops<Fn, false>::move,
+    &Task::Ops<Fn, false>::destroy
+};
+
+} // namespace entwine
+
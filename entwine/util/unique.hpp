@@ -12,6 +12,8 @@
 
 #include <memory>
 
+#include <json/json.h>
+
 namespace entwine
 {
 
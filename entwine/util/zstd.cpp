@@ -0,0 +1,127 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/compression.hpp>
+
+#include <zstd.h>
+
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+constexpr int Compression::zstdLevel;
+
+namespace
+{
+
+void check(const std::size_t code)
+{
+    if (ZSTD_isError(code))
+    {
+        throw std::runtime_error(
+                std::string("Zstd error: ") + ZSTD_getErrorName(code));
+    }
+}
+
+// Contexts hold their working memory between frames, which saves reallocating
+// it for every column of every chunk.
+class Contexts
+{
+public:
+    Contexts() : m_c(ZSTD_createCCtx()), m_d(ZSTD_createDCtx())
+    {
+        if (!m_c || !m_d) throw std::runtime_error("Zstd allocation failed");
+    }
+
+    ~Contexts()
+    {
+        ZSTD_freeCCtx(m_c);
+        ZSTD_freeDCtx(m_d);
+    }
+
+    ZSTD_CCtx* c() { return m_c; }
+    ZSTD_DCtx* d() { return m_d; }
+
+private:
+    ZSTD_CCtx* m_c;
+    ZSTD_DCtx* m_d;
+};
+
+Contexts& contexts()
+{
+    thread_local Contexts local;
+    return local;
+}
+
+} // unnamed namespace
+
+std::unique_ptr<std::vector<char>> Compression::compressZstd(
+        const std::vector<char>& in,
+        const int level)
+{
+    auto out(makeUnique<std::vector<char>>());
+    compressZstd(in.data(), in.size(), *out, level);
+    return out;
+}
+
+std::unique_ptr<std::vector<char>> Compression::decompressZstd(
+        const std::vector<char>& in)
+{
+    const auto size(ZSTD_getFrameContentSize(in.data(), in.size()));
+
+    if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN)
+    {
+        throw std::runtime_error("Invalid zstd frame");
+    }
+
+    auto out(makeUnique<std::vector<char>>(size));
+    decompressZstd(in.data(), in.size(), out->data(), out->size());
+    return out;
+}
+
+std::size_t Compression::compressZstd(
+        const char* data,
+        const std::size_t size,
+        std::vector<char>& out,
+        const int level)
+{
+    const std::size_t begin(out.size());
+    out.resize(begin + ZSTD_compressBound(size));
+
+    const std::size_t written(
+            ZSTD_compressCCtx(
+                contexts().c(),
+                out.data() + begin,
+                out.size() - begin,
+                data,
+                size,
+                level));
+
+    check(written);
+    out.resize(begin + written);
+    return written;
+}
+
+void Compression::decompressZstd(
+        const char* data,
+        const std::size_t size,
+        char* out,
+        const std::size_t outSize)
+{
+    const std::size_t read(
+            ZSTD_decompressDCtx(contexts().d(), out, outSize, data, size));
+
+    check(read);
+    if (read != outSize) throw std::runtime_error("Invalid zstd frame size");
+}
+
+} // namespace entwine
+
@@ -10,8 +10,10 @@
 
 #include "entwine.hpp"
 
+#include <cctype>
 #include <chrono>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <string>
 
@@ -20,6 +22,7 @@
 #include <entwine/tree/builder.hpp>
 #include <entwine/tree/chunk.hpp>
 #include <entwine/tree/config-parser.hpp>
+#include <entwine/tree/serializer.hpp>
 #include <entwine/tree/thread-pools.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/metadata.hpp>
@@ -30,6 +33,8 @@
 #include <entwine/types/subset.hpp>
 #include <entwine/util/json.hpp>
 #include <entwine/util/matrix.hpp>
+#include <entwine/util/numa.hpp>
+#include <entwine/util/spin-lock.hpp>
 
 using namespace entwine;
 
@@ -102,7 +107,16 @@ namespace
 
             "\t-c <storage compression-type>\n"
             "\t\tSet data storage type.  Valid value: 'binary', 'laszip',\n"
-            "\t\tor 'lazperf'.\n\n"
+            "\t\t'lazperf', or 'zstd'.\n\n"
+
+            "\t-P\n"
+            "\t\tPack data chunks into a small number of large archive\n"
+            "\t\tfiles, rather than writing each chunk as its own file.\n\n"
+
+            "\t-q\n"
+            "\t\tStore XYZ values of binary and lazperf chunks relative to\n"
+            "\t\ttheir chunk bounds, in as few bytes as they require.  Only\n"
+            "\t\tapplies to scaled output.\n\n"
 
             "\t-n\n"
             "\t\tIf set, absolute positioning will be used, even if values\n"
@@ -125,7 +139,18 @@ namespace
             "\t\tTransformation matrix.\n\n"
 
             "\t-d <density>\n"
-            "\t\tDensity estimate, in points per square unit\n\n";
+            "\t\tDensity estimate, in points per square unit\n\n"
+
+            "\t-N (<nodes>)\n"
+            "\t\tNUMA mode: keep per-node point pools and pin worker\n"
+            "\t\tthreads to nodes.  If a node count is given that differs\n"
+            "\t\tfrom the machine's topology, that many nodes are emulated\n"
+            "\t\tby splitting the available CPUs evenly.\n\n"
+
+            "\t-l\n"
+            "\t\tCount lock acquisitions and contention per lock site, and\n"
+            "\t\tprint a summary, along with the hit rate of each thread's\n"
+            "\t\tpoint pool cache, when the build completes.\n\n";
     }
 
     std::string getDimensionString(const Schema& schema)
@@ -182,6 +207,42 @@ namespace
             return "(none)";
         }
     }
+
+    template<typename Pool>
+    void reportMagazines(const std::string& name, const Pool& pool)
+    {
+        for (const auto& s : pool.magazineStats())
+        {
+            std::cout << "\t" <<
+                std::left << std::setw(24) <<
+                    (name + " " + std::to_string(s.slot)) <<
+                std::right <<
+                std::setw(16) << commify(s.hits + s.misses) <<
+                std::setw(10) << std::fixed << std::setprecision(2) <<
+                    s.hitRate() * 100.0 << "\n";
+        }
+    }
+
+    void reportPools(const Builder& builder)
+    {
+        std::cout << "Pool magazines:\n" <<
+            "\t" << std::left << std::setw(24) << "Pool/thread" <<
+            std::right <<
+            std::setw(16) << "Acquired" <<
+            std::setw(10) << "Hit %" << "\n";
+
+        const auto& pools(builder.pointPools());
+        for (std::size_t i(0); i < pools.size(); ++i)
+        {
+            const std::string suffix(
+                    pools.size() > 1 ? "[" + std::to_string(i) + "]" : "");
+
+            reportMagazines("Data" + suffix, pools[i]->dataPool());
+            reportMagazines("Cell" + suffix, pools[i]->cellPool());
+        }
+
+        std::cout << std::endl;
+    }
 }
 
 void Kernel::build(std::vector<std::string> args)
@@ -205,6 +266,7 @@ void Kernel::build(std::vector<std::string> args)
     entwine::arbiter::Arbiter localArbiter;
 
     std::size_t a(0);
+    bool lockStats(false);
 
     if (args[0].front() != '-')
     {
@@ -285,7 +347,21 @@ void Kernel::build(std::vector<std::string> args)
             else error("Invalid bounds: " + str);
         }
         else if (arg == "-f") { json["force"] = true; }
+        else if (arg == "-l") { lockStats = true; }
+        else if (arg == "-N")
+        {
+            if (a + 1 < args.size() && std::isdigit(args[a + 1].front()))
+            {
+                json["numa"] = Json::UInt64(std::stoul(args[++a]));
+            }
+            else
+            {
+                json["numa"] = true;
+            }
+        }
         else if (arg == "-x") { json["trustHeaders"] = false; }
+        else if (arg == "-P") { json["archive"] = true; }
+        else if (arg == "-q") { json["quantize"] = true; }
         else if (arg == "-n") { json["absolute"] = true; }
         else if (arg == "-e") { json["arbiter"]["s3"]["sse"] = true; }
         else if (arg == "-h")
@@ -501,11 +577,23 @@ void Kernel::build(std::vector<std::string> args)
         "\tThreads: " << threadPools.size() <<
         std::endl;
 
+    const Serializer& serializer(builder->serializer());
+    std::cout <<
+        "\tSerialization threads: " << serializer.encodeThreads() <<
+        " encode, " << serializer.ioThreads() << " I/O, queue size " <<
+        serializer.queueSize() << std::endl;
+
+    if (const Numa* numa = builder->numa())
+    {
+        std::cout << "\tNUMA: " << numa->toString() << std::endl;
+    }
+
     std::cout <<
         "Output:\n" <<
         "\tOutput path: " << outPath << "\n" <<
         "\tData storage: " << toString(storage.chunkStorageType()) <<
-        std::endl;
+        (storage.archive() ? " (archived)" : "") <<
+        (storage.quantize() ? " (quantized)" : "") << std::endl;
 
     if (const auto* delta = metadata.delta())
     {
@@ -555,6 +643,8 @@ void Kernel::build(std::vector<std::string> args)
 
     std::cout << std::endl;
 
+    LockSite::enable(lockStats);
+
     auto start = now();
     const std::size_t alreadyInserted(manifest.pointStats().inserts());
 
@@ -589,5 +679,12 @@ void Kernel::build(std::vector<std::string> args)
         "\t\tOverflow past max depth: " <<
             commify(stats.overflows()) << "\n" <<
         std::endl;
-}
 
+    builder->serializer().report(std::cout);
+
+    if (lockStats)
+    {
+        LockSite::report(std::cout);
+        reportPools(*builder);
+    }
+}
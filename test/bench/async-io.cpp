@@ -0,0 +1,198 @@
+// Saves and then loads a set of chunk-sized files in a local directory, with
+// blocking I/O on a pool of threads as the serializer's I/O pool performs it,
+// and through AsyncIo with its thread fallback and with io_uring, if
+// available.  Each run submits from the given number of threads.  Loads are
+// likely to be served from the page cache - drop caches between runs to
+// measure the device instead.
+//
+// Usage: bench-async-io [directory] [chunks] [bytes] [threads]
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/util/async-io.hpp>
+#include <entwine/util/io.hpp>
+#include <entwine/util/pool.hpp>
+#include <entwine/util/time.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    struct Result
+    {
+        double saveSecs = 0;
+        double loadSecs = 0;
+        bool ok = true;
+    };
+
+    template<typename Op>
+    double time(Op op)
+    {
+        const auto start(now());
+        op();
+        return since<std::chrono::microseconds>(start) / 1e6;
+    }
+
+    std::string name(const std::size_t i)
+    {
+        return "bench-async-io-" + std::to_string(i);
+    }
+
+    Result blocking(
+            const arbiter::Endpoint& ep,
+            const std::size_t chunks,
+            const std::vector<char>& data,
+            const std::size_t threads)
+    {
+        Result result;
+        std::atomic_size_t good(0);
+
+        result.saveSecs = time([&]()
+        {
+            Pool pool(threads, threads);
+            for (std::size_t i(0); i < chunks; ++i)
+            {
+                pool.add([&, i]() { io::ensurePut(ep, name(i), data); });
+            }
+        });
+
+        result.loadSecs = time([&]()
+        {
+            Pool pool(threads, threads);
+            for (std::size_t i(0); i < chunks; ++i)
+            {
+                pool.add([&, i]()
+                {
+                    if (io::ensureGet(ep, name(i))->size() == data.size())
+                    {
+                        ++good;
+                    }
+                });
+            }
+        });
+
+        result.ok = good == chunks;
+        return result;
+    }
+
+    Result async(
+            AsyncIo& io,
+            const arbiter::Endpoint& ep,
+            const std::size_t chunks,
+            const std::vector<char>& data,
+            const std::size_t threads)
+    {
+        Result result;
+        std::atomic_size_t good(0);
+
+        result.saveSecs = time([&]()
+        {
+            Pool pool(threads, threads);
+            for (std::size_t i(0); i < chunks; ++i)
+            {
+                pool.add([&, i]()
+                {
+                    io.write(
+                            ep.fullPath(name(i)),
+                            data.data(),
+                            data.size(),
+                            [&good](bool ok) { if (ok) ++good; });
+                });
+            }
+            pool.join();
+            io.await();
+        });
+
+        result.loadSecs = time([&]()
+        {
+            Pool pool(threads, threads);
+            for (std::size_t i(0); i < chunks; ++i)
+            {
+                pool.add([&, i]()
+                {
+                    io.read(
+                            ep.fullPath(name(i)),
+                            [&](std::unique_ptr<AsyncIo::Data> d)
+                            {
+                                if (d && d->size() == data.size()) ++good;
+                            });
+                });
+            }
+            pool.join();
+            io.await();
+        });
+
+        result.ok = good == 2 * chunks;
+        return result;
+    }
+
+    void report(
+            const std::string& mode,
+            const Result& r,
+            const std::size_t chunks,
+            const std::size_t bytes)
+    {
+        const double mb(chunks * bytes / 1024.0 / 1024.0);
+
+        std::cout << "\t" << std::left << std::setw(10) << mode <<
+            std::right <<
+            std::setw(10) << chunks / r.saveSecs << " saves/s" <<
+            std::setw(10) << mb / r.saveSecs << " MB/s" <<
+            std::setw(10) << chunks / r.loadSecs << " loads/s" <<
+            std::setw(10) << mb / r.loadSecs << " MB/s" <<
+            (r.ok ? "" : "  (FAILED)") << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::string dir(argc > 1 ? argv[1] : ".");
+    const std::size_t chunks(argc > 2 ? std::atol(argv[2]) : 100000);
+    const std::size_t bytes(argc > 3 ? std::atol(argv[3]) : 4096);
+    const std::size_t threads(argc > 4 ? std::atol(argv[4]) : 4);
+
+    arbiter::Arbiter a;
+    const arbiter::Endpoint ep(a.getEndpoint(dir));
+
+    std::vector<char> data(bytes);
+    for (std::size_t i(0); i < bytes; ++i) data[i] = i * 31;
+
+    AsyncIo threaded(256, false);
+    AsyncIo uring(256);
+
+    std::cout << "Chunks: " << chunks << " of " << bytes << " bytes, " <<
+        threads << " submitting threads, io_uring: " <<
+        (uring.uring() ? "yes" : "no") << std::endl;
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    const Result b(blocking(ep, chunks, data, threads));
+    report("Blocking", b, chunks, bytes);
+
+    const Result t(async(threaded, ep, chunks, data, threads));
+    report("Threads", t, chunks, bytes);
+
+    bool ok(b.ok && t.ok);
+
+    if (uring.uring())
+    {
+        const Result u(async(uring, ep, chunks, data, threads));
+        report("io_uring", u, chunks, bytes);
+        ok = ok && u.ok;
+    }
+
+    for (std::size_t i(0); i < chunks; ++i)
+    {
+        std::remove(ep.fullPath(name(i)).c_str());
+    }
+
+    return ok ? 0 : 1;
+}
+
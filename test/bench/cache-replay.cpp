@@ -0,0 +1,299 @@
+// Replays a trace of chunk reservations through the reader Cache with each
+// eviction policy, reporting the hits, misses, and evictions of each, and the
+// time taken.  Chunks are fetched by the cache's FetchPool from copies of an
+// existing index in a local directory, one copy per reader path of the trace,
+// so the replay goes through the same sharding, fetching, and holding of
+// chunks as queries do.  Each reservation is held until the given number of
+// later reservations have been made, as a query holds a block while fetching
+// the next.
+//
+// A trace has one reservation per line: <reader path> <chunk id>.  Chunks not
+// in the index are skipped.  If no trace is given, one is generated: viewers
+// repeatedly reading the shallow chunks of a few datasets, skewed toward the
+// shallowest, interrupted now and then by a large query streaming through the
+// deep chunks of one of them.
+//
+// Usage: bench-cache-replay <index> [capacity MB] [held] [trace]
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <entwine/reader/cache.hpp>
+#include <entwine/reader/eviction.hpp>
+#include <entwine/reader/query-chunk-state.hpp>
+#include <entwine/reader/reader.hpp>
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/dir.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/types/structure.hpp>
+#include <entwine/util/time.hpp>
+#include <entwine/util/unique.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    struct Access
+    {
+        std::string path;
+        Id id;
+    };
+
+    using Trace = std::vector<Access>;
+
+    const std::size_t mb(1024 * 1024);
+    const std::size_t fetchThreads(8);
+
+    const std::string root(
+            arbiter::fs::getTempPath() + "entwine-bench-cache-replay/");
+
+    // Every cold chunk of the index, in ascending Id order.
+    void collect(
+            const Reader& reader,
+            const QueryChunkState& c,
+            std::map<Id, FetchInfo>& fetches)
+    {
+        if (c.depth() >= reader.metadata().structure().coldDepthBegin())
+        {
+            if (!reader.exists(c)) return;
+            fetches.emplace(
+                    c.chunkId(),
+                    FetchInfo(reader, c.chunkId(), c.bounds(), c.depth()));
+        }
+
+        if (c.allDirections())
+        {
+            for (std::size_t i(0); i < dirHalfEnd(); ++i)
+            {
+                collect(reader, c.getClimb(toDir(i)), fetches);
+            }
+        }
+        else collect(reader, c.getClimb(), fetches);
+    }
+
+    std::map<Id, FetchInfo> collect(const Reader& reader)
+    {
+        std::map<Id, FetchInfo> fetches;
+        const Metadata& metadata(reader.metadata());
+        collect(
+                reader,
+                QueryChunkState(
+                    metadata.structure(),
+                    metadata.boundsScaledCubic()),
+                fetches);
+        return fetches;
+    }
+
+    Trace read(const std::string& path)
+    {
+        Trace trace;
+        std::ifstream file(path);
+
+        std::string name;
+        std::string id;
+
+        while (file >> name >> id) trace.push_back(Access { name, Id(id) });
+
+        return trace;
+    }
+
+    Trace generate(const std::vector<Id>& ids)
+    {
+        Trace trace;
+        std::mt19937 gen(42);
+
+        const std::vector<std::string> paths { "a", "b", "c" };
+        const std::size_t shallow(std::min<std::size_t>(300, ids.size() / 2));
+        std::uniform_int_distribution<std::size_t> path(0, paths.size() - 1);
+
+        // Zipf-like weights over the shallow chunks.
+        std::vector<double> weights;
+        for (std::size_t i(0); i < shallow; ++i)
+        {
+            weights.push_back(1.0 / (i + 1));
+        }
+
+        std::discrete_distribution<std::size_t> popular(
+                weights.begin(),
+                weights.end());
+
+        for (std::size_t round(0); round < 40; ++round)
+        {
+            for (std::size_t i(0); i < 2000; ++i)
+            {
+                trace.push_back(Access { paths[path(gen)], ids[popular(gen)] });
+            }
+
+            if (round % 4 == 3)
+            {
+                const std::string& scanned(paths[path(gen)]);
+                for (std::size_t i(shallow); i < ids.size(); ++i)
+                {
+                    trace.push_back(Access { scanned, ids[i] });
+                }
+            }
+        }
+
+        return trace;
+    }
+
+    // A local copy of the index for each reader path of the trace.
+    std::set<std::string> copy(const std::string& index, const Trace& trace)
+    {
+        std::set<std::string> paths;
+        for (const Access& access : trace) paths.insert(access.path);
+
+        arbiter::Arbiter a;
+        for (const std::string& path : paths)
+        {
+            if (!arbiter::fs::mkdirp(root + path))
+            {
+                throw std::runtime_error("Could not create " + root + path);
+            }
+
+            if (a.resolve(root + path + "/**").empty())
+            {
+                a.copy(index + "/", root + path + "/");
+            }
+        }
+
+        return paths;
+    }
+
+    void replay(
+            const Trace& trace,
+            const std::set<std::string>& paths,
+            const EvictionType type,
+            const std::size_t capacity,
+            const std::size_t held)
+    {
+        Cache cache(capacity, fetchThreads, type);
+
+        std::map<std::string, std::unique_ptr<Reader>> readers;
+        std::map<std::string, std::map<Id, FetchInfo>> fetches;
+
+        for (const std::string& path : paths)
+        {
+            auto& reader(readers[path]);
+            reader = makeUnique<Reader>(root + path, root + "tmp", cache);
+            fetches.emplace(path, collect(*reader));
+        }
+
+        std::deque<std::unique_ptr<Block>> blocks;
+        std::size_t skipped(0);
+
+        const auto start(now());
+
+        for (const Access& a : trace)
+        {
+            const auto& chunks(fetches.at(a.path));
+            const auto it(chunks.find(a.id));
+            if (it == chunks.end())
+            {
+                ++skipped;
+                continue;
+            }
+
+            blocks.push_back(
+                    cache.acquire(
+                        readers.at(a.path)->path(),
+                        FetchInfoSet { it->second }));
+
+            while (blocks.size() > held) blocks.pop_front();
+        }
+
+        blocks.clear();
+
+        const double secs(since<std::chrono::milliseconds>(start) / 1000.0);
+
+        CacheStats total;
+        for (const auto& p : readers)
+        {
+            const CacheStats stats(cache.stats(p.second->path()));
+            total.hits += stats.hits;
+            total.misses += stats.misses;
+            total.evictions += stats.evictions;
+        }
+
+        const std::size_t reserved(total.hits + total.misses);
+
+        std::cout << "\t" << std::left << std::setw(10) << toString(type) <<
+            std::right <<
+            std::setw(6) << (reserved ? 100.0 * total.hits / reserved : 0) <<
+            "% hits" <<
+            std::setw(8) << total.misses << " misses" <<
+            std::setw(8) << total.evictions << " evictions" <<
+            std::setw(8) << secs << " s" <<
+            (skipped ? "  (" + std::to_string(skipped) + " skipped)" : "") <<
+            std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout <<
+            "Usage: bench-cache-replay <index> [capacity MB] [held] [trace]" <<
+            std::endl;
+        return 1;
+    }
+
+    const std::string index(argv[1]);
+    const std::size_t capacity((argc > 2 ? std::atol(argv[2]) : 256) * mb);
+    const std::size_t held(argc > 3 ? std::max(std::atol(argv[3]), 1L) : 1);
+
+    arbiter::fs::mkdirp(root + "tmp");
+
+    Trace trace;
+    if (argc > 4)
+    {
+        trace = read(argv[4]);
+    }
+    else
+    {
+        // Generated over the chunks of the index itself.
+        Cache cache(0);
+        Reader reader(index, root + "tmp", cache);
+
+        std::vector<Id> ids;
+        for (const auto& p : collect(reader)) ids.push_back(p.first);
+        if (ids.size() < 2)
+        {
+            throw std::runtime_error("Too few cold chunks in " + index);
+        }
+
+        trace = generate(ids);
+    }
+
+    const std::set<std::string> paths(copy(index, trace));
+
+    std::cout << "Reservations: " << trace.size() << "\tCapacity: " <<
+        capacity / mb << " MB\tHeld: " << held << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    const std::vector<EvictionType> types {
+        EvictionType::Lru,
+        EvictionType::TwoQueue,
+        EvictionType::TinyLfu
+    };
+
+    for (const EvictionType type : types)
+    {
+        replay(trace, paths, type, capacity, held);
+    }
+
+    return 0;
+}
@@ -0,0 +1,290 @@
+// Compares zstd columnar chunks against lazperf: compression ratio, and encode
+// and decode throughput, on a single thread.  Points are generated in process
+// in the same way as the ellipsoid test data (see test/data), scaled to 0.01,
+// and split into chunks by the octree cells at the given depth.  Uncompressed
+// binary records are reported as a baseline.  Lazperf compression is that of
+// Compression::compress, which Entwine always builds with.
+//
+// Usage: bench-chunk-storage [points] [depth]
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/chunk-storage/zstd.hpp>
+#include <entwine/types/dir.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/util/compression.hpp>
+#include <entwine/util/time.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using DimId = pdal::Dimension::Id;
+    using DimType = pdal::Dimension::Type;
+
+    const double pi(std::acos(-1));
+    const double scale(0.01);
+    const Point radius(150, 100, 50);
+
+    // The ellipsoid dimensions, with XYZ scaled.
+    const Schema schema(DimList {
+        DimInfo("X", DimId::X, DimType::Signed32),
+        DimInfo("Y", DimId::Y, DimType::Signed32),
+        DimInfo("Z", DimId::Z, DimType::Signed32),
+        DimInfo("Intensity", DimId::Intensity, DimType::Unsigned16),
+        DimInfo("ReturnNumber", DimId::ReturnNumber, DimType::Unsigned8),
+        DimInfo(
+                "NumberOfReturns",
+                DimId::NumberOfReturns,
+                DimType::Unsigned8),
+        DimInfo(
+                "EdgeOfFlightLine",
+                DimId::EdgeOfFlightLine,
+                DimType::Unsigned8),
+        DimInfo("Classification", DimId::Classification, DimType::Unsigned8),
+        DimInfo("ScanAngleRank", DimId::ScanAngleRank, DimType::Float),
+        DimInfo("PointSourceId", DimId::PointSourceId, DimType::Unsigned16),
+        DimInfo("GpsTime", DimId::GpsTime, DimType::Double),
+        DimInfo("Red", DimId::Red, DimType::Unsigned16),
+        DimInfo("Green", DimId::Green, DimType::Unsigned16),
+        DimInfo("Blue", DimId::Blue, DimType::Unsigned16)
+    });
+
+    class Writer
+    {
+    public:
+        explicit Writer(std::vector<char>& data) : m_data(data) { }
+
+        template<typename T>
+        Writer& operator<<(const T v)
+        {
+            const char* pos(reinterpret_cast<const char*>(&v));
+            m_data.insert(m_data.end(), pos, pos + sizeof(T));
+            return *this;
+        }
+
+    private:
+        std::vector<char>& m_data;
+    };
+
+    struct ChunkData
+    {
+        Bounds bounds;
+        std::vector<char> data;
+    };
+
+    // Mirrors addCartesian in test/data/generate-ellipsoid.cpp.
+    void add(
+            const Point& p,
+            const std::size_t t,
+            const std::size_t depth,
+            std::map<std::size_t, ChunkData>& chunks)
+    {
+        const int32_t xyz[3] = {
+            static_cast<int32_t>(std::llround(p.x * radius.x / scale)),
+            static_cast<int32_t>(std::llround(p.y * radius.y / scale)),
+            static_cast<int32_t>(std::llround(p.z * radius.z / scale))
+        };
+
+        // Chunks split the scaled cube which contains the ellipsoid.
+        const double half(radius.x / scale);
+        const double width(2 * half / (1 << depth));
+
+        std::size_t index(0);
+        Point min;
+        for (std::size_t i(0); i < 3; ++i)
+        {
+            const std::size_t cell(
+                    std::min<std::size_t>(
+                        (xyz[i] + half) / width,
+                        (1 << depth) - 1));
+
+            index = (index << depth) + cell;
+            min[i] = -half + cell * width;
+        }
+
+        ChunkData& chunk(chunks[index]);
+        chunk.bounds = Bounds(min, min + width);
+
+        double r(std::max({ p.y, -p.x, -p.z, 0.0 }));
+        double g(std::max({ p.x, -p.y, -p.z, 0.0 }));
+        double b(std::max({ p.z, -p.y, -p.x, 0.0 }));
+
+        const double xyMag(std::sqrt(p.x * p.x + p.y * p.y));
+        uint8_t cl(xyMag < 0.25 ? 2 : xyMag < 0.5 ? 3 : xyMag < 0.75 ? 4 : 5);
+        if (p.z < 0) cl += 13;
+
+        const int s((p.x >= 0) + (p.y >= 0) + (p.z >= 0));
+
+        Writer(chunk.data) << xyz[0] << xyz[1] << xyz[2] <<
+            static_cast<uint16_t>(s % 2 ? 255 : 128) <<
+            static_cast<uint8_t>(p.z >= 0 ? 1 : 2) <<
+            static_cast<uint8_t>(2) <<
+            static_cast<uint8_t>(xyMag >= 0.95) <<
+            cl <<
+            static_cast<float>(45.0 * p.x) <<
+            static_cast<uint16_t>(toIntegral(getDirection(Point(), p))) <<
+            (42.0 + t * .00001) <<
+            static_cast<uint16_t>(r * 255) <<
+            static_cast<uint16_t>(g * 255) <<
+            static_cast<uint16_t>(b * 255);
+    }
+
+    std::map<std::size_t, ChunkData> generate(
+            const std::size_t n,
+            const std::size_t depth)
+    {
+        std::map<std::size_t, ChunkData> chunks;
+        std::size_t t(0);
+
+        const double area(4 * pi / n);
+        const double distance(std::sqrt(area));
+        const double mTheta(std::round(pi / distance));
+        const double dTheta(pi / mTheta);
+        const double dPhi(area / dTheta);
+
+        for (std::size_t m(0); m < mTheta; ++m)
+        {
+            const double theta(pi * (m + 0.5) / mTheta);
+            const double mPhi(std::round(2 * pi * std::sin(theta) / dPhi));
+
+            for (std::size_t i(0); i < mPhi; ++i)
+            {
+                const double phi(2 * pi * i / mPhi);
+                const Point p(
+                        std::sin(theta) * std::cos(phi),
+                        std::sin(theta) * std::sin(phi),
+                        std::cos(theta));
+
+                add(p, t++, depth, chunks);
+            }
+        }
+
+        return chunks;
+    }
+
+    struct Result
+    {
+        std::size_t bytes = 0;
+        double encodeSecs = 0;
+        double decodeSecs = 0;
+    };
+
+    template<typename Op>
+    double time(Op op)
+    {
+        const auto start(now());
+        op();
+        return since<std::chrono::microseconds>(start) / 1e6;
+    }
+
+    void report(
+            const std::string& name,
+            const Result& r,
+            const std::size_t rawBytes,
+            const std::size_t numPoints)
+    {
+        std::cout << "\t" << std::left << std::setw(10) << name <<
+            std::right <<
+            std::setw(8) << static_cast<double>(rawBytes) / r.bytes <<
+            " ratio" <<
+            std::setw(10) << numPoints / r.encodeSecs / 1e6 <<
+            " Mpt/s encode" <<
+            std::setw(10) << numPoints / r.decodeSecs / 1e6 <<
+            " Mpt/s decode" << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t n(argc > 1 ? std::atol(argv[1]) : 1 << 20);
+    const std::size_t depth(argc > 2 ? std::atol(argv[2]) : 2);
+
+    const std::map<std::size_t, ChunkData> chunks(generate(n, depth));
+    const std::size_t pointSize(schema.pointSize());
+
+    std::size_t numPoints(0);
+    std::size_t rawBytes(0);
+    for (const auto& p : chunks)
+    {
+        numPoints += p.second.data.size() / pointSize;
+        rawBytes += p.second.data.size();
+    }
+
+    Result binary;
+    Result zstd;
+    Result lazperf;
+    bool match(true);
+
+    for (const auto& p : chunks)
+    {
+        const ChunkData& chunk(p.second);
+        const std::vector<char>& data(chunk.data);
+        const std::size_t np(data.size() / pointSize);
+
+        std::vector<char> copied;
+        binary.encodeSecs += time([&]() { copied = data; });
+        binary.bytes += copied.size();
+
+        std::vector<char> copiedBack;
+        binary.decodeSecs += time([&]() { copiedBack = copied; });
+        match = match && copiedBack == data;
+
+        std::vector<char> packed;
+        zstd.encodeSecs += time([&]()
+        {
+            packed = ZstdStorage::pack(schema, chunk.bounds, data.data(), np);
+        });
+        zstd.bytes += packed.size();
+
+        std::vector<char> unpacked;
+        zstd.decodeSecs += time([&]()
+        {
+            unpacked = ZstdStorage::unpack(
+                    schema,
+                    packed.data(),
+                    packed.size());
+        });
+        match = match && unpacked == data;
+
+        std::unique_ptr<std::vector<char>> compressed;
+        lazperf.encodeSecs += time([&]()
+        {
+            compressed = Compression::compress(data, schema);
+        });
+        lazperf.bytes += compressed->size();
+
+        std::unique_ptr<std::vector<char>> decompressed;
+        lazperf.decodeSecs += time([&]()
+        {
+            decompressed = Compression::decompress(*compressed, schema, np);
+        });
+        match = match && *decompressed == data;
+    }
+
+    std::cout << "Points: " << numPoints << ", chunks: " << chunks.size() <<
+        ", point size: " << pointSize << std::endl;
+
+    std::cout << std::fixed << std::setprecision(2);
+    report("binary:", binary, rawBytes, numPoints);
+    report("zstd:", zstd, rawBytes, numPoints);
+    report("lazperf:", lazperf, rawBytes, numPoints);
+
+    if (!match)
+    {
+        std::cout << "Round trip mismatch" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,140 @@
+// Compares per-point PointState climbing against batched Descent paths, on a
+// single thread.  Usage: bench-descent [points] [depth]
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <json/json.h>
+
+#include <entwine/tree/climber.hpp>
+#include <entwine/tree/descent.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/structure.hpp>
+#include <entwine/util/time.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const Bounds bounds(0, 0, 0, 1024, 1024, 1024);
+
+    // Sum some results so the work can't be optimized out.
+    std::size_t checksum(const PointState& state)
+    {
+        return state.tick() + std::hash<Id>()(state.index());
+    }
+
+    template<typename Op>
+    double time(Op op)
+    {
+        const auto start(now());
+        op();
+        return since<std::chrono::microseconds>(start) / 1e6;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t n(argc > 1 ? std::atol(argv[1]) : 1 << 20);
+    const std::size_t depth(
+            std::min<std::size_t>(
+                argc > 2 ? std::atol(argv[2]) : 10,
+                Descent::maxLevels()));
+
+    Json::Value json;
+    json["nullDepth"] = 0;
+    json["baseDepth"] = depth;
+    json["coldDepth"] = 0;
+    json["pointsPerChunk"] = 262144;
+    json["numPointsHint"] = Json::UInt64(1ULL << 32);
+    const Structure structure(json);
+
+    std::vector<double> x(n), y(n), z(n);
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(0, 1024);
+
+    for (std::size_t i(0); i < n; ++i)
+    {
+        x[i] = dist(gen);
+        y[i] = dist(gen);
+        z[i] = dist(gen);
+    }
+
+    std::vector<Descent::Path> paths(n);
+    std::size_t sum(0);
+
+    const double climbSecs(time([&]()
+    {
+        PointState state(structure, bounds);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            state.reset();
+            state.climbTo(Point(x[i], y[i], z[i]), depth);
+            sum += checksum(state);
+        }
+    }));
+
+    // As the Builder does, paths only cover the levels above the nominal
+    // chunk depth, and the per-level climb finishes the descent.
+    const std::size_t levels(Descent::levels(structure, depth));
+
+    auto descend([&](bool vectorized)
+    {
+        return time([&]()
+        {
+            if (vectorized)
+            {
+                Descent::paths(
+                        x.data(), y.data(), z.data(),
+                        n, bounds, levels, paths.data());
+            }
+            else
+            {
+                Descent::pathsScalar(
+                        x.data(), y.data(), z.data(),
+                        n, bounds, levels, paths.data());
+            }
+
+            PointState state(structure, bounds);
+
+            for (std::size_t i(0); i < n; ++i)
+            {
+                const Point point(x[i], y[i], z[i]);
+
+                state.reset();
+                state.climb(point, paths[i], levels);
+                state.climbTo(point, depth);
+                sum += checksum(state);
+            }
+        });
+    });
+
+    const double scalarSecs(descend(false));
+    const double vectorSecs(descend(true));
+
+    const double pathOnlySecs(time([&]()
+    {
+        Descent::paths(
+                x.data(), y.data(), z.data(),
+                n, bounds, levels, paths.data());
+    }));
+
+    std::cout <<
+        "Points: " << n << ", depth: " << depth << ", path levels: " <<
+        levels << ", vectorized: " <<
+        (Descent::vectorized() ? "yes" : "no") << " (checksum " << sum <<
+        ")" << std::endl;
+
+    std::cout << std::fixed << std::setprecision(2) <<
+        "\tPer-point climb:       " << n / climbSecs / 1e6 << " Mpt/s\n" <<
+        "\tScalar paths + climb:  " << n / scalarSecs / 1e6 << " Mpt/s\n" <<
+        "\tVector paths + climb:  " << n / vectorSecs / 1e6 << " Mpt/s\n" <<
+        "\tVector paths only:     " << n / pathOnlySecs / 1e6 << " Mpt/s" <<
+        std::endl;
+
+    return 0;
+}
@@ -0,0 +1,261 @@
+// Compares LZMA and zstd, at several levels, for hierarchy blocks: compression
+// ratio, and encode and decode throughput, on a single thread.  zstd is only
+// compared if Entwine was built with it.  Blocks are
+// generated in process as runs of sparse tubes with a few ticks each, and
+// counted into sparse HierarchyBlocks in both the words and compact formats.
+// Encoding is timed through HierarchyBlock::save, to a local directory, and
+// decoding through HierarchyBlock::create of a read-only block from the saved
+// data.  Throughput is measured against the uncompressed size, as saved
+// without compression.
+//
+// Usage: bench-hierarchy-compression [blocks] [tubes]
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/tree/hierarchy-block.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/types/storage.hpp>
+#include <entwine/types/structure.hpp>
+#include <entwine/util/time.hpp>
+#include <entwine/util/unique.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using DimId = pdal::Dimension::Id;
+    using DimType = pdal::Dimension::Type;
+
+    struct Entry
+    {
+        uint64_t tube;
+        uint64_t tick;
+        uint64_t count;
+    };
+
+    using Cells = std::vector<Entry>;
+
+    // With 256 points per chunk and a mapped depth of 6, blocks from this Id
+    // onward are sparse.
+    const Id sparseId(1365);
+    const Id sparsePoints(Id(1) << 100);
+
+    // Sorted by tube and then tick, as blocks are written.  Counts shrink
+    // with tick, like those of a tube spanning the top of a surface.
+    Cells generate(std::mt19937& gen, const std::size_t tubes)
+    {
+        Cells cells;
+
+        std::geometric_distribution<uint64_t> gap(0.3);
+        std::uniform_int_distribution<uint64_t> ticks(1, 4);
+        std::uniform_int_distribution<uint64_t> base(8, 60000);
+
+        uint64_t tube(0);
+        for (std::size_t i(0); i < tubes; ++i)
+        {
+            tube += 1 + gap(gen);
+            uint64_t tick(gap(gen));
+            uint64_t count(base(gen));
+
+            for (uint64_t t(ticks(gen)); t; --t)
+            {
+                cells.push_back(Entry{ tube, tick, count });
+                tick += 1 + gap(gen);
+                count = count / 4 + 1;
+            }
+        }
+
+        return cells;
+    }
+
+    struct Codec
+    {
+        std::string name;
+        int level;
+    };
+
+    std::unique_ptr<Metadata> makeMetadata(
+            const std::string& format,
+            const Codec& codec)
+    {
+        Json::Value structure;
+        structure["nullDepth"] = 0;
+        structure["baseDepth"] = 4;
+        structure["coldDepth"] = 0;
+        structure["pointsPerChunk"] = 256;
+        structure["mappedDepth"] = 6;
+        structure["sparseDepth"] = 8;
+
+        const Schema schema(DimList {
+                DimInfo("X", DimId::X, DimType::Double),
+                DimInfo("Y", DimId::Y, DimType::Double),
+                DimInfo("Z", DimId::Z, DimType::Double) });
+
+        const Bounds bounds(0, 0, 0, 64, 64, 64);
+
+        Json::Value json;
+        json["bounds"] = bounds.toJson();
+        json["boundsConforming"] = bounds.toJson();
+        json["schema"] = schema.toJson();
+        json["structure"] = structure;
+        json["hierarchyStructure"] = structure;
+        json["storage"] = "binary";
+        json["compressHierarchy"] = codec.name;
+        if (codec.level) json["compressHierarchyLevel"] = codec.level;
+        json["hierarchyFormat"] = format;
+        json["version"] = currentVersion().toString();
+
+        return makeUnique<Metadata>(json);
+    }
+
+    class Bench
+    {
+    public:
+        Bench(const std::vector<Cells>& blocks)
+            : m_blocks(blocks)
+            , m_arbiter()
+            , m_out(m_arbiter.getEndpoint(
+                        arbiter::fs::getTempPath() +
+                        "entwine-bench-hierarchy-compression/"))
+            , m_pool(4096)
+        {
+            arbiter::fs::mkdirp(m_out.root());
+        }
+
+        void run(const std::string& format, const std::vector<Codec>& codecs)
+        {
+            std::size_t raw(0);
+            for (const Cells& cells : m_blocks)
+            {
+                raw += save(*makeMetadata(format, { "none", 0 }), cells).size();
+            }
+
+            const double mb(raw / 1024.0 / 1024.0);
+            std::cout << format << ": " << mb << " MB" << std::endl;
+
+            for (const Codec& codec : codecs)
+            {
+                const auto metadata(makeMetadata(format, codec));
+
+                std::size_t size(0);
+                double encodeSecs(0);
+                double decodeSecs(0);
+                bool valid(true);
+
+                for (const Cells& cells : m_blocks)
+                {
+                    const std::vector<char> data(
+                            save(*metadata, cells, &encodeSecs));
+                    size += data.size();
+
+                    const auto start(now());
+                    auto block(
+                            HierarchyBlock::create(
+                                m_pool,
+                                *metadata,
+                                sparseId,
+                                &m_out,
+                                sparsePoints,
+                                data,
+                                true));
+                    decodeSecs += since<std::chrono::microseconds>(start) / 1e6;
+
+                    const Entry& last(cells.back());
+                    valid = valid &&
+                        block->get(sparseId + last.tube, last.tick) ==
+                            last.count;
+                }
+
+                const std::string label(
+                        codec.level ?
+                            codec.name + " " + std::to_string(codec.level) :
+                            codec.name);
+
+                std::cout << "\t" << std::left << std::setw(10) << label <<
+                    std::right <<
+                    std::setw(8) << static_cast<double>(raw) / size << "x" <<
+                    std::setw(10) << mb / encodeSecs << " MB/s encode" <<
+                    std::setw(10) << mb / decodeSecs << " MB/s decode" <<
+                    (valid ? "" : "  (FAILED)") << std::endl;
+            }
+        }
+
+    private:
+        // Counts the cells into a new block, and saves it, returning the
+        // saved data.  If given, the time taken by the save is added to secs.
+        std::vector<char> save(
+                const Metadata& metadata,
+                const Cells& cells,
+                double* secs = nullptr)
+        {
+            auto block(
+                    HierarchyBlock::create(
+                        m_pool,
+                        metadata,
+                        sparseId,
+                        &m_out,
+                        sparsePoints));
+
+            for (const Entry& c : cells)
+            {
+                block->count(sparseId + c.tube, c.tick, c.count);
+            }
+
+            const auto start(now());
+            block->save(m_out);
+            if (secs) *secs += since<std::chrono::microseconds>(start) / 1e6;
+
+            return m_out.getBinary(sparseId.str());
+        }
+
+        const std::vector<Cells>& m_blocks;
+
+        arbiter::Arbiter m_arbiter;
+        arbiter::Endpoint m_out;
+        HierarchyCell::Pool m_pool;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t numBlocks(argc > 1 ? std::atol(argv[1]) : 20);
+    const std::size_t tubes(argc > 2 ? std::atol(argv[2]) : 20000);
+
+    std::mt19937 gen(42);
+
+    std::vector<Cells> blocks;
+    for (std::size_t i(0); i < numBlocks; ++i)
+    {
+        blocks.push_back(generate(gen, tubes));
+    }
+
+    const std::vector<Codec> codecs {
+        { "lzma", 0 },
+#ifdef ENTWINE_HAVE_ZSTD
+        { "zstd", 1 },
+        { "zstd", 3 },
+        { "zstd", 9 },
+        { "zstd", 19 }
+#endif
+    };
+
+    std::cout << "Blocks: " << numBlocks << " of " << tubes << " tubes" <<
+        std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    Bench bench(blocks);
+    bench.run("words", codecs);
+    bench.run("compact", codecs);
+
+    return 0;
+}
@@ -0,0 +1,323 @@
+// Compares the pooled Cell layout against PointColumns for the bulk passes
+// over a chunk where PointColumns is used: deserialization, and descending
+// every point.  The pooled cells are shuffled first, as they are after a
+// build has churned through the pools for a while.
+//
+// Alongside throughput, each pass reports hardware cache misses where
+// perf_event_open is permitted, and otherwise the number of non-sequential
+// cache line transitions per point - accesses which the prefetcher can't
+// predict - as a proxy.
+//
+// Usage: bench-point-columns [points] [depth]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <entwine/tree/descent.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/point-columns.hpp>
+#include <entwine/types/point-pool.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/util/time.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using DimId = pdal::Dimension::Id;
+    using DimType = pdal::Dimension::Type;
+
+    const Bounds bounds(0, 0, 0, 1 << 20, 1 << 20, 1 << 20);
+
+    // A typical scaled schema: 32-bit XYZ followed by LAS-like attributes.
+    const Schema schema(DimList {
+        DimInfo("X", DimId::X, DimType::Signed32),
+        DimInfo("Y", DimId::Y, DimType::Signed32),
+        DimInfo("Z", DimId::Z, DimType::Signed32),
+        DimInfo("Intensity", DimId::Intensity, DimType::Unsigned16),
+        DimInfo("ReturnNumber", DimId::ReturnNumber, DimType::Unsigned8),
+        DimInfo(
+                "NumberOfReturns",
+                DimId::NumberOfReturns,
+                DimType::Unsigned8),
+        DimInfo("Classification", DimId::Classification, DimType::Unsigned8),
+        DimInfo("PointSourceId", DimId::PointSourceId, DimType::Unsigned16),
+        DimInfo("GpsTime", DimId::GpsTime, DimType::Double),
+        DimInfo("Red", DimId::Red, DimType::Unsigned16),
+        DimInfo("Green", DimId::Green, DimType::Unsigned16),
+        DimInfo("Blue", DimId::Blue, DimType::Unsigned16)
+    });
+
+    class Misses
+    {
+    public:
+        Misses() : m_fd(-1)
+        {
+#ifdef __linux__
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            m_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+        }
+
+        ~Misses()
+        {
+#ifdef __linux__
+            if (m_fd >= 0) close(m_fd);
+#endif
+        }
+
+        bool available() const { return m_fd >= 0; }
+
+        void start()
+        {
+#ifdef __linux__
+            if (!available()) return;
+            ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+
+        uint64_t stop()
+        {
+            uint64_t count(0);
+#ifdef __linux__
+            if (!available()) return 0;
+            ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(m_fd, &count, sizeof(count)) != sizeof(count)) count = 0;
+#endif
+            return count;
+        }
+
+    private:
+        int m_fd;
+    };
+
+    // Counts accesses landing on a cache line other than the current one or
+    // the next.
+    class Lines
+    {
+    public:
+        void touch(const void* p)
+        {
+            const uintptr_t line(reinterpret_cast<uintptr_t>(p) / 64);
+            if (line != m_line && line != m_line + 1) ++m_jumps;
+            m_line = line;
+        }
+
+        std::size_t jumps() const { return m_jumps; }
+
+    private:
+        uintptr_t m_line = 0;
+        std::size_t m_jumps = 0;
+    };
+
+    struct Result
+    {
+        double secs = 0;
+        uint64_t misses = 0;
+        std::size_t jumps = 0;
+    };
+
+    Misses misses;
+
+    template<typename Op>
+    Result measure(Op op)
+    {
+        Result result;
+        misses.start();
+        const auto start(now());
+        op();
+        result.secs = since<std::chrono::microseconds>(start) / 1e6;
+        result.misses = misses.stop();
+        return result;
+    }
+
+    void report(const std::string& name, const Result& r, std::size_t n)
+    {
+        std::cout << "\t" << std::left << std::setw(28) << name <<
+            std::right << std::setw(8) << n / r.secs / 1e6 << " Mpt/s";
+
+        if (misses.available())
+        {
+            std::cout << std::setw(10) <<
+                static_cast<double>(r.misses) / n << " misses/pt";
+        }
+
+        std::cout << std::setw(10) <<
+            static_cast<double>(r.jumps) / n << " jumps/pt" << std::endl;
+    }
+
+    // The previous pooled deserialization, without its PDAL field accessors.
+    Cell::PooledStack readCells(
+            PointPool& pool,
+            const std::vector<char>& data,
+            const std::size_t n)
+    {
+        const std::size_t pointSize(schema.pointSize());
+        Data::PooledStack dataStack(pool.dataPool().acquire(n));
+        Cell::PooledStack cellStack(pool.cellPool().acquire(n));
+
+        const char* pos(data.data());
+        int32_t xyz[3];
+
+        for (Cell& cell : cellStack)
+        {
+            Data::PooledNode dataNode(dataStack.popOne());
+            std::copy(pos, pos + pointSize, *dataNode);
+            std::memcpy(xyz, pos, sizeof(xyz));
+            cell.set(Point(xyz[0], xyz[1], xyz[2]), std::move(dataNode));
+            pos += pointSize;
+        }
+
+        return cellStack;
+    }
+
+    void shuffle(Cell::PooledStack& cells, std::mt19937& gen)
+    {
+        std::vector<Cell::PooledNode> nodes;
+        nodes.reserve(cells.size());
+        while (!cells.empty()) nodes.push_back(cells.popOne());
+        std::shuffle(nodes.begin(), nodes.end(), gen);
+        for (auto& node : nodes) cells.push(std::move(node));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t n(argc > 1 ? std::atol(argv[1]) : 1 << 20);
+    const std::size_t depth(
+            std::min<std::size_t>(
+                argc > 2 ? std::atol(argv[2]) : 12,
+                Descent::maxLevels()));
+
+    const std::size_t pointSize(schema.pointSize());
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int32_t> coord(0, (1 << 20) - 1);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    std::vector<char> data(n * pointSize);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        char* pos(data.data() + i * pointSize);
+        const int32_t xyz[3] = { coord(gen), coord(gen), coord(gen) };
+        std::memcpy(pos, xyz, sizeof(xyz));
+        for (std::size_t b(sizeof(xyz)); b < pointSize; ++b)
+        {
+            pos[b] = static_cast<char>(byte(gen));
+        }
+    }
+
+    PointPool pool(schema);
+    std::vector<Descent::Path> paths(n);
+    std::size_t sum(0);
+
+    // Deserialization.
+    Cell::PooledStack cells(pool.cellPool());
+    const Result cellRead(measure([&]()
+    {
+        cells = readCells(pool, data, n);
+    }));
+
+    PointColumns columns(schema);
+    const Result columnRead(measure([&]()
+    {
+        columns.append(data.data(), n);
+    }));
+
+    for (std::size_t i(0); i < n; ++i)
+    {
+        const int32_t* xyz(reinterpret_cast<const int32_t*>(columns.record(i)));
+        if (columns.point(i) != Point(xyz[0], xyz[1], xyz[2]))
+        {
+            std::cout << "Column mismatch at " << i << std::endl;
+            return 1;
+        }
+    }
+
+    shuffle(cells, gen);
+
+    // Descent.
+    std::vector<double> xs(n), ys(n), zs(n);
+    Result cellDescend(measure([&]()
+    {
+        std::size_t i(0);
+        for (const Cell& cell : cells)
+        {
+            const Point& p(cell.point());
+            xs[i] = p.x;
+            ys[i] = p.y;
+            zs[i] = p.z;
+            ++i;
+        }
+
+        Descent::paths(
+                xs.data(), ys.data(), zs.data(),
+                n, bounds, depth, paths.data());
+    }));
+    for (const Descent::Path p : paths) sum += p;
+
+    Result columnDescend(measure([&]()
+    {
+        Descent::paths(
+                columns.x(), columns.y(), columns.z(),
+                n, bounds, depth, paths.data());
+    }));
+    for (const Descent::Path p : paths) sum += p;
+
+    // Access patterns, replayed outside of the timed runs.
+    {
+        Lines points;
+        for (const Cell& cell : cells) points.touch(&cell.point());
+
+        Lines x, y, z;
+        for (std::size_t i(0); i < n; ++i)
+        {
+            x.touch(columns.x() + i);
+            y.touch(columns.y() + i);
+            z.touch(columns.z() + i);
+        }
+
+        cellDescend.jumps = points.jumps();
+        columnDescend.jumps = x.jumps() + y.jumps() + z.jumps();
+
+        pool.release(std::move(cells));
+    }
+
+    std::cout << "Points: " << n << ", point size: " << pointSize <<
+        ", depth: " << depth << " (checksum " << sum << ")" << std::endl;
+
+    if (!misses.available())
+    {
+        std::cout << "\tHardware cache counters unavailable" << std::endl;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    report("Cell read:", cellRead, n);
+    report("Column read:", columnRead, n);
+    report("Cell descend:", cellDescend, n);
+    report("Column descend:", columnDescend, n);
+
+    return 0;
+}
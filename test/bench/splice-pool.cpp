@@ -0,0 +1,140 @@
+// Measures pool allocator throughput with and without per-thread magazines,
+// under the access pattern of a build: each thread acquires small batches of
+// cells and buffers, and then releases them one at a time in shuffled order,
+// as tubes do when points are rejected or swapped.  Reports the time for each
+// mode and the hit rate of each thread's magazine.
+//
+// Usage: bench-splice-pool [threads] [operations per thread] [magazine size]
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <entwine/tree/heuristics.hpp>
+#include <entwine/types/point-pool.hpp>
+#include <entwine/util/time.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::size_t pointSize(36);
+    const std::size_t blockSize(4096);
+
+    struct Pools
+    {
+        explicit Pools(const std::size_t magazineSize)
+            : data(pointSize, blockSize, magazineSize)
+            , cells(blockSize, magazineSize)
+        { }
+
+        Data::Pool data;
+        Cell::Pool cells;
+    };
+
+    void work(Pools& pools, const std::size_t ops, const std::size_t seed)
+    {
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<std::size_t> batch(1, 32);
+
+        std::vector<Data::PooledNode> data;
+        std::vector<Cell::PooledNode> cells;
+
+        std::size_t done(0);
+        while (done < ops)
+        {
+            const std::size_t n(batch(gen));
+
+            Data::PooledStack dataStack(pools.data.acquire(n));
+            while (!dataStack.empty()) data.push_back(dataStack.popOne());
+            for (std::size_t i(0); i < n; ++i)
+            {
+                cells.push_back(pools.cells.acquireOne());
+            }
+
+            if (data.size() > 256)
+            {
+                std::shuffle(data.begin(), data.end(), gen);
+                std::shuffle(cells.begin(), cells.end(), gen);
+                data.clear();
+                cells.clear();
+            }
+
+            done += n;
+        }
+    }
+
+    double run(Pools& pools, const std::size_t threads, const std::size_t ops)
+    {
+        const auto start(now());
+
+        std::vector<std::thread> workers;
+        for (std::size_t i(0); i < threads; ++i)
+        {
+            workers.emplace_back([&pools, ops, i]() { work(pools, ops, i); });
+        }
+
+        for (auto& t : workers) t.join();
+
+        return since<std::chrono::microseconds>(start) / 1e6;
+    }
+
+    template<typename Pool>
+    void report(const std::string& name, const Pool& pool)
+    {
+        std::cout << "\t" << name << " magazines:" << std::endl;
+
+        for (const auto& s : pool.magazineStats())
+        {
+            std::cout << "\t\tSlot " << std::setw(2) << s.slot << ": " <<
+                std::setw(6) << s.hitRate() * 100.0 << "% hits (" <<
+                s.hits << " / " << s.hits + s.misses << ")" << std::endl;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t threads(
+            argc > 1 ?
+                std::atol(argv[1]) :
+                std::max(std::thread::hardware_concurrency(), 4u));
+    const std::size_t ops(argc > 2 ? std::atol(argv[2]) : 2000000);
+    const std::size_t magazineSize(
+            argc > 3 ?
+                std::atol(argv[3]) :
+                heuristics::poolMagazineSize);
+
+    Pools shared(0);
+    Pools cached(magazineSize);
+
+    // Allocate up front, so that neither run pays for block allocation.
+    for (Pools* pools : { &shared, &cached })
+    {
+        pools->data.acquire(threads * blockSize);
+        pools->cells.acquire(threads * blockSize);
+    }
+
+    const double sharedSecs(run(shared, threads, ops));
+    const double cachedSecs(run(cached, threads, ops));
+
+    const double total(threads * ops * 2);
+
+    std::cout << "Threads: " << threads << ", operations: " << ops <<
+        " per thread, magazine size: " << magazineSize << std::endl;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "\tShared:    " << std::setw(8) << total / sharedSecs / 1e6 <<
+        " M node acquisitions/s" << std::endl;
+    std::cout << "\tMagazines: " << std::setw(8) << total / cachedSecs / 1e6 <<
+        " M node acquisitions/s" << std::endl;
+
+    report("Data", cached.data);
+    report("Cell", cached.cells);
+
+    return 0;
+}
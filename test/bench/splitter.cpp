@@ -0,0 +1,158 @@
+// Compares the sharded Splitter slow path against the previous std::map +
+// global mutex under concurrent chunk lookups, using chunk IDs from a lossless
+// (unbounded cold depth) structure, where every chunk beyond the fast-tracker
+// range lands in the slow path.
+//
+// Usage: bench-splitter [lookups] [chunks] [maxThreads]
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <json/json.h>
+
+#include <entwine/tree/splitter.hpp>
+#include <entwine/types/structure.hpp>
+#include <entwine/util/time.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using Splits = Splitter<std::size_t>;
+
+    // The previous slow path, retained here for comparison.
+    class MapSplitter
+    {
+    public:
+        Splits::Slot& getOrCreate(const Id& chunkId, std::size_t)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_slow[chunkId];
+        }
+
+    private:
+        std::map<Id, Splits::Slot> m_slow;
+        std::mutex m_mutex;
+    };
+
+    class ShardedSplitter : public Splits
+    {
+    public:
+        ShardedSplitter(const Structure& structure) : Splits(structure) { }
+
+        std::size_t numFast() const { return m_fast.size(); }
+    };
+
+    struct Job
+    {
+        const Id* chunkId;
+        std::size_t chunkNum;
+    };
+
+    // Each lookup mirrors Cold::insert: find the slot, then lock it briefly
+    // to touch its contents.
+    template<typename S>
+    double run(
+            S& splitter,
+            const std::vector<std::vector<Job>>& jobs)
+    {
+        std::vector<std::thread> workers;
+
+        const auto start(now());
+
+        for (std::size_t t(0); t < jobs.size(); ++t)
+        {
+            workers.emplace_back([&splitter, &jobs, t]()
+            {
+                for (const Job& job : jobs[t])
+                {
+                    auto& slot(
+                            splitter.getOrCreate(*job.chunkId, job.chunkNum));
+
+                    SpinGuard lock(slot.spinner);
+                    slot.exists = true;
+                    if (!slot.t) slot.t.reset(new std::size_t(0));
+                    ++*slot.t;
+                }
+            });
+        }
+
+        for (auto& w : workers) w.join();
+
+        return since<std::chrono::microseconds>(start) / 1e6;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t lookups(argc > 1 ? std::atol(argv[1]) : 1 << 22);
+    const std::size_t numChunks(argc > 2 ? std::atol(argv[2]) : 1 << 16);
+    const std::size_t maxThreads(
+            argc > 3 ?
+                std::atol(argv[3]) :
+                std::max<std::size_t>(std::thread::hardware_concurrency(), 1));
+
+    Json::Value json;
+    json["nullDepth"] = 0;
+    json["baseDepth"] = 10;
+    json["coldDepth"] = 0;
+    json["pointsPerChunk"] = 262144;
+    json["numPointsHint"] = Json::UInt64(1ULL << 36);
+
+    const Structure structure(json);
+    const std::size_t numFast(ShardedSplitter(structure).numFast());
+
+    std::vector<Id> ids;
+    ids.reserve(numChunks);
+
+    for (std::size_t i(0); i < numChunks; ++i)
+    {
+        ids.push_back(structure.getInfoFromNum(numFast + i).chunkId());
+    }
+
+    std::cout <<
+        "Lookups: " << lookups << ", slow chunks: " << numChunks <<
+        ", fast trackers: " << numFast << "\n" <<
+        "Deepest chunk ID: " << ids.back() << " (" <<
+        ids.back().blockSize() << " blocks)" << std::endl;
+
+    std::cout <<
+        std::setw(8) << "Threads" <<
+        std::setw(18) << "Map (Mlookup/s)" <<
+        std::setw(22) << "Sharded (Mlookup/s)" << std::endl;
+
+    for (std::size_t threads(1); threads <= maxThreads; threads *= 2)
+    {
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<std::size_t> dist(0, numChunks - 1);
+        std::vector<std::vector<Job>> jobs(threads);
+
+        for (std::size_t t(0); t < threads; ++t)
+        {
+            for (std::size_t i(t); i < lookups; i += threads)
+            {
+                const std::size_t n(dist(gen));
+                jobs[t].push_back(Job { &ids[n], numFast + n });
+            }
+        }
+
+        MapSplitter mapSplitter;
+        ShardedSplitter shardedSplitter(structure);
+
+        const double mapSecs(run(mapSplitter, jobs));
+        const double shardedSecs(run(shardedSplitter, jobs));
+
+        std::cout << std::fixed << std::setprecision(2) <<
+            std::setw(8) << threads <<
+            std::setw(18) << lookups / mapSecs / 1e6 <<
+            std::setw(22) << lookups / shardedSecs / 1e6 << std::endl;
+    }
+
+    return 0;
+}
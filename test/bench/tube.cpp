@@ -0,0 +1,248 @@
+// Compares the inline-slot Tube against the previous std::map + lock Tube
+// under concurrent insertion, and the inline-slot Tube with its resident
+// coordinates held in TubeColumns, as contiguous chunks hold them.
+// Usage: bench-tube [points] [tubes] [ticks]
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <entwine/types/point-pool.hpp>
+#include <entwine/types/tube.hpp>
+#include <entwine/util/spin-lock.hpp>
+#include <entwine/util/time.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::size_t pointSize(8);
+
+    // The previous Tube implementation, retained here for comparison.
+    class MapTube
+    {
+    public:
+        Tube::Insertion insert(
+                uint64_t tick,
+                const Point& center,
+                Cell::PooledNode& cell)
+        {
+            Tube::Insertion result;
+
+            SpinGuard lock(m_spinner);
+
+            const auto it(m_cells.find(tick));
+
+            if (it != m_cells.end())
+            {
+                Cell::PooledNode& curr(it->second);
+
+                if (cell->point() != curr->point())
+                {
+                    const auto a(cell->point().sqDist3d(center));
+                    const auto b(curr->point().sqDist3d(center));
+
+                    if (
+                            a < b ||
+                            (a == b && ltChained(cell->point(), curr->point())))
+                    {
+                        result.setDelta(
+                                static_cast<int>(cell->size()) -
+                                static_cast<int>(curr->size()));
+                        std::swap(cell, curr);
+                    }
+                }
+                else
+                {
+                    result.setDone(cell->size());
+                    it->second->push(std::move(cell), pointSize);
+                }
+            }
+            else
+            {
+                result.setDone(cell->size());
+                m_cells.emplace(std::make_pair(tick, std::move(cell)));
+            }
+
+            return result;
+        }
+
+        void acquire(Cell::PooledStack& cells)
+        {
+            for (auto& p : m_cells) cells.push(std::move(p.second));
+            m_cells.clear();
+        }
+
+    private:
+        std::map<uint64_t, Cell::PooledNode> m_cells;
+        SpinLock m_spinner;
+    };
+
+    void acquire(Tube& tube, Cell::PooledStack& cells) { tube.acquire(cells); }
+    void acquire(MapTube& tube, Cell::PooledStack& cells)
+    {
+        tube.acquire(cells);
+    }
+
+    Tube::Insertion insert(
+            Tube& tube,
+            uint64_t tick,
+            const Point& center,
+            Cell::PooledNode& cell,
+            Tube::Residents residents)
+    {
+        return tube.insert(tick, center, pointSize, cell, residents);
+    }
+
+    Tube::Insertion insert(
+            MapTube& tube,
+            uint64_t tick,
+            const Point& center,
+            Cell::PooledNode& cell,
+            Tube::Residents)
+    {
+        return tube.insert(tick, center, cell);
+    }
+
+    struct Job
+    {
+        std::size_t tube;
+        uint64_t tick;
+    };
+
+    template<typename T>
+    double run(
+            const std::size_t threads,
+            const std::size_t points,
+            const std::size_t numTubes,
+            const std::size_t numTicks,
+            const bool resident = false)
+    {
+        Data::Pool dataPool(pointSize, 4096);
+        Cell::Pool cellPool(4096);
+
+        std::vector<T> tubes(numTubes);
+        TubeColumns columns(resident ? numTubes : 0);
+        std::vector<std::vector<Job>> jobs(threads);
+        std::vector<std::vector<Cell::PooledNode>> cells(threads);
+
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<std::size_t> tubeDist(0, numTubes - 1);
+        std::uniform_int_distribution<uint64_t> tickDist(0, numTicks - 1);
+        std::uniform_int_distribution<int> variantDist(0, 3);
+
+        for (std::size_t t(0); t < threads; ++t)
+        {
+            for (std::size_t i(t); i < points; i += threads)
+            {
+                const Job job { tubeDist(gen), tickDist(gen) };
+
+                Cell::PooledNode cell(cellPool.acquireOne());
+                cell->point() = Point(job.tube, job.tick, variantDist(gen));
+                cell->push(dataPool.acquireOne());
+
+                jobs[t].push_back(job);
+                cells[t].push_back(std::move(cell));
+            }
+        }
+
+        const Point center(0, 0, 0);
+        std::vector<std::thread> workers;
+
+        const auto start(now());
+
+        for (std::size_t t(0); t < threads; ++t)
+        {
+            workers.emplace_back([&, t]()
+            {
+                Data::PooledStack discard(dataPool);
+
+                for (std::size_t i(0); i < jobs[t].size(); ++i)
+                {
+                    const Job& job(jobs[t][i]);
+                    Cell::PooledNode& cell(cells[t][i]);
+
+                    // Swapped-out cells walk to the neighbouring tube, which
+                    // roughly mirrors a cell descending to the next depth.
+                    std::size_t tube(job.tube);
+                    bool done(false);
+
+                    for (std::size_t tries(0); !done && tries < 8; ++tries)
+                    {
+                        done = insert(
+                                tubes[tube],
+                                job.tick,
+                                center,
+                                cell,
+                                resident ?
+                                    columns.at(tube) : Tube::Residents())
+                            .done();
+                        tube = (tube + 1) % tubes.size();
+                    }
+
+                    if (!done)
+                    {
+                        discard.push(cell->acquire());
+                        cell.reset();
+                    }
+                }
+            });
+        }
+
+        for (auto& w : workers) w.join();
+
+        const double seconds(since<std::chrono::microseconds>(start) / 1e6);
+
+        Cell::PooledStack acquired(cellPool);
+        for (auto& tube : tubes) acquire(tube, acquired);
+
+        Data::PooledStack data(dataPool);
+        for (auto& cell : acquired) data.push(cell.acquire());
+
+        return seconds;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t points(argc > 1 ? std::atol(argv[1]) : 1 << 22);
+    const std::size_t numTubes(argc > 2 ? std::atol(argv[2]) : 1 << 16);
+    const std::size_t numTicks(argc > 3 ? std::atol(argv[3]) : 2);
+    const std::size_t maxThreads(
+            std::max<std::size_t>(std::thread::hardware_concurrency(), 1));
+
+    std::cout <<
+        "Points: " << points << ", tubes: " << numTubes <<
+        ", ticks/tube: " << numTicks << std::endl;
+
+    std::cout << "Tube footprint: map " << sizeof(MapTube) << "B, inline " <<
+        sizeof(Tube) << "B, resident columns " <<
+        3 * sizeof(double) * Tube::inlineSlots() << "B" << std::endl;
+
+    std::cout <<
+        std::setw(8) << "Threads" <<
+        std::setw(16) << "Map (Mpt/s)" <<
+        std::setw(16) << "Inline (Mpt/s)" <<
+        std::setw(18) << "Resident (Mpt/s)" << std::endl;
+
+    for (std::size_t threads(1); threads <= maxThreads; threads *= 2)
+    {
+        const double mapSecs(run<MapTube>(threads, points, numTubes, numTicks));
+        const double newSecs(run<Tube>(threads, points, numTubes, numTicks));
+        const double resSecs(
+                run<Tube>(threads, points, numTubes, numTicks, true));
+
+        std::cout << std::fixed << std::setprecision(2) <<
+            std::setw(8) << threads <<
+            std::setw(16) << points / mapSecs / 1e6 <<
+            std::setw(16) << points / newSecs / 1e6 <<
+            std::setw(18) << points / resSecs / 1e6 << std::endl;
+    }
+
+    return 0;
+}
+
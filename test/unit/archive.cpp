@@ -0,0 +1,232 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/archive.hpp>
+#include <entwine/util/mapped-file.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::string dir("entwine-test-archive/");
+
+    // Small enough that a few puts fill a pack.
+    const std::size_t packSize(64);
+
+    void clear()
+    {
+        for (const auto& f : arbiter::fs::glob(dir + "a/*"))
+        {
+            arbiter::fs::remove(f);
+        }
+
+        arbiter::fs::mkdirp(dir + "a/");
+    }
+
+    std::string path(const std::string& prefix, const std::size_t i)
+    {
+        return prefix + std::to_string(i);
+    }
+
+    std::vector<char> data(const std::string& path)
+    {
+        const std::string s(path + "-data");
+        return std::vector<char>(s.begin(), s.end());
+    }
+
+    std::function<std::string()> postfix(const std::string& p)
+    {
+        return [p]() { return p; };
+    }
+
+    void expectAll(
+            Archive& archive,
+            const arbiter::Endpoint& out,
+            const std::string& prefix,
+            const std::size_t n)
+    {
+        for (std::size_t i(0); i < n; ++i)
+        {
+            const std::string p(path(prefix, i));
+            const std::vector<char> expected(data(p));
+
+            EXPECT_EQ(*archive.get(out, p), expected) << p;
+            EXPECT_EQ(archive.size(out, p), expected.size()) << p;
+
+            if (MappedFile::supported())
+            {
+                const auto mapped(archive.map(out, p));
+                ASSERT_TRUE(mapped) << p;
+                EXPECT_EQ(
+                        std::vector<char>(
+                            mapped->data(),
+                            mapped->data() + mapped->size()),
+                        expected) << p;
+            }
+        }
+    }
+}
+
+TEST(Archive, PutGet)
+{
+    clear();
+
+    arbiter::Arbiter a;
+    const arbiter::Endpoint out(a.getEndpoint(dir));
+    const std::size_t n(20);
+
+    Archive archive(postfix(""), packSize);
+
+    for (std::size_t i(0); i < n; ++i)
+    {
+        const std::string p(path("chunk-", i));
+        archive.put(out, p, data(p));
+    }
+
+    // Entries are readable from both open and sealed packs.
+    expectAll(archive, out, "chunk-", n);
+
+    EXPECT_THROW(archive.get(out, "missing"), std::runtime_error);
+    EXPECT_EQ(archive.size(out, "missing"), 0u);
+    EXPECT_FALSE(archive.map(out, "missing"));
+
+    // Each pack holds several puts.
+    const std::size_t packs(arbiter::fs::glob(dir + "a/*").size());
+    EXPECT_GT(packs, 1u);
+    EXPECT_LT(packs, n);
+
+    archive.save(out);
+    EXPECT_TRUE(out.tryGet("a/index"));
+
+    Archive loaded(postfix(""), packSize);
+    expectAll(loaded, out, "chunk-", n);
+    EXPECT_EQ(loaded.size(out, "missing"), 0u);
+}
+
+TEST(Archive, FailedPut)
+{
+    clear();
+
+    // The first pack can't be written, since every write to it fails.
+    if (symlink("/dev/full", (dir + "a/0").c_str())) return;
+
+    arbiter::Arbiter a;
+    const arbiter::Endpoint out(a.getEndpoint(dir));
+    const std::size_t n(10);
+
+    Archive archive(postfix(""), packSize);
+
+    EXPECT_THROW(
+            archive.put(out, "failed", data("failed")),
+            std::runtime_error);
+    EXPECT_EQ(archive.size(out, "failed"), 0u);
+
+    // The failed pack isn't reused, so later puts start a pack of their own.
+    for (std::size_t i(0); i < n; ++i)
+    {
+        const std::string p(path("chunk-", i));
+        archive.put(out, p, data(p));
+    }
+
+    expectAll(archive, out, "chunk-", n);
+    archive.save(out);
+
+    Archive loaded(postfix(""), packSize);
+    expectAll(loaded, out, "chunk-", n);
+    EXPECT_EQ(loaded.size(out, "failed"), 0u);
+
+    // Not a regular file, so clear() won't find it.
+    unlink((dir + "a/0").c_str());
+}
+
+TEST(Archive, ConcurrentPuts)
+{
+    clear();
+
+    arbiter::Arbiter a;
+    const arbiter::Endpoint out(a.getEndpoint(dir));
+
+    const std::size_t numThreads(4);
+    const std::size_t n(200);
+
+    Archive archive(postfix(""), packSize);
+
+    std::vector<std::thread> threads;
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&archive, &out, t, n]()
+        {
+            const std::string prefix("thread-" + std::to_string(t) + "-");
+
+            for (std::size_t i(0); i < n; ++i)
+            {
+                const std::string p(path(prefix, i));
+                archive.put(out, p, data(p));
+
+                // Read back one of our earlier puts, whose pack may have
+                // been sealed since.
+                const std::string q(path(prefix, i / 2));
+                if (*archive.get(out, q) != data(q))
+                {
+                    throw std::runtime_error("Mismatch: " + q);
+                }
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    archive.save(out);
+
+    Archive loaded(postfix(""), packSize);
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        expectAll(loaded, out, "thread-" + std::to_string(t) + "-", n);
+    }
+}
+
+TEST(Archive, Merge)
+{
+    clear();
+
+    arbiter::Arbiter a;
+    const arbiter::Endpoint out(a.getEndpoint(dir));
+    const std::size_t n(10);
+
+    // The first subset becomes the whole, and takes in the second.
+    std::string first("-1");
+    Archive whole([&first]() { return first; }, packSize);
+    Archive other(postfix("-2"), packSize);
+
+    for (std::size_t i(0); i < n; ++i)
+    {
+        const std::string p1(path("one-", i));
+        const std::string p2(path("two-", i));
+        whole.put(out, p1, data(p1));
+        other.put(out, p2, data(p2));
+    }
+
+    EXPECT_THROW(whole.merge(out, other), std::runtime_error);
+
+    whole.save(out);
+    other.save(out);
+    EXPECT_TRUE(out.tryGet("a/index-1"));
+    EXPECT_TRUE(out.tryGet("a/index-2"));
+
+    first.clear();
+    whole.merge(out, other);
+    whole.save(out);
+
+    Archive loaded(postfix(""), packSize);
+    expectAll(loaded, out, "one-", n);
+    expectAll(loaded, out, "two-", n);
+}
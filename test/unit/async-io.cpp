@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <entwine/util/async-io.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::string prefix("entwine-test-async-io-");
+
+    std::vector<char> contents(const std::size_t i)
+    {
+        std::vector<char> data(1000 + i * 37);
+        for (std::size_t j(0); j < data.size(); ++j) data[j] = i + j * 7;
+        return data;
+    }
+
+    void roundTrip(AsyncIo& io)
+    {
+        const std::size_t n(64);
+
+        std::vector<std::vector<char>> data;
+        for (std::size_t i(0); i < n; ++i) data.push_back(contents(i));
+
+        std::atomic_size_t written(0);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            const std::vector<char>& d(data[i]);
+            io.write(
+                    prefix + std::to_string(i),
+                    d.data(),
+                    d.size(),
+                    [&written](bool ok) { if (ok) ++written; });
+        }
+
+        io.await();
+        ASSERT_EQ(written.load(), n);
+
+        std::vector<std::unique_ptr<AsyncIo::Data>> read(n);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            io.read(
+                    prefix + std::to_string(i),
+                    [&read, i](std::unique_ptr<AsyncIo::Data> d)
+                    {
+                        read[i] = std::move(d);
+                    });
+        }
+
+        io.await();
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            ASSERT_TRUE(read[i]);
+            EXPECT_EQ(*read[i], data[i]);
+            std::remove((prefix + std::to_string(i)).c_str());
+        }
+
+        EXPECT_FALSE(io.read(prefix + "missing"));
+    }
+}
+
+TEST(AsyncIo, Uring)
+{
+    // Falls back to threads if io_uring is unavailable.
+    AsyncIo io(8);
+    roundTrip(io);
+}
+
+TEST(AsyncIo, Threads)
+{
+    AsyncIo io(8, false);
+    EXPECT_FALSE(io.uring());
+    roundTrip(io);
+}
+
+TEST(AsyncIo, Readahead)
+{
+    AsyncIo io;
+    const std::vector<char> data(contents(3));
+    const std::string path(prefix + "ahead");
+    ASSERT_TRUE(io.write(path, data.data(), data.size()));
+
+    std::unique_ptr<AsyncIo::Data> taken;
+
+    {
+        Readahead readahead(io, std::vector<std::string>{ path });
+        ASSERT_TRUE(Readahead::take(path, taken));
+        ASSERT_TRUE(taken);
+        EXPECT_EQ(*taken, data);
+
+        // Each read is taken once.
+        EXPECT_FALSE(Readahead::take(path, taken));
+    }
+
+    {
+        Readahead readahead(io, std::vector<std::string>{ path });
+    }
+
+    // Reads not taken are discarded.
+    EXPECT_FALSE(Readahead::take(path, taken));
+    std::remove(path.c_str());
+}
+
@@ -0,0 +1,265 @@
+#include "gtest/gtest.h"
+#include "config.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pdal/util/FileUtils.hpp>
+
+#include <entwine/reader/cache.hpp>
+#include <entwine/reader/chunk-reader.hpp>
+#include <entwine/reader/query-chunk-state.hpp>
+#include <entwine/reader/reader.hpp>
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/tree/builder.hpp>
+#include <entwine/tree/config-parser.hpp>
+#include <entwine/types/dir.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/types/structure.hpp>
+#include <entwine/util/unique.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::string outPath(test::dataPath() + "out/cache/");
+    const std::string tmpPath(test::dataPath() + "tmp/");
+    arbiter::Arbiter a;
+
+    std::string indexPath(const std::size_t i)
+    {
+        return outPath + std::to_string(i);
+    }
+
+    // Every cold chunk of the index, found as a query would find them.
+    void collect(
+            const Reader& reader,
+            const QueryChunkState& c,
+            std::vector<FetchInfo>& fetches)
+    {
+        if (c.depth() >= reader.metadata().structure().coldDepthBegin())
+        {
+            if (!reader.exists(c)) return;
+            fetches.emplace_back(reader, c.chunkId(), c.bounds(), c.depth());
+        }
+
+        if (c.allDirections())
+        {
+            for (std::size_t i(0); i < dirHalfEnd(); ++i)
+            {
+                collect(reader, c.getClimb(toDir(i)), fetches);
+            }
+        }
+        else collect(reader, c.getClimb(), fetches);
+    }
+
+    std::vector<FetchInfo> collect(const Reader& reader)
+    {
+        std::vector<FetchInfo> fetches;
+        const Metadata& metadata(reader.metadata());
+        collect(
+                reader,
+                QueryChunkState(
+                    metadata.structure(),
+                    metadata.boundsScaledCubic()),
+                fetches);
+        return fetches;
+    }
+}
+
+class CacheTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestCase()
+    {
+        Json::Value config;
+        config["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        config["output"] = indexPath(0);
+        config["force"] = true;
+        config["pointsPerChunk"] = 1024;
+        config["nullDepth"] = 4;
+        config["baseDepth"] = 6;
+
+        auto builder(ConfigParser::getBuilder(config));
+        builder->go();
+    }
+
+    static void TearDownTestCase()
+    {
+        for (const auto& p : a.resolve(outPath + "**"))
+        {
+            pdal::FileUtils::deleteFile(p);
+        }
+    }
+};
+
+TEST_F(CacheTest, ConcurrentShards)
+{
+    // The size of each chunk, which is the same in every copy of the index.
+    std::map<Id, std::size_t> sizes;
+    std::size_t indexBytes(0);
+
+    {
+        Cache cache(1024 * 1024 * 1024);
+        Reader reader(indexPath(0), tmpPath, cache);
+
+        const std::vector<FetchInfo> fetches(collect(reader));
+        ASSERT_GT(fetches.size(), 16u);
+
+        const auto block(
+                cache.acquire(
+                    reader.path(),
+                    FetchInfoSet(fetches.begin(), fetches.end())));
+
+        for (const auto& c : block->chunkMap())
+        {
+            sizes[c.first] = c.second->size();
+            indexBytes += c.second->size();
+        }
+    }
+
+    const std::size_t maxChunkBytes(
+            std::accumulate(
+                sizes.begin(),
+                sizes.end(),
+                std::size_t(0),
+                [](std::size_t m, const std::pair<const Id, std::size_t>& s)
+                {
+                    return std::max(m, s.second);
+                }));
+
+    // The smallest cache allowed, with a few fetch threads.
+    Cache cache(0, 4);
+    ASSERT_GT(cache.numShards(), 1u);
+
+    // Enough copies of the index that their chunks overflow the cache, each
+    // of which is a distinct reader path.
+    const std::size_t numIndexes(cache.maxBytes() / indexBytes + 2);
+    for (std::size_t i(1); i < numIndexes; ++i)
+    {
+        a.copy(indexPath(0) + "/", indexPath(i) + "/");
+    }
+
+    std::vector<std::unique_ptr<Reader>> readers;
+    std::vector<std::vector<FetchInfo>> fetches;
+    for (std::size_t i(0); i < numIndexes; ++i)
+    {
+        readers.push_back(makeUnique<Reader>(indexPath(i), tmpPath, cache));
+        fetches.push_back(collect(*readers.back()));
+        ASSERT_EQ(fetches.back().size(), sizes.size());
+    }
+
+    const std::size_t numThreads(8);
+    const std::size_t iterations(200);
+    const std::size_t chunksPerBlock(4);
+
+    // Chunks may be fetched past the cap only for blocks which are held, so
+    // the cache never exceeds it by more than every thread's block.
+    const std::size_t limit(
+            cache.maxBytes() + numThreads * chunksPerBlock * maxChunkBytes);
+
+    std::vector<std::atomic_size_t> reservations(numIndexes);
+    for (auto& r : reservations) r = 0;
+
+    std::atomic_size_t mismatches(0);
+    std::atomic_size_t peak(0);
+    std::atomic_bool done(false);
+
+    std::thread monitor([&]()
+    {
+        while (!done)
+        {
+            const std::size_t active(cache.activeBytes());
+            std::size_t prev(peak);
+            while (active > prev && !peak.compare_exchange_weak(prev, active))
+            { }
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<std::size_t> index(
+                    0,
+                    numIndexes - 1);
+            std::uniform_int_distribution<std::size_t> chunk(
+                    0,
+                    sizes.size() - 1);
+
+            for (std::size_t i(0); i < iterations; ++i)
+            {
+                const std::size_t r(index(gen));
+                FetchInfoSet set;
+                while (set.size() < chunksPerBlock)
+                {
+                    set.insert(fetches[r][chunk(gen)]);
+                }
+
+                reservations[r] += set.size();
+
+                const auto block(cache.acquire(readers[r]->path(), set));
+                for (const auto& c : block->chunkMap())
+                {
+                    if (!c.second || c.second->size() != sizes.at(c.first))
+                    {
+                        ++mismatches;
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+    done = true;
+    monitor.join();
+
+    EXPECT_EQ(mismatches.load(), 0u);
+    EXPECT_LE(peak.load(), limit);
+
+    // With every block released, inactive chunks have been evicted down to
+    // the cap, and each shard accounts for its share of what remains.
+    const std::vector<std::size_t> shardBytes(cache.shardBytes());
+    ASSERT_EQ(shardBytes.size(), cache.numShards());
+
+    EXPECT_LE(cache.activeBytes(), cache.maxBytes());
+    EXPECT_EQ(
+            std::accumulate(
+                shardBytes.begin(),
+                shardBytes.end(),
+                std::size_t(0)),
+            cache.activeBytes());
+    EXPECT_GT(
+            std::count_if(
+                shardBytes.begin(),
+                shardBytes.end(),
+                [](std::size_t b) { return b > 0; }),
+            1);
+
+    std::size_t evictions(0);
+    for (std::size_t i(0); i < numIndexes; ++i)
+    {
+        const CacheStats stats(cache.stats(readers[i]->path()));
+        EXPECT_EQ(stats.hits + stats.misses, reservations[i].load()) << i;
+        EXPECT_LE(stats.evictions, stats.misses) << i;
+        evictions += stats.evictions;
+    }
+
+    EXPECT_GT(evictions, 0u);
+
+    // Releasing each reader returns its chunks from their shards.
+    readers.clear();
+    EXPECT_EQ(cache.activeBytes(), 0u);
+    for (const std::size_t b : cache.shardBytes()) EXPECT_EQ(b, 0u);
+}
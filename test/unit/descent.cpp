@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <vector>
+
+#include <entwine/tree/climber.hpp>
+#include <entwine/tree/descent.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/structure.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const Bounds bounds(-100, -100, -100, 100, 100, 100);
+
+    struct Batch
+    {
+        explicit Batch(std::size_t n) : x(n), y(n), z(n)
+        {
+            std::mt19937 gen(42);
+            std::uniform_real_distribution<double> dist(-100, 100);
+
+            for (std::size_t i(0); i < n; ++i)
+            {
+                x[i] = dist(gen);
+                y[i] = dist(gen);
+                z[i] = dist(gen);
+            }
+
+            // Points lying exactly on split planes, and on the bounds.
+            x[0] = 0; y[0] = 0; z[0] = 0;
+            x[1] = 50; y[1] = -25; z[1] = 12.5;
+            x[2] = -100; y[2] = -100; z[2] = -100;
+            x[3] = 99.999999; y[3] = 0; z[3] = -50;
+        }
+
+        std::vector<double> x, y, z;
+    };
+
+    Structure makeStructure()
+    {
+        Json::Value json;
+        json["nullDepth"] = 0;
+        json["baseDepth"] = 4;
+        json["coldDepth"] = 0;
+        json["pointsPerChunk"] = 4096;
+        json["numPointsHint"] = Json::UInt64(1ULL << 30);
+        return Structure(json);
+    }
+}
+
+TEST(Descent, MatchesScalar)
+{
+    const std::size_t n(1027);
+    const Batch batch(n);
+
+    for (std::size_t levels(0); levels <= Descent::maxLevels(); levels += 5)
+    {
+        std::vector<Descent::Path> fast(n), slow(n);
+
+        Descent::paths(
+                batch.x.data(), batch.y.data(), batch.z.data(),
+                n, bounds, levels, fast.data());
+
+        Descent::pathsScalar(
+                batch.x.data(), batch.y.data(), batch.z.data(),
+                n, bounds, levels, slow.data());
+
+        EXPECT_EQ(fast, slow) << "Mismatch at " << levels << " levels";
+    }
+}
+
+TEST(Descent, MatchesClimb)
+{
+    const std::size_t n(256);
+    const Batch batch(n);
+    const Structure structure(makeStructure());
+    const std::size_t levels(Descent::maxLevels());
+
+    ASSERT_LT(structure.nominalChunkDepth(), levels);
+
+    std::vector<Descent::Path> paths(n);
+    Descent::paths(
+            batch.x.data(), batch.y.data(), batch.z.data(),
+            n, bounds, levels, paths.data());
+
+    for (std::size_t i(0); i < n; ++i)
+    {
+        const Point point(batch.x[i], batch.y[i], batch.z[i]);
+
+        PointState expected(structure, bounds);
+        expected.climbTo(point, levels);
+
+        PointState actual(structure, bounds);
+        actual.climb(point, paths[i], levels);
+
+        EXPECT_EQ(actual.depth(), expected.depth());
+        EXPECT_EQ(actual.index(), expected.index());
+        EXPECT_EQ(actual.tick(), expected.tick());
+        EXPECT_EQ(actual.chunkId(), expected.chunkId());
+        EXPECT_EQ(actual.chunkNum(), expected.chunkNum());
+        EXPECT_EQ(actual.bounds().min(), expected.bounds().min());
+        EXPECT_EQ(actual.bounds().max(), expected.bounds().max());
+    }
+}
+
+TEST(Descent, LevelsStopAtChunkDepth)
+{
+    const std::size_t n(256);
+    const Batch batch(n);
+    const Structure structure(makeStructure());
+    const std::size_t depth(Descent::maxLevels());
+
+    // Paths stop at the nominal chunk depth, and the per-level climb takes
+    // over from there with the same results.
+    const std::size_t levels(Descent::levels(structure, depth));
+    EXPECT_EQ(levels, structure.nominalChunkDepth());
+    EXPECT_EQ(Descent::levels(structure, 2), std::min<std::size_t>(2, levels));
+
+    std::vector<Descent::Path> paths(n);
+    Descent::paths(
+            batch.x.data(), batch.y.data(), batch.z.data(),
+            n, bounds, levels, paths.data());
+
+    for (std::size_t i(0); i < n; ++i)
+    {
+        const Point point(batch.x[i], batch.y[i], batch.z[i]);
+
+        PointState expected(structure, bounds);
+        expected.climbTo(point, depth);
+
+        PointState actual(structure, bounds);
+        actual.climb(point, paths[i], levels);
+        actual.climbTo(point, depth);
+
+        EXPECT_EQ(actual.depth(), expected.depth());
+        EXPECT_EQ(actual.index(), expected.index());
+        EXPECT_EQ(actual.tick(), expected.tick());
+        EXPECT_EQ(actual.chunkId(), expected.chunkId());
+        EXPECT_EQ(actual.chunkNum(), expected.chunkNum());
+    }
+}
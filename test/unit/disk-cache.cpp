@@ -0,0 +1,219 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/util/disk-cache.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::string dir("entwine-test-disk-cache/");
+    const std::string src("entwine-test-disk-cache-src/");
+
+    using Data = DiskCache::Data;
+
+    void clear(const std::string& path)
+    {
+        for (const auto& f : arbiter::fs::glob(path + "*"))
+        {
+            arbiter::fs::remove(f);
+        }
+    }
+
+    // Fetches of this data are counted.
+    DiskCache::Fetch counted(const Data& data, std::size_t& fetches)
+    {
+        return [&data, &fetches]()
+        {
+            ++fetches;
+            return std::unique_ptr<Data>(new Data(data));
+        };
+    }
+
+    std::vector<std::string> files(const std::string& path)
+    {
+        return arbiter::fs::glob(path + "*");
+    }
+}
+
+TEST(DiskCache, MissThenHit)
+{
+    clear(dir);
+
+    const Data data { 'a', 'b', 'c' };
+    std::size_t fetches(0);
+
+    DiskCache cache(dir, 1024);
+    EXPECT_EQ(*cache.get("key", counted(data, fetches)), data);
+    EXPECT_EQ(*cache.get("key", counted(data, fetches)), data);
+    EXPECT_EQ(fetches, 1u);
+    EXPECT_EQ(cache.hits(), 1u);
+    EXPECT_EQ(cache.misses(), 1u);
+    EXPECT_EQ(cache.size(), 1u);
+
+    EXPECT_FALSE(cache.find("other"));
+
+    clear(dir);
+}
+
+TEST(DiskCache, Eviction)
+{
+    clear(dir);
+
+    const Data data(100, 'x');
+    std::size_t fetches(0);
+
+    // Each entry carries its key and a trailer, so only a few fit.
+    DiskCache cache(dir, 450);
+    for (std::size_t i(0); i < 10; ++i)
+    {
+        cache.get(std::to_string(i), counted(data, fetches));
+    }
+
+    EXPECT_LE(cache.bytes(), cache.maxBytes());
+    EXPECT_EQ(cache.size(), 3u);
+    EXPECT_EQ(files(dir).size(), 3u);
+
+    // The oldest are gone, and the newest remain.
+    EXPECT_FALSE(cache.find("0"));
+    EXPECT_TRUE(cache.find("9"));
+
+    // Too large to hold at all.
+    cache.put("big", Data(1000));
+    EXPECT_FALSE(cache.find("big"));
+
+    clear(dir);
+}
+
+TEST(DiskCache, Restart)
+{
+    clear(dir);
+
+    const Data data { 'a', 'b', 'c' };
+    std::size_t fetches(0);
+
+    {
+        DiskCache cache(dir, 1024);
+        cache.get("a", counted(data, fetches));
+        cache.get("b", counted(data, fetches));
+    }
+
+    // Left by an interrupted write.
+    std::ofstream(dir + "0123.4-5.tmp") << "partial";
+
+    {
+        DiskCache cache(dir, 1024);
+        EXPECT_EQ(cache.size(), 2u);
+        EXPECT_EQ(files(dir).size(), 2u);
+
+        EXPECT_EQ(*cache.get("a", counted(data, fetches)), data);
+        EXPECT_EQ(fetches, 2u);
+    }
+
+    // Corrupt entries are fetched again.
+    for (const auto& f : files(dir))
+    {
+        std::ofstream(f, std::ios::trunc) << "bad";
+    }
+
+    {
+        DiskCache cache(dir, 1024);
+        EXPECT_EQ(*cache.get("a", counted(data, fetches)), data);
+        EXPECT_EQ(fetches, 3u);
+        EXPECT_EQ(*cache.get("a", counted(data, fetches)), data);
+        EXPECT_EQ(fetches, 3u);
+    }
+
+    clear(dir);
+}
+
+TEST(DiskCache, Collision)
+{
+    clear(dir);
+
+    const Data data { 'a', 'b', 'c' };
+    std::size_t fetches(0);
+
+    DiskCache cache(dir, 1024);
+    cache.get("a", counted(data, fetches));
+    ASSERT_EQ(files(dir).size(), 1u);
+    const std::string shortPath(files(dir).front());
+
+    const std::vector<char> shortEntry(arbiter::Arbiter().getBinary(shortPath));
+
+    const std::string longKey(64, 'k');
+    cache.get(longKey, counted(data, fetches));
+    ASSERT_EQ(files(dir).size(), 2u);
+
+    // As if the longer key had hashed to the file of the shorter one, which
+    // holds fewer bytes than the longer key past its data.
+    for (const auto& f : files(dir))
+    {
+        if (f == shortPath) continue;
+        std::ofstream file(f, std::ios::binary | std::ios::trunc);
+        file.write(shortEntry.data(), shortEntry.size());
+    }
+
+    EXPECT_FALSE(cache.find(longKey));
+    EXPECT_EQ(*cache.get(longKey, counted(data, fetches)), data);
+    EXPECT_EQ(fetches, 3u);
+    EXPECT_EQ(*cache.find("a"), data);
+
+    clear(dir);
+}
+
+TEST(DiskCache, Endpoint)
+{
+    clear(dir);
+    clear(src);
+
+    arbiter::Arbiter a;
+    arbiter::fs::mkdirp(src);
+    a.put(src + "chunk", std::string("data"));
+
+    const arbiter::Endpoint endpoint(a.getEndpoint(src));
+    const arbiter::Endpoint other(a.getEndpoint(dir));
+
+    // A single read, as Hierarchy makes.
+    auto read([&endpoint](const std::string path) -> DiskCache::Fetch
+    {
+        return [&endpoint, path]()
+        {
+            return std::unique_ptr<Data>(new Data(endpoint.getBinary(path)));
+        };
+    });
+
+    auto cache(std::make_shared<DiskCache>(dir, 1024));
+    EXPECT_FALSE(DiskCache::find(endpoint));
+
+    {
+        const DiskCache::Attachment attachment(endpoint, cache);
+        EXPECT_EQ(DiskCache::find(endpoint), cache.get());
+        EXPECT_EQ(DiskCache::find(endpoint.getSubEndpoint("h")), cache.get());
+        EXPECT_FALSE(DiskCache::find(other));
+
+        EXPECT_EQ(cache->get(endpoint, "chunk", read("chunk"))->size(), 4u);
+
+        // Now held locally, so the source is no longer needed.
+        arbiter::fs::remove(src + "chunk");
+        EXPECT_EQ(cache->get(endpoint, "chunk", read("chunk"))->size(), 4u);
+        EXPECT_EQ(cache->hits(), 1u);
+
+        // A failed fetch is the caller's to handle, and isn't held.
+        EXPECT_ANY_THROW(cache->get(endpoint, "missing", read("missing")));
+        EXPECT_ANY_THROW(cache->get(endpoint, "missing", read("missing")));
+        EXPECT_EQ(cache->misses(), 3u);
+        EXPECT_EQ(cache->size(), 1u);
+    }
+
+    EXPECT_FALSE(DiskCache::find(endpoint));
+
+    clear(dir);
+    clear(src);
+}
@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <memory>
+#include <set>
+#include <stdexcept>
+
+#include <entwine/reader/eviction.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    GlobalChunkInfo chunk(const std::size_t id)
+    {
+        return GlobalChunkInfo("path", ChunkKey(Id(id), nullptr));
+    }
+
+    // Fill a policy with a popular chunk and then a scan of one-off chunks,
+    // evicting down to a few chunks as we go.  Returns true if the popular
+    // chunk survived.
+    bool survivesScan(const EvictionType type)
+    {
+        std::unique_ptr<EvictionPolicy> policy(EvictionPolicy::create(type));
+        const GlobalChunkInfo popular(chunk(0));
+
+        for (std::size_t i(0); i < 8; ++i)
+        {
+            policy->touch(popular);
+            if (i) policy->hold(popular);
+            policy->add(popular);
+        }
+
+        std::set<GlobalChunkInfo> held { popular };
+
+        for (std::size_t i(1); i < 1000; ++i)
+        {
+            policy->touch(chunk(i));
+            policy->add(chunk(i));
+            held.insert(chunk(i));
+
+            GlobalChunkInfo evicted;
+            while (held.size() > 4 && policy->evict(evicted))
+            {
+                EXPECT_EQ(held.erase(evicted), 1u);
+            }
+        }
+
+        return held.count(popular);
+    }
+}
+
+TEST(Eviction, Lru)
+{
+    std::unique_ptr<EvictionPolicy> policy(
+            EvictionPolicy::create(EvictionType::Lru));
+
+    for (std::size_t i(0); i < 4; ++i) policy->add(chunk(i));
+
+    // Reserving a chunk again takes it out of the policy, and releasing it
+    // makes it the most recent.
+    policy->hold(chunk(0));
+    EXPECT_EQ(policy->size(), 3u);
+    policy->add(chunk(0));
+
+    policy->drop(chunk(2));
+
+    GlobalChunkInfo evicted;
+    ASSERT_TRUE(policy->evict(evicted));
+    EXPECT_EQ(evicted.key.first, Id(1));
+    ASSERT_TRUE(policy->evict(evicted));
+    EXPECT_EQ(evicted.key.first, Id(3));
+    ASSERT_TRUE(policy->evict(evicted));
+    EXPECT_EQ(evicted.key.first, Id(0));
+    EXPECT_FALSE(policy->evict(evicted));
+}
+
+TEST(Eviction, ScanResistance)
+{
+    EXPECT_FALSE(survivesScan(EvictionType::Lru));
+    EXPECT_TRUE(survivesScan(EvictionType::TwoQueue));
+    EXPECT_TRUE(survivesScan(EvictionType::TinyLfu));
+}
+
+TEST(Eviction, Names)
+{
+    for (const auto type : {
+            EvictionType::Lru, EvictionType::TwoQueue, EvictionType::TinyLfu })
+    {
+        EXPECT_EQ(toEvictionType(toString(type)), type);
+    }
+
+    EXPECT_THROW(toEvictionType("fifo"), std::runtime_error);
+}
@@ -0,0 +1,88 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <entwine/reader/fetch-pool.hpp>
+
+using namespace entwine;
+
+TEST(FetchPool, Concurrency)
+{
+    const std::size_t numThreads(3);
+    std::atomic_size_t running(0);
+    std::atomic_size_t peak(0);
+    std::atomic_size_t done(0);
+
+    {
+        FetchPool pool(numThreads);
+        ASSERT_EQ(pool.numThreads(), numThreads);
+
+        for (std::size_t i(0); i < 24; ++i)
+        {
+            pool.add(i % 2 ? "a" : "b", [&]()
+            {
+                const std::size_t now(++running);
+                std::size_t prev(peak.load());
+                while (now > prev && !peak.compare_exchange_weak(prev, now))
+                { }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                --running;
+                ++done;
+            });
+        }
+    }
+
+    // Queued fetches are drained before destruction completes.
+    EXPECT_EQ(done.load(), 24u);
+    EXPECT_LE(peak.load(), numThreads);
+}
+
+TEST(FetchPool, Fairness)
+{
+    std::promise<void> started;
+    std::promise<void> gate;
+    std::shared_future<void> opened(gate.get_future().share());
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+
+    {
+        FetchPool pool(1);
+
+        pool.add("a", [&]()
+        {
+            started.set_value();
+            opened.wait();
+        });
+
+        started.get_future().wait();
+
+        // A reader with many queued fetches doesn't hold up another.
+        for (const std::string name : { "a1", "a2", "a3", "a4", "b1", "b2" })
+        {
+            pool.add(name.substr(0, 1), [&mutex, &order, name]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(name);
+            });
+        }
+
+        EXPECT_EQ(pool.pending(), 6u);
+        gate.set_value();
+    }
+
+    const std::vector<std::string> expected {
+        "b1", "a1", "b2", "a2", "a3", "a4"
+    };
+
+    EXPECT_EQ(order, expected);
+}
+
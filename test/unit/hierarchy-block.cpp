@@ -0,0 +1,308 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/tree/hierarchy-block.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/defs.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/types/storage.hpp>
+#include <entwine/types/structure.hpp>
+#include <entwine/util/compression.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using DimId = pdal::Dimension::Id;
+    using DimType = pdal::Dimension::Type;
+
+    const std::string dir("entwine-test-hierarchy-block/");
+
+    // With 256 points per chunk, the base spans depths 0 through 3, so its
+    // Ids are below 85.  Blocks are contiguous from there until the mapped
+    // depth of 6, at Id 1365, and sparse after that.
+    const Id contiguousId(85);
+    const std::size_t contiguousPoints(256);
+    const Id sparseId(1365);
+    const Id sparsePoints(Id(1) << 100);
+
+    // Omitting the format selects the original words format, as for indexes
+    // which predate the compact format.
+    std::unique_ptr<Metadata> makeMetadata(
+            const std::string& compress,
+            const std::string& format = "")
+    {
+        Json::Value structure;
+        structure["nullDepth"] = 0;
+        structure["baseDepth"] = 4;
+        structure["coldDepth"] = 0;
+        structure["pointsPerChunk"] = 256;
+        structure["mappedDepth"] = 6;
+        structure["sparseDepth"] = 8;
+
+        const Schema schema(DimList {
+                DimInfo("X", DimId::X, DimType::Double),
+                DimInfo("Y", DimId::Y, DimType::Double),
+                DimInfo("Z", DimId::Z, DimType::Double) });
+
+        const Bounds bounds(0, 0, 0, 64, 64, 64);
+
+        Json::Value json;
+        json["bounds"] = bounds.toJson();
+        json["boundsConforming"] = bounds.toJson();
+        json["schema"] = schema.toJson();
+        json["structure"] = structure;
+        json["hierarchyStructure"] = structure;
+        json["storage"] = "binary";
+        json["compressHierarchy"] = compress;
+        if (!format.empty()) json["hierarchyFormat"] = format;
+        json["version"] = currentVersion().toString();
+
+        return makeUnique<Metadata>(json);
+    }
+
+    // Global Id, tick, and count.
+    using Cells = std::vector<std::tuple<Id, uint64_t, uint64_t>>;
+
+    // Counts which need one or more varint bytes, in several ticks of each of
+    // a spread of tubes.  Counting is done in int deltas, so they stay within
+    // that range.
+    Cells makeCells(const Id& begin, const Id& span, const Id& stride)
+    {
+        Cells cells;
+        std::size_t i(0);
+
+        for (Id id(begin); id < begin + span; id += stride, ++i)
+        {
+            cells.emplace_back(id, 0, i + 1);
+            cells.emplace_back(id, 3, 300 * i + 7);
+            cells.emplace_back(id, 1 << 20, 1ULL << (i % 30));
+        }
+
+        return cells;
+    }
+
+    void count(HierarchyBlock& block, const Cells& cells)
+    {
+        for (const auto& c : cells)
+        {
+            block.count(std::get<0>(c), std::get<1>(c), std::get<2>(c));
+        }
+    }
+
+    void check(const HierarchyBlock& block, const Cells& cells)
+    {
+        for (const auto& c : cells)
+        {
+            const Id& id(std::get<0>(c));
+            const uint64_t tick(std::get<1>(c));
+
+            EXPECT_EQ(block.get(id, tick), std::get<2>(c)) << id << " " << tick;
+            EXPECT_EQ(block.get(id, tick + 1), 0u) << id << " " << tick;
+        }
+    }
+
+    class HierarchyBlockTest : public ::testing::Test
+    {
+    protected:
+        HierarchyBlockTest()
+            : m_arbiter()
+            , m_out(m_arbiter.getEndpoint(dir))
+            , m_pool(4096)
+        {
+            arbiter::fs::mkdirp(dir);
+        }
+
+        // Save a block and read it back, both as a writable block of its own
+        // type and as a read-only block, checking each against these cells.
+        template<typename Block>
+        std::size_t roundTrip(
+                const Metadata& metadata,
+                const Id& id,
+                const Id& maxPoints,
+                const Cells& cells)
+        {
+            auto written(
+                    HierarchyBlock::create(
+                        m_pool,
+                        metadata,
+                        id,
+                        &m_out,
+                        maxPoints));
+            EXPECT_TRUE(dynamic_cast<Block*>(written.get()));
+
+            count(*written, cells);
+            check(*written, cells);
+            written->save(m_out);
+
+            const std::vector<char> data(m_out.getBinary(id.str()));
+
+            for (const bool readOnly : { false, true })
+            {
+                auto read(
+                        HierarchyBlock::create(
+                            m_pool,
+                            metadata,
+                            id,
+                            &m_out,
+                            maxPoints,
+                            data,
+                            readOnly));
+
+                if (readOnly && id)
+                {
+                    EXPECT_TRUE(dynamic_cast<ReadOnlyBlock*>(read.get()));
+                }
+                else EXPECT_TRUE(dynamic_cast<Block*>(read.get()));
+
+                check(*read, cells);
+            }
+
+            return data.size();
+        }
+
+        template<typename Block>
+        void roundTrip(const Id& id, const Id& maxPoints, const Cells& cells)
+        {
+            const auto compact(makeMetadata("none", "compact"));
+            const auto words(makeMetadata("none", "words"));
+
+            const std::size_t compactSize(
+                    roundTrip<Block>(*compact, id, maxPoints, cells));
+            const std::size_t wordsSize(
+                    roundTrip<Block>(*words, id, maxPoints, cells));
+
+            EXPECT_LT(compactSize, wordsSize);
+
+#ifdef ENTWINE_HAVE_ZSTD
+            const auto zstd(makeMetadata("zstd", "compact"));
+            const std::size_t zstdSize(
+                    roundTrip<Block>(*zstd, id, maxPoints, cells));
+            EXPECT_GT(zstdSize, 0u);
+#endif
+        }
+
+        arbiter::Arbiter m_arbiter;
+        arbiter::Endpoint m_out;
+        HierarchyCell::Pool m_pool;
+    };
+
+    void pushWord(std::vector<char>& data, const uint64_t v)
+    {
+        data.insert(
+                data.end(),
+                reinterpret_cast<const char*>(&v),
+                reinterpret_cast<const char*>(&v) + sizeof(v));
+    }
+}
+
+TEST_F(HierarchyBlockTest, ContiguousRoundTrip)
+{
+    roundTrip<ContiguousBlock>(
+            contiguousId,
+            contiguousPoints,
+            makeCells(contiguousId, contiguousPoints, 3));
+}
+
+TEST_F(HierarchyBlockTest, SparseRoundTrip)
+{
+    // Tubes spaced widely enough that the Id deltas between them need more
+    // than 64 bits.
+    Cells cells(makeCells(sparseId, 4096, 97));
+    const Cells far(
+            makeCells(sparseId + (Id(1) << 70), Id(1) << 90, Id(1) << 85));
+    cells.insert(cells.end(), far.begin(), far.end());
+
+    roundTrip<SparseBlock>(sparseId, sparsePoints, cells);
+}
+
+TEST_F(HierarchyBlockTest, BaseRoundTrip)
+{
+    roundTrip<BaseBlock>(0, 85, makeCells(0, 85, 1));
+}
+
+TEST_F(HierarchyBlockTest, LegacyWords)
+{
+    // Written by hand in the original words format, as an index which
+    // predates the compact format would have been, with the original LZMA
+    // compression.
+    const auto metadata(makeMetadata("lzma"));
+    EXPECT_EQ(
+            metadata->storage().hierarchyFormat(),
+            HierarchyFormat::Words);
+
+    // Base and contiguous blocks hold a normalized tube, a tick, and a count.
+    const Cells base(makeCells(0, 85, 2));
+    std::vector<char> baseData;
+    for (const auto& c : base)
+    {
+        pushWord(baseData, std::get<0>(c).getSimple());
+        pushWord(baseData, std::get<1>(c));
+        pushWord(baseData, std::get<2>(c));
+    }
+
+    const Cells contiguous(makeCells(contiguousId, contiguousPoints, 5));
+    std::vector<char> contiguousData;
+    for (const auto& c : contiguous)
+    {
+        pushWord(contiguousData, (std::get<0>(c) - contiguousId).getSimple());
+        pushWord(contiguousData, std::get<1>(c));
+        pushWord(contiguousData, std::get<2>(c));
+    }
+
+    // Sparse blocks replace the tube with its number of blocks, followed by
+    // each block.
+    const Cells sparse(makeCells(sparseId, Id(1) << 80, Id(1) << 75));
+    std::vector<char> sparseData;
+    for (const auto& c : sparse)
+    {
+        const auto blocks((std::get<0>(c) - sparseId).blocks());
+        pushWord(sparseData, blocks.size());
+        for (const Id::Block block : blocks) pushWord(sparseData, block);
+        pushWord(sparseData, std::get<1>(c));
+        pushWord(sparseData, std::get<2>(c));
+    }
+
+    const std::vector<std::tuple<Id, Id, const Cells*, std::vector<char>*>>
+        blocks {
+            std::make_tuple(Id(0), Id(85), &base, &baseData),
+            std::make_tuple(
+                    contiguousId,
+                    Id(contiguousPoints),
+                    &contiguous,
+                    &contiguousData),
+            std::make_tuple(sparseId, sparsePoints, &sparse, &sparseData)
+        };
+
+    for (const auto& b : blocks)
+    {
+        const Id& id(std::get<0>(b));
+        const std::vector<char> data(
+                *Compression::compressLzma(*std::get<3>(b)));
+
+        for (const bool readOnly : { false, true })
+        {
+            auto read(
+                    HierarchyBlock::create(
+                        m_pool,
+                        *metadata,
+                        id,
+                        &m_out,
+                        std::get<1>(b),
+                        data,
+                        readOnly));
+
+            check(*read, *std::get<2>(b));
+        }
+    }
+}
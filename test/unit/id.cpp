@@ -0,0 +1,176 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <vector>
+
+#include <entwine/types/id.hpp>
+#include <entwine/types/structure.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    // Compare an Id against the equivalent BigUint.
+    void check(const Id& id, const BigUint& big)
+    {
+        EXPECT_EQ(id.str(), big.str());
+        EXPECT_EQ(id.blockSize(), big.blockSize());
+        EXPECT_EQ(id.trivial(), big.trivial());
+
+        const auto& data(big.data());
+        EXPECT_EQ(
+                id.blocks(),
+                std::vector<Id::Block>(data.begin(), data.end()));
+    }
+
+    BigUint random(std::mt19937_64& gen, std::size_t blocks)
+    {
+        std::vector<BigUint::Block> v(blocks);
+        for (auto& b : v) b = gen();
+        return BigUint(v.data(), v.data() + v.size());
+    }
+}
+
+TEST(Id, Basic)
+{
+    EXPECT_TRUE(Id().zero());
+    EXPECT_TRUE(Id().fixed());
+    EXPECT_EQ(Id(42).getSimple(), 42u);
+    EXPECT_EQ(Id("123456789012345678901234567890").str(),
+            "123456789012345678901234567890");
+
+    Id id(1);
+    id <<= 64;
+    EXPECT_FALSE(id.trivial());
+    EXPECT_THROW(id.getSimple(), std::overflow_error);
+    EXPECT_THROW(Id(1) - Id(2), std::underflow_error);
+    EXPECT_THROW(Id(1) / Id(0), std::invalid_argument);
+}
+
+TEST(Id, Log2)
+{
+    EXPECT_EQ(Id::log2(1), 0u);
+    EXPECT_EQ(Id::log2(7), 2u);
+    EXPECT_EQ(Id::log2(8), 3u);
+    EXPECT_EQ(Id::log2(~0ULL), 63u);
+    EXPECT_EQ(Id::log2(Id(1) << 64), 64u);
+    EXPECT_EQ(Id::log2(Id(1) << 200), 200u);
+    EXPECT_EQ(Id::log2((Id(1) << 200) - 1), 199u);
+}
+
+TEST(Id, Log2Exact)
+{
+    // BigUint::log2 goes through double, so values just below a power of two
+    // above 2^53 rounded up to that power.  Id::log2 is exact.
+    for (std::size_t bits(54); bits <= 128; ++bits)
+    {
+        const Id power(Id(1) << bits);
+        EXPECT_EQ(Id::log2(power), bits);
+        EXPECT_EQ(Id::log2(power - 1), bits - 1) << bits;
+        EXPECT_EQ(Id::log2(power + 1), bits);
+    }
+}
+
+TEST(Id, CalcDepthBoundaries)
+{
+    // The first and last indices of each depth.  Near the top of the 64-bit
+    // range, the last few indices of a depth used to be placed one depth too
+    // deep, since their log2 rounded up.
+    for (const std::size_t factor : { 4u, 8u })
+    {
+        Id begin(0);
+        Id levelSize(1);
+
+        for (std::size_t depth(0); depth < 40; ++depth)
+        {
+            const Id end(begin + levelSize);
+
+            EXPECT_EQ(ChunkInfo::calcDepth(factor, begin), depth);
+            EXPECT_EQ(ChunkInfo::calcDepth(factor, end - 1), depth) <<
+                "Factor " << factor << ", depth " << depth;
+
+            begin = end;
+            levelSize *= factor;
+        }
+    }
+}
+
+TEST(Id, Overflow)
+{
+    // Grow well past any inline width, then shrink back down.
+    Id id(1);
+    BigUint big(1);
+
+    for (std::size_t i(0); i < 200; ++i)
+    {
+        id <<= 2;
+        ++id;
+        big <<= 2;
+        ++big;
+        check(id, big);
+    }
+
+    EXPECT_FALSE(id.fixed());
+
+    for (std::size_t i(0); i < 200; ++i)
+    {
+        id >>= 2;
+        big >>= 2;
+        check(id, big);
+    }
+
+    EXPECT_TRUE(id.fixed());
+    EXPECT_EQ(id, Id(1));
+}
+
+TEST(Id, MatchesBigUint)
+{
+    std::mt19937_64 gen(42);
+
+    for (std::size_t i(0); i < 2000; ++i)
+    {
+        const BigUint a(random(gen, 1 + i % 3));
+        const BigUint b(random(gen, 1 + (i / 3) % 3));
+        const Id x(a);
+        const Id y(b);
+
+        check(x + y, a + b);
+
+        // BigUint's multiplication estimates the product's size with a
+        // floating point log2, which can wrap - so check this one by division.
+        const Id product(x * y);
+        EXPECT_EQ(product / y, x);
+        EXPECT_TRUE((product % y).zero());
+        if (a.trivial() && b.trivial() && a.getSimple() < (1ULL << 31) &&
+                b.getSimple() < (1ULL << 31))
+        {
+            check(product, a * b);
+        }
+        check(x / y, a / b);
+        check(x % y, a % b);
+        check(x | y, a | b);
+        check(x & y, a & b);
+        // BigUint drops all but the lowest block when shifting by zero.
+        const Id::Block shift(1 + i % 70);
+        check(x << shift, a << shift);
+        check(x >> shift, a >> shift);
+        EXPECT_EQ(x << 0, x);
+        EXPECT_EQ(x >> 0, x);
+
+        if (b <= a) check(x - y, a - b);
+        else EXPECT_THROW(x - y, std::underflow_error);
+
+        EXPECT_EQ(x == y, a == b);
+        EXPECT_EQ(x < y, a < b);
+        EXPECT_EQ(y < x, b < a);
+
+        const auto dm(x.divMod(y));
+        check(dm.first, a / b);
+        check(dm.second, a % b);
+
+        const std::vector<Id::Block> blocks(x.blocks());
+        const Id copy(blocks.data(), blocks.data() + blocks.size());
+        EXPECT_EQ(copy, x);
+        EXPECT_EQ(std::hash<Id>()(copy), std::hash<Id>()(x));
+    }
+}
@@ -0,0 +1,115 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <pdal/PointTable.hpp>
+#include <pdal/PointView.hpp>
+#include <pdal/io/BufferReader.hpp>
+
+#include <entwine/types/chunk-storage/las-buffer.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using DimId = pdal::Dimension::Id;
+
+    // The reader and writer require a filename, but never touch the file.
+    const std::string path("entwine-test-laszip.laz");
+    const std::size_t numPoints(1000);
+    const double scale(0.01);
+
+    double x(const std::size_t i) { return i * scale; }
+    double y(const std::size_t i) { return 100.0 - i * scale; }
+    double z(const std::size_t i) { return (i % 37) * 2 * scale; }
+    uint16_t intensity(const std::size_t i) { return i % 256; }
+
+    std::vector<char> write(const bool compress)
+    {
+        pdal::PointTable table;
+        table.layout()->registerDims(
+                { DimId::X, DimId::Y, DimId::Z, DimId::Intensity });
+
+        pdal::PointViewPtr view(new pdal::PointView(table));
+        for (pdal::PointId i(0); i < numPoints; ++i)
+        {
+            view->setField(DimId::X, i, x(i));
+            view->setField(DimId::Y, i, y(i));
+            view->setField(DimId::Z, i, z(i));
+            view->setField(DimId::Intensity, i, intensity(i));
+        }
+
+        pdal::BufferReader reader;
+        reader.addView(view);
+
+        pdal::Options options;
+        options.add("filename", path);
+        options.add("minor_version", 4);
+        if (compress) options.add("compression", "laszip");
+        options.add("scale_x", scale);
+        options.add("scale_y", scale);
+        options.add("scale_z", scale);
+        options.add("offset_x", 0);
+        options.add("offset_y", 0);
+        options.add("offset_z", 0);
+
+        BufferLasWriter writer;
+        writer.setOptions(options);
+        writer.setInput(reader);
+        writer.prepare(table);
+        writer.execute(table);
+
+        return writer.data();
+    }
+
+    void check(const std::vector<char>& data)
+    {
+        ASSERT_GT(data.size(), 4u);
+        EXPECT_EQ(std::string(data.data(), 4), "LASF");
+        EXPECT_FALSE(std::ifstream(path).good());
+
+        pdal::PointTable table;
+
+        pdal::Options options;
+        options.add("filename", path);
+        options.add("nosrs", true);
+
+        BufferLasReader reader(data);
+        reader.setOptions(options);
+        reader.prepare(table);
+        EXPECT_EQ(reader.header().pointCount(), numPoints);
+
+        const pdal::PointViewSet views(reader.execute(table));
+        ASSERT_EQ(views.size(), 1u);
+
+        const pdal::PointView& view(**views.begin());
+        ASSERT_EQ(view.size(), numPoints);
+
+        for (pdal::PointId i(0); i < numPoints; ++i)
+        {
+            ASSERT_NEAR(view.getFieldAs<double>(DimId::X, i), x(i), 1e-9);
+            ASSERT_NEAR(view.getFieldAs<double>(DimId::Y, i), y(i), 1e-9);
+            ASSERT_NEAR(view.getFieldAs<double>(DimId::Z, i), z(i), 1e-9);
+            ASSERT_EQ(
+                    view.getFieldAs<uint16_t>(DimId::Intensity, i),
+                    intensity(i));
+        }
+    }
+}
+
+TEST(LasZip, BufferRoundTripLas)
+{
+    check(write(false));
+}
+
+TEST(LasZip, BufferRoundTripLaz)
+{
+    const std::vector<char> laz(write(true));
+    check(laz);
+
+    // The LAZ is compressed, so it should be smaller than the LAS.
+    EXPECT_LT(laz.size(), write(false).size());
+}
@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <entwine/types/storage-types.hpp>
+#include <entwine/util/mapped-file.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::string path("entwine-test-mapped-file");
+
+    void write(const std::vector<char>& data)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), data.size());
+    }
+}
+
+TEST(MappedFile, Contents)
+{
+    if (!MappedFile::supported()) return;
+
+    std::vector<char> data(10000);
+    for (std::size_t i(0); i < data.size(); ++i) data[i] = i * 7;
+    write(data);
+
+    {
+        const MappedFile mapped(path);
+        ASSERT_EQ(mapped.size(), data.size());
+        EXPECT_EQ(
+                std::vector<char>(mapped.data(), mapped.data() + mapped.size()),
+                data);
+    }
+
+    write(std::vector<char>());
+    {
+        const MappedFile mapped(path);
+        EXPECT_EQ(mapped.size(), 0u);
+    }
+
+    std::remove(path.c_str());
+    EXPECT_THROW(MappedFile mapped(path), std::runtime_error);
+}
+
+TEST(MappedFile, Range)
+{
+    if (!MappedFile::supported()) return;
+
+    std::vector<char> data(20000);
+    for (std::size_t i(0); i < data.size(); ++i) data[i] = i * 7;
+    write(data);
+
+    for (const std::size_t offset : { 0u, 1u, 4095u, 4096u, 12345u })
+    {
+        const std::size_t size(std::min<std::size_t>(5000, 20000 - offset));
+        const MappedFile mapped(path, offset, size);
+        ASSERT_EQ(mapped.size(), size);
+        EXPECT_EQ(
+                std::vector<char>(mapped.data(), mapped.data() + size),
+                std::vector<char>(
+                    data.begin() + offset,
+                    data.begin() + offset + size));
+    }
+
+    EXPECT_THROW(MappedFile mapped(path, 19000, 2000), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(MappedFile, Tail)
+{
+    const TailFieldList fields{ TailField::NumPoints, TailField::ChunkType };
+
+    std::vector<char> data(24, 'x');
+    const uint64_t numPoints(42);
+    const char* pos(reinterpret_cast<const char*>(&numPoints));
+    data.insert(data.end(), pos, pos + sizeof(numPoints));
+    data.push_back(static_cast<char>(ChunkType::Contiguous));
+
+    std::vector<char> copy(data);
+    const Tail fromVector(copy, fields);
+
+    std::size_t size(data.size());
+    const Tail fromPointer(data.data(), size, fields);
+
+    EXPECT_EQ(size, 24u);
+    EXPECT_EQ(copy.size(), 24u);
+    EXPECT_EQ(fromPointer.numPoints(), 42u);
+    EXPECT_EQ(fromPointer.numPoints(), fromVector.numPoints());
+    EXPECT_EQ(fromPointer.type(), ChunkType::Contiguous);
+}
@@ -0,0 +1,155 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/dir.hpp>
+#include <entwine/types/morton.hpp>
+#include <entwine/types/point.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const Bounds bounds(Point(0, 0, 0), Point(1024, 1024, 1024));
+    const std::size_t depths(8);
+
+    std::vector<Point> randomPoints(std::size_t n)
+    {
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> dist(0, 1024);
+
+        std::vector<Point> points;
+        for (std::size_t i(0); i < n; ++i)
+        {
+            points.emplace_back(dist(gen), dist(gen), dist(gen));
+        }
+        return points;
+    }
+
+    // The path of directions, 2D unless is3d is set, taken to reach this
+    // point's node at each depth, as the tree would descend.
+    std::vector<std::size_t> path(const Point& p, bool is3d = false)
+    {
+        std::vector<std::size_t> result;
+        Bounds current(bounds);
+
+        for (std::size_t d(0); d < depths; ++d)
+        {
+            const Dir dir(getDirection(current.mid(), p, !is3d));
+            result.push_back(toIntegral(dir, !is3d));
+            current = current.get(dir, !is3d);
+        }
+
+        return result;
+    }
+
+    uint64_t key(const Point& p, bool is3d)
+    {
+        return is3d ? morton::key3d(p, bounds) : morton::key2d(p, bounds);
+    }
+
+    // At every depth, once the sorted points leave a node they never return.
+    void checkContiguous(bool is3d)
+    {
+        std::vector<Point> points(randomPoints(5000));
+        std::sort(
+                points.begin(),
+                points.end(),
+                [is3d](const Point& a, const Point& b)
+                {
+                    return key(a, is3d) < key(b, is3d);
+                });
+
+        for (std::size_t d(1); d <= depths; ++d)
+        {
+            std::set<std::vector<std::size_t>> finished;
+            std::vector<std::size_t> current;
+
+            for (const Point& p : points)
+            {
+                std::vector<std::size_t> node(path(p, is3d));
+                node.resize(d);
+
+                if (node != current)
+                {
+                    if (!current.empty()) finished.insert(current);
+                    EXPECT_FALSE(finished.count(node)) << "Depth " << d;
+                    current = node;
+                }
+            }
+        }
+    }
+
+}
+
+TEST(Morton, Spread)
+{
+    EXPECT_EQ(morton::spread2(0), 0u);
+    EXPECT_EQ(morton::spread2(1), 1u);
+    EXPECT_EQ(morton::spread2(3), 5u);
+    EXPECT_EQ(morton::spread2(0xffffffff), 0x5555555555555555ULL);
+}
+
+TEST(Morton, Quantize)
+{
+    EXPECT_EQ(morton::quantize(-1, 0, 8), 0u);
+    EXPECT_EQ(morton::quantize(0, 0, 8), 0u);
+    EXPECT_EQ(morton::quantize(4, 0, 8), 0x80000000u);
+    EXPECT_EQ(morton::quantize(8, 0, 8), 0xffffffffu);
+    EXPECT_EQ(morton::quantize(9, 0, 8), 0xffffffffu);
+}
+
+TEST(Morton, MatchesDirections)
+{
+    // Each pair of bits from the top matches the direction taken there.
+    for (const Point& p : randomPoints(1000))
+    {
+        const uint64_t key(morton::key2d(p, bounds));
+        const std::vector<std::size_t> dirs(path(p));
+
+        for (std::size_t d(0); d < depths; ++d)
+        {
+            EXPECT_EQ((key >> (62 - 2 * d)) & 3u, dirs[d]) << p << " " << d;
+        }
+    }
+}
+
+TEST(Morton, SortedNodesAreContiguous)
+{
+    checkContiguous(false);
+}
+
+TEST(Morton, Spread3)
+{
+    EXPECT_EQ(morton::spread3(0), 0u);
+    EXPECT_EQ(morton::spread3(1), 1u);
+    EXPECT_EQ(morton::spread3(3), 9u);
+    EXPECT_EQ(morton::spread3(0x1fffff), 0x1249249249249249ULL);
+    EXPECT_EQ(morton::spread3(0xffffffff), 0x1249249249249249ULL);
+}
+
+TEST(Morton, MatchesDirections3d)
+{
+    // Each triple of bits from bit 62 down matches the direction taken there.
+    for (const Point& p : randomPoints(1000))
+    {
+        const uint64_t key(morton::key3d(p, bounds));
+        const std::vector<std::size_t> dirs(path(p, true));
+
+        for (std::size_t d(0); d < depths; ++d)
+        {
+            EXPECT_EQ((key >> (60 - 3 * d)) & 7u, dirs[d]) << p << " " << d;
+        }
+    }
+}
+
+TEST(Morton, SortedNodesAreContiguous3d)
+{
+    checkContiguous(true);
+}
@@ -0,0 +1,159 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <entwine/tree/thread-pools.hpp>
+#include <entwine/types/point-pool.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/util/numa.hpp>
+#include <entwine/util/pool.hpp>
+
+using namespace entwine;
+
+TEST(Numa, Detect)
+{
+    const Numa numa(Numa::detect());
+    ASSERT_GE(numa.numNodes(), 1u);
+    EXPECT_FALSE(numa.emulated());
+
+    for (std::size_t i(0); i < numa.numNodes(); ++i)
+    {
+        EXPECT_FALSE(numa.cpus(i).empty());
+    }
+}
+
+TEST(Numa, Emulate)
+{
+    const Numa detected(Numa::detect());
+    std::set<int> available;
+    for (std::size_t i(0); i < detected.numNodes(); ++i)
+    {
+        available.insert(detected.cpus(i).begin(), detected.cpus(i).end());
+    }
+
+    for (const std::size_t n : { 1u, 2u, 3u, 8u })
+    {
+        const Numa numa(Numa::emulate(n));
+        ASSERT_EQ(numa.numNodes(), n);
+        EXPECT_TRUE(numa.emulated());
+
+        std::set<int> covered;
+        for (std::size_t i(0); i < n; ++i)
+        {
+            ASSERT_FALSE(numa.cpus(i).empty());
+            covered.insert(numa.cpus(i).begin(), numa.cpus(i).end());
+        }
+
+        EXPECT_EQ(covered, available);
+    }
+
+    EXPECT_EQ(Numa::create(0).numNodes(), detected.numNodes());
+    EXPECT_FALSE(Numa::create(detected.numNodes()).emulated());
+    EXPECT_EQ(Numa::create(detected.numNodes() + 1).numNodes(),
+            detected.numNodes() + 1);
+}
+
+TEST(Numa, PinnedPools)
+{
+    const Numa numa(Numa::emulate(2));
+    const std::size_t workThreads(4);
+
+    std::mutex mutex;
+    std::set<std::size_t> nodes;
+    bool contained(true);
+
+    {
+        ThreadPools pools(workThreads, 4, &numa);
+        EXPECT_EQ(pools.numa(), &numa);
+
+        for (std::size_t i(0); i < 64; ++i)
+        {
+            pools.workPool().add([&]()
+            {
+                const std::size_t node(Numa::currentNode());
+
+#ifdef __linux__
+                const std::vector<int>& cpus(numa.cpus(node));
+                const int cpu(sched_getcpu());
+                const bool ok(
+                        std::find(cpus.begin(), cpus.end(), cpu) != cpus.end());
+#else
+                const bool ok(true);
+#endif
+
+                std::lock_guard<std::mutex> lock(mutex);
+                nodes.insert(node);
+                contained = contained && ok;
+            });
+        }
+
+        pools.join();
+    }
+
+    EXPECT_TRUE(contained);
+    for (const std::size_t node : nodes) EXPECT_LT(node, numa.numNodes());
+
+    // Unpinned threads report the first node.
+    EXPECT_EQ(Numa::currentNode(), 0u);
+}
+
+
+TEST(Numa, PoolRelease)
+{
+    using DimId = pdal::Dimension::Id;
+    using DimType = pdal::Dimension::Type;
+
+    const Schema schema(DimList {
+        DimInfo("X", DimId::X, DimType::Double),
+        DimInfo("Y", DimId::Y, DimType::Double),
+        DimInfo("Z", DimId::Z, DimType::Double)
+    });
+
+    const std::vector<std::shared_ptr<PointPool>> pools {
+        std::make_shared<PointPool>(schema, nullptr, 64),
+        std::make_shared<PointPool>(schema, nullptr, 64)
+    };
+
+    PointPool& a(*pools[0]);
+    PointPool& b(*pools[1]);
+
+    // A chunk whose pool is that of node A, holding points allocated on node
+    // B, and a cell from A whose data came from both.
+    Cell::PooledStack cells(a.cellPool());
+
+    for (std::size_t i(0); i < 200; ++i)
+    {
+        Cell::PooledNode cell(b.cellPool().acquireOne());
+        cell->set(Point(i, i, i), b.dataPool().acquireOne());
+        cells.push(std::move(cell));
+    }
+
+    {
+        Cell::PooledNode cell(a.cellPool().acquireOne());
+        cell->set(Point(-1, -1, -1), a.dataPool().acquireOne());
+        cell->push(b.dataPool().acquireOne());
+        cells.push(std::move(cell));
+    }
+
+    EXPECT_GE(b.cellPool().allocated(), 200u);
+    EXPECT_GE(b.dataPool().allocated(), 201u);
+    EXPECT_LE(b.dataPool().available(), b.dataPool().allocated() - 201);
+
+    PointPool::release(pools, std::move(cells));
+
+    // Every node is back where it came from, so no pool holds more than it
+    // allocated, and none is left short.
+    for (const auto& p : pools)
+    {
+        EXPECT_EQ(p->cellPool().available(), p->cellPool().allocated());
+        EXPECT_EQ(p->dataPool().available(), p->dataPool().allocated());
+    }
+}
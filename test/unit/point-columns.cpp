@@ -0,0 +1,161 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <entwine/types/point-columns.hpp>
+#include <entwine/types/point-pool.hpp>
+#include <entwine/types/schema.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using DimId = pdal::Dimension::Id;
+    using DimType = pdal::Dimension::Type;
+
+    // XYZ of type T, followed by other dimensions so that the records are
+    // strided.  A Schema always places XYZ first.
+    template<typename T>
+    struct Layout
+    {
+        struct Record
+        {
+            T x;
+            T y;
+            T z;
+            uint16_t intensity;
+            uint8_t classification;
+        };
+
+        static Schema schema(DimType type)
+        {
+            return Schema(DimList {
+                DimInfo("Intensity", DimId::Intensity, DimType::Unsigned16),
+                DimInfo("X", DimId::X, type),
+                DimInfo("Y", DimId::Y, type),
+                DimInfo("Z", DimId::Z, type),
+                DimInfo(
+                        "Classification",
+                        DimId::Classification,
+                        DimType::Unsigned8)
+            });
+        }
+
+        // Packed records, without the struct's padding.
+        static std::vector<char> pack(const std::vector<Record>& records)
+        {
+            const std::size_t pointSize(2 + 3 * sizeof(T) + 1);
+            std::vector<char> data(records.size() * pointSize);
+            char* pos(data.data());
+
+            for (const Record& r : records)
+            {
+                std::memcpy(pos, &r.x, sizeof(T));
+                std::memcpy(pos + sizeof(T), &r.y, sizeof(T));
+                std::memcpy(pos + 2 * sizeof(T), &r.z, sizeof(T));
+                std::memcpy(pos + 3 * sizeof(T), &r.intensity, 2);
+                std::memcpy(pos + 3 * sizeof(T) + 2, &r.classification, 1);
+                pos += pointSize;
+            }
+
+            return data;
+        }
+
+        static void check(DimType type)
+        {
+            const Schema s(schema(type));
+
+            std::vector<Record> records;
+            for (int i(0); i < 100; ++i)
+            {
+                records.push_back(Record {
+                    static_cast<T>(i),
+                    static_cast<T>(i + 1),
+                    static_cast<T>(i + 2),
+                    static_cast<uint16_t>(i),
+                    static_cast<uint8_t>(i) });
+            }
+
+            const std::vector<char> data(pack(records));
+
+            PointColumns columns(s);
+            columns.append(data.data(), records.size());
+
+            ASSERT_EQ(columns.size(), records.size());
+            ASSERT_EQ(columns.pointSize(), s.pointSize());
+            EXPECT_EQ(columns.records(), data);
+
+            for (std::size_t i(0); i < records.size(); ++i)
+            {
+                const Record& r(records[i]);
+                EXPECT_EQ(columns.point(i), Point(r.x, r.y, r.z));
+                EXPECT_EQ(
+                        std::memcmp(
+                            columns.record(i),
+                            data.data() + i * s.pointSize(),
+                            s.pointSize()),
+                        0);
+            }
+
+            // Pooled cells, in slot order.
+            PointPool pool(s);
+            Cell::PooledStack cells(columns.cells(pool));
+            ASSERT_EQ(cells.size(), records.size());
+
+            std::size_t i(0);
+            for (const Cell& cell : cells)
+            {
+                EXPECT_EQ(cell.point(), columns.point(i));
+                EXPECT_EQ(
+                        std::memcmp(
+                            cell.uniqueData(),
+                            columns.record(i),
+                            s.pointSize()),
+                        0);
+                ++i;
+            }
+
+            pool.release(std::move(cells));
+        }
+    };
+}
+
+TEST(PointColumns, Types)
+{
+    Layout<int8_t>::check(DimType::Signed8);
+    Layout<int16_t>::check(DimType::Signed16);
+    Layout<int32_t>::check(DimType::Signed32);
+    Layout<int64_t>::check(DimType::Signed64);
+    Layout<uint8_t>::check(DimType::Unsigned8);
+    Layout<uint16_t>::check(DimType::Unsigned16);
+    Layout<uint32_t>::check(DimType::Unsigned32);
+    Layout<uint64_t>::check(DimType::Unsigned64);
+    Layout<float>::check(DimType::Float);
+    Layout<double>::check(DimType::Double);
+}
+
+TEST(PointColumns, Coordinates)
+{
+    const Schema s(Layout<int32_t>::schema(DimType::Signed32));
+    const std::vector<char> data(Layout<int32_t>::pack({ { 2, 3, 4, 1, 5 } }));
+
+    PointColumns columns(s);
+    columns.appendCoordinates(data.data(), 1);
+
+    EXPECT_EQ(columns.size(), 1u);
+    EXPECT_EQ(columns.point(0), Point(2, 3, 4));
+    EXPECT_TRUE(columns.records().empty());
+}
+
+TEST(PointColumns, MissingDimension)
+{
+    const Schema s(DimList {
+        DimInfo("X", DimId::X, DimType::Double),
+        DimInfo("Y", DimId::Y, DimType::Double)
+    });
+
+    EXPECT_THROW(PointColumns columns(s), std::runtime_error);
+}
@@ -0,0 +1,140 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <entwine/util/pool.hpp>
+
+using namespace entwine;
+
+TEST(Pool, Basic)
+{
+    std::atomic<std::size_t> count(0);
+
+    Pool pool(4);
+    for (std::size_t i(0); i < 10000; ++i) pool.add([&count]() { ++count; });
+    pool.join();
+
+    EXPECT_EQ(count.load(), 10000u);
+    EXPECT_TRUE(pool.errors().empty());
+    EXPECT_THROW(pool.add([]() { }), std::runtime_error);
+}
+
+TEST(Pool, NestedGroups)
+{
+    std::atomic<std::size_t> count(0);
+
+    // More outer tasks than threads, each of which waits on inner tasks.  A
+    // blocking wait here would deadlock, so workers must help while waiting.
+    Pool pool(2, 1);
+    TaskGroup outer;
+
+    for (std::size_t i(0); i < 64; ++i)
+    {
+        pool.add(outer, [&pool, &count]()
+        {
+            TaskGroup inner;
+            for (std::size_t j(0); j < 16; ++j)
+            {
+                pool.add(inner, [&count]() { ++count; });
+            }
+            inner.wait();
+        });
+    }
+
+    outer.wait();
+    EXPECT_EQ(count.load(), 64u * 16u);
+    EXPECT_EQ(outer.outstanding(), 0u);
+}
+
+TEST(Pool, Errors)
+{
+    Pool pool(2);
+    TaskGroup group;
+
+    pool.add(group, []() { throw std::runtime_error("Task failure"); });
+    pool.add([]() { });
+    group.wait();
+
+    ASSERT_EQ(group.errors().size(), 1u);
+    EXPECT_EQ(group.errors().front(), "Task failure");
+
+    pool.await();
+    EXPECT_EQ(pool.errors().size(), 1u);
+}
+
+TEST(Pool, Resize)
+{
+    std::atomic<std::size_t> count(0);
+
+    Pool pool(1);
+    pool.resize(3);
+    EXPECT_EQ(pool.size(), 3u);
+
+    for (std::size_t i(0); i < 100; ++i) pool.add([&count]() { ++count; });
+    pool.cycle();
+
+    EXPECT_EQ(count.load(), 100u);
+    EXPECT_TRUE(pool.running());
+}
+
+TEST(Pool, BoundedProducers)
+{
+    // One worker, held up until we release it, so that every producer fills
+    // the queue up to its bound and then blocks.
+    const std::size_t maxPending(2);
+    Scheduler scheduler(1);
+    scheduler.start();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool open(false);
+
+    scheduler.add([&]()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&open]() { return open; });
+    });
+
+    while (scheduler.pending()) std::this_thread::yield();
+
+    std::atomic<std::size_t> count(0);
+    std::atomic<std::size_t> added(0);
+    std::vector<std::thread> producers;
+
+    for (std::size_t i(0); i < 8; ++i)
+    {
+        producers.emplace_back([&]()
+        {
+            for (std::size_t j(0); j < 10; ++j)
+            {
+                scheduler.add([&count]() { ++count; }, nullptr, maxPending);
+                ++added;
+            }
+        });
+    }
+
+    // While the worker is held, producers may only fill the queue.
+    for (std::size_t i(0); i < 2000; ++i)
+    {
+        EXPECT_LE(scheduler.pending(), maxPending);
+        std::this_thread::yield();
+    }
+
+    EXPECT_LE(added.load(), maxPending);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = true;
+    }
+    cv.notify_all();
+
+    for (auto& t : producers) t.join();
+    scheduler.await();
+
+    EXPECT_EQ(count.load(), 80u);
+}
@@ -0,0 +1,42 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+
+#include <entwine/reader/prefetch-depth.hpp>
+
+using namespace entwine;
+
+TEST(PrefetchDepth, Initial)
+{
+    const PrefetchDepth depth(8, 2);
+    EXPECT_EQ(depth.get(), 2u);
+    EXPECT_EQ(depth.max(), 8u);
+
+    EXPECT_EQ(PrefetchDepth(4, 10).get(), 4u);
+    EXPECT_EQ(PrefetchDepth(4, 0).get(), 1u);
+}
+
+TEST(PrefetchDepth, Adapts)
+{
+    PrefetchDepth depth(8, 2);
+
+    // Fetches take three times as long as processing.
+    for (std::size_t i(0); i < 20; ++i)
+    {
+        depth.fetched(0.3);
+        depth.processed(0.1);
+    }
+    EXPECT_EQ(depth.get(), 3u);
+
+    // Fetches are now cached, so they complete immediately.
+    for (std::size_t i(0); i < 50; ++i) depth.fetched(0);
+    EXPECT_EQ(depth.get(), 1u);
+
+    // Very slow fetches are limited to the maximum.
+    for (std::size_t i(0); i < 50; ++i) depth.fetched(100);
+    EXPECT_EQ(depth.get(), 8u);
+
+    // As is processing that takes no measurable time.
+    for (std::size_t i(0); i < 50; ++i) depth.processed(0);
+    EXPECT_EQ(depth.get(), 8u);
+}
@@ -0,0 +1,116 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <entwine/types/bounds.hpp>
+#ifdef ENTWINE_HAVE_ZSTD
+#include <entwine/types/chunk-storage/zstd.hpp>
+#endif
+#include <entwine/types/projection.hpp>
+#include <entwine/types/schema.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using DimId = pdal::Dimension::Id;
+    using DimType = pdal::Dimension::Type;
+
+    const Schema native(DimList {
+        DimInfo("X", DimId::X, DimType::Signed32),
+        DimInfo("Y", DimId::Y, DimType::Signed32),
+        DimInfo("Z", DimId::Z, DimType::Signed32),
+        DimInfo("Intensity", DimId::Intensity, DimType::Unsigned16),
+        DimInfo("Classification", DimId::Classification, DimType::Unsigned8),
+        DimInfo("GpsTime", DimId::GpsTime, DimType::Double)
+    });
+
+    std::vector<char> records(const std::size_t numPoints)
+    {
+        std::vector<char> data(numPoints * native.pointSize());
+        char* pos(data.data());
+
+        for (std::size_t i(0); i < numPoints; ++i)
+        {
+            const int32_t xyz[3] = {
+                static_cast<int32_t>(i),
+                static_cast<int32_t>(i * 3),
+                static_cast<int32_t>(i % 17)
+            };
+            const uint16_t intensity(i * 11);
+            const uint8_t classification(i % 5);
+            const double time(42.0 + i * 0.001);
+
+            std::memcpy(pos, xyz, sizeof(xyz)); pos += sizeof(xyz);
+            std::memcpy(pos, &intensity, 2); pos += 2;
+            std::memcpy(pos, &classification, 1); pos += 1;
+            std::memcpy(pos, &time, 8); pos += 8;
+        }
+
+        return data;
+    }
+}
+
+TEST(Projection, Layout)
+{
+    const Projection p(native, std::set<std::string>{ "Classification" });
+
+    EXPECT_FALSE(p.full());
+    EXPECT_TRUE(p.contains("X"));
+    EXPECT_TRUE(p.contains("Y"));
+    EXPECT_TRUE(p.contains("Z"));
+    EXPECT_TRUE(p.contains("Classification"));
+    EXPECT_FALSE(p.contains("Intensity"));
+    EXPECT_FALSE(p.contains("GpsTime"));
+    EXPECT_EQ(p.schema().pointSize(), 13u);
+
+    const std::set<std::string> all{ "Intensity", "Classification", "GpsTime" };
+    EXPECT_TRUE(Projection(native, all).full());
+}
+
+TEST(Projection, Apply)
+{
+    const std::size_t numPoints(1000);
+    const std::vector<char> data(records(numPoints));
+
+    const Projection p(native, std::set<std::string>{ "GpsTime" });
+    const std::vector<char> projected(p.apply(data.data(), numPoints));
+
+    const std::size_t nativeSize(native.pointSize());
+    const std::size_t pointSize(p.schema().pointSize());
+    ASSERT_EQ(projected.size(), numPoints * pointSize);
+
+    for (std::size_t i(0); i < numPoints; ++i)
+    {
+        const char* in(data.data() + i * nativeSize);
+        const char* out(projected.data() + i * pointSize);
+
+        ASSERT_EQ(std::memcmp(in, out, 12), 0);
+        ASSERT_EQ(std::memcmp(in + 15, out + 12, 8), 0);
+    }
+}
+
+#ifdef ENTWINE_HAVE_ZSTD
+TEST(Projection, Zstd)
+{
+    const std::size_t numPoints(1000);
+    const std::vector<char> data(records(numPoints));
+    const Bounds bounds(Point(0, 0, 0), Point(4096, 4096, 4096));
+
+    const std::vector<char> packed(
+            ZstdStorage::pack(native, bounds, data.data(), numPoints));
+
+    for (const std::string name : { "Intensity", "Classification", "GpsTime" })
+    {
+        const Projection p(native, std::set<std::string>{ name });
+
+        EXPECT_EQ(
+                ZstdStorage::unpack(p, packed.data(), packed.size()),
+                p.apply(data.data(), numPoints));
+    }
+}
+#endif
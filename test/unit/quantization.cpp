@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/quantization.hpp>
+#include <entwine/types/schema.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using DimId = pdal::Dimension::Id;
+    using DimType = pdal::Dimension::Type;
+
+    const Schema native(DimList {
+        DimInfo("X", DimId::X, DimType::Signed32),
+        DimInfo("Y", DimId::Y, DimType::Signed32),
+        DimInfo("Z", DimId::Z, DimType::Signed32),
+        DimInfo("Intensity", DimId::Intensity, DimType::Unsigned16)
+    });
+
+    // Points spread over a cube at the given origin.
+    std::vector<char> records(
+            const std::size_t numPoints,
+            const int32_t origin,
+            const int32_t span)
+    {
+        std::vector<char> data(numPoints * native.pointSize());
+        char* pos(data.data());
+
+        for (std::size_t i(0); i < numPoints; ++i)
+        {
+            const int32_t xyz[3] = {
+                static_cast<int32_t>(origin + (i * 7) % span),
+                static_cast<int32_t>(origin + (i * 13) % span),
+                static_cast<int32_t>(origin + i % 3)
+            };
+            const uint16_t intensity(i * 11);
+
+            std::memcpy(pos, xyz, sizeof(xyz)); pos += sizeof(xyz);
+            std::memcpy(pos, &intensity, 2); pos += 2;
+        }
+
+        return data;
+    }
+}
+
+TEST(Quantization, RoundTrip)
+{
+    const std::size_t numPoints(1000);
+    const int32_t origin(-123456);
+    const std::vector<char> data(records(numPoints, origin, 4000));
+    const Bounds bounds(
+            Point(origin, origin, origin),
+            Point(origin + 4096, origin + 4096, origin + 4096));
+
+    const Quantization q(native, bounds, data.data(), numPoints);
+    ASSERT_FALSE(q.empty());
+
+    // X and Y need two bytes, and Z only one.
+    const Schema schema(q.schema(native));
+    EXPECT_EQ(schema.pointSize(), 2u + 2u + 1u + 2u);
+
+    const std::vector<char> encoded(q.encode(native, data.data(), numPoints));
+    ASSERT_EQ(encoded.size(), numPoints * schema.pointSize());
+
+    std::vector<char> stored(encoded);
+    q.append(stored);
+    EXPECT_EQ(stored.size(), encoded.size() + Quantization::footerSize);
+
+    const Quantization r(stored);
+    EXPECT_EQ(stored, encoded);
+    EXPECT_EQ(r.decode(native, stored.data(), numPoints), data);
+}
+
+TEST(Quantization, Wide)
+{
+    // Offsets too large to narrow are stored natively.
+    const std::size_t numPoints(100);
+    const std::vector<char> data(records(numPoints, 0, 1000));
+    const double min(-(1 << 30));
+    const Bounds bounds(Point(min, min, min), Point(1000, 1000, 1000));
+
+    const Quantization q(native, bounds, data.data(), numPoints);
+    EXPECT_TRUE(q.empty());
+    EXPECT_EQ(q.schema(native).pointSize(), native.pointSize());
+
+    // Floating point coordinates aren't quantized.
+    const Schema floating(DimList {
+        DimInfo("X", DimId::X, DimType::Double),
+        DimInfo("Y", DimId::Y, DimType::Double),
+        DimInfo("Z", DimId::Z, DimType::Double)
+    });
+
+    const std::vector<char> doubles(numPoints * floating.pointSize());
+    EXPECT_TRUE(
+            Quantization(floating, bounds, doubles.data(), numPoints).empty());
+}
+
@@ -0,0 +1,281 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/tree/serializer.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/chunk-storage/chunk-storage.hpp>
+#include <entwine/types/point-pool.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/util/unique.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using DimId = pdal::Dimension::Id;
+    using DimType = pdal::Dimension::Type;
+
+    const std::string dir("entwine-test-serializer/");
+
+    void clear(const std::string& path)
+    {
+        for (const auto& f : arbiter::fs::glob(path + "*"))
+        {
+            arbiter::fs::remove(f);
+        }
+    }
+
+    std::vector<char> gathered(const std::size_t i)
+    {
+        const std::string s("chunk-" + std::to_string(i));
+        return std::vector<char>(s.begin(), s.end());
+    }
+
+    // Encodes by reversing the gathered bytes.  Puts wait until the gate is
+    // opened, and are then written synchronously to the write's endpoint.
+    class StubStages : public Serializer::Stages
+    {
+    public:
+        virtual std::unique_ptr<ChunkWrite> gather(Chunk&) const override
+        {
+            throw std::runtime_error("Writes are pushed pre-gathered");
+        }
+
+        virtual void encode(ChunkWrite& write) const override
+        {
+            std::reverse(write.data.begin(), write.data.end());
+            ++m_encoded;
+        }
+
+        virtual void put(ChunkWrite& write) const override
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return m_open; });
+            }
+
+            // Keep puts in progress while the test awaits them.
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            write.out.put(write.id.str(), write.data);
+            ++m_puts;
+        }
+
+        virtual bool putAsync(
+                ChunkWrite&,
+                std::function<void(bool)>) const override
+        {
+            return false;
+        }
+
+        void open()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_open = true;
+            }
+
+            m_cv.notify_all();
+        }
+
+        std::size_t encoded() const { return m_encoded; }
+        std::size_t puts() const { return m_puts; }
+
+    private:
+        mutable std::atomic<std::size_t> m_encoded = { 0 };
+        mutable std::atomic<std::size_t> m_puts = { 0 };
+
+        mutable std::mutex m_mutex;
+        mutable std::condition_variable m_cv;
+        bool m_open = false;
+    };
+
+    // Odd chunks fail to be written, and even ones are written through a
+    // failed asynchronous put, so they are retried with a blocking put.
+    class FailingStages : public Serializer::Stages
+    {
+    public:
+        virtual std::unique_ptr<ChunkWrite> gather(Chunk&) const override
+        {
+            throw std::runtime_error("Writes are pushed pre-gathered");
+        }
+
+        virtual void encode(ChunkWrite&) const override { }
+
+        virtual void put(ChunkWrite& write) const override
+        {
+            if (write.id.getSimple() % 2)
+            {
+                throw std::runtime_error("Failed " + write.id.str());
+            }
+
+            write.out.put(write.id.str(), write.data);
+        }
+
+        virtual bool putAsync(
+                ChunkWrite&,
+                std::function<void(bool)> done) const override
+        {
+            done(false);
+            return true;
+        }
+    };
+
+    std::shared_ptr<ChunkWrite> makeWrite(
+            const std::size_t i,
+            const arbiter::Endpoint& out,
+            const std::vector<std::shared_ptr<PointPool>>& pools)
+    {
+        const Bounds bounds(0, 0, 0, 1, 1, 1);
+
+        auto write(
+                std::make_shared<ChunkWrite>(
+                    Id(i),
+                    bounds,
+                    ChunkType::Contiguous,
+                    out,
+                    out,
+                    *pools.front(),
+                    pools));
+        write->data = gathered(i);
+        return write;
+    }
+}
+
+TEST(Serializer, Throttle)
+{
+    arbiter::fs::mkdirp(dir);
+    clear(dir);
+
+    arbiter::Arbiter a;
+    const arbiter::Endpoint out(a.getEndpoint(dir));
+
+    const Schema schema(DimList {
+            DimInfo("X", DimId::X, DimType::Double),
+            DimInfo("Y", DimId::Y, DimType::Double),
+            DimInfo("Z", DimId::Z, DimType::Double) });
+    const std::vector<std::shared_ptr<PointPool>> pools(
+            1, std::make_shared<PointPool>(schema));
+    const Bounds bounds(0, 0, 0, 1, 1, 1);
+
+    Json::Value json;
+    json["encodeThreads"] = 1;
+    json["ioThreads"] = 1;
+    json["queueSize"] = 1;
+
+    auto stages(makeUnique<StubStages>());
+    StubStages& stub(*stages);
+    Serializer serializer(std::move(stages), 1, json);
+
+    // A chunk in each thread and each queue.
+    const std::size_t capacity(4);
+    const std::size_t numChunks(capacity * 6);
+    std::atomic<std::size_t> pushed(0);
+
+    std::thread producer([&]()
+    {
+        for (std::size_t i(0); i < numChunks; ++i)
+        {
+            serializer.throttle();
+
+            auto write(
+                    std::make_shared<ChunkWrite>(
+                        Id(i),
+                        bounds,
+                        ChunkType::Contiguous,
+                        out,
+                        out,
+                        *pools.front(),
+                        pools));
+            write->data = gathered(i);
+
+            serializer.push(write);
+            ++pushed;
+        }
+    });
+
+    // With every put held, the producer stalls once the pipeline is full.
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    EXPECT_EQ(pushed.load(), capacity);
+    EXPECT_GE(serializer.pressure(), 1.0);
+    EXPECT_EQ(stub.puts(), 0u);
+
+    stub.open();
+    producer.join();
+    EXPECT_EQ(pushed.load(), numChunks);
+
+    serializer.await();
+
+    EXPECT_EQ(stub.encoded(), numChunks);
+    EXPECT_EQ(stub.puts(), numChunks);
+    EXPECT_EQ(serializer.pressure(), 0.0);
+
+    for (std::size_t i(0); i < numChunks; ++i)
+    {
+        std::vector<char> expected(gathered(i));
+        std::reverse(expected.begin(), expected.end());
+        EXPECT_EQ(out.getBinary(Id(i).str()), expected) << i;
+    }
+
+    clear(dir);
+}
+
+TEST(Serializer, Failures)
+{
+    arbiter::fs::mkdirp(dir);
+    clear(dir);
+
+    arbiter::Arbiter a;
+    const arbiter::Endpoint out(a.getEndpoint(dir));
+
+    const Schema schema(DimList {
+            DimInfo("X", DimId::X, DimType::Double),
+            DimInfo("Y", DimId::Y, DimType::Double),
+            DimInfo("Z", DimId::Z, DimType::Double) });
+    const std::vector<std::shared_ptr<PointPool>> pools(
+            1, std::make_shared<PointPool>(schema));
+
+    const std::size_t numChunks(8);
+
+    {
+        Serializer serializer(makeUnique<FailingStages>(), 2);
+        for (std::size_t i(0); i < numChunks; ++i)
+        {
+            serializer.push(makeWrite(i, out, pools));
+        }
+
+        // Failures are reported once, by the await which follows them.
+        EXPECT_THROW(serializer.await(), std::runtime_error);
+        EXPECT_NO_THROW(serializer.await());
+        EXPECT_EQ(serializer.pressure(), 0.0);
+
+        for (std::size_t i(0); i < numChunks; ++i)
+        {
+            EXPECT_EQ(!!out.tryGetSize(Id(i).str()), i % 2 == 0) << i;
+        }
+    }
+
+    // Failures which are never awaited are logged on destruction rather than
+    // thrown from it.
+    {
+        Serializer serializer(makeUnique<FailingStages>(), 2);
+        for (std::size_t i(0); i < numChunks; ++i)
+        {
+            serializer.push(makeWrite(i, out, pools));
+        }
+    }
+
+    clear(dir);
+}
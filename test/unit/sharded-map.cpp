@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstddef>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <entwine/util/sharded-map.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::size_t numThreads(8);
+    const std::size_t perThread(5000);
+}
+
+TEST(ShardedMap, Basic)
+{
+    ShardedMap<int, int> map(16);
+    EXPECT_EQ(map.numShards(), 16u);
+    EXPECT_TRUE(map.empty());
+
+    map.get(1) = 10;
+    map.get(2) = 20;
+
+    EXPECT_EQ(map.size(), 2u);
+    EXPECT_EQ(map.at(1), 10);
+    EXPECT_EQ(*map.find(2), 20);
+    EXPECT_FALSE(map.find(3));
+    EXPECT_THROW(map.at(3), std::out_of_range);
+
+    EXPECT_EQ(map.erase(1), 1u);
+    EXPECT_EQ(map.erase(1), 0u);
+    EXPECT_EQ(map.count(1), 0u);
+    EXPECT_EQ(map.size(), 1u);
+
+    // Shard counts are rounded up to a power of two.
+    EXPECT_EQ((ShardedMap<int, int>(5).numShards()), 8u);
+}
+
+TEST(ShardedMap, ConcurrentInsertFind)
+{
+    ShardedMap<std::size_t, std::size_t> map;
+    std::vector<std::thread> threads;
+
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&map, t]()
+        {
+            for (std::size_t i(0); i < perThread; ++i)
+            {
+                const std::size_t key(t * perThread + i);
+                map.get(key) = key * 2;
+
+                // Our own entries, and their addresses, are stable while
+                // other threads insert.
+                const std::size_t* value(map.find(key));
+                ASSERT_TRUE(value);
+                EXPECT_EQ(*value, key * 2);
+                EXPECT_EQ(&map.at(key), value);
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(map.size(), numThreads * perThread);
+
+    std::set<std::size_t> keys;
+    map.forEach([&keys](const std::size_t& key, std::size_t& value)
+    {
+        EXPECT_EQ(value, key * 2);
+        keys.insert(key);
+    });
+    EXPECT_EQ(keys.size(), numThreads * perThread);
+}
+
+TEST(ShardedMap, ConcurrentErase)
+{
+    ShardedMap<std::size_t, std::size_t> map;
+    for (std::size_t i(0); i < numThreads * perThread; ++i) map.get(i) = i;
+
+    // Every thread erases the even keys and reads the odd ones, so each even
+    // key is erased exactly once in total.
+    std::atomic<std::size_t> erased(0);
+    std::vector<std::thread> threads;
+
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&map, &erased]()
+        {
+            for (std::size_t i(0); i < numThreads * perThread; ++i)
+            {
+                if (i % 2) EXPECT_EQ(map.at(i), i);
+                else erased += map.erase(i);
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(erased.load(), numThreads * perThread / 2);
+    EXPECT_EQ(map.size(), numThreads * perThread / 2);
+    EXPECT_FALSE(map.find(0));
+    EXPECT_TRUE(map.find(1));
+}
@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <entwine/util/spin-lock.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    LockSite testSite("test-spin-lock");
+
+    const std::size_t numThreads(8);
+}
+
+TEST(SpinLock, MutualExclusion)
+{
+    LockSite::enable();
+    testSite.clear();
+
+    SpinLock spinner;
+    std::atomic_size_t inside(0);
+    std::atomic_size_t maxInside(0);
+    std::size_t counter(0);
+
+    const std::size_t perThread(20000);
+    std::vector<std::thread> threads;
+
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            for (std::size_t i(0); i < perThread; ++i)
+            {
+                SpinGuard lock(spinner, testSite);
+
+                const std::size_t now(++inside);
+                std::size_t seen(maxInside.load());
+                while (
+                        now > seen &&
+                        !maxInside.compare_exchange_weak(seen, now))
+                { }
+
+                // Unprotected read-modify-write, which would lose increments
+                // without mutual exclusion.
+                const std::size_t current(counter);
+                counter = current + 1;
+
+                --inside;
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+    LockSite::enable(false);
+
+    EXPECT_EQ(counter, numThreads * perThread);
+    EXPECT_EQ(maxInside.load(), 1u);
+    EXPECT_EQ(testSite.acquisitions(), numThreads * perThread);
+    EXPECT_LE(testSite.contended(), testSite.acquisitions());
+}
+
+TEST(SpinLock, Parking)
+{
+    // Holders sleep while locked, so waiters exhaust their spinning and park.
+    SpinLock spinner;
+    std::size_t counter(0);
+    std::vector<std::thread> threads;
+
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            for (std::size_t i(0); i < 10; ++i)
+            {
+                UniqueSpin lock(spinner);
+                const std::size_t current(counter);
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                counter = current + 1;
+                lock.unlock();
+
+                lock.lock();
+                ++counter;
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(counter, numThreads * 20);
+}
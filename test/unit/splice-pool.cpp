@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <entwine/third/splice-pool/splice-pool.hpp>
+
+using Pool = splicer::ObjectPool<int>;
+
+TEST(SplicePool, MagazineAccounting)
+{
+    const std::size_t blockSize(64);
+    const std::size_t magazineSize(16);
+    Pool pool(blockSize, magazineSize);
+    EXPECT_EQ(pool.magazineSize(), magazineSize);
+
+    {
+        std::vector<Pool::UniqueNodeType> nodes;
+        for (std::size_t i(0); i < 40; ++i) nodes.push_back(pool.acquireOne());
+
+        std::set<int*> distinct;
+        for (auto& node : nodes) distinct.insert(&node.get()->val());
+        EXPECT_EQ(distinct.size(), nodes.size());
+
+        EXPECT_EQ(pool.allocated(), blockSize);
+        EXPECT_EQ(pool.used(), nodes.size());
+    }
+
+    // Released nodes are either cached or returned, and remain available.
+    EXPECT_EQ(pool.used(), 0u);
+    EXPECT_EQ(pool.available(), blockSize);
+
+    const auto stats(pool.magazineStats());
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_EQ(stats[0].hits + stats[0].misses, 40u);
+    EXPECT_GT(stats[0].hitRate(), 0.5);
+    EXPECT_LE(stats[0].cached, magazineSize);
+
+    pool.flush();
+    EXPECT_EQ(pool.magazineStats()[0].cached, 0u);
+    EXPECT_EQ(pool.available(), blockSize);
+
+    // Small stacks go through the magazine, large ones bypass it.
+    {
+        auto small(pool.acquire(magazineSize));
+        auto large(pool.acquire(blockSize));
+        EXPECT_EQ(small.size(), magazineSize);
+        EXPECT_EQ(large.size(), blockSize);
+        EXPECT_EQ(pool.used(), magazineSize + blockSize);
+    }
+
+    EXPECT_EQ(pool.used(), 0u);
+}
+
+TEST(SplicePool, Disabled)
+{
+    Pool pool(64, 0);
+    EXPECT_TRUE(pool.magazineStats().empty());
+
+    {
+        auto a(pool.acquireOne(42));
+        auto b(pool.acquire(10));
+        EXPECT_EQ(*a, 42);
+        EXPECT_EQ(pool.used(), 11u);
+    }
+
+    EXPECT_EQ(pool.used(), 0u);
+    EXPECT_TRUE(pool.magazineStats().empty());
+}
+
+TEST(SplicePool, DisabledByDefault)
+{
+    const std::size_t blockSize(64);
+    Pool pool(blockSize);
+    EXPECT_EQ(pool.magazineSize(), 0u);
+
+    {
+        auto a(pool.acquireOne(1));
+        auto b(pool.acquire(blockSize));
+        EXPECT_EQ(pool.allocated(), 2 * blockSize);
+        EXPECT_EQ(pool.available(), blockSize - 1);
+        EXPECT_EQ(pool.used(), blockSize + 1);
+
+        b.reset();
+        EXPECT_EQ(pool.available(), 2 * blockSize - 1);
+    }
+
+    EXPECT_EQ(pool.available(), pool.allocated());
+    EXPECT_TRUE(pool.magazineStats().empty());
+
+    splicer::BufferPool<char> buffers(8, blockSize);
+    EXPECT_EQ(buffers.magazineSize(), 0u);
+}
+
+TEST(SplicePool, Threads)
+{
+    const std::size_t numThreads(4);
+    const std::size_t iterations(20000);
+    Pool pool(256, 32);
+    std::atomic<std::size_t> errors(0);
+
+    std::vector<std::thread> threads;
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&pool, &errors, t, iterations]()
+        {
+            std::vector<Pool::UniqueNodeType> held;
+            const int value(static_cast<int>(t));
+
+            for (std::size_t i(0); i < iterations; ++i)
+            {
+                held.push_back(pool.acquireOne(value));
+                if (held.size() > 48)
+                {
+                    for (auto& node : held) if (*node != value) ++errors;
+                    held.clear();
+                }
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(errors.load(), 0u);
+    EXPECT_EQ(pool.used(), 0u);
+
+    std::size_t total(0);
+    for (const auto& s : pool.magazineStats()) total += s.hits + s.misses;
+    EXPECT_EQ(total, numThreads * iterations);
+    EXPECT_EQ(pool.available(), pool.allocated());
+}
@@ -0,0 +1,272 @@
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <entwine/types/point.hpp>
+#include <entwine/types/point-pool.hpp>
+#include <entwine/types/tube.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::size_t pointSize(8);
+    const Point center(0, 0, 0);
+
+    class TubeTest : public ::testing::Test
+    {
+    protected:
+        TubeTest() : m_dataPool(pointSize, 64), m_cellPool(64) { }
+
+        Cell::PooledNode cell(const Point& p)
+        {
+            Cell::PooledNode node(m_cellPool.acquireOne());
+            node->set(p, m_dataPool.acquireOne());
+            return node;
+        }
+
+        void release(Cell::PooledNode&& node)
+        {
+            Data::PooledStack data(m_dataPool);
+            data.push(node->acquire());
+            node.reset();
+        }
+
+        // Empty the tube, returning the data of its cells to our pool.
+        void release(Tube& tube)
+        {
+            Cell::PooledStack cells(m_cellPool);
+            tube.acquire(cells);
+
+            Data::PooledStack data(m_dataPool);
+            for (auto& c : cells) data.push(c.acquire());
+        }
+
+        Data::Pool m_dataPool;
+        Cell::Pool m_cellPool;
+    };
+}
+
+TEST_F(TubeTest, Insert)
+{
+    Tube tube;
+    EXPECT_TRUE(tube.empty());
+
+    Cell::PooledNode c(cell(Point(1, 1, 1)));
+    const Tube::Insertion result(tube.insert(3, center, pointSize, c));
+
+    EXPECT_TRUE(result.done());
+    EXPECT_EQ(result.delta(), 1);
+    EXPECT_FALSE(tube.empty());
+
+    release(tube);
+    EXPECT_TRUE(tube.empty());
+}
+
+TEST_F(TubeTest, Collision)
+{
+    Tube tube;
+    const Point near(1, 1, 1);
+    const Point far(5, 5, 5);
+
+    // The same point is merged into the existing cell.
+    {
+        Cell::PooledNode a(cell(near));
+        Cell::PooledNode b(cell(near));
+        EXPECT_TRUE(tube.insert(0, center, pointSize, a).done());
+
+        const Tube::Insertion result(tube.insert(0, center, pointSize, b));
+        EXPECT_TRUE(result.done());
+        EXPECT_EQ(result.delta(), 1);
+        EXPECT_EQ(tube.begin()->second->size(), 2u);
+    }
+
+    // A farther point is handed back.
+    {
+        Cell::PooledNode c(cell(far));
+        const Tube::Insertion result(tube.insert(0, center, pointSize, c));
+        EXPECT_FALSE(result.done());
+        EXPECT_EQ(c->point(), far);
+        release(std::move(c));
+    }
+
+    release(tube);
+
+    // A nearer point displaces the existing cell, which is handed back.
+    {
+        Cell::PooledNode a(cell(far));
+        Cell::PooledNode b(cell(near));
+        EXPECT_TRUE(tube.insert(0, center, pointSize, a).done());
+
+        const Tube::Insertion result(tube.insert(0, center, pointSize, b));
+        EXPECT_FALSE(result.done());
+        EXPECT_EQ(result.delta(), 0);
+        EXPECT_EQ(b->point(), far);
+        EXPECT_EQ(tube.begin()->second->point(), near);
+        release(std::move(b));
+    }
+
+    release(tube);
+}
+
+TEST_F(TubeTest, Residents)
+{
+    Tube tube;
+    TubeColumns columns(1);
+    const Tube::Residents residents(columns.at(0));
+
+    const Point near(1, 1, 1);
+    const Point far(5, 5, 5);
+    const Point farther(9, 9, 9);
+
+    // Claiming a slot records its point.
+    {
+        Cell::PooledNode a(cell(far));
+        EXPECT_TRUE(tube.insert(0, center, pointSize, a, residents).done());
+        EXPECT_EQ(residents.get(0), far);
+    }
+
+    // A displaced cell is replaced in the columns by the one displacing it.
+    {
+        Cell::PooledNode b(cell(near));
+        EXPECT_FALSE(tube.insert(0, center, pointSize, b, residents).done());
+        EXPECT_EQ(b->point(), far);
+        EXPECT_EQ(residents.get(0), near);
+        release(std::move(b));
+    }
+
+    // A rejected cell leaves them alone, and the same point is merged.
+    {
+        Cell::PooledNode c(cell(farther));
+        EXPECT_FALSE(tube.insert(0, center, pointSize, c, residents).done());
+        EXPECT_EQ(residents.get(0), near);
+        release(std::move(c));
+
+        Cell::PooledNode d(cell(near));
+        EXPECT_TRUE(tube.insert(0, center, pointSize, d, residents).done());
+        EXPECT_EQ(tube.begin()->second->size(), 2u);
+    }
+
+    // Each inline slot has its own resident, and overflowed ticks have none.
+    for (uint64_t tick(1); tick < 2 * Tube::inlineSlots(); ++tick)
+    {
+        const Point p(tick, tick, tick);
+        Cell::PooledNode e(cell(p));
+        EXPECT_TRUE(tube.insert(tick, center, pointSize, e, residents).done());
+        if (tick < Tube::inlineSlots())
+        {
+            EXPECT_EQ(residents.get(tick), p);
+        }
+    }
+
+    EXPECT_EQ(residents.get(0), near);
+
+    for (const auto& p : tube)
+    {
+        if (p.first < Tube::inlineSlots())
+        {
+            EXPECT_EQ(residents.get(p.first), p.second->point());
+        }
+    }
+
+    release(tube);
+}
+
+TEST_F(TubeTest, IterationOrder)
+{
+    Tube tube;
+
+    // More ticks than there are inline slots, so some spill into overflow,
+    // inserted out of order.
+    const std::vector<uint64_t> ticks { 7, 2, 9, 0, 4 };
+    ASSERT_GT(ticks.size(), Tube::inlineSlots());
+
+    for (const uint64_t tick : ticks)
+    {
+        Cell::PooledNode c(cell(Point(tick, tick, tick)));
+        EXPECT_TRUE(tube.insert(tick, center, pointSize, c).done());
+    }
+
+    std::vector<uint64_t> seen;
+    for (const auto& p : tube)
+    {
+        seen.push_back(p.first);
+        EXPECT_EQ(p.second->point(), Point(p.first, p.first, p.first));
+    }
+
+    EXPECT_EQ(seen, (std::vector<uint64_t> { 0, 2, 4, 7, 9 }));
+
+    release(tube);
+    EXPECT_TRUE(tube.begin() == tube.end());
+}
+
+TEST_F(TubeTest, Concurrent)
+{
+    Tube tube;
+    TubeColumns columns(1);
+    const Tube::Residents residents(columns.at(0));
+    const std::size_t numThreads(8);
+    const std::size_t perThread(500);
+    const uint64_t numTicks(4);
+
+    std::vector<std::vector<Cell::PooledNode>> cells(numThreads);
+    for (auto& v : cells)
+    {
+        for (std::size_t i(0); i < perThread; ++i)
+        {
+            const uint64_t tick(i % numTicks);
+            v.push_back(cell(Point(tick, tick, tick)));
+        }
+    }
+
+    std::vector<std::thread> threads;
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&tube, &cells, &residents, t, numTicks]()
+        {
+            for (std::size_t i(0); i < cells[t].size(); ++i)
+            {
+                const uint64_t tick(i % numTicks);
+                EXPECT_TRUE(
+                        tube.insert(
+                            tick,
+                            center,
+                            pointSize,
+                            cells[t][i],
+                            residents).done());
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    // Every point landed in the cell for its tick.
+    std::size_t total(0);
+    uint64_t expected(0);
+    for (const auto& p : tube)
+    {
+        EXPECT_EQ(p.first, expected++);
+        EXPECT_EQ(p.second->size(), numThreads * perThread / numTicks);
+        total += p.second->size();
+    }
+
+    // Whichever ticks claimed the inline slots have their points resident.
+    std::set<double> resident;
+    for (std::size_t slot(0); slot < Tube::inlineSlots(); ++slot)
+    {
+        const Point p(residents.get(slot));
+        EXPECT_EQ(p, Point(p.x, p.x, p.x));
+        EXPECT_LT(p.x, numTicks);
+        resident.insert(p.x);
+    }
+
+    EXPECT_EQ(resident.size(), Tube::inlineSlots());
+
+    EXPECT_EQ(total, numThreads * perThread);
+
+    release(tube);
+}
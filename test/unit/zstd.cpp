@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/chunk-storage/zstd.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/util/compression.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using DimId = pdal::Dimension::Id;
+    using DimType = pdal::Dimension::Type;
+
+    std::vector<char> random(const std::size_t size)
+    {
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int> byte(0, 255);
+
+        std::vector<char> data(size);
+        for (char& c : data) c = static_cast<char>(byte(gen));
+        return data;
+    }
+}
+
+TEST(Zstd, Frames)
+{
+    const std::vector<char> data(random(100000));
+
+    auto compressed(Compression::compressZstd(data));
+    EXPECT_EQ(*Compression::decompressZstd(*compressed), data);
+
+    std::vector<char> out(data.size() - 1);
+    EXPECT_THROW(
+            Compression::decompressZstd(
+                compressed->data(),
+                compressed->size(),
+                out.data(),
+                out.size()),
+            std::runtime_error);
+}
+
+TEST(Zstd, Columns)
+{
+    const Schema schema(DimList {
+        DimInfo("X", DimId::X, DimType::Signed32),
+        DimInfo("Y", DimId::Y, DimType::Signed64),
+        DimInfo("Z", DimId::Z, DimType::Double),
+        DimInfo("Intensity", DimId::Intensity, DimType::Unsigned16),
+        DimInfo("Classification", DimId::Classification, DimType::Unsigned8)
+    });
+
+    // Bounds which don't contain the points must still round trip.
+    const Bounds bounds(-1000.5, -50, 0, 1000, 2000, 3000);
+    const Bounds wrong(1e9, 1e9, 1e9, 2e9, 2e9, 2e9);
+
+    for (const std::size_t numPoints : { 0u, 1u, 1000u })
+    {
+        const std::vector<char> data(random(numPoints * schema.pointSize()));
+
+        for (const Bounds& b : { bounds, wrong })
+        {
+            const std::vector<char> packed(
+                    ZstdStorage::pack(schema, b, data.data(), numPoints));
+
+            EXPECT_EQ(
+                    ZstdStorage::unpack(schema, packed.data(), packed.size()),
+                    data);
+        }
+    }
+
+    const std::vector<char> tiny(8);
+    EXPECT_THROW(
+            ZstdStorage::unpack(schema, tiny.data(), tiny.size()),
+            std::runtime_error);
+}